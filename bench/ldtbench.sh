@@ -0,0 +1,236 @@
+#!/bin/bash
+#
+# ldtbench.sh - reproducible throughput / latency benchmark for ldt
+#
+# Creates two network namespaces joined by a veth pair, sets up a
+# client and a server ldt device for each tunnel type and drives
+# traffic through the tunnel with ldtperf. Everything runs on the
+# local host, no external network is needed.
+#
+# The result is written as JSON lines, one object per run, e.g.:
+# {"tun":"dccp","proto":"udp","size":64,"rate":0,"sys_cpu_ns_per_pkt":..,
+#  "gen":{...},"sink":{...}}
+# Compare two runs e.g. with:
+# jq -s 'map({tun,proto,size,pps:.sink.pps,p99:.sink.lat_p99_us})' a.json
+#
+
+PROG="$(basename "$0")"
+X="$(cd "$(dirname "$0")" && pwd -P)"
+
+TUNS="none dccp mpdccp"
+PROTOS="udp tcp"
+SIZES="64 512 1200"
+DURATION=10
+RATE=0
+OUT=""
+KMOD="$X/../ldt-kmod/ldt.ko"
+LDT="$X/../ldt-tool/tool/ldt"
+PERF="$X/ldtperf"
+KEEP=no
+
+NS_S=ldtb-srv
+NS_C=ldtb-cli
+OUTER_S=10.201.0.1
+OUTER_C=10.201.0.2
+INNER_S=10.202.0.1
+INNER_C=10.202.0.2
+TUNPORT=4711
+PERFPORT=5201
+
+
+usage ()
+{
+	cat << .
+$PROG: usage: $PROG [<options>]
+  options are:
+    -h             - this help screen
+    -T <types>     - tunnel types to test (default: "$TUNS")
+                     none = plain veth without tunnel (baseline)
+    -P <protos>    - traffic to generate: udp, tcp (default: "$PROTOS")
+    -s <sizes>     - payload sizes in bytes (default: "$SIZES")
+    -d <sec>       - duration of each run (default: $DURATION)
+    -r <pps>       - packet rate, 0 = unlimited (default: $RATE)
+    -o <file>      - write results to file (default: stdout)
+    -k <ldt.ko>    - kernel module to load if ldt is not loaded yet
+                     (default: ../ldt-kmod/ldt.ko)
+    -t <ldt>       - ldt tool to use (default: ../ldt-tool/tool/ldt)
+    -K             - keep namespaces after the run (for debugging)
+.
+}
+
+
+SOPTS="hT:P:s:d:r:o:k:t:K"
+if test "$(which getopt)"; then
+	TEMP="$(getopt -o "$SOPTS" -n "$PROG" -- "$@")"
+	if test $? != 0; then
+		echo "$PROG: Terminating..." >&2
+		exit 1
+	fi
+	eval set -- "$TEMP"
+fi
+
+while test "$1"; do
+	case "$1" in
+	-h) usage; exit 0 ;;
+	-T) TUNS="$2"; shift ;;
+	-P) PROTOS="$2"; shift ;;
+	-s) SIZES="$2"; shift ;;
+	-d) DURATION="$2"; shift ;;
+	-r) RATE="$2"; shift ;;
+	-o) OUT="$2"; shift ;;
+	-k) KMOD="$2"; shift ;;
+	-t) LDT="$2"; shift ;;
+	-K) KEEP=yes ;;
+	--) ;;
+	esac
+	shift
+done
+
+
+die ()
+{
+	echo "$PROG: $*" >&2
+	exit 1
+}
+
+log ()
+{
+	echo "$PROG: $*" >&2
+}
+
+nss () { ip netns exec $NS_S "$@"; }
+nsc () { ip netns exec $NS_C "$@"; }
+
+cleanup ()
+{
+	test "$KEEP" = yes && return
+	ip netns del $NS_S 2>/dev/null
+	ip netns del $NS_C 2>/dev/null
+	test "$WORK" && rm -rf "$WORK"
+}
+
+# busy jiffies of all cpus (user nice system irq softirq steal)
+cpubusy ()
+{
+	awk '/^cpu / { print $2+$3+$4+$7+$8+$9; exit }' /proc/stat
+}
+
+
+test "$(id -u)" = 0 || die "must be run as root"
+test -x "$PERF" || make -C "$X" ldtperf >&2 || die "cannot build ldtperf"
+test -x "$LDT" || die "ldt tool not found at $LDT (-t)"
+
+if test "$(echo $TUNS | sed -e 's/\<none\>//g')" && \
+			! grep -qw '^ldt' /proc/modules; then
+	modprobe -q dccp_ipv4
+	modprobe -q dccp_ipv6
+	if test -e "$KMOD"; then
+		insmod "$KMOD" || die "cannot load $KMOD"
+	else
+		modprobe ldt || die "cannot load ldt module"
+	fi
+fi
+
+WORK="$(mktemp -d)"
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+# the ldt tool logs to the current directory
+cd "$WORK" || die "cannot cd to $WORK"
+test "$OUT" && { test "${OUT:0:1}" = / || OUT="$OLDPWD/$OUT"; : > "$OUT"; }
+
+ip netns del $NS_S 2>/dev/null
+ip netns del $NS_C 2>/dev/null
+ip netns add $NS_S || die "cannot create namespace"
+ip netns add $NS_C || die "cannot create namespace"
+ip link add ldtb0 netns $NS_S type veth peer name ldtb1 netns $NS_C \
+	|| die "cannot create veth pair"
+nss ip link set lo up
+nsc ip link set lo up
+nss ip addr add $OUTER_S/24 dev ldtb0
+nsc ip addr add $OUTER_C/24 dev ldtb1
+nss ip link set ldtb0 up
+nsc ip link set ldtb1 up
+
+
+# sets up the tunnel of given type, prints the server address to use
+tunup ()
+{
+	local tun="$1" i
+
+	nss "$LDT" rmdev ldtb 2>/dev/null
+	nsc "$LDT" rmdev ldtb 2>/dev/null
+	if test "$tun" = none; then
+		echo $OUTER_S
+		return 0
+	fi
+	nss "$LDT" newdev ldtb || return 1
+	nss "$LDT" newtun -T "$tun" ldtb || return 1
+	nss "$LDT" tunbind -b $OUTER_S:$TUNPORT ldtb || return 1
+	nss "$LDT" serverstart ldtb || return 1
+	nss ip addr add $INNER_S/30 dev ldtb
+	nss ip link set ldtb up
+	nsc "$LDT" newdev ldtb || return 1
+	nsc "$LDT" newtun -T "$tun" ldtb || return 1
+	nsc "$LDT" tunbind -b $OUTER_C:$TUNPORT ldtb || return 1
+	nsc "$LDT" setpeer -r $OUTER_S:$TUNPORT ldtb || return 1
+	nsc ip addr add $INNER_C/30 dev ldtb
+	nsc ip link set ldtb up
+	for i in $(seq 1 20); do
+		nsc ping -c1 -W1 -q $INNER_S >/dev/null 2>&1 && {
+			echo $INNER_S
+			return 0
+		}
+	done
+	log "tunnel $tun did not come up"
+	return 1
+}
+
+run1 ()
+{
+	local tun="$1" proto="$2" size="$3" addr="$4"
+	local popt c0 c1 hz gen sink pkts
+
+	popt="-u"
+	test "$proto" = tcp && popt="-t"
+	nss "$PERF" -s $popt -p $PERFPORT -w 5 > sink.out &
+	sleep 0.5
+	c0=$(cpubusy)
+	gen="$(nsc "$PERF" -c $addr $popt -p $PERFPORT -l $size -d $DURATION \
+				-r $RATE)"
+	wait
+	c1=$(cpubusy)
+	sink="$(cat sink.out)"
+	test "$gen" -a "$sink" || {
+		log "run $tun/$proto/$size failed"
+		return 1
+	}
+	hz=$(getconf CLK_TCK)
+	pkts=$(echo "$sink" | sed -e 's/.*"pkts":\([0-9]*\).*/\1/')
+	echo "{\"tun\":\"$tun\",\"proto\":\"$proto\",\"size\":$size,"\
+"\"rate\":$RATE,\"duration\":$DURATION,\"kernel\":\"$(uname -r)\","\
+"\"sys_cpu_ns_per_pkt\":$(awk -v c=$((c1-c0)) -v hz=$hz -v p=$pkts \
+	'BEGIN { printf "%.1f", p ? c * 1e9 / hz / p : 0 }'),"\
+"\"gen\":$gen,\"sink\":$sink}"
+}
+
+
+for tun in $TUNS; do
+	addr="$(tunup $tun)" || continue
+	for proto in $PROTOS; do
+		for size in $SIZES; do
+			log "running $tun / $proto / $size bytes"
+			if test "$OUT"; then
+				run1 $tun $proto $size $addr >> "$OUT"
+			else
+				run1 $tun $proto $size $addr
+			fi
+		done
+	done
+done
+nss "$LDT" rmdev ldtb 2>/dev/null
+nsc "$LDT" rmdev ldtb 2>/dev/null
+exit 0
+
+
+
+# vim:tw=0:ts=3:wm=0:
@@ -0,0 +1,506 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+
+/* ldtperf - minimal packet generator and sink for the ldt benchmark
+ *
+ * every packet starts with a struct perfhdr. The sender stamps it with
+ * CLOCK_MONOTONIC, which is shared between network namespaces, so the
+ * sink can compute the one way latency when both run on the same host.
+ * Results are printed as one JSON object to stdout.
+ */
+
+#define PERF_MAGIC		0x6c647470	/* ldtp */
+#define PERF_F_FIN		0x01
+#define PERF_MINSIZE		((int)sizeof (struct perfhdr))
+#define PERF_MAXSIZE		65000
+#define PERF_NSAMPLES	(1<<20)
+#define PERF_PORT			5201
+
+struct perfhdr {
+	uint32_t	magic;
+	uint32_t	flags;
+	uint32_t	len;		/* whole message incl. header */
+	uint32_t	resv;
+	uint64_t	seq;
+	uint64_t	tstamp;	/* ns, CLOCK_MONOTONIC */
+};
+
+static const char	*PROG = "ldtperf";
+static volatile int	stop = 0;
+
+static
+uint64_t
+now_ns ()
+{
+	struct timespec	ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static
+uint64_t
+cpu_ns ()
+{
+	struct rusage	ru;
+
+	getrusage (RUSAGE_SELF, &ru);
+	return ((uint64_t)ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL
+			+ ((uint64_t)ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+}
+
+static
+void
+onsig (sig)
+	int	sig;
+{
+	stop = 1;
+}
+
+static
+void
+usage ()
+{
+	printf ("%s: usage: %s -s | -c <addr> [<options>]\n"
+				"  options are:\n"
+				"    -h             - this help screen\n"
+				"    -s             - run as sink (receiver)\n"
+				"    -c <addr>      - run as generator, sending to addr\n"
+				"    -u             - use udp (default)\n"
+				"    -t             - use tcp\n"
+				"    -p <port>      - port (default %d)\n"
+				"    -l <size>      - generator: payload size in bytes (default 64)\n"
+				"    -d <sec>       - duration in seconds (default 10)\n"
+				"    -r <pps>       - packet rate, 0 = as fast as possible (default)\n"
+				"    -w <sec>       - sink: give up after sec idle seconds\n"
+				"                     (default 5)\n"
+				"\n", PROG, PROG, PERF_PORT);
+}
+
+
+struct perfopt {
+	int			sink;
+	int			tcp;
+	const char	*addr;
+	int			port;
+	int			size;
+	int			duration;
+	uint64_t		rate;
+	int			idle;
+};
+
+static int run_gen (struct perfopt*);
+static int run_sink (struct perfopt*);
+
+
+int
+main (argc, argv)
+	int	argc;
+	char	**argv;
+{
+	struct perfopt	opt = { .port = PERF_PORT, .size = 64, .duration = 10,
+									.idle = 5 };
+	int				c;
+
+	while ((c = getopt (argc, argv, "hsc:utp:l:d:r:w:")) != -1) {
+		switch (c) {
+		case 'h':
+			usage ();
+			return 0;
+		case 's':
+			opt.sink = 1;
+			break;
+		case 'c':
+			opt.addr = optarg;
+			break;
+		case 'u':
+			opt.tcp = 0;
+			break;
+		case 't':
+			opt.tcp = 1;
+			break;
+		case 'p':
+			opt.port = atoi (optarg);
+			break;
+		case 'l':
+			opt.size = atoi (optarg);
+			break;
+		case 'd':
+			opt.duration = atoi (optarg);
+			break;
+		case 'r':
+			opt.rate = strtoull (optarg, NULL, 10);
+			break;
+		case 'w':
+			opt.idle = atoi (optarg);
+			break;
+		default:
+			usage ();
+			return 1;
+		}
+	}
+	if (opt.sink == !!opt.addr) {
+		fprintf (stderr, "%s: exactly one of -s or -c must be given\n", PROG);
+		return 1;
+	}
+	if (opt.size < PERF_MINSIZE) opt.size = PERF_MINSIZE;
+	if (opt.size > PERF_MAXSIZE) opt.size = PERF_MAXSIZE;
+	if (opt.duration <= 0) opt.duration = 1;
+	if (opt.idle <= 0) opt.idle = 1;
+	signal (SIGINT, onsig);
+	signal (SIGTERM, onsig);
+	signal (SIGPIPE, SIG_IGN);
+	return opt.sink ? run_sink (&opt) : run_gen (&opt);
+}
+
+
+static
+int
+mksock (opt, sa)
+	struct perfopt				*opt;
+	struct sockaddr_storage	*sa;
+{
+	struct addrinfo	hints, *res;
+	char					port[16];
+	int					fd, ret, one = 1;
+
+	bzero (&hints, sizeof (hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = opt->tcp ? SOCK_STREAM : SOCK_DGRAM;
+	if (opt->sink) hints.ai_flags = AI_PASSIVE;
+	snprintf (port, sizeof (port), "%d", opt->port);
+	ret = getaddrinfo (opt->addr ? opt->addr : "::", port, &hints, &res);
+	if (ret) {
+		fprintf (stderr, "%s: cannot resolve %s: %s\n", PROG,
+					opt->addr ? opt->addr : "::", gai_strerror (ret));
+		return -1;
+	}
+	fd = socket (res->ai_family, res->ai_socktype, 0);
+	if (fd < 0) {
+		perror ("socket");
+		freeaddrinfo (res);
+		return -1;
+	}
+	memcpy (sa, res->ai_addr, res->ai_addrlen);
+	if (opt->sink) {
+		setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+		if (bind (fd, res->ai_addr, res->ai_addrlen) < 0) {
+			perror ("bind");
+			goto err;
+		}
+		if (opt->tcp && listen (fd, 1) < 0) {
+			perror ("listen");
+			goto err;
+		}
+	} else {
+		if (connect (fd, res->ai_addr, res->ai_addrlen) < 0) {
+			perror ("connect");
+			goto err;
+		}
+		if (opt->tcp) {
+			setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+		}
+	}
+	freeaddrinfo (res);
+	return fd;
+err:
+	freeaddrinfo (res);
+	close (fd);
+	return -1;
+}
+
+
+static
+int
+run_gen (opt)
+	struct perfopt	*opt;
+{
+	struct sockaddr_storage	sa;
+	struct perfhdr				*hdr;
+	char							*buf;
+	int							fd, i, ret;
+	uint64_t						start, end, t, next, gap, cstart;
+	uint64_t						seq = 0, errs = 0;
+
+	fd = mksock (opt, &sa);
+	if (fd < 0) return 1;
+	buf = calloc (1, opt->size);
+	if (!buf) {
+		close (fd);
+		return 1;
+	}
+	hdr = (struct perfhdr*)buf;
+	hdr->magic = htonl (PERF_MAGIC);
+	hdr->len = htonl (opt->size);
+	gap = opt->rate ? 1000000000ULL / opt->rate : 0;
+	cstart = cpu_ns ();
+	start = next = now_ns ();
+	end = start + (uint64_t)opt->duration * 1000000000ULL;
+	while (!stop) {
+		t = now_ns ();
+		if (t >= end) break;
+		if (gap) {
+			if (t < next) continue;
+			next += gap;
+		}
+		hdr->seq = seq;
+		hdr->tstamp = t;
+		ret = send (fd, buf, opt->size, 0);
+		if (ret == opt->size) {
+			seq++;
+		} else if (opt->tcp && ret < 0 && errno != EINTR) {
+			perror ("send");
+			break;
+		} else {
+			/* udp: ENOBUFS / ECONNREFUSED are counted, not fatal */
+			errs++;
+		}
+	}
+	t = now_ns () - start;
+	/* tell the sink we are done - udp may lose single packets */
+	hdr->flags = htonl (PERF_F_FIN);
+	hdr->seq = seq;
+	hdr->tstamp = now_ns ();
+	for (i=0; i<(opt->tcp ? 1 : 5); i++) {
+		send (fd, buf, opt->size, 0);
+		if (!opt->tcp) usleep (10000);
+	}
+	printf ("{\"role\":\"gen\",\"proto\":\"%s\",\"size\":%d,\"pkts\":%llu,"
+				"\"errors\":%llu,\"duration_ns\":%llu,\"pps\":%.0f,"
+				"\"gbps\":%.4f,\"cpu_ns_per_pkt\":%.1f}\n",
+				opt->tcp ? "tcp" : "udp", opt->size,
+				(unsigned long long)seq, (unsigned long long)errs,
+				(unsigned long long)t,
+				t ? (double)seq * 1e9 / t : 0.,
+				t ? (double)seq * opt->size * 8. / t : 0.,
+				seq ? (double)(cpu_ns () - cstart) / seq : 0.);
+	free (buf);
+	close (fd);
+	return 0;
+}
+
+
+static
+int
+cmp_u64 (a, b)
+	const void	*a, *b;
+{
+	uint64_t	x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static
+ssize_t
+recv_full (fd, buf, len)
+	int	fd;
+	char	*buf;
+	int	len;
+{
+	ssize_t	ret, got = 0;
+
+	while (got < len) {
+		ret = recv (fd, buf + got, len - got, 0);
+		if (ret <= 0) return ret < 0 ? ret : got;
+		got += ret;
+	}
+	return got;
+}
+
+static
+int
+run_sink (opt)
+	struct perfopt	*opt;
+{
+	struct sockaddr_storage	sa;
+	struct timeval				tv = { .tv_sec = 1 };
+	struct perfhdr				*hdr;
+	uint64_t						*samples;
+	char							*buf;
+	int							fd, lfd = -1, nsamp = 0, idle = 0;
+	ssize_t						ret, len;
+	uint64_t						pkts = 0, bytes = 0, bad = 0, sent = 0;
+	uint64_t						first = 0, last = 0, t, lat, cstart;
+	uint64_t						rnd = 88172645463325252ULL;
+	double						p50 = 0., p99 = 0., dur;
+
+	fd = mksock (opt, &sa);
+	if (fd < 0) return 1;
+	if (opt->tcp) {
+		lfd = fd;
+		fd = accept (lfd, NULL, NULL);
+		if (fd < 0) {
+			perror ("accept");
+			close (lfd);
+			return 1;
+		}
+	}
+	setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+	buf = malloc (PERF_MAXSIZE);
+	samples = malloc (PERF_NSAMPLES * sizeof (uint64_t));
+	if (!buf || !samples) {
+		fprintf (stderr, "%s: out of memory\n", PROG);
+		return 1;
+	}
+	hdr = (struct perfhdr*)buf;
+	cstart = cpu_ns ();
+	while (!stop) {
+		if (opt->tcp) {
+			/* stream: read header first, it carries the message length */
+			ret = recv_full (fd, buf, PERF_MINSIZE);
+			if (ret == 0) break;
+			if (ret == PERF_MINSIZE) {
+				len = ntohl (hdr->len);
+				if (ntohl (hdr->magic) != PERF_MAGIC || len < PERF_MINSIZE ||
+							len > PERF_MAXSIZE) {
+					fprintf (stderr, "%s: lost message framing\n", PROG);
+					break;
+				}
+				if (len > PERF_MINSIZE) {
+					ret = recv_full (fd, buf + PERF_MINSIZE, len - PERF_MINSIZE);
+					if (ret == 0) break;
+					if (ret > 0) ret += PERF_MINSIZE;
+				}
+			}
+		} else {
+			ret = recv (fd, buf, PERF_MAXSIZE, 0);
+		}
+		if (ret < 0) {
+			if (errno != EAGAIN && errno != EINTR) {
+				perror ("recv");
+				break;
+			}
+			if (++idle >= opt->idle) break;
+			continue;
+		}
+		idle = 0;
+		t = now_ns ();
+		if (ret < PERF_MINSIZE || ntohl (hdr->magic) != PERF_MAGIC) {
+			bad++;
+			continue;
+		}
+		if (ntohl (hdr->flags) & PERF_F_FIN) {
+			sent = hdr->seq;
+			break;
+		}
+		if (!first) first = t;
+		last = t;
+		pkts++;
+		bytes += ret;
+		lat = t > hdr->tstamp ? t - hdr->tstamp : 0;
+		/* reservoir sampling keeps the memory bounded for long runs */
+		if (nsamp < PERF_NSAMPLES) {
+			samples[nsamp++] = lat;
+		} else {
+			rnd ^= rnd << 13; rnd ^= rnd >> 7; rnd ^= rnd << 17;
+			if (rnd % pkts < PERF_NSAMPLES) samples[rnd % PERF_NSAMPLES] = lat;
+		}
+	}
+	if (nsamp > 0) {
+		qsort (samples, nsamp, sizeof (uint64_t), cmp_u64);
+		p50 = samples[(nsamp - 1) * 50 / 100] / 1000.;
+		p99 = samples[(nsamp - 1) * 99 / 100] / 1000.;
+	}
+	dur = last > first ? (double)(last - first) : 0.;
+	printf ("{\"role\":\"sink\",\"proto\":\"%s\",\"size\":%llu,\"pkts\":%llu,"
+				"\"bytes\":%llu,\"bad\":%llu,\"sent\":%llu,\"loss\":%.6f,"
+				"\"duration_ns\":%.0f,\"pps\":%.0f,\"gbps\":%.4f,"
+				"\"cpu_ns_per_pkt\":%.1f,\"lat_p50_us\":%.1f,"
+				"\"lat_p99_us\":%.1f}\n",
+				opt->tcp ? "tcp" : "udp",
+				(unsigned long long)(pkts ? bytes / pkts : 0),
+				(unsigned long long)pkts, (unsigned long long)bytes,
+				(unsigned long long)bad, (unsigned long long)sent,
+				sent > pkts ? (double)(sent - pkts) / sent : 0.,
+				dur, dur > 0. ? pkts * 1e9 / dur : 0.,
+				dur > 0. ? bytes * 8. / dur : 0.,
+				pkts ? (double)(cpu_ns () - cstart) / pkts : 0.,
+				p50, p99);
+	free (samples);
+	free (buf);
+	close (fd);
+	if (lfd >= 0) close (lfd);
+	return 0;
+}
+
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
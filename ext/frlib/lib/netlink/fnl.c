@@ -550,6 +550,172 @@ retry:
 }
 
 
+
+int
+fnl_rbuf_init (rb, buf, slotlen, nslots)
+	struct fnl_rbuf	*rb;
+	char					*buf;
+	size_t				slotlen;
+	int					nslots;
+{
+	int	i;
+
+	if (!rb) return RERR_PARAM;
+	if (slotlen == 0) slotlen = 8192;
+	if (nslots <= 0) nslots = 16;
+	bzero (rb, sizeof (struct fnl_rbuf));
+	rb->hdrs = calloc (nslots, sizeof (struct mmsghdr));
+	rb->iov = calloc (nslots, sizeof (struct iovec));
+	if (!buf) {
+		buf = malloc (slotlen * nslots);
+		rb->isalloc = 1;
+	}
+	if (!rb->hdrs || !rb->iov || !buf) {
+		if (rb->isalloc && buf) free (buf);
+		if (rb->hdrs) free (rb->hdrs);
+		if (rb->iov) free (rb->iov);
+		bzero (rb, sizeof (struct fnl_rbuf));
+		return RERR_NOMEM;
+	}
+	rb->buf = buf;
+	rb->slotlen = slotlen;
+	rb->nslots = nslots;
+	for (i=0; i<nslots; i++) {
+		rb->hdrs[i].msg_hdr.msg_iov = &rb->iov[i];
+		rb->hdrs[i].msg_hdr.msg_iovlen = 1;
+	}
+	return RERR_OK;
+}
+
+void
+fnl_rbuf_free (rb)
+	struct fnl_rbuf	*rb;
+{
+	if (!rb) return;
+	if (rb->isalloc && rb->buf) free (rb->buf);
+	if (rb->hdrs) free (rb->hdrs);
+	if (rb->iov) free (rb->iov);
+	bzero (rb, sizeof (struct fnl_rbuf));
+}
+
+static
+int
+rbuf_grow (rb, len)
+	struct fnl_rbuf	*rb;
+	size_t				len;
+{
+	char	*buf;
+
+	if (len <= rb->slotlen) return RERR_OK;
+	if (!rb->isalloc) return RERR_INVALID_LEN;
+	len = (len + 4095) & ~(size_t)4095;
+	buf = realloc (rb->buf, len * rb->nslots);
+	if (!buf) return RERR_NOMEM;
+	rb->buf = buf;
+	rb->slotlen = len;
+	return RERR_OK;
+}
+
+int
+fnl_recvbatch (sd, rb, maxmsg, timeout, flags)
+	int					sd, maxmsg, flags;
+	struct fnl_rbuf	*rb;
+	tmo_t					timeout;
+{
+	struct fnlsock		*sock;
+	struct nlmsghdr	*nlh;
+	ssize_t				n;
+	int					i, ret, num;
+	tmo_t					tout, start=-1, now;
+
+	if (!rb || !rb->buf) return RERR_PARAM;
+	rb->num = rb->cur = rb->ntrunc = 0;
+	rb->off = 0;
+	if (maxmsg <= 0 || maxmsg > rb->nslots) maxmsg = rb->nslots;
+
+	ret = TLST_GETPTR (sock, socks, sd);
+	if (!RERR_ISOK(ret)) return ret;
+	if (sock->sd != sd) return RERR_NOT_FOUND;
+
+	while (1) {
+		if (timeout < 0) {
+			tout = -1;
+		} else if (start == -1) {
+			tout = timeout;
+			start = tmo_now();
+		} else {
+			now = tmo_now();
+			tout = timeout - (now - start);
+			if (tout < 0) return RERR_TIMEDOUT;
+		}
+		ret = fd_isready (sd, tout);
+		if (!RERR_ISOK(ret)) return ret;
+		/* make sure the first datagram fits */
+		n = recv (sd, NULL, 0, MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT);
+		if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+		if (n < 0) return RERR_SYSTEM;
+		ret = rbuf_grow (rb, n);
+		if (!RERR_ISOK(ret)) return ret;
+		for (i=0; i<maxmsg; i++) {
+			rb->iov[i].iov_base = rb->buf + i * rb->slotlen;
+			rb->iov[i].iov_len = rb->slotlen;
+			rb->hdrs[i].msg_hdr.msg_flags = 0;
+			rb->hdrs[i].msg_len = 0;
+		}
+		num = recvmmsg (sd, rb->hdrs, maxmsg, MSG_DONTWAIT, NULL);
+		if (num < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+		if (num < 0) return RERR_SYSTEM;
+		break;
+	}
+	for (i=0; i<num; i++) {
+		if (rb->hdrs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+			rb->hdrs[i].msg_len = 0;
+			rb->ntrunc++;
+		}
+		if (flags & FNL_F_NOHDR) continue;
+		/* keep sequence numbers in sync with fnl_recv */
+		nlh = (struct nlmsghdr*)rb->iov[i].iov_base;
+		if (rb->hdrs[i].msg_len >= NLMSG_HDRLEN) {
+			sock->rcvseq = nlh->nlmsg_seq + 1;
+		}
+	}
+	if (rb->ntrunc > 0) {
+		FRLOGF (LOG_WARN, "%d netlink messages dropped (larger than %d bytes)",
+					rb->ntrunc, (int)rb->slotlen);
+	}
+	rb->num = num;
+	return num;
+}
+
+char *
+fnl_rbuf_next (rb, msglen)
+	struct fnl_rbuf	*rb;
+	int					*msglen;
+{
+	struct nlmsghdr	*nlh;
+	size_t				len;
+
+	if (!rb) return NULL;
+	for (; rb->cur < rb->num; rb->cur++, rb->off = 0) {
+		len = rb->hdrs[rb->cur].msg_len;
+		if (rb->off + NLMSG_HDRLEN > len) continue;
+		nlh = (struct nlmsghdr*)((char*)rb->iov[rb->cur].iov_base + rb->off);
+		if (nlh->nlmsg_len < NLMSG_HDRLEN || nlh->nlmsg_len > len - rb->off) {
+			/* invalid header - pass the rest as one message */
+			len -= rb->off;
+			rb->off += len;
+		} else {
+			len = nlh->nlmsg_len;
+			rb->off += NLMSG_ALIGN(len);
+		}
+		if (msglen) *msglen = len;
+		return (char*)nlh;
+	}
+	return NULL;
+}
+
+
+
 char *
 fnl_putdata (ptr, data, dlen)
 	char			*ptr;
@@ -637,6 +803,31 @@ fnl_getnextattr (ptr)
 }
 
 
+/* in place attribute iterator, attr == NULL gives the first attribute,
+ * returns NULL at the end of the message or on malformed attributes
+ */
+char *
+fnl_attrnext (msg, hdrlen, attr)
+	const char	*msg, *attr;
+	int			hdrlen;
+{
+	const struct nlattr	*nla;
+	const char				*end;
+
+	if (!msg) return NULL;
+	end = msg + ((const struct nlmsghdr*)msg)->nlmsg_len;
+	if (!attr) {
+		attr = fnl_getmsgdata (msg, hdrlen);
+	} else {
+		attr += NLA_ALIGN(((const struct nlattr*)attr)->nla_len);
+	}
+	if (attr + NLA_HDRLEN > end) return NULL;
+	nla = (const struct nlattr*)attr;
+	if (nla->nla_len < NLA_HDRLEN || attr + nla->nla_len > end) return NULL;
+	return (char*)attr;
+}
+
+
 int
 fnl_getfamilyid (sd, name, timeout, flags)
 	int			sd, flags;
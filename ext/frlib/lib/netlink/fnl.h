@@ -71,6 +71,37 @@ int fnl_recv2 (int sd, struct sockaddr_nl *nla, char **msg,
 					struct ucred **creds, tmo_t timeout, int flags);
 
 
+/* batched receive into reusable buffers
+ *
+ * fnl_recvbatch() receives up to maxmsg (0 = number of slots) datagrams
+ * with one system call. The first datagram is always received completely
+ * (a buffer allocated by fnl_rbuf_init grows on demand), following
+ * datagrams not fitting into a slot are dropped and counted in ntrunc.
+ * fnl_rbuf_next() iterates in place over the netlink messages received,
+ * the data is valid until the next call of fnl_recvbatch().
+ * Control messages are not filtered, credentials are not supported.
+ */
+struct mmsghdr;
+struct fnl_rbuf {
+	char				*buf;
+	size_t			slotlen;
+	int				nslots;
+	int				isalloc;
+	struct mmsghdr	*hdrs;
+	struct iovec	*iov;
+	int				num;		/* datagrams received */
+	int				cur;		/* iterator - current datagram */
+	size_t			off;		/* iterator - offset inside datagram */
+	int				ntrunc;	/* datagrams dropped (too large) */
+};
+
+int fnl_rbuf_init (struct fnl_rbuf *rb, char *buf, size_t slotlen, int nslots);
+void fnl_rbuf_free (struct fnl_rbuf *rb);
+int fnl_recvbatch (	int sd, struct fnl_rbuf *rb, int maxmsg, tmo_t timeout,
+							int flags);
+char *fnl_rbuf_next (struct fnl_rbuf *rb, int *msglen);
+
+
 
 /* message info functions */
 
@@ -93,6 +124,8 @@ char *fnl_getattrdata (const char *ptr);
 int fnl_getattrlen (const char *ptr);
 int fnl_getattrid (const char *ptr);
 
+char *fnl_attrnext (const char *msg, int hdrlen, const char *attr);
+
 char *fnl_putattr (char *ptr, int attrid, const void *data, int dlen);
 char *fnl_putdata (char *ptr, const void *data, int dlen);
 
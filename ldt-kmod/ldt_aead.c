@@ -0,0 +1,625 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/version.h>
+#include <linux/skbuff.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include <linux/err.h>
+#include <linux/log2.h>
+#include <crypto/aead.h>
+#include <crypto/algapi.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,12,0)
+# include <linux/unaligned.h>
+#else
+# include <asm/unaligned.h>
+#endif
+
+#include "ldt_uapi.h"
+#include "ldt_aead.h"
+#include "ldt_prot1.h"
+#include "ldt_debug.h"
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,9,0)
+# define kfree_sensitive kzfree
+#endif
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3,17,0)
+# define ktime_get_real_seconds get_seconds
+#endif
+
+
+struct ldt_aead_tfm {
+	struct crypto_aead	*tfm;
+	struct aead_request	*req;
+};
+
+#define AEAD_IVLEN			(LDT_AEAD_SALTLEN + 8)
+#define AEAD_MAXSG			16
+#define AEAD_REPLAY_WORDS	(LDT_AEAD_REPLAY_BITS / BITS_PER_LONG)
+#define AEAD_REPLAY_WIN		(LDT_AEAD_REPLAY_BITS - BITS_PER_LONG)
+
+/* the top bit of the sequence number is the role of the sender (set by
+ * the server). The counter of a new key starts at the wall clock
+ * seconds shifted by AEAD_SEQ_TSHIFT, so a key installed again later
+ * never reuses a nonce as long as less than 2^28 packets per second
+ * were sent on average.
+ */
+#define AEAD_SEQ_DIR			(1ULL << 63)
+#define AEAD_SEQ_MASK		(AEAD_SEQ_DIR - 1)
+#define AEAD_SEQ_TSHIFT		28
+
+static const char	*aead_algname[LDT_AEAD_MAX+1] = {
+	[LDT_AEAD_AES_GCM] = "gcm(aes)",
+	[LDT_AEAD_CHACHA20_POLY1305] = "rfc7539(chacha20,poly1305)",
+};
+static const char	*aead_prtname[LDT_AEAD_MAX+1] = {
+	[LDT_AEAD_NONE] = "none",
+	[LDT_AEAD_AES_GCM] = "aes-gcm",
+	[LDT_AEAD_CHACHA20_POLY1305] = "chacha20-poly1305",
+};
+
+/* freeing a transform may sleep - retired keys are freed by a work
+ * after a grace period
+ */
+static struct workqueue_struct	*aead_wq = NULL;
+
+static void aead_key_free (struct ldt_aead_key*);
+static void aead_key_retire (struct ldt_aead_key*);
+static void aead_key_rcu (struct rcu_head*);
+static void aead_key_work (struct work_struct*);
+static bool aead_replay (struct ldt_aead_key*, u64, int);
+static bool aead_samekey (struct ldt_aead_key*, struct ldt_aead_key*);
+static void aead_takeover (struct ldt_aead_key*, struct ldt_aead_key*);
+
+
+
+int
+ldt_aead_global_init (void)
+{
+	aead_wq = alloc_workqueue ("ldt_aead", 0, 0);
+	if (!aead_wq) return -ENOMEM;
+	return 0;
+}
+
+void
+ldt_aead_global_exit (void)
+{
+	/* wait for pending rcu callbacks to queue their work */
+	rcu_barrier ();
+	if (aead_wq) destroy_workqueue (aead_wq);
+	aead_wq = NULL;
+}
+
+
+void
+ldt_aead_init (aead)
+	struct ldt_aead	*aead;
+{
+	if (!aead) return;
+	*aead = (struct ldt_aead) { .require = 0, };
+	RCU_INIT_POINTER (aead->tx, NULL);
+	RCU_INIT_POINTER (aead->rx[0], NULL);
+	RCU_INIT_POINTER (aead->rx[1], NULL);
+}
+
+void
+ldt_aead_destroy (aead)
+	struct ldt_aead	*aead;
+{
+	if (!aead) return;
+	ldt_aead_set (aead, NULL, NULL, LDT_AEAD_F_FLUSH);
+}
+
+
+struct ldt_aead_key*
+ldt_aead_mkkey (alg, key, keylen, keyid)
+	int		alg;
+	const u8	*key;
+	int		keylen, keyid;
+{
+	struct ldt_aead_key	*k;
+	struct ldt_aead_tfm	*t;
+	int						klen, cpu, ret;
+
+	if (alg <= LDT_AEAD_NONE || alg > LDT_AEAD_MAX) return ERR_PTR (-EINVAL);
+	if (keyid < 0 || keyid > LDT_AEAD_KEYID_MAX) return ERR_PTR (-ERANGE);
+	if (!key) return ERR_PTR (-EINVAL);
+	klen = keylen - LDT_AEAD_SALTLEN;
+	switch (alg) {
+	case LDT_AEAD_AES_GCM:
+		if (klen != 16 && klen != 24 && klen != 32) return ERR_PTR (-EINVAL);
+		break;
+	case LDT_AEAD_CHACHA20_POLY1305:
+		if (klen != 32) return ERR_PTR (-EINVAL);
+		break;
+	}
+	k = kzalloc (sizeof (*k), GFP_KERNEL);
+	if (!k) return ERR_PTR (-ENOMEM);
+	INIT_WORK (&k->work, aead_key_work);
+	spin_lock_init (&k->rxlock);
+	atomic64_set (&k->txseq, ((u64)ktime_get_real_seconds () <<
+										AEAD_SEQ_TSHIFT) & AEAD_SEQ_MASK);
+	k->alg = alg;
+	k->keyid = keyid;
+	memcpy (k->salt, key + klen, LDT_AEAD_SALTLEN);
+	memcpy (k->key, key, keylen);
+	k->keylen = keylen;
+	k->tfm = alloc_percpu (struct ldt_aead_tfm);
+	if (!k->tfm) {
+		ret = -ENOMEM;
+		goto err;
+	}
+	for_each_possible_cpu (cpu) {
+		t = per_cpu_ptr (k->tfm, cpu);
+		/* synchronous implementations only - we run in softirq */
+		t->tfm = crypto_alloc_aead (aead_algname[alg], 0, CRYPTO_ALG_ASYNC);
+		if (IS_ERR (t->tfm)) {
+			ret = PTR_ERR (t->tfm);
+			t->tfm = NULL;
+			goto err;
+		}
+		ret = crypto_aead_setkey (t->tfm, key, klen);
+		if (ret < 0) goto err;
+		ret = crypto_aead_setauthsize (t->tfm, LDT_AEAD_TAGLEN);
+		if (ret < 0) goto err;
+		if (crypto_aead_ivsize (t->tfm) != AEAD_IVLEN) {
+			ret = -EINVAL;
+			goto err;
+		}
+		t->req = aead_request_alloc (t->tfm, GFP_KERNEL);
+		if (!t->req) {
+			ret = -ENOMEM;
+			goto err;
+		}
+		aead_request_set_callback (t->req, 0, NULL, NULL);
+	}
+	return k;
+err:
+	tp_note ("cannot setup %s: %d", aead_algname[alg], ret);
+	aead_key_free (k);
+	return ERR_PTR (ret);
+}
+
+void
+ldt_aead_freekey (k)
+	struct ldt_aead_key	*k;
+{
+	if (IS_ERR_OR_NULL (k)) return;
+	aead_key_free (k);
+}
+
+static
+void
+aead_key_free (k)
+	struct ldt_aead_key	*k;
+{
+	struct ldt_aead_tfm	*t;
+	int						cpu;
+
+	if (!k) return;
+	if (k->tfm) {
+		for_each_possible_cpu (cpu) {
+			t = per_cpu_ptr (k->tfm, cpu);
+			if (t->req) aead_request_free (t->req);
+			if (t->tfm) crypto_free_aead (t->tfm);
+		}
+		free_percpu (k->tfm);
+	}
+	kfree_sensitive (k);
+}
+
+static
+void
+aead_key_retire (k)
+	struct ldt_aead_key	*k;
+{
+	if (!k) return;
+	call_rcu (&k->rcu, aead_key_rcu);
+}
+
+static
+void
+aead_key_rcu (rcu)
+	struct rcu_head	*rcu;
+{
+	struct ldt_aead_key	*k = container_of (rcu, struct ldt_aead_key, rcu);
+
+	queue_work (aead_wq, &k->work);
+}
+
+static
+void
+aead_key_work (work)
+	struct work_struct	*work;
+{
+	aead_key_free (container_of (work, struct ldt_aead_key, work));
+}
+
+
+/* called under device lock - writers are serialized by it */
+int
+ldt_aead_set (aead, tx, rx, flags)
+	struct ldt_aead		*aead;
+	struct ldt_aead_key	*tx, *rx;
+	u32						flags;
+{
+	struct ldt_aead_key	*old0, *old1;
+
+#define XCHG(p,n)	({ \
+				struct ldt_aead_key *_o = rcu_dereference_protected ((p), 1); \
+				rcu_assign_pointer ((p), (n)); \
+				_o; })
+	if (!aead) return -EINVAL;
+	if (flags & LDT_AEAD_F_FLUSH) {
+		aead_key_retire (XCHG (aead->tx, NULL));
+		aead_key_retire (XCHG (aead->rx[0], NULL));
+		aead_key_retire (XCHG (aead->rx[1], NULL));
+		WRITE_ONCE (aead->require, 0);
+	}
+	if (tx) {
+		old0 = rcu_dereference_protected (aead->tx, 1);
+		/* the same key again must not start the counter anew */
+		if (aead_samekey (old0, tx)) aead_takeover (tx, old0);
+		aead_key_retire (XCHG (aead->tx, tx));
+	}
+	if (rx) {
+		old0 = rcu_dereference_protected (aead->rx[0], 1);
+		old1 = rcu_dereference_protected (aead->rx[1], 1);
+		/* nor must it forget the packets already seen */
+		if (aead_samekey (old0, rx)) {
+			aead_takeover (rx, old0);
+		} else if (aead_samekey (old1, rx)) {
+			aead_takeover (rx, old1);
+		}
+		if (old0 && old0->keyid == rx->keyid) {
+			/* replace current key */
+			aead_key_retire (XCHG (aead->rx[0], rx));
+		} else {
+			/* current key becomes previous one */
+			old1 = XCHG (aead->rx[1], old0);
+			rcu_assign_pointer (aead->rx[0], rx);
+			aead_key_retire (old1);
+		}
+	}
+	if (flags & LDT_AEAD_F_REQUIRE) {
+		WRITE_ONCE (aead->require, 1);
+	} else if (flags & LDT_AEAD_F_OPTIONAL) {
+		WRITE_ONCE (aead->require, 0);
+	}
+	return 0;
+#undef XCHG
+}
+
+static
+bool
+aead_samekey (old, k)
+	struct ldt_aead_key	*old, *k;
+{
+	return old && k && old->alg == k->alg && old->keylen == k->keylen &&
+				!crypto_memneq (old->key, k->key, k->keylen);
+}
+
+/* k is not yet visible to the data path - old still is */
+static
+void
+aead_takeover (k, old)
+	struct ldt_aead_key	*k, *old;
+{
+	u64	seq;
+
+	seq = atomic64_read (&old->txseq);
+	if (seq > atomic64_read (&k->txseq)) atomic64_set (&k->txseq, seq);
+	spin_lock_bh (&old->rxlock);
+	k->rxmax = old->rxmax;
+	memcpy (k->replay, old->replay, sizeof (k->replay));
+	spin_unlock_bh (&old->rxlock);
+}
+
+
+int
+ldt_aead_encrypt (aead, skb, server)
+	struct ldt_aead	*aead;
+	struct sk_buff		*skb;
+	int					server;
+{
+	struct ldt_aead_key	*key;
+	struct ldt_aead_tfm	*t;
+	struct scatterlist	sg;
+	u8							iv[AEAD_IVLEN];
+	u8							*hdr;
+	u64						seq;
+	int						plen, nhead, ntail, ret;
+
+	if (!aead || !skb) return -EINVAL;
+	if (!rcu_access_pointer (aead->tx)) return 0;
+	/* already protected - packet was requeued */
+	if (skb->len > 0 && TP_GETPKTTYPE (skb->data[0]) == 2) return 0;
+
+	if (skb_linearize (skb) < 0) return -ENOMEM;
+	nhead = LDT_AEAD_HDRLEN - (int)skb_headroom (skb);
+	ntail = LDT_AEAD_TAGLEN - (int)skb_tailroom (skb);
+	if (nhead > 0 || ntail > 0 || skb_cloned (skb)) {
+		ret = pskb_expand_head (skb, max (nhead, 0), max (ntail, 0), GFP_ATOMIC);
+		if (ret < 0) return ret;
+	}
+
+	rcu_read_lock_bh ();
+	key = rcu_dereference_bh (aead->tx);
+	if (!key) {
+		rcu_read_unlock_bh ();
+		return 0;
+	}
+	seq = atomic64_inc_return (&key->txseq) & AEAD_SEQ_MASK;
+	if (server) seq |= AEAD_SEQ_DIR;
+	plen = skb->len;
+	hdr = skb_push (skb, LDT_AEAD_HDRLEN);
+	hdr[0] = 0x20 | key->keyid;
+	hdr[1] = key->alg;
+	hdr[2] = hdr[3] = 0;
+	put_unaligned_be64 (seq, hdr + 4);
+	skb_put (skb, LDT_AEAD_TAGLEN);
+	memcpy (iv, key->salt, LDT_AEAD_SALTLEN);
+	put_unaligned_be64 (seq, iv + LDT_AEAD_SALTLEN);
+
+	sg_init_one (&sg, skb->data, skb->len);
+	t = this_cpu_ptr (key->tfm);
+	aead_request_set_crypt (t->req, &sg, &sg, plen, iv);
+	aead_request_set_ad (t->req, LDT_AEAD_HDRLEN);
+	ret = crypto_aead_encrypt (t->req);
+	rcu_read_unlock_bh ();
+	if (ret < 0) {
+		tp_debug ("error encrypting packet: %d", ret);
+		return ret;
+	}
+	atomic64_inc (&aead->encrypted);
+	return 0;
+}
+
+
+int
+ldt_aead_decrypt (aead, skb, server)
+	struct ldt_aead	*aead;
+	struct sk_buff		*skb;
+	int					server;
+{
+	struct ldt_aead_key	*key = NULL, *k;
+	struct ldt_aead_tfm	*t;
+	struct scatterlist	sg[AEAD_MAXSG];
+	struct sk_buff			*trailer;
+	u8							iv[AEAD_IVLEN];
+	u64						seq;
+	int						keyid, alg, nfrags, ret, i;
+
+	if (!aead || !skb || !skb->len) return -EINVAL;
+	if (TP_GETPKTTYPE (skb->data[0]) != 2) {
+		if (!READ_ONCE (aead->require)) return 0;
+		atomic64_inc (&aead->cleardrop);
+		return -EACCES;
+	}
+	if (skb->len < LDT_AEAD_OVERHEAD || !pskb_may_pull (skb, LDT_AEAD_HDRLEN)) {
+		atomic64_inc (&aead->authfail);
+		return -EBADMSG;
+	}
+	keyid = skb->data[0] & 0x0f;
+	alg = skb->data[1];
+	seq = get_unaligned_be64 (skb->data + 4);
+	/* sent with our own role - a reflected packet */
+	if (!!(seq & AEAD_SEQ_DIR) == !!server) {
+		atomic64_inc (&aead->authfail);
+		return -EBADMSG;
+	}
+
+	rcu_read_lock_bh ();
+	for (i=0; i<2; i++) {
+		k = rcu_dereference_bh (aead->rx[i]);
+		if (k && k->keyid == keyid && k->alg == alg) {
+			key = k;
+			break;
+		}
+	}
+	if (!key) {
+		atomic64_inc (&aead->authfail);
+		ret = -EBADMSG;
+		goto out;
+	}
+	/* cheap check first, the window is updated after authentication only */
+	if (!aead_replay (key, seq & AEAD_SEQ_MASK, 0)) {
+		atomic64_inc (&aead->replay);
+		ret = -EALREADY;
+		goto out;
+	}
+	nfrags = skb_cow_data (skb, 0, &trailer);
+	if (nfrags < 0) {
+		ret = nfrags;
+		goto out;
+	}
+	if (nfrags > AEAD_MAXSG) {
+		ret = skb_linearize (skb);
+		if (ret < 0) goto out;
+		nfrags = 1;
+	}
+	sg_init_table (sg, nfrags);
+	ret = skb_to_sgvec (skb, sg, 0, skb->len);
+	if (ret < 0) goto out;
+
+	memcpy (iv, key->salt, LDT_AEAD_SALTLEN);
+	put_unaligned_be64 (seq, iv + LDT_AEAD_SALTLEN);
+	t = this_cpu_ptr (key->tfm);
+	aead_request_set_crypt (t->req, sg, sg, skb->len - LDT_AEAD_HDRLEN, iv);
+	aead_request_set_ad (t->req, LDT_AEAD_HDRLEN);
+	ret = crypto_aead_decrypt (t->req);
+	if (ret < 0) {
+		if (ret == -EBADMSG) atomic64_inc (&aead->authfail);
+		goto out;
+	}
+	if (!aead_replay (key, seq & AEAD_SEQ_MASK, 1)) {
+		atomic64_inc (&aead->replay);
+		ret = -EALREADY;
+		goto out;
+	}
+	rcu_read_unlock_bh ();
+
+	ret = pskb_trim (skb, skb->len - LDT_AEAD_TAGLEN);
+	if (ret < 0) return ret;
+	if (!pskb_pull (skb, LDT_AEAD_HDRLEN)) return -EINVAL;
+	skb->ip_summed = CHECKSUM_NONE;
+	atomic64_inc (&aead->decrypted);
+	return 0;
+out:
+	rcu_read_unlock_bh ();
+	return ret;
+}
+
+/* sliding window of LDT_AEAD_REPLAY_BITS bits, the word(s) passed by the
+ * highest sequence number are cleared when the window advances
+ * called with bottom halves disabled
+ */
+static
+bool
+aead_replay (key, seq, update)
+	struct ldt_aead_key	*key;
+	u64						seq;
+	int						update;
+{
+	u64	idx, cur, top, i;
+	bool	ok = false;
+
+	spin_lock (&key->rxlock);
+	if (seq == 0 || seq + AEAD_REPLAY_WIN < key->rxmax) goto out;
+	idx = seq >> ilog2 (BITS_PER_LONG);
+	if (seq > key->rxmax) {
+		if (!update) {
+			ok = true;
+			goto out;
+		}
+		cur = key->rxmax >> ilog2 (BITS_PER_LONG);
+		top = min_t (u64, idx - cur, AEAD_REPLAY_WORDS);
+		for (i=1; i<=top; i++)
+			key->replay[(cur + i) & (AEAD_REPLAY_WORDS - 1)] = 0;
+		key->rxmax = seq;
+	}
+	idx &= AEAD_REPLAY_WORDS - 1;
+	if (update) {
+		ok = !__test_and_set_bit (seq & (BITS_PER_LONG - 1), &key->replay[idx]);
+	} else {
+		ok = !test_bit (seq & (BITS_PER_LONG - 1), &key->replay[idx]);
+	}
+out:
+	spin_unlock (&key->rxlock);
+	return ok;
+}
+
+
+int
+ldt_aead_prtinfo (aead, buf, blen, spc)
+	struct ldt_aead	*aead;
+	char					*buf;
+	size_t				blen;
+	unsigned				spc;
+{
+	struct ldt_aead_key	*key;
+	int						len = 0, i;
+
+	if (!aead) return 0;
+	if (!rcu_access_pointer (aead->tx) && !rcu_access_pointer (aead->rx[0])
+			&& !READ_ONCE (aead->require))
+		return 0;
+#define _FSTR	(buf ? buf + len : NULL)
+#define _FLEN	(blen > len ? blen - len : 0)
+	len += snprintf (_FSTR, _FLEN, "%*c<aead require=\"%d\" encrypted=\"%lld\" "
+							"decrypted=\"%lld\" authfail=\"%lld\" replay=\"%lld\" "
+							"cleardrop=\"%lld\">\n", spc, ' ', READ_ONCE (aead->require),
+							(long long)atomic64_read (&aead->encrypted),
+							(long long)atomic64_read (&aead->decrypted),
+							(long long)atomic64_read (&aead->authfail),
+							(long long)atomic64_read (&aead->replay),
+							(long long)atomic64_read (&aead->cleardrop));
+	rcu_read_lock ();
+	key = rcu_dereference (aead->tx);
+	if (key) {
+		len += snprintf (_FSTR, _FLEN, "%*c<tx alg=\"%s\" keyid=\"%d\" "
+								"seq=\"%llu\"/>\n", spc+2, ' ', aead_prtname[key->alg],
+								(int)key->keyid,
+								(unsigned long long)atomic64_read (&key->txseq));
+	}
+	for (i=0; i<2; i++) {
+		key = rcu_dereference (aead->rx[i]);
+		if (!key) continue;
+		len += snprintf (_FSTR, _FLEN, "%*c<rx alg=\"%s\" keyid=\"%d\" "
+								"seq=\"%llu\"/>\n", spc+2, ' ', aead_prtname[key->alg],
+								(int)key->keyid, (unsigned long long)READ_ONCE (key->rxmax));
+	}
+	rcu_read_unlock ();
+	len += snprintf (_FSTR, _FLEN, "%*c</aead>\n", spc, ' ');
+	return len;
+#undef _FSTR
+#undef _FLEN
+}
+
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#ifndef _R__KERNEL_LDT_AEAD_H
+#define _R__KERNEL_LDT_AEAD_H
+
+#include <linux/types.h>
+#include <linux/skbuff.h>
+#include <linux/rcupdate.h>
+#include <linux/workqueue.h>
+#include "ldt_uapi.h"
+#include <linux/spinlock.h>
+#include <linux/atomic.h>
+
+/* aead protection of the tunnel payload - the packet is encrypted in
+ * place (header pushed in front, tag put behind) on sending and
+ * decrypted in place on receiving. Each key holds one transform per
+ * cpu, hence no locking is needed in the data path. The receive side
+ * keeps two keys to allow a seamless rotation.
+ */
+
+#define LDT_AEAD_REPLAY_BITS	1024
+
+struct ldt_aead_tfm;
+
+struct ldt_aead_key {
+	struct rcu_head				rcu;
+	struct work_struct			work;			/* frees the key */
+	struct ldt_aead_tfm __percpu	*tfm;
+	int								alg;				/* LDT_AEAD_* */
+	u8									keyid;
+	u8									salt[LDT_AEAD_SALTLEN];
+	u8									key[LDT_AEAD_MAXKEYLEN];	/* to detect reinstalls */
+	int								keylen;
+	atomic64_t						txseq;
+	spinlock_t						rxlock;
+	u64								rxmax;			/* highest seq seen */
+	unsigned long					replay[LDT_AEAD_REPLAY_BITS/BITS_PER_LONG];
+};
+
+struct ldt_aead {
+	struct ldt_aead_key __rcu	*tx;
+	struct ldt_aead_key __rcu	*rx[2];			/* current, previous */
+	int								require;
+	atomic64_t						encrypted;
+	atomic64_t						decrypted;
+	atomic64_t						authfail;
+	atomic64_t						replay;
+	atomic64_t						cleardrop;
+};
+
+
+int ldt_aead_global_init (void);
+void ldt_aead_global_exit (void);
+
+void ldt_aead_init (struct ldt_aead*);
+void ldt_aead_destroy (struct ldt_aead*);
+
+/* may sleep - key is the key followed by the salt */
+struct ldt_aead_key *ldt_aead_mkkey (int alg, const u8 *key, int keylen,
+											int keyid);
+/* frees a key never passed to ldt_aead_set() */
+void ldt_aead_freekey (struct ldt_aead_key*);
+/* takes over tx and rx - may be called from atomic context */
+int ldt_aead_set (struct ldt_aead*, struct ldt_aead_key *tx,
+						struct ldt_aead_key *rx, u32 flags);
+
+static inline int ldt_aead_txactive (
+	struct ldt_aead	*aead)
+{
+	return aead && rcu_access_pointer (aead->tx);
+}
+
+/* skb->data is the inner packet - returns 0 if no key is set
+ * server is the role of the local side, it goes into the nonce, so both
+ * directions never share a nonce even with the same key
+ */
+int ldt_aead_encrypt (struct ldt_aead*, struct sk_buff*, int server);
+/* returns 0 on success or for unprotected packets which are accepted,
+ * -EBADMSG if authentication failed or the packet was sent with our own
+ * role (reflected), -EALREADY for replayed packets
+ * -EACCES for unprotected packets not accepted
+ */
+int ldt_aead_decrypt (struct ldt_aead*, struct sk_buff*, int server);
+
+int ldt_aead_prtinfo (struct ldt_aead*, char *buf, size_t blen, unsigned spc);
+
+
+
+#endif	/* _R__KERNEL_LDT_AEAD_H */
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
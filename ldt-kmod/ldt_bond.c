@@ -0,0 +1,1445 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/version.h>
+#include <linux/slab.h>
+#include <linux/skbuff.h>
+#include <linux/netdevice.h>
+#include <linux/workqueue.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/string.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/udp.h>
+#include <net/sock.h>
+#include <net/udp.h>
+#include <net/udp_tunnel.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,12,0)
+# include <linux/unaligned.h>
+#else
+# include <asm/unaligned.h>
+#endif
+
+#include "ldt_uapi.h"
+#include "ldt_dev.h"
+#include "ldt_tun.h"
+#include "ldt_debug.h"
+#include "ldt_event.h"
+#include "ldt_addr.h"
+#include "ldt_prot1.h"
+#include "ldt_trace.h"
+#include "ldt_tunaddr.h"
+#include "ldt_queue.h"
+#include "ldt_rxsteer.h"
+#include "ldt_qos.h"
+#include "ldt_bond.h"
+
+
+#define BOND_RING			256		/* reorder window in packets */
+#define BOND_RATE_MIN		16000		/* bytes/s */
+#define BOND_MINRTT_WIN		(10*HZ)
+#define BOND_XMIT_BATCH		64
+
+struct bondtun;
+static int bondtun_new (struct ldt_tun*, const char*);
+static int bondtun_bind (struct bondtun*, tp_addr_t*, int);
+static int bondtun_peer (struct bondtun*, tp_addr_t*);
+static int bondtun_serverstart (struct bondtun*, int);
+static void bondtun_remove (struct bondtun*);
+static netdev_tx_t bondtun_xmit (struct bondtun*, struct sk_buff*);
+static ssize_t bondtun_getinfo (struct bondtun*, char*, size_t);
+static int bondtun_eventcreate (struct bondtun*, char*, size_t, const char*, const char*);
+static int bondtun_setrxsteer (struct bondtun*, struct ldt_rxsteer_cfg*);
+static int bondtun_setpaths (struct bondtun*, struct ldt_pathcfg*, int, int);
+static int bondtun_setqos (struct bondtun*, struct ldt_qos_state*);
+static int bondtun_mksock (struct bondtun*, tp_addr_t*, const char*, struct socket**);
+static void bondtun_closesk (struct bondtun*);
+static int bondtun_clisetup (struct bondtun*);
+static int bondtun_srvsetup (struct bondtun*);
+static struct bond_path *bondtun_sched (struct bondtun*, int, u64);
+static int bondtun_sendmsg (struct socket*, tp_addr_t*, u8*, int, void*, int);
+static int bondtun_send (struct bondtun*, struct sk_buff*);
+static void bondtun_sendctl (struct bondtun*, struct bond_path*, int);
+static int bondtun_encap_rcv (struct sock*, struct sk_buff*);
+static struct bond_path *bondtun_rxpath (struct bondtun*, int, tp_addr_t*);
+static void bondtun_ack (struct bondtun*, struct bond_path*, u64, u32, u32);
+static void bondtun_rxdata (struct bondtun*, u32, struct sk_buff*);
+static void bondtun_reorder (struct bondtun*, u32, struct sk_buff*, struct sk_buff_head*);
+static void bondtun_deliver (struct bondtun*, struct sk_buff*);
+static void setup_handler (struct work_struct*);
+static void xmit_handler (struct work_struct*);
+static void ack_handler (struct work_struct*);
+static void probe_handler (struct work_struct*);
+static void reorder_handler (struct work_struct*);
+static void destroy_handler (struct work_struct*);
+
+
+static struct ldt_tunops	bondtun_ops = {
+	.tp_new = bondtun_new,
+	.tp_bind = (void*)bondtun_bind,
+	.tp_peer = (void*)bondtun_peer,
+	.tp_serverstart = (void*)bondtun_serverstart,
+	.tp_remove = (void*)bondtun_remove,
+	.tp_xmit = (void*)bondtun_xmit,
+	.tp_gettuninfo = (void*)bondtun_getinfo,
+	.tp_createvent = (void*)bondtun_eventcreate,
+	.tp_setrxsteer = (void*)bondtun_setrxsteer,
+	.tp_setpaths = (void*)bondtun_setpaths,
+	.tp_setqos = (void*)bondtun_setqos,
+	.ipv6 = 0,
+};
+
+static struct ldt_tunops	bondtun_ops6 = {
+	.tp_new = bondtun_new,
+	.tp_bind = (void*)bondtun_bind,
+	.tp_peer = (void*)bondtun_peer,
+	.tp_serverstart = (void*)bondtun_serverstart,
+	.tp_remove = (void*)bondtun_remove,
+	.tp_xmit = (void*)bondtun_xmit,
+	.tp_gettuninfo = (void*)bondtun_getinfo,
+	.tp_createvent = (void*)bondtun_eventcreate,
+	.tp_setrxsteer = (void*)bondtun_setrxsteer,
+	.tp_setpaths = (void*)bondtun_setpaths,
+	.tp_setqos = (void*)bondtun_setqos,
+	.ipv6 = 1,
+};
+
+
+#define BONDTUN_MAGIC	(0xb0d7c3a1)
+#define ISBONDTUN(tdat) ((tdat) && (tdat)->MAGIC == BONDTUN_MAGIC)
+
+struct bond_path {
+	int					id;
+	u32					inuse:1,
+							up:1,
+							ownsock:1,
+							hasreport:1,
+							ackpending:1;
+	struct socket		*sock;
+	tp_addr_t			laddr, raddr;
+	char					dev[IFNAMSIZ];
+	u32					cfgrate;
+	/* scheduler */
+	u64					vt;				/* nsec - path is busy until */
+	u32					rate;				/* bytes/s - estimated capacity */
+	u32					delivered;		/* bytes/s - last measurement */
+	u32					srtt, minrtt;	/* usec */
+	unsigned long		minrtt_stamp;	/* jiffies */
+	unsigned long		last_ack;		/* jiffies */
+	/* probing */
+	u32					probeseq;
+	u64					probe_ts;		/* nsec - last probe sent */
+	u32					probe_txpkts;
+	u64					rep_ts;			/* last probe acked */
+	u32					rep_txpkts, rep_rxpkts, rep_rxbytes;
+	u64					ack_ts;			/* to be echoed */
+	/* statistics */
+	u64					tx_packets, tx_bytes;
+	u64					rx_packets, rx_bytes;
+	u64					lost, probes, acks;
+};
+
+struct bond_reorder {
+	u32					next;				/* next sequence number expected */
+	u32					started:1;
+	int					held;
+	unsigned long		gapstart;		/* jiffies */
+	unsigned long		timeout;			/* jiffies */
+	struct sk_buff		*ring[BOND_RING];
+	u64					inorder, reordered, late, skipped, dups;
+};
+
+struct bondtun {
+	u32						MAGIC;
+	struct ldt_tun			*tun;
+	struct net_device		*ndev;
+	const char				*name;
+	u32						tostop;
+	u32						ipv6:1,
+								isserver:1,
+								haspeer:1;
+	tp_tunaddr_t			addr;
+	struct mutex			cfgmtx;		/* sockets - process context only */
+	spinlock_t				lock;			/* paths */
+	struct bond_path		path[LDT_BOND_MAXPATH];
+	int						npath;
+	struct ldt_pathcfg	cfg[LDT_BOND_MAXPATH];
+	int						ncfg;
+	struct socket			*srvsock;
+	u32						txseq;
+	spinlock_t				rxlock;		/* reorder buffer */
+	struct bond_reorder	ro;
+	struct ldt_rxsteer	rxsteer;
+	struct ldt_qos			qos;
+	struct tp_queue		xmit_queue;
+	struct work_struct	work_setup;
+	struct delayed_work	work_xmit;
+	struct work_struct	work_ack;
+	struct delayed_work	work_probe;
+	struct delayed_work	work_reorder;
+	struct work_struct	work_destroy;
+};
+
+/* all work of the bonding tunnels - drained on unload */
+static struct workqueue_struct	*bond_wq = NULL;
+
+/* delay until the gap of the oldest held packet is given up */
+#define RO_DELAY(ro) (time_after ((ro)->gapstart + (ro)->timeout, jiffies) ? \
+							(ro)->gapstart + (ro)->timeout - jiffies : 0)
+
+#define ISSTOP(tdat) (smp_load_acquire(&(tdat->tostop)))
+#define CHKSTOP(ret) { if (ISSTOP(tdat)) { return (ret); } }
+#define CHKSTOPVOID	{ if (ISSTOP(tdat)) { return; } }
+
+
+
+int
+ldt_bond_register (void)
+{
+	int	ret;
+
+	bond_wq = alloc_workqueue ("ldt_bond", WQ_MEM_RECLAIM, 0);
+	if (!bond_wq) return -ENOMEM;
+	ret = ldt_tun_register ("bond", &bondtun_ops);
+	if (ret < 0) return ret;
+	ret = ldt_tun_register ("bond4", &bondtun_ops);
+	if (ret < 0) return ret;
+	ret = ldt_tun_register ("bond6", &bondtun_ops6);
+	if (ret < 0) return ret;
+	return 0;
+}
+
+void
+ldt_bond_unregister (void)
+{
+	ldt_tun_unregister ("bond");
+	ldt_tun_unregister ("bond4");
+	ldt_tun_unregister ("bond6");
+	if (bond_wq) {
+		/* waits for the pending destroy handlers */
+		destroy_workqueue (bond_wq);
+		bond_wq = NULL;
+	}
+}
+
+
+static
+int
+bondtun_new (tun, type)
+	struct ldt_tun	*tun;
+	const char		*type;
+{
+	struct bondtun	*tdat;
+	int				ipv6;
+
+	if (!tun || !tun->tdev || !tun->tdev->ndev || !type) return -EINVAL;
+	if (!strcasecmp (type, "bond6")) {
+		ipv6 = 1;
+	} else if (!strcasecmp (type, "bond4") || !strcasecmp (type, "bond")) {
+		ipv6 = 0;
+	} else {
+		return -ENOTSUPP;
+	}
+	tp_info ("create %s tunnel\n", type);
+	tdat = kzalloc (sizeof (struct bondtun), GFP_KERNEL);
+	if (!tdat) return -ENOMEM;
+	tdat->MAGIC = BONDTUN_MAGIC;
+	tdat->tun = tun;
+	tdat->ndev = tun->tdev->ndev;
+	tdat->name = tun->tdev->ndev->name;
+	tdat->ipv6 = ipv6;
+	tdat->ro.timeout = msecs_to_jiffies (LDT_BOND_REORDER_DEF);
+	if (ldt_rxsteer_init (&tdat->rxsteer, GFP_KERNEL) < 0) {
+		kfree (tdat);
+		return -ENOMEM;
+	}
+	ldt_tunaddr_init (&tdat->addr, ipv6);
+	ldt_qos_init (&tdat->qos);
+	mutex_init (&tdat->cfgmtx);
+	spin_lock_init (&tdat->lock);
+	spin_lock_init (&tdat->rxlock);
+	tpq_init (&tdat->xmit_queue, TP_QUEUE_DROP_NEWEST, 1000);
+	tpq_set_name (&tdat->xmit_queue, tdat->name);
+	INIT_WORK (&tdat->work_setup, setup_handler);
+	INIT_DELAYED_WORK (&tdat->work_xmit, xmit_handler);
+	INIT_WORK (&tdat->work_ack, ack_handler);
+	INIT_DELAYED_WORK (&tdat->work_probe, probe_handler);
+	INIT_DELAYED_WORK (&tdat->work_reorder, reorder_handler);
+	INIT_WORK (&tdat->work_destroy, destroy_handler);
+	tun->tundata = tdat;
+	tun->tunops = ipv6 ? &bondtun_ops6 : &bondtun_ops;
+	return 0;
+}
+
+
+/* the configuration calls are made under device lock - the sockets
+ * are (re)created by setup_handler
+ */
+static
+int
+bondtun_bind (tdat, addr, flags)
+	struct bondtun	*tdat;
+	tp_addr_t		*addr;
+	int				flags;
+{
+	int	ret;
+
+	if (!tdat) return -EINVAL;
+	if (!addr) return 0;
+	CHKSTOP(0);
+	ret = ldt_tunaddr_bind (&tdat->addr, addr, flags);
+	if (ret < 0) {
+		tp_err ("error copying address: %d\n", ret);
+		return ret;
+	}
+	if (tdat->isserver || tdat->haspeer)
+		queue_work (bond_wq, &tdat->work_setup);
+	return 0;
+}
+
+static
+int
+bondtun_peer (tdat, addr)
+	struct bondtun	*tdat;
+	tp_addr_t		*addr;
+{
+	int	ret;
+
+	if (!tdat) return -EINVAL;
+	CHKSTOP(-EPERM);
+	if (addr) {
+		ret = ldt_tunaddr_setpeer (&tdat->addr, addr, 0);
+		if (ret < 0) return ret;
+		tdat->haspeer = 1;
+	}
+	if (!tdat->haspeer) {
+		tp_err ("no peer address");
+		return -ENOTCONN;
+	}
+	if (tdat->isserver) {
+		tp_debug ("we are server - don't do anything\n");
+		return 0;
+	}
+	queue_work (bond_wq, &tdat->work_setup);
+	return 0;
+}
+
+static
+int
+bondtun_serverstart (tdat, flags)
+	struct bondtun	*tdat;
+	int				flags;
+{
+	if (!tdat) return -EINVAL;
+	CHKSTOP(-EPERM);
+	/* the paths are learned from one client only */
+	if (flags & LDT_SERVERSTART_F_MULTICLIENT) return -EOPNOTSUPP;
+	if (tdat->isserver) return 0;
+	tdat->isserver = 1;
+	queue_work (bond_wq, &tdat->work_setup);
+	return 0;
+}
+
+/* called under device lock - must not sleep */
+static
+int
+bondtun_setrxsteer (tdat, cfg)
+	struct bondtun				*tdat;
+	struct ldt_rxsteer_cfg	*cfg;
+{
+	if (!tdat) return -EINVAL;
+	CHKSTOP(-EPERM);
+	ldt_rxsteer_set (&tdat->rxsteer, cfg);
+	return 0;
+}
+
+/* called under device lock - must not sleep */
+static
+int
+bondtun_setqos (tdat, st)
+	struct bondtun				*tdat;
+	struct ldt_qos_state		*st;
+{
+	if (!tdat) return -EINVAL;
+	CHKSTOP(-EPERM);
+	ldt_qos_set (&tdat->qos, st);
+	return 0;
+}
+
+/* called under device lock - must not sleep */
+static
+int
+bondtun_setpaths (tdat, cfg, num, reorder)
+	struct bondtun			*tdat;
+	struct ldt_pathcfg	*cfg;
+	int						num, reorder;
+{
+	if (!tdat) return -EINVAL;
+	CHKSTOP(-EPERM);
+	if (num > LDT_BOND_MAXPATH) return -ERANGE;
+	if (num > 0 && !cfg) return -EINVAL;
+	if (reorder > LDT_BOND_REORDER_MAX) return -ERANGE;
+	if (reorder >= 0) {
+		spin_lock_bh (&tdat->rxlock);
+		tdat->ro.timeout = msecs_to_jiffies (reorder);
+		spin_unlock_bh (&tdat->rxlock);
+	}
+	if (num < 0) return 0;
+	spin_lock_bh (&tdat->lock);
+	if (num > 0) memcpy (tdat->cfg, cfg, num * sizeof (*cfg));
+	tdat->ncfg = num;
+	spin_unlock_bh (&tdat->lock);
+	/* the server learns the paths of the client */
+	if (!tdat->isserver && tdat->haspeer)
+		queue_work (bond_wq, &tdat->work_setup);
+	return 0;
+}
+
+
+static
+void
+bondtun_remove (tdat)
+	struct bondtun	*tdat;
+{
+	if (!tdat) return;
+	if (ISSTOP(tdat)) return;
+	smp_store_release (&(tdat->tostop), 1);
+	if (tdat->tun) {
+		tdat->tun->tundata = NULL;
+		tdat->tun->tunops = NULL;
+	}
+	/* we are called under device lock - the sockets are closed and the
+	 * handlers are waited for in destroy_handler */
+	queue_work (bond_wq, &tdat->work_destroy);
+}
+
+static
+void
+destroy_handler (work)
+	struct work_struct	*work;
+{
+	struct bondtun	*tdat;
+	int				i;
+
+	if (!work) return;
+	tdat = container_of (work, struct bondtun, work_destroy);
+	cancel_work_sync (&tdat->work_setup);
+	mutex_lock (&tdat->cfgmtx);
+	bondtun_closesk (tdat);
+	mutex_unlock (&tdat->cfgmtx);
+	/* no receive handler uses tdat anymore - hence nothing requeues */
+	synchronize_rcu ();
+	cancel_delayed_work_sync (&tdat->work_xmit);
+	cancel_work_sync (&tdat->work_ack);
+	cancel_delayed_work_sync (&tdat->work_probe);
+	cancel_delayed_work_sync (&tdat->work_reorder);
+	for (i=0; i<BOND_RING; i++) {
+		if (tdat->ro.ring[i]) kfree_skb (tdat->ro.ring[i]);
+	}
+	tpq_destroy (&tdat->xmit_queue);
+	ldt_rxsteer_destroy (&tdat->rxsteer);
+	ldt_qos_destroy (&tdat->qos);
+	/* poison struct */
+	tdat->MAGIC = 0;
+	kfree (tdat);
+}
+
+
+static
+void
+setup_handler (work)
+	struct work_struct	*work;
+{
+	struct bondtun	*tdat;
+	int				ret = 0;
+
+	if (!work) return;
+	tdat = container_of (work, struct bondtun, work_setup);
+	CHKSTOPVOID;
+	mutex_lock (&tdat->cfgmtx);
+	bondtun_closesk (tdat);
+	if (tdat->isserver) {
+		ret = bondtun_srvsetup (tdat);
+	} else if (tdat->haspeer) {
+		ret = bondtun_clisetup (tdat);
+	}
+	mutex_unlock (&tdat->cfgmtx);
+	if (ret < 0) {
+		tp_err ("%s: cannot set up paths: %d\n", tdat->name, ret);
+		ldt_event_crsend (LDT_EVTYPE_CONN_ESTAB_FAIL, tdat->tun, (-1)*ret);
+		return;
+	}
+	mod_delayed_work (bond_wq, &tdat->work_probe, 0);
+}
+
+/* called with cfgmtx held */
+static
+int
+bondtun_clisetup (tdat)
+	struct bondtun	*tdat;
+{
+	struct ldt_pathcfg	cfg[LDT_BOND_MAXPATH];
+	struct bond_path		np;
+	struct socket			*sock;
+	tp_addr_t				laddr;
+	int						i, num, ret;
+
+	if (!tdat->addr.hasraddr) return -ENOTCONN;
+	spin_lock_bh (&tdat->lock);
+	num = tdat->ncfg;
+	memcpy (cfg, tdat->cfg, num * sizeof (cfg[0]));
+	spin_unlock_bh (&tdat->lock);
+	if (num == 0) {
+		/* the tunnel's address is the only path */
+		memset (&cfg[0], 0, sizeof (cfg[0]));
+		if (tdat->addr.bound) {
+			tp_addr_cp (&cfg[0].local, &tdat->addr.laddr);
+		} else {
+			cfg[0].local.ad.sa_family = AF_UNSPEC;
+		}
+		num = 1;
+	}
+	for (i=0; i<num; i++) {
+		if (TP_ADDR_FAM(cfg[i].local) == AF_UNSPEC) {
+			memset (&laddr, 0, sizeof (laddr));
+			laddr.ad.sa_family = tdat->ipv6 ? AF_INET6 : AF_INET;
+		} else {
+			tp_addr_cp (&laddr, &cfg[i].local);
+		}
+		if (TP_ADDR_FAM(laddr) != TP_ADDR_FAM(tdat->addr.raddr)) {
+			tp_err ("%s: path %d - wrong address family\n", tdat->name, i);
+			return -EINVAL;
+		}
+		ret = bondtun_mksock (tdat, &laddr, cfg[i].dev, &sock);
+		if (ret < 0) return ret;
+		np = (struct bond_path) {
+			.id = i,
+			.inuse = 1,
+			.up = 1,				/* until the first probe is unanswered */
+			.ownsock = 1,
+			.sock = sock,
+			.cfgrate = cfg[i].rate,
+			.rate = cfg[i].rate ? cfg[i].rate : LDT_BOND_RATE_INIT,
+			.last_ack = jiffies,
+		};
+		tp_addr_cp (&np.laddr, &laddr);
+		tp_addr_cp (&np.raddr, &tdat->addr.raddr);
+		strscpy (np.dev, cfg[i].dev, sizeof (np.dev));
+		spin_lock_bh (&tdat->lock);
+		tdat->path[i] = np;
+		tdat->npath = i+1;
+		spin_unlock_bh (&tdat->lock);
+	}
+	tp_debug ("%s: %d paths set up\n", tdat->name, num);
+	return 0;
+}
+
+/* called with cfgmtx held */
+static
+int
+bondtun_srvsetup (tdat)
+	struct bondtun	*tdat;
+{
+	struct socket	*sock;
+	int				ret;
+
+	if (!tdat->addr.bound || tdat->addr.anylport) {
+		tp_err ("server cannot bind to anyport\n");
+		return -ENOTCONN;
+	}
+	ret = bondtun_mksock (tdat, &tdat->addr.laddr, NULL, &sock);
+	if (ret < 0) return ret;
+	spin_lock_bh (&tdat->lock);
+	tdat->srvsock = sock;
+	spin_unlock_bh (&tdat->lock);
+	return 0;
+}
+
+static
+int
+bondtun_mksock (tdat, laddr, dev, osock)
+	struct bondtun	*tdat;
+	tp_addr_t		*laddr;
+	const char		*dev;
+	struct socket	**osock;
+{
+	struct udp_port_cfg			cfg;
+	struct udp_tunnel_sock_cfg	tcfg;
+	struct net						*net = NDEV2NET(tdat->ndev);
+	struct net_device				*ndev;
+	struct socket					*sock;
+	int								ifindex = 0;
+	int								ret;
+
+	memset (&cfg, 0, sizeof (cfg));
+	if (TP_ADDRP_ISIPV6(laddr)) {
+#if IS_ENABLED(CONFIG_IPV6)
+		cfg.family = AF_INET6;
+		memcpy (&cfg.local_ip6, &laddr->v6.sin6_addr, sizeof (cfg.local_ip6));
+		cfg.local_udp_port = laddr->v6.sin6_port;
+		cfg.ipv6_v6only = 1;
+#else
+		return -EAFNOSUPPORT;
+#endif
+	} else {
+		cfg.family = AF_INET;
+		cfg.local_ip.s_addr = laddr->v4.sin_addr.s_addr;
+		cfg.local_udp_port = laddr->v4.sin_port;
+	}
+	if (dev && *dev) {
+		ndev = dev_get_by_name (net, dev);
+		if (!ndev) {
+			tp_err ("%s: no such interface %s\n", tdat->name, dev);
+			return -ENODEV;
+		}
+		ifindex = ndev->ifindex;
+		dev_put (ndev);
+	}
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0)
+	cfg.bind_ifindex = ifindex;
+#endif
+	ret = udp_sock_create (net, &cfg, &sock);
+	if (ret < 0) {
+		tp_err ("error creating socket: %d", ret);
+		return ret;
+	}
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,8,0)
+	if (ifindex > 0) {
+		ret = kernel_setsockopt (sock, SOL_SOCKET, SO_BINDTODEVICE,
+										(char*)dev, strnlen (dev, IFNAMSIZ));
+		if (ret < 0) {
+			tp_err ("cannot bind socket to %s: %d\n", dev, ret);
+			udp_tunnel_sock_release (sock);
+			return ret;
+		}
+	}
+#endif
+	tcfg = (struct udp_tunnel_sock_cfg) {
+		.sk_user_data = tdat,
+		.encap_type = 1,
+		.encap_rcv = bondtun_encap_rcv,
+	};
+	setup_udp_tunnel_sock (net, sock, &tcfg);
+	*osock = sock;
+	return 0;
+}
+
+/* called with cfgmtx held */
+static
+void
+bondtun_closesk (tdat)
+	struct bondtun	*tdat;
+{
+	struct socket	*sock[LDT_BOND_MAXPATH+1];
+	int				i, num = 0;
+
+	spin_lock_bh (&tdat->lock);
+	for (i=0; i<tdat->npath; i++) {
+		if (tdat->path[i].inuse && tdat->path[i].ownsock && tdat->path[i].sock)
+			sock[num++] = tdat->path[i].sock;
+		tdat->path[i].inuse = 0;
+		tdat->path[i].sock = NULL;
+	}
+	tdat->npath = 0;
+	if (tdat->srvsock) sock[num++] = tdat->srvsock;
+	tdat->srvsock = NULL;
+	spin_unlock_bh (&tdat->lock);
+	for (i=0; i<num; i++) udp_tunnel_sock_release (sock[i]);
+}
+
+
+
+static
+netdev_tx_t
+bondtun_xmit (tdat, skb)
+	struct bondtun		*tdat;
+	struct sk_buff		*skb;
+{
+	if (!tdat || !skb) {
+		if (skb) kfree_skb (skb);
+		return NETDEV_TX_OK;
+	}
+	if (ISSTOP(tdat) || !READ_ONCE (tdat->npath)) {
+		trace_ldt_drop (tdat->name, skb->len, tpq_len (&tdat->xmit_queue),
+								LDT_DROP_NOTCONN);
+		kfree_skb (skb);
+		return NETDEV_TX_OK;
+	}
+	if (tpq_isfull (&tdat->xmit_queue)) {
+		tp_debug3 ("we are busy");
+		return NETDEV_TX_BUSY;
+	}
+	/* keep the mark for the outer class */
+	skb_scrub_packet (skb, false);
+	tpq_enqueue (&tdat->xmit_queue, skb);
+	queue_delayed_work (bond_wq, &tdat->work_xmit, 0);
+	return NETDEV_TX_OK;
+}
+
+static
+void
+xmit_handler (work)
+	struct work_struct	*work;
+{
+	struct delayed_work	*dwork;
+	struct bondtun			*tdat;
+	struct sk_buff			*skb;
+	int						cnt = 0, ret = 0;
+
+	if (!work) return;
+	dwork = container_of (work, struct delayed_work, work);
+	tdat = container_of (dwork, struct bondtun, work_xmit);
+	CHKSTOPVOID;
+	mutex_lock (&tdat->cfgmtx);
+	while (cnt < BOND_XMIT_BATCH && (skb = tpq_dequeue (&tdat->xmit_queue))) {
+		ret = bondtun_send (tdat, skb);
+		if (ret == -EAGAIN) {
+			tpq_requeue (&tdat->xmit_queue, skb);
+			break;
+		}
+		cnt++;
+	}
+	mutex_unlock (&tdat->cfgmtx);
+	if (tpq_len (&tdat->xmit_queue) > 0) {
+		/* socket buffer full - retry with the next tick */
+		queue_delayed_work (bond_wq, &tdat->work_xmit, ret == -EAGAIN ? 1 : 0);
+	}
+}
+
+/* called with cfgmtx held - the sequence number is used only when the
+ * packet was sent, so a requeued packet does not leave a gap
+ */
+static
+int
+bondtun_send (tdat, skb)
+	struct bondtun		*tdat;
+	struct sk_buff		*skb;
+{
+	struct bond_path	*p;
+	struct socket		*sock;
+	tp_addr_t			raddr;
+	u8						hdr[LDT_BOND_HDRLEN];
+	int					id, ret, len;
+
+	len = skb->len;
+	if (skb_linearize (skb) < 0) {
+		ret = -ENOMEM;
+		goto drop;
+	}
+	spin_lock_bh (&tdat->lock);
+	p = bondtun_sched (tdat, len, ktime_get_ns ());
+	if (!p) {
+		spin_unlock_bh (&tdat->lock);
+		ret = -ENOTCONN;
+		goto drop;
+	}
+	id = p->id;
+	sock = p->sock;
+	tp_addr_cp (&raddr, &p->raddr);
+	spin_unlock_bh (&tdat->lock);
+
+	hdr[0] = 0x50 | LDT_BOND_T_DATA;
+	hdr[1] = id;
+	hdr[2] = hdr[3] = 0;
+	put_unaligned_be32 (tdat->txseq, hdr + 4);
+	ldt_qos_apply (&tdat->qos, sock->sk, skb);
+	ret = bondtun_sendmsg (sock, &raddr, hdr, sizeof (hdr), skb->data, len);
+	trace_ldt_send (tdat->name, len, ret);
+	if (ret == -EAGAIN) return ret;
+	if (ret < 0) goto drop;
+	tdat->txseq++;
+	spin_lock_bh (&tdat->lock);
+	if (p->inuse) {
+		p->tx_packets++;
+		p->tx_bytes += len;
+	}
+	spin_unlock_bh (&tdat->lock);
+	tdat->ndev->stats.tx_packets++;
+	tdat->ndev->stats.tx_bytes += len;
+	consume_skb (skb);
+	return 0;
+
+drop:
+	tdat->ndev->stats.tx_dropped++;
+	if (ret != -ENOTCONN) tdat->ndev->stats.tx_errors++;
+	trace_ldt_drop (tdat->name, len, tpq_len (&tdat->xmit_queue),
+							ret == -ENOTCONN ? LDT_DROP_NOTCONN : LDT_DROP_XMIT);
+	kfree_skb (skb);
+	return ret;
+}
+
+/* earliest arrival first: each path is busy for len/rate per packet,
+ * the packet takes the path where it arrives first (including half
+ * the rtt). Called with lock held.
+ */
+static
+struct bond_path*
+bondtun_sched (tdat, len, now)
+	struct bondtun	*tdat;
+	int				len;
+	u64				now;
+{
+	struct bond_path	*p, *best = NULL;
+	u64					start, arrive, bestarrive = U64_MAX;
+	int					i;
+
+	for (i=0; i<tdat->npath; i++) {
+		p = &tdat->path[i];
+		if (!p->inuse || !p->up || !p->sock) continue;
+		start = max (p->vt, now);
+		arrive = start + div_u64 ((u64)len * NSEC_PER_SEC, p->rate)
+						+ (u64)p->srtt * (NSEC_PER_USEC / 2);
+		if (arrive < bestarrive) {
+			bestarrive = arrive;
+			best = p;
+		}
+	}
+	if (!best) return NULL;
+	start = max (best->vt, now);
+	best->vt = start + div_u64 ((u64)len * NSEC_PER_SEC, best->rate);
+	/* an overloaded path must not be blocked for ever */
+	if (best->vt > now + NSEC_PER_SEC) best->vt = now + NSEC_PER_SEC;
+	return best;
+}
+
+static
+int
+bondtun_sendmsg (sock, raddr, hdr, hlen, data, dlen)
+	struct socket	*sock;
+	tp_addr_t		*raddr;
+	u8					*hdr;
+	int				hlen;
+	void				*data;
+	int				dlen;
+{
+	struct kvec		kvec[2] = {
+		{ .iov_base = hdr, .iov_len = hlen, },
+		{ .iov_base = data, .iov_len = dlen, },
+	};
+	struct msghdr	msg = {
+		.msg_name = &raddr->ad,
+		.msg_namelen = TP_ADDRP_SIZE(raddr),
+		.msg_flags = MSG_DONTWAIT,
+	};
+	int				ret;
+
+	if (!sock) return -ENOTCONN;
+	ret = kernel_sendmsg (sock, &msg, kvec, dlen > 0 ? 2 : 1, hlen + dlen);
+	return ret < 0 ? ret : 0;
+}
+
+
+/* sends a probe or the ack of the last probe received - called with
+ * cfgmtx held
+ */
+static
+void
+bondtun_sendctl (tdat, p, kind)
+	struct bondtun		*tdat;
+	struct bond_path	*p;
+	int					kind;
+{
+	u8					buf[LDT_BOND_HDRLEN + LDT_BOND_CTLLEN];
+	struct socket	*sock;
+	tp_addr_t		raddr;
+	u32				seq;
+
+	memset (buf, 0, sizeof (buf));
+	spin_lock_bh (&tdat->lock);
+	if (!p->inuse || !p->sock) {
+		spin_unlock_bh (&tdat->lock);
+		return;
+	}
+	if (kind == LDT_BOND_T_PROBE) {
+		seq = ++p->probeseq;
+		p->probe_ts = ktime_get_ns ();
+		p->probe_txpkts = (u32)p->tx_packets;
+		p->probes++;
+		put_unaligned_be64 (p->probe_ts, buf + LDT_BOND_HDRLEN);
+	} else {
+		if (!p->ackpending) {
+			spin_unlock_bh (&tdat->lock);
+			return;
+		}
+		p->ackpending = 0;
+		seq = 0;
+		put_unaligned_be64 (p->ack_ts, buf + LDT_BOND_HDRLEN);
+		put_unaligned_be32 ((u32)p->rx_packets, buf + LDT_BOND_HDRLEN + 8);
+		put_unaligned_be32 ((u32)p->rx_bytes, buf + LDT_BOND_HDRLEN + 12);
+	}
+	sock = p->sock;
+	tp_addr_cp (&raddr, &p->raddr);
+	buf[0] = 0x50 | kind;
+	buf[1] = p->id;
+	put_unaligned_be32 (seq, buf + 4);
+	spin_unlock_bh (&tdat->lock);
+	bondtun_sendmsg (sock, &raddr, buf, sizeof (buf), NULL, 0);
+}
+
+static
+void
+ack_handler (work)
+	struct work_struct	*work;
+{
+	struct bondtun	*tdat;
+	int				i;
+
+	if (!work) return;
+	tdat = container_of (work, struct bondtun, work_ack);
+	CHKSTOPVOID;
+	mutex_lock (&tdat->cfgmtx);
+	for (i=0; i<READ_ONCE (tdat->npath); i++)
+		bondtun_sendctl (tdat, &tdat->path[i], LDT_BOND_T_ACK);
+	mutex_unlock (&tdat->cfgmtx);
+}
+
+/* probes all paths - a path without ack for LDT_BOND_DEAD is taken out
+ * of the schedule until it answers again
+ */
+static
+void
+probe_handler (work)
+	struct work_struct	*work;
+{
+	struct delayed_work	*dwork;
+	struct bondtun			*tdat;
+	struct bond_path		*p;
+	unsigned long			dead = msecs_to_jiffies (LDT_BOND_DEAD);
+	int						i, up, down;
+
+	if (!work) return;
+	dwork = container_of (work, struct delayed_work, work);
+	tdat = container_of (dwork, struct bondtun, work_probe);
+	CHKSTOPVOID;
+	mutex_lock (&tdat->cfgmtx);
+	for (i=0; i<READ_ONCE (tdat->npath); i++) {
+		p = &tdat->path[i];
+		spin_lock_bh (&tdat->lock);
+		up = p->inuse && time_before (jiffies, p->last_ack + dead);
+		down = p->up && !up;
+		if (down) p->up = 0;
+		spin_unlock_bh (&tdat->lock);
+		if (down) tp_note ("%s: path %d is down\n", tdat->name, i);
+		bondtun_sendctl (tdat, p, LDT_BOND_T_PROBE);
+	}
+	mutex_unlock (&tdat->cfgmtx);
+	queue_delayed_work (bond_wq, &tdat->work_probe,
+								msecs_to_jiffies (LDT_BOND_PROBE));
+}
+
+
+static
+int
+bondtun_encap_rcv (sk, skb)
+	struct sock			*sk;
+	struct sk_buff		*skb;
+{
+	struct bondtun		*tdat;
+	struct bond_path	*p;
+	tp_addr_t			src;
+	u8						*hdr;
+	int					kind, id, len;
+	u32					seq;
+
+	tdat = rcu_dereference_sk_user_data (sk);
+	if (!ISBONDTUN(tdat) || ISSTOP(tdat)) goto drop;
+	/* the data packet is an ip packet, hence always longer */
+	if (!pskb_may_pull (skb, sizeof (struct udphdr) + LDT_BOND_HDRLEN
+									+ LDT_BOND_CTLLEN)) {
+		goto bad;
+	}
+	if (ip_hdr (skb)->version == 4) {
+		tp_addr_setipv4 (&src, ip_hdr (skb)->saddr, ntohs (udp_hdr (skb)->source));
+	} else {
+		tp_addr_setipv6 (&src, ipv6_hdr (skb)->saddr.s6_addr,
+								ntohs (udp_hdr (skb)->source));
+	}
+	hdr = skb->data + sizeof (struct udphdr);
+	if (TP_GETPKTTYPE (hdr[0]) != 5) goto bad;
+	kind = hdr[0] & 0x0f;
+	id = hdr[1];
+	seq = get_unaligned_be32 (hdr + 4);
+	if (id >= LDT_BOND_MAXPATH) goto bad;
+	__skb_pull (skb, sizeof (struct udphdr) + LDT_BOND_HDRLEN);
+	/* the outer checksum does not cover the inner packet */
+	skb->ip_summed = CHECKSUM_NONE;
+	len = skb->len;
+
+	spin_lock_bh (&tdat->lock);
+	p = bondtun_rxpath (tdat, id, &src);
+	if (!p) {
+		spin_unlock_bh (&tdat->lock);
+		goto drop;
+	}
+	switch (kind) {
+	case LDT_BOND_T_DATA:
+		p->rx_packets++;
+		p->rx_bytes += len;
+		spin_unlock_bh (&tdat->lock);
+		trace_ldt_recv (tdat->name, len, len);
+		bondtun_rxdata (tdat, seq, skb);
+		return 0;
+	case LDT_BOND_T_PROBE:
+		p->ack_ts = get_unaligned_be64 (skb->data);
+		p->ackpending = 1;
+		spin_unlock_bh (&tdat->lock);
+		queue_work (bond_wq, &tdat->work_ack);
+		break;
+	case LDT_BOND_T_ACK:
+		bondtun_ack (tdat, p, get_unaligned_be64 (skb->data),
+							get_unaligned_be32 (skb->data + 8),
+							get_unaligned_be32 (skb->data + 12));
+		spin_unlock_bh (&tdat->lock);
+		break;
+	default:
+		spin_unlock_bh (&tdat->lock);
+		goto bad;
+	}
+	consume_skb (skb);
+	return 0;
+
+bad:
+	if (ISBONDTUN(tdat)) {
+		trace_ldt_drop (tdat->name, skb->len, 0, LDT_DROP_BADMSG);
+		tdat->ndev->stats.rx_errors++;
+	}
+drop:
+	kfree_skb (skb);
+	return 0;
+}
+
+/* the server learns the paths (and their nat mappings) from the
+ * client's packets - called with lock held
+ */
+static
+struct bond_path*
+bondtun_rxpath (tdat, id, src)
+	struct bondtun	*tdat;
+	int				id;
+	tp_addr_t		*src;
+{
+	struct bond_path	*p = &tdat->path[id];
+
+	if (!tdat->isserver) return p->inuse ? p : NULL;
+	if (!tdat->srvsock) return NULL;
+	if (!p->inuse) {
+		*p = (struct bond_path) {
+			.id = id,
+			.inuse = 1,
+			.up = 1,
+			.sock = tdat->srvsock,
+			.rate = LDT_BOND_RATE_INIT,
+			.last_ack = jiffies,
+		};
+		tp_addr_cp (&p->laddr, &tdat->addr.laddr);
+		if (id >= tdat->npath) WRITE_ONCE (tdat->npath, id+1);
+		tp_note ("%s: new path %d\n", tdat->name, id);
+	}
+	if (!tp_addr_eq (&p->raddr, src)) tp_addr_cp (&p->raddr, src);
+	return p;
+}
+
+/* rtt and delivery rate - the rate is lowered to what was delivered
+ * on loss or a growing rtt, and raised by a quarter when the path
+ * delivers what it is given. Called with lock held.
+ */
+static
+void
+bondtun_ack (tdat, p, ts, rxpkts, rxbytes)
+	struct bondtun		*tdat;
+	struct bond_path	*p;
+	u64					ts;
+	u32					rxpkts, rxbytes;
+{
+	u64	now = ktime_get_ns ();
+	u64	dt, delivered, rate;
+	u32	rtt, dtx, drx, lost;
+	int	congested;
+
+	if (ts > now || now - ts > 10ULL * NSEC_PER_SEC) return;
+	rtt = (u32)div_u64 (now - ts, NSEC_PER_USEC);
+	if (!rtt) rtt = 1;
+	p->srtt = p->srtt ? (p->srtt * 7 + rtt) / 8 : rtt;
+	if (!p->minrtt || rtt < p->minrtt ||
+			time_after (jiffies, p->minrtt_stamp + BOND_MINRTT_WIN)) {
+		p->minrtt = rtt;
+		p->minrtt_stamp = jiffies;
+	}
+	p->last_ack = jiffies;
+	p->acks++;
+	if (!p->up) {
+		p->up = 1;
+		p->vt = 0;
+		tp_note ("%s: path %d is up\n", tdat->name, p->id);
+	}
+	/* the rate needs the counters of the last probe sent */
+	if (ts != p->probe_ts) return;
+	if (p->hasreport && ts > p->rep_ts) {
+		dt = ts - p->rep_ts;
+		dtx = p->probe_txpkts - p->rep_txpkts;
+		drx = rxpkts - p->rep_rxpkts;
+		lost = (drx < dtx) ? dtx - drx : 0;
+		p->lost += lost;
+		delivered = div64_u64 ((u64)(u32)(rxbytes - p->rep_rxbytes)
+										* NSEC_PER_SEC, dt);
+		p->delivered = (u32)min_t (u64, delivered, LDT_BOND_RATE_MAX);
+		congested = lost > 0 || p->srtt > p->minrtt + max (p->minrtt / 2, 5000U);
+		rate = p->rate;
+		if (congested) {
+			rate = max_t (u64, delivered, BOND_RATE_MIN);
+		} else if (delivered * 4 >= rate * 3) {
+			rate += rate / 4;
+		}
+		p->rate = (u32)min_t (u64, max_t (u64, rate, BOND_RATE_MIN),
+										LDT_BOND_RATE_MAX);
+	}
+	p->rep_ts = ts;
+	p->rep_txpkts = p->probe_txpkts;
+	p->rep_rxpkts = rxpkts;
+	p->rep_rxbytes = rxbytes;
+	p->hasreport = 1;
+}
+
+
+static
+void
+bondtun_rxdata (tdat, seq, skb)
+	struct bondtun		*tdat;
+	u32					seq;
+	struct sk_buff		*skb;
+{
+	struct sk_buff_head	q;
+	unsigned long			timeout;
+	int						held;
+
+	__skb_queue_head_init (&q);
+	spin_lock_bh (&tdat->rxlock);
+	bondtun_reorder (tdat, seq, skb, &q);
+	held = tdat->ro.held;
+	timeout = RO_DELAY(&tdat->ro);
+	spin_unlock_bh (&tdat->rxlock);
+	if (held) queue_delayed_work (bond_wq, &tdat->work_reorder, timeout);
+	while ((skb = __skb_dequeue (&q))) bondtun_deliver (tdat, skb);
+}
+
+/* releases the slot of the next expected packet - called with rxlock held */
+static
+void
+bond_ro_pop (ro, q)
+	struct bond_reorder	*ro;
+	struct sk_buff_head	*q;
+{
+	struct sk_buff	*skb;
+
+	skb = ro->ring[ro->next % BOND_RING];
+	if (skb) {
+		ro->ring[ro->next % BOND_RING] = NULL;
+		ro->held--;
+		__skb_queue_tail (q, skb);
+	} else {
+		ro->skipped++;
+	}
+	ro->next++;
+}
+
+/* called with rxlock held - the packets to deliver are put on q */
+static
+void
+bondtun_reorder (tdat, seq, skb, q)
+	struct bondtun			*tdat;
+	u32						seq;
+	struct sk_buff			*skb;
+	struct sk_buff_head	*q;
+{
+	struct bond_reorder	*ro = &tdat->ro;
+	s32						d;
+	int						held = ro->held;
+
+	if (!ro->started) {
+		ro->next = seq;
+		ro->started = 1;
+	}
+	d = (s32)(seq - ro->next);
+	if (d < -(s32)(4*BOND_RING) || d >= (s32)(2*BOND_RING)) {
+		/* the peer restarted - start over */
+		while (ro->held) bond_ro_pop (ro, q);
+		ro->next = seq;
+		d = 0;
+	} else if (d < 0) {
+		/* its gap was given up already */
+		ro->late++;
+		__skb_queue_tail (q, skb);
+		return;
+	}
+	while ((s32)(seq - ro->next) >= BOND_RING) bond_ro_pop (ro, q);
+	if (seq != ro->next) {
+		if (ro->ring[seq % BOND_RING]) {
+			ro->dups++;
+			kfree_skb (skb);
+			return;
+		}
+		ro->ring[seq % BOND_RING] = skb;
+		ro->held++;
+		ro->reordered++;
+		if (!held) ro->gapstart = jiffies;
+		/* the window may have been moved onto held packets */
+		while (ro->held && ro->ring[ro->next % BOND_RING]) bond_ro_pop (ro, q);
+		return;
+	}
+	ro->inorder++;
+	__skb_queue_tail (q, skb);
+	ro->next++;
+	while (ro->held && ro->ring[ro->next % BOND_RING]) bond_ro_pop (ro, q);
+	/* the next gap starts waiting now */
+	if (ro->held) ro->gapstart = jiffies;
+}
+
+/* gives up the gap in front of the oldest held packet */
+static
+void
+reorder_handler (work)
+	struct work_struct	*work;
+{
+	struct delayed_work	*dwork;
+	struct bondtun			*tdat;
+	struct bond_reorder	*ro;
+	struct sk_buff_head	q;
+	struct sk_buff			*skb;
+	unsigned long			timeout = 0;
+	int						held;
+
+	if (!work) return;
+	dwork = container_of (work, struct delayed_work, work);
+	tdat = container_of (dwork, struct bondtun, work_reorder);
+	CHKSTOPVOID;
+	ro = &tdat->ro;
+	__skb_queue_head_init (&q);
+	spin_lock_bh (&tdat->rxlock);
+	if (ro->held && time_after_eq (jiffies, ro->gapstart + ro->timeout)) {
+		while (!ro->ring[ro->next % BOND_RING]) bond_ro_pop (ro, &q);
+		while (ro->held && ro->ring[ro->next % BOND_RING]) bond_ro_pop (ro, &q);
+		if (ro->held) ro->gapstart = jiffies;
+	}
+	held = ro->held;
+	if (held) timeout = RO_DELAY(ro);
+	spin_unlock_bh (&tdat->rxlock);
+	if (held) queue_delayed_work (bond_wq, &tdat->work_reorder, timeout);
+	local_bh_disable ();
+	while ((skb = __skb_dequeue (&q))) bondtun_deliver (tdat, skb);
+	local_bh_enable ();
+}
+
+static
+void
+bondtun_deliver (tdat, skb)
+	struct bondtun		*tdat;
+	struct sk_buff		*skb;
+{
+	int	ret, sz;
+
+	if (!skb->len || !pskb_may_pull (skb, min_t (int, skb->len,
+												sizeof (struct ipv6hdr)))) {
+		goto bad;
+	}
+	switch (TP_GETPKTTYPE (skb->data[0])) {
+	case 4:
+		skb->protocol = htons (ETH_P_IP);
+		break;
+	case 6:
+		skb->protocol = htons (ETH_P_IPV6);
+		break;
+	default:
+		goto bad;
+	}
+	skb_scrub_packet (skb, true);
+	skb->dev = tdat->ndev;
+	skb->pkt_type = PACKET_HOST;
+	skb_reset_network_header (skb);
+	sz = skb->len;
+	ret = ldt_rxsteer_rx (&tdat->rxsteer, skb);
+	trace_ldt_deliver (tdat->name, sz, ret);
+	if (ret != NET_RX_SUCCESS) {
+		trace_ldt_drop (tdat->name, sz, 0, LDT_DROP_NETIF);
+		/* skb must not be freed here! */
+	}
+	tdat->ndev->stats.rx_packets++;
+	tdat->ndev->stats.rx_bytes += sz;
+	return;
+
+bad:
+	tp_debug ("received unsupported packet type\n");
+	trace_ldt_drop (tdat->name, skb->len, 0, LDT_DROP_BADMSG);
+	tdat->ndev->stats.rx_errors++;
+	kfree_skb (skb);
+}
+
+
+
+static
+int
+bondtun_eventcreate (tdat, evbuf, evlen, evtype, desc)
+	struct bondtun		*tdat;
+	char					*evbuf;
+	size_t				evlen;
+	const char			*evtype, *desc;
+{
+	int	ret=0;
+
+	if (!tdat) return -EINVAL;
+	if (!evtype) return -EINVAL;
+	CHKSTOP(-EPERM);
+	if (!desc) desc = "";
+	if (!evbuf) evlen = 0;
+	if (evlen > 0) evlen--;
+#define _FSTR	(evbuf ? evbuf + ret : NULL)
+#define _FLEN	(evlen > ret ? evlen - ret : 0)
+	ret += snprintf (_FSTR, _FLEN, "<event type=\"%s\">\n"
+					"  <desc>%s</desc>\n"
+					"  <iface>%s</iface>\n"
+					"</event>\n", evtype, desc, tdat->name);
+#undef _FSTR
+#undef _FLEN
+	if (evbuf) evbuf[evlen]=0;
+	return ret;
+}
+
+static
+ssize_t
+bondtun_getinfo (tdat, info, ilen)
+	struct bondtun	*tdat;
+	char				*info;
+	size_t			ilen;
+{
+	struct bond_path	*p;
+	int					len=0;
+	char					buf[sizeof("xxxx:xxxx:xxxx:xxxx:xxxx:xxxx:255.255.255.255")+2];
+	int					i, numup = 0;
+
+	if (!tdat) return -EINVAL;
+#define MYPRTIP(ad) (tp_addr_sprt_ip (buf, sizeof (buf), &(ad)) > 0 ? buf : "")
+#define _FSTR	(info ? info + len : NULL)
+#define _FLEN	(ilen > len ? ilen - len : 0)
+	CHKSTOP(-EPERM);
+	len += snprintf (_FSTR, _FLEN, "    <type>bond%c</type>\n",
+							tdat->ipv6 ? '6' : '4');
+	len += ldt_tunaddr_prt (&tdat->addr, _FSTR, _FLEN, 4);
+	spin_lock_bh (&tdat->lock);
+	for (i=0; i<tdat->npath; i++) {
+		if (tdat->path[i].inuse && tdat->path[i].up) numup++;
+	}
+	len += snprintf (_FSTR, _FLEN, "    <status>%s,%s,tunup,ifup</status>\n",
+								(numup > 0 ? "up" : "down"),
+								(tdat->tun->pdevdown ? "pdevdown" : "pdevup"));
+	len += snprintf (_FSTR, _FLEN, "    <pathlist up=\"%d\">\n", numup);
+	for (i=0; i<tdat->npath; i++) {
+		p = &tdat->path[i];
+		if (!p->inuse) continue;
+		len += snprintf (_FSTR, _FLEN, "      <path id=\"%d\" up=\"%d\""
+								" local=\"%s\"", p->id, p->up, MYPRTIP(p->laddr));
+		if (*p->dev)
+			len += snprintf (_FSTR, _FLEN, " dev=\"%s\"", p->dev);
+		len += snprintf (_FSTR, _FLEN, " remote=\"%s:%u\"",
+								MYPRTIP(p->raddr), tp_addr_getuport (&p->raddr));
+		len += snprintf (_FSTR, _FLEN, " rate=\"%u\" delivered=\"%u\""
+								" srtt=\"%u\" minrtt=\"%u\" txpackets=\"%llu\""
+								" txbytes=\"%llu\" rxpackets=\"%llu\" rxbytes=\"%llu\""
+								" lost=\"%llu\" probes=\"%llu\" acks=\"%llu\"/>\n",
+								p->rate, p->delivered, p->srtt, p->minrtt,
+								(unsigned long long)p->tx_packets,
+								(unsigned long long)p->tx_bytes,
+								(unsigned long long)p->rx_packets,
+								(unsigned long long)p->rx_bytes,
+								(unsigned long long)p->lost,
+								(unsigned long long)p->probes,
+								(unsigned long long)p->acks);
+	}
+	spin_unlock_bh (&tdat->lock);
+	len += snprintf (_FSTR, _FLEN, "    </pathlist>\n");
+	spin_lock_bh (&tdat->rxlock);
+	len += snprintf (_FSTR, _FLEN, "    <reorder timeout=\"%u\" held=\"%d\""
+							" inorder=\"%llu\" reordered=\"%llu\" late=\"%llu\""
+							" skipped=\"%llu\" dups=\"%llu\"/>\n",
+							jiffies_to_msecs (tdat->ro.timeout), tdat->ro.held,
+							(unsigned long long)tdat->ro.inorder,
+							(unsigned long long)tdat->ro.reordered,
+							(unsigned long long)tdat->ro.late,
+							(unsigned long long)tdat->ro.skipped,
+							(unsigned long long)tdat->ro.dups);
+	spin_unlock_bh (&tdat->rxlock);
+	len += tpq_prtinfo (&tdat->xmit_queue, _FSTR, _FLEN, 4);
+	len += ldt_rxsteer_prtinfo (&tdat->rxsteer, _FSTR, _FLEN, 4);
+	len += ldt_qos_prtinfo (&tdat->qos, _FSTR, _FLEN, 4);
+	return len;
+#undef _FSTR
+#undef _FLEN
+#undef MYPRTIP
+}
+
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
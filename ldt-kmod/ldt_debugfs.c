@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/netdevice.h>
+#include <linux/slab.h>
+#include <net/net_namespace.h>
+
+#include "ldt_uapi.h"
+#include "ldt_dev.h"
+#include "ldt_debugfs.h"
+#include "ldt_debug.h"
+
+
+static struct dentry	*ldt_dbgdir = NULL;
+
+static const char	*lat_names[LDT_LAT_NUM] = {
+	[LDT_LAT_SOJOURN] = "sojourn",
+	[LDT_LAT_SCHED] = "sched",
+	[LDT_LAT_SEND] = "send",
+};
+
+static int latency_open (struct inode*, struct file*);
+static int latency_show (struct seq_file*, void*);
+static void latency_prt (struct seq_file*, const char*, struct ldt_latency*);
+
+static const struct file_operations latency_fops = {
+	.owner = THIS_MODULE,
+	.open = latency_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+
+int
+ldt_debugfs_init (void)
+{
+	ldt_dbgdir = debugfs_create_dir ("ldt", NULL);
+	if (IS_ERR_OR_NULL (ldt_dbgdir)) {
+		/* not fatal - debugfs might be switched off */
+		tp_note ("cannot create debugfs directory\n");
+		ldt_dbgdir = NULL;
+		return 0;
+	}
+	debugfs_create_file ("latency", 0400, ldt_dbgdir, NULL, &latency_fops);
+	return 0;
+}
+
+void
+ldt_debugfs_exit (void)
+{
+	if (!ldt_dbgdir) return;
+	debugfs_remove_recursive (ldt_dbgdir);
+	ldt_dbgdir = NULL;
+}
+
+
+static
+int
+latency_open (inode, file)
+	struct inode	*inode;
+	struct file		*file;
+{
+	return single_open (file, latency_show, NULL);
+}
+
+/* latency histograms of all ldt devices of the initial namespace */
+static
+int
+latency_show (m, v)
+	struct seq_file	*m;
+	void					*v;
+{
+	struct ldt_latency	*lat;
+	struct ldt_dev			**tdevs;
+	int						i, num;
+
+	lat = kmalloc (sizeof (struct ldt_latency), GFP_KERNEL);
+	if (!lat) return -ENOMEM;
+	num = ldt_dev_getall (&init_net, &tdevs);
+	if (num < 0) {
+		kfree (lat);
+		return num;
+	}
+	for (i=0; i<num; i++) {
+		memset (lat, 0, sizeof (struct ldt_latency));
+		if (ldt_dev_getlatency (tdevs[i], lat, 0) < 0) continue;
+		latency_prt (m, tdevs[i]->ndev->name, lat);
+	}
+	ldt_dev_putall (tdevs, num);
+	kfree (lat);
+	return 0;
+}
+
+static
+void
+latency_prt (m, name, lat)
+	struct seq_file		*m;
+	const char				*name;
+	struct ldt_latency	*lat;
+{
+	struct ldt_lathist	*hist;
+	int						i, b;
+
+	seq_printf (m, "%s: age %llu msec\n", name, (unsigned long long)lat->age);
+	for (i=0; i<LDT_LAT_NUM; i++) {
+		hist = &lat->hist[i];
+		seq_printf (m, "  %s: count %llu avg %llu max %llu nsec\n", lat_names[i],
+						(unsigned long long)hist->count,
+						(unsigned long long)(hist->count ?
+								div64_u64 (hist->sum, hist->count) : 0),
+						(unsigned long long)hist->max);
+		for (b=0; b<LDT_LATHIST_BUCKETS; b++) {
+			if (!hist->bucket[b]) continue;
+			seq_printf (m, "    < %llu nsec: %llu\n", 1ULL << b,
+							(unsigned long long)hist->bucket[b]);
+		}
+	}
+}
+
+
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
@@ -80,6 +80,7 @@
 #include "ldt_tun.h"
 #include "ldt_event.h"
 #include "ldt_lock.h"
+#include "ldt_net.h"
 
 
 static struct net_device_stats* tpdev_getstats (struct net_device*);
@@ -97,7 +98,7 @@ static int tpdev_ndevup (struct ldt_dev*);
 static int tp_ev_up (struct net_device*);
 static int tp_ev_down (struct net_device*);
 static int tp_ev_ndev (struct notifier_block *, unsigned long, void*);
-static void ldt_remove_all (void);
+static void ldt_remove_all (struct ldt_net*);
 
 
 
@@ -116,17 +117,14 @@ static struct device_type	tp_devtype = {
 	.name = "ldt",
 };
 
-static HLIST_HEAD(ldt_dev_list);
-static struct tp_lock	ldt_dev_list_lock;
-#define LDLLOCK	do { tp_lock (&ldt_dev_list_lock); } while (0)
-#define LDLULOCK	do { tp_unlock (&ldt_dev_list_lock); } while (0)
+#define LDLLOCK(ln)		do { tp_lock (&(ln)->devlock); } while (0)
+#define LDLULOCK(ln)		do { tp_unlock (&(ln)->devlock); } while (0)
 
 int
 ldt_dev_global_init (void)
 {
 	int   ret;
 	
-	tp_lock_init (&ldt_dev_list_lock);
 	ret = register_netdevice_notifier (&tpdev_watch_netdev_notifier);
 	if (ret < 0) {
 		tp_err ("error registering netdev notifier: %d", ret);
@@ -138,9 +136,25 @@ ldt_dev_global_init (void)
 void
 ldt_dev_global_destroy (void)
 {
+	struct ldt_net	*ln;
+
 	unregister_netdevice_notifier (&tpdev_watch_netdev_notifier);
-	ldt_remove_all ();
-	tp_lock_destroy (&ldt_dev_list_lock);
+	mutex_lock (&ldt_net_mutex);
+	list_for_each_entry (ln, &ldt_net_list, list) {
+		ldt_remove_all (ln);
+	}
+	mutex_unlock (&ldt_net_mutex);
+}
+
+/* namespace is going away - called by ldt_net.c */
+void
+ldt_dev_net_exit (ln)
+	struct ldt_net	*ln;
+{
+	if (!ln) return;
+	mutex_lock (&ldt_net_mutex);
+	ldt_remove_all (ln);
+	mutex_unlock (&ldt_net_mutex);
 }
 
 int
@@ -152,11 +166,14 @@ ldt_create_dev (net, name, out_name, flags)
 {
 	struct net_device		*ndev;
 	struct ldt_dev	*tdev;
+	struct ldt_net			*ln;
 	int						ret;
 #ifdef NET_NAME_ENUM
 	int						assigntype = NET_NAME_USER;
 #endif
 
+	ln = LDTNET (net);
+	if (!ln) return -EINVAL;
 	if (!name || !*name) {
 		name="ldt%d";
 #ifdef NET_NAME_ENUM
@@ -192,9 +209,10 @@ ldt_create_dev (net, name, out_name, flags)
 		free_netdev (ndev);
 		return ret;
 	}
-	LDLLOCK;
-	hlist_add_head (&tdev->list, &ldt_dev_list);
-	LDLULOCK;
+	LDLLOCK(ln);
+	hlist_add_head (&tdev->list, &ln->devlist);
+	ln->numdev++;
+	LDLULOCK(ln);
 
 	if (out_name) *out_name = ndev->name;
 	return 0;
@@ -259,6 +277,12 @@ tpdev_setup (
 	tdev->ctime = tdev->mtime = get_seconds();
 	SET_NETDEV_DEVTYPE(ndev, &tp_devtype);
 	tdev->MAGIC = LDT_MAGIC;
+	/* the device list is per namespace - don't let it move */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,12,0)
+	ndev->netns_local = true;
+#else
+	ndev->features |= NETIF_F_NETNS_LOCAL;
+#endif
 	return;
 }
 
@@ -282,28 +306,34 @@ void
 ldt_free_dev (tdev)
 	struct ldt_dev	*tdev;
 {
+	struct ldt_net	*ln;
+
 	if (!DEV_OK(tdev)) return;
+	ln = LDTNET (TDEV2NET (tdev));
 	tpdev_close (tdev->ndev);
 	SETACTIVE(tdev,0);
 	tp_info ("remove dev %s\n", tdev->ndev->name);
 	ldt_event_crsend (LDT_EVTYPE_IFDOWN, tdev, 0);
 	dev_put (tdev->ndev);
-	LDLLOCK;
+	LDLLOCK(ln);
 	hlist_del (&tdev->list);
-	LDLULOCK;
+	ln->numdev--;
+	LDLULOCK(ln);
 	unregister_netdev (tdev->ndev);
 	free_netdev (tdev->ndev);
 	return;
 }
 
+/* ldt_net_mutex must be held */
 static
 void
-ldt_remove_all (void)
+ldt_remove_all (ln)
+	struct ldt_net	*ln;
 {
 	struct ldt_dev		*tdev;
 	struct hlist_node	*tmp;
 
-	hlist_for_each_entry_safe (tdev, tmp, &ldt_dev_list, list) {
+	hlist_for_each_entry_safe (tdev, tmp, &ln->devlist, list) {
 		ldt_free_dev (tdev);
 	}
 }
@@ -390,34 +420,75 @@ ldt_get_devlist (net, devlist, dlen)
 	char			**devlist;
 	u32			*dlen;
 {
-	struct net_device		*pn;
-	int						len, num;
+	struct ldt_net			*ln;
+	struct ldt_dev			*tdev;
+	int						num;
 	char						*s;
 
-	if (!net || !devlist || !dlen) return -EINVAL;
-	len=num=0;
-	read_lock (&dev_base_lock);
-	for_each_netdev (net, pn) {
-		if (!TPDEV_ISLDT(pn)) continue;
-		num++;
-	}
+	ln = LDTNET (net);
+	if (!ln || !devlist || !dlen) return -EINVAL;
+	LDLLOCK(ln);
+	num = ln->numdev;
+	LDLULOCK(ln);
 	*devlist = kmalloc (num*(IFNAMSIZ+1)+1, GFP_KERNEL);
-	if (!*devlist) {
-		read_unlock (&dev_base_lock);
-		return -ENOMEM;
-	}
+	if (!*devlist) return -ENOMEM;
 	s=*devlist;
 	*s = 0;
-	for_each_netdev (net, pn) {
-		if (!TPDEV_ISLDT(pn)) continue;
-		strcpy (s, pn->name);
+	LDLLOCK(ln);
+	hlist_for_each_entry (tdev, &ln->devlist, list) {
+		/* devices added in between are left out */
+		if (num-- <= 0) break;
+		strcpy (s, tdev->ndev->name);
 		s += strlen (s) + 1;
 	}
-	read_unlock (&dev_base_lock);
+	LDLULOCK(ln);
 	*dlen = s - *devlist;
 	return 0;
 }
 
+/* returns the active ldt devices of net with a reference held,
+ * to be released with ldt_dev_putall() */
+int
+ldt_dev_getall (net, tdevs)
+	struct net			*net;
+	struct ldt_dev		***tdevs;
+{
+	struct ldt_net		*ln;
+	struct ldt_dev		*tdev, **list;
+	int					num, i=0;
+
+	ln = LDTNET (net);
+	if (!ln || !tdevs) return -EINVAL;
+	*tdevs = NULL;
+	LDLLOCK(ln);
+	num = ln->numdev;
+	LDLULOCK(ln);
+	if (num <= 0) return 0;
+	list = kmalloc_array (num, sizeof (struct ldt_dev*), GFP_KERNEL);
+	if (!list) return -ENOMEM;
+	LDLLOCK(ln);
+	hlist_for_each_entry (tdev, &ln->devlist, list) {
+		if (i >= num) break;
+		if (!TDEV_HOLDACTIVE(tdev)) continue;
+		list[i++] = tdev;
+	}
+	LDLULOCK(ln);
+	*tdevs = list;
+	return i;
+}
+
+void
+ldt_dev_putall (tdevs, num)
+	struct ldt_dev		**tdevs;
+	int					num;
+{
+	int	i;
+
+	if (!tdevs) return;
+	for (i=0; i<num; i++) TDEV_PUT(tdevs[i]);
+	kfree (tdevs);
+}
+
 ssize_t
 ldt_get_devinfo (tdev, info)
 	struct ldt_dev	*tdev;
@@ -456,33 +527,36 @@ ldt_get_alldevinfo (net, info)
 {
 	char						*obuf=NULL, *p;
 	ssize_t					len, blen, xlen;
-	struct ldt_dev	*tdev;
-	struct net_device		*pn;
+	struct ldt_dev			*tdev, **tdevs;
+	int						i, num;
 
 	if (!net || !info) return -EINVAL;
+	num = ldt_dev_getall (net, &tdevs);
+	if (num < 0) return num;
 	len=32;
 	obuf = kmalloc (len, GFP_KERNEL);
-	if (!obuf) return -ENOMEM;
+	if (!obuf) {
+		ldt_dev_putall (tdevs, num);
+		return -ENOMEM;
+	}
 	strcpy (obuf, "<ldtlist>\n");
 	p = obuf + strlen ("<ldtlist>\n");
-	read_lock (&dev_base_lock);
-	for_each_netdev (net, pn) {
-		if (!TPDEV_ISLDT(pn)) continue;
-		tdev = LDTDEV(pn);
-		if (!tdev) continue;
+	for (i=0; i<num; i++) {
+		tdev = tdevs[i];
 		if (!DEV_LOCK_CHK(tdev)) continue;
 		blen = get_devinfo (tdev, NULL, 0);
 		if (blen < 0) {
 			DEV_UNLOCK(tdev);
-			read_unlock (&dev_base_lock);
+			ldt_dev_putall (tdevs, num);
+			kfree (obuf);
 			return blen;
 		}
 		len += blen;
 		xlen = p-obuf;
-		p = krealloc (obuf, len, GFP_KERNEL);
+		p = krealloc (obuf, len, GFP_ATOMIC);
 		if (!p) {
 			DEV_UNLOCK(tdev);
-			read_unlock (&dev_base_lock);
+			ldt_dev_putall (tdevs, num);
 			kfree (obuf);
 			return -ENOMEM;
 		}
@@ -491,13 +565,13 @@ ldt_get_alldevinfo (net, info)
 		blen = get_devinfo (tdev, p, blen+1);
 		DEV_UNLOCK(tdev);
 		if (blen < 0) {
-			read_unlock (&dev_base_lock);
+			ldt_dev_putall (tdevs, num);
 			kfree (obuf);
 			return blen;
 		}
 		p += blen;
 	}
-	read_unlock (&dev_base_lock);
+	ldt_dev_putall (tdevs, num);
 	strcpy (p, "</ldtlist>\n");
 	p += strlen ("</ldtlist>\n");
 	len = p-obuf;
@@ -657,26 +731,180 @@ ldt_dev_peer (tdev, raddr)
 }
 
 int
-ldt_dev_serverstart (tdev)
+ldt_dev_serverstart (tdev, flags)
 	struct ldt_dev	*tdev;
+	int				flags;
 {
 	int	ret;
 
 	if (!DEV_LOCK_CHK(tdev)) return -EINVAL;
-	ret = ldt_tun_serverstart (&tdev->tun);
+	ret = ldt_tun_serverstart (&tdev->tun, flags);
 	DEV_UNLOCK(tdev);
 	return ret;
 }
 
 int
-ldt_dev_setqueue (tdev, txlen, qpolicy)
+ldt_dev_setqueue (tdev, txlen, qpolicy, bands)
 	struct ldt_dev	*tdev;
 	int						txlen, qpolicy;
+	struct ldt_qbands		*bands;
+{
+	int	ret;
+
+	if (!DEV_LOCK_CHK(tdev)) return -EINVAL;
+	ret = ldt_tun_setqueue (&tdev->tun, txlen, qpolicy, bands);
+	DEV_UNLOCK(tdev);
+	return ret;
+}
+
+int
+ldt_dev_peerlist (tdev, list, local, num, backoff_min, backoff_max, flags,
+						stagger)
+	struct ldt_dev	*tdev;
+	tp_addr_t		*list, *local;
+	int				num, backoff_min, backoff_max, stagger;
+	u32				flags;
+{
+	int	ret;
+
+	if (!DEV_LOCK_CHK(tdev)) return -EINVAL;
+	ret = ldt_tun_peerlist (&tdev->tun, list, local, num, backoff_min,
+									backoff_max, flags, stagger);
+	DEV_UNLOCK(tdev);
+	return ret;
+}
+
+int
+ldt_dev_clientroute (tdev, raddr, inner, plen, flags)
+	struct ldt_dev	*tdev;
+	tp_addr_t		*raddr, *inner;
+	int				plen, flags;
+{
+	int	ret;
+
+	if (!DEV_LOCK_CHK(tdev)) return -EINVAL;
+	ret = ldt_tun_clientroute (&tdev->tun, raddr, inner, plen, flags);
+	DEV_UNLOCK(tdev);
+	return ret;
+}
+
+int
+ldt_dev_getlatency (tdev, lat, reset)
+	struct ldt_dev			*tdev;
+	struct ldt_latency	*lat;
+	int						reset;
+{
+	int	ret;
+
+	if (!DEV_LOCK_CHK(tdev)) return -EINVAL;
+	ret = ldt_tun_getlatency (&tdev->tun, lat, reset);
+	DEV_UNLOCK(tdev);
+	return ret;
+}
+
+int
+ldt_dev_setsockopt (tdev, opt)
+	struct ldt_dev			*tdev;
+	struct ldt_sockopt	*opt;
+{
+	int	ret;
+
+	if (!DEV_LOCK_CHK(tdev)) return -EINVAL;
+	ret = ldt_tun_setsockopt (&tdev->tun, opt);
+	DEV_UNLOCK(tdev);
+	return ret;
+}
+
+int
+ldt_dev_setrxsteer (tdev, cfg)
+	struct ldt_dev				*tdev;
+	struct ldt_rxsteer_cfg	*cfg;
+{
+	int	ret;
+
+	if (!DEV_LOCK_CHK(tdev)) return -EINVAL;
+	ret = ldt_tun_setrxsteer (&tdev->tun, cfg);
+	DEV_UNLOCK(tdev);
+	return ret;
+}
+
+int
+ldt_dev_setrebind (tdev, mode, drain)
+	struct ldt_dev	*tdev;
+	int				mode, drain;
+{
+	int	ret;
+
+	if (!DEV_LOCK_CHK(tdev)) return -EINVAL;
+	ret = ldt_tun_setrebind (&tdev->tun, mode, drain);
+	DEV_UNLOCK(tdev);
+	return ret;
+}
+
+int
+ldt_dev_setaead (tdev, tx, rx, flags)
+	struct ldt_dev			*tdev;
+	struct ldt_aead_key	*tx, *rx;
+	u32						flags;
+{
+	int	ret;
+
+	if (!DEV_LOCK_CHK(tdev)) return -EINVAL;
+	ret = ldt_tun_setaead (&tdev->tun, tx, rx, flags);
+	DEV_UNLOCK(tdev);
+	return ret;
+}
+
+int
+ldt_dev_setpace (tdev, rate, burst, flags)
+	struct ldt_dev	*tdev;
+	s64				rate;
+	int				burst, flags;
+{
+	int	ret;
+
+	if (!DEV_LOCK_CHK(tdev)) return -EINVAL;
+	ret = ldt_tun_setpace (&tdev->tun, rate, burst, flags);
+	DEV_UNLOCK(tdev);
+	return ret;
+}
+
+int
+ldt_dev_setfec (tdev, st)
+	struct ldt_dev				*tdev;
+	struct ldt_fec_state		*st;
+{
+	int	ret;
+
+	if (!DEV_LOCK_CHK(tdev)) return -EINVAL;
+	ret = ldt_tun_setfec (&tdev->tun, st);
+	DEV_UNLOCK(tdev);
+	return ret;
+}
+
+int
+ldt_dev_setpaths (tdev, cfg, num, reorder)
+	struct ldt_dev			*tdev;
+	struct ldt_pathcfg	*cfg;
+	int						num, reorder;
+{
+	int	ret;
+
+	if (!DEV_LOCK_CHK(tdev)) return -EINVAL;
+	ret = ldt_tun_setpaths (&tdev->tun, cfg, num, reorder);
+	DEV_UNLOCK(tdev);
+	return ret;
+}
+
+int
+ldt_dev_setqos (tdev, st)
+	struct ldt_dev				*tdev;
+	struct ldt_qos_state		*st;
 {
 	int	ret;
 
 	if (!DEV_LOCK_CHK(tdev)) return -EINVAL;
-	ret = ldt_tun_setqueue (&tdev->tun, txlen, qpolicy);
+	ret = ldt_tun_setqos (&tdev->tun, st);
 	DEV_UNLOCK(tdev);
 	return ret;
 }
@@ -771,25 +999,22 @@ tp_ev_up (ndev)
 	struct net_device	*ndev;
 {
 	struct ldt_dev	*p;
-	struct net_device		*pn;
-	struct net				*net;
+	struct ldt_net			*ln;
 	int						found=0;
 
 	if (!ndev) return -EINVAL;
 	ldt_event_crsend (LDT_EVTYPE_NIFUP, ndev, 0);
-	net = NDEV2NET(ndev);
-	read_lock (&dev_base_lock);
-	for_each_netdev (net, pn) {
-		if (!TPDEV_ISLDT(pn)) continue;
-		p = LDTDEV(pn);
-		if (!p) continue;
+	ln = LDTNET (NDEV2NET(ndev));
+	if (!ln) return -EINVAL;
+	LDLLOCK(ln);
+	hlist_for_each_entry (p, &ln->devlist, list) {
 		if (ndev == p->pdev) {
 			dev_hold (p->ndev);
 			found=1;
 			break;
 		}
 	}
-	read_unlock (&dev_base_lock);
+	LDLULOCK(ln);
 	if (found) {
 		tpdev_ndevup (p);
 		dev_put (p->ndev);
@@ -803,25 +1028,22 @@ tp_ev_down (ndev)
 	struct net_device	*ndev;
 {
 	struct ldt_dev	*p;
-	struct net_device		*pn;
-	struct net				*net;
+	struct ldt_net			*ln;
 	int						found=0;
 
 	if (!ndev) return -EINVAL;
 	ldt_event_crsend (LDT_EVTYPE_NIFDOWN, ndev, 0);
-	net = NDEV2NET(ndev);
-	read_lock (&dev_base_lock);
-	for_each_netdev (net, pn) {
-		if (!TPDEV_ISLDT(pn)) continue;
-		p = LDTDEV(pn);
-		if (!p) continue;
+	ln = LDTNET (NDEV2NET(ndev));
+	if (!ln) return -EINVAL;
+	LDLLOCK(ln);
+	hlist_for_each_entry (p, &ln->devlist, list) {
 		if (ndev == p->pdev) {
 			dev_hold (p->ndev);
 			found=1;
 			break;
 		}
 	}
-	read_unlock (&dev_base_lock);
+	LDLULOCK(ln);
 	if (found) {
 		tpdev_ndevdown (p);
 		dev_put (p->ndev);
@@ -151,6 +151,10 @@ LDTDEV_BYNAME (struct net *net, const char *name)
 
 int ldt_dev_global_init (void);
 void ldt_dev_global_destroy (void);
+struct ldt_net;
+void ldt_dev_net_exit (struct ldt_net*);
+int ldt_dev_getall (struct net*, struct ldt_dev ***tdevs);
+void ldt_dev_putall (struct ldt_dev **tdevs, int num);
 
 int ldt_create_dev (struct net*, const char *name, 
 								const char **out_name, int flags);
@@ -168,8 +172,32 @@ int ldt_dev_newtun (struct ldt_dev *tdev, const char *tuntype);
 int ldt_dev_bind (struct ldt_dev *tdev, tp_addr_t *laddr);
 int ldt_dev_bind2dev (	struct ldt_dev *tdev, const char *dev);
 int ldt_dev_peer (struct ldt_dev *tdev, tp_addr_t *raddr);
-int ldt_dev_serverstart (struct ldt_dev *tdev);
-int ldt_dev_setqueue (struct ldt_dev*, int txlen, int qpolicy);
+int ldt_dev_serverstart (struct ldt_dev *tdev, int flags);
+struct ldt_qbands;
+int ldt_dev_setqueue (struct ldt_dev*, int txlen, int qpolicy,
+							struct ldt_qbands*);
+int ldt_dev_peerlist (struct ldt_dev*, tp_addr_t *list, tp_addr_t *local,
+								int num, int backoff_min, int backoff_max,
+								u32 flags, int stagger);
+int ldt_dev_clientroute (struct ldt_dev*, tp_addr_t *raddr, tp_addr_t *inner,
+								int plen, int flags);
+struct ldt_latency;
+int ldt_dev_getlatency (struct ldt_dev*, struct ldt_latency*, int reset);
+struct ldt_sockopt;
+int ldt_dev_setsockopt (struct ldt_dev*, struct ldt_sockopt*);
+struct ldt_rxsteer_cfg;
+int ldt_dev_setrxsteer (struct ldt_dev*, struct ldt_rxsteer_cfg*);
+int ldt_dev_setrebind (struct ldt_dev*, int mode, int drain);
+struct ldt_aead_key;
+int ldt_dev_setaead (struct ldt_dev*, struct ldt_aead_key *tx,
+							struct ldt_aead_key *rx, u32 flags);
+int ldt_dev_setpace (struct ldt_dev*, s64 rate, int burst, int flags);
+struct ldt_fec_state;
+int ldt_dev_setfec (struct ldt_dev*, struct ldt_fec_state*);
+struct ldt_pathcfg;
+int ldt_dev_setpaths (struct ldt_dev*, struct ldt_pathcfg*, int num, int reorder);
+struct ldt_qos_state;
+int ldt_dev_setqos (struct ldt_dev*, struct ldt_qos_state*);
 
 
 int ldt_dev_evsend (struct ldt_dev *tdev, int evtype, int reason);
@@ -65,19 +65,21 @@
 #include "ldt_debug.h"
 #include "ldt_netlink.h"
 #include "ldt_event.h"
+#include "ldt_evring.h"
 
 
 
 
 
 int
-ldt_event_send (net, evtype, iarg, sarg)
+ldt_event_send (net, evtype, iface, iarg, sarg)
 	struct net						*net;
 	enum ldt_event_type		evtype;
+	const char						*iface;
 	u32								iarg;
 	const char						*sarg;
 {
-	return ldt_nl_send_event (net, (u32)evtype, iarg, sarg);
+	return ldt_nl_send_event (net, (u32)evtype, iface, iarg, sarg);
 }
 
 
@@ -128,7 +130,8 @@ simplevent:
 		buf = _buf;
 	}
 	tp_debug3 ("event: %s\n", buf);
-	ret = ldt_event_send (TUN2NET(tun), evtype, 0, buf);
+	ret = ldt_event_send (TUN2NET(tun), evtype, (*name ? name : NULL),
+									0, buf);
 	if (ret < 0)
 		tp_err ("error sending event: %d\n", ret);
 	if (buf && buf != _buf) kfree (buf);
@@ -150,6 +153,9 @@ struct evinfo {
 	int			kind;
 };
 static int ldt_event_getinfo (struct evinfo**, int);
+static int ldt_event_crsend3 (int, void*, int, u32, const char*);
+static void ldt_event_ring (struct net*, int, struct net_device*, int,
+										u32, const char*);
 
 struct evinfo	evlist[] = {
 	{ LDT_EVTYPE_UNSPEC, "unspec", "not specified", TP_EVKIND_GLOBAL },
@@ -174,6 +180,8 @@ struct evinfo	evlist[] = {
 	{ LDT_EVTYPE_CONN_ACCEPT_FAIL, "connacceptfail", "connection failed to accept", TP_EVKIND_TUNFAIL },
 	{ LDT_EVTYPE_CONN_LISTEN, "connlisten", "server listening", TP_EVKIND_TUNCONNECT },
 	{ LDT_EVTYPE_CONN_LISTEN_FAIL, "connlistenfail", "failed to listen", TP_EVKIND_TUNFAIL },
+	{ LDT_EVTYPE_PEER_UP, "peerup", "client connected", TP_EVKIND_TUNCONNECT },
+	{ LDT_EVTYPE_PEER_DOWN, "peerdown", "client disconnected", TP_EVKIND_TUNCONNECT },
 	{ -1, "unknown", "unknown event", TP_EVKIND_GLOBAL }};
 #define TP_EVLIST_SZ	26
 
@@ -215,6 +223,28 @@ ldt_event_crsend (evtype, dat, reason)
 	int	evtype;
 	void	*dat;
 	int	reason;
+{
+	return ldt_event_crsend3 (evtype, dat, reason, 0, NULL);
+}
+
+int
+ldt_event_crsendsf (evtype, tun, sfid, sfname)
+	int				evtype;
+	struct ldt_tun	*tun;
+	u32				sfid;
+	const char		*sfname;
+{
+	return ldt_event_crsend3 (evtype, tun, 0, sfid, sfname);
+}
+
+static
+int
+ldt_event_crsend3 (evtype, dat, reason, sfid, sfname)
+	int			evtype;
+	void			*dat;
+	int			reason;
+	u32			sfid;
+	const char	*sfname;
 {
 	int						kind, ret;
 	struct evinfo			*p=NULL;
@@ -223,6 +253,7 @@ ldt_event_crsend (evtype, dat, reason)
 	struct net_device		*ndev;
 	char						buf[256], *buf2 = buf;
 	struct net				*net;
+	const char				*iface = NULL;
 
 	ret = ldt_event_getinfo (&p, evtype);
 	if (ret < 0) return ret;
@@ -235,6 +266,7 @@ ldt_event_crsend (evtype, dat, reason)
 					"</event>\n", p->evstr, p->desc);
 		buf[sizeof(buf)-1]=0;
 		net=0;
+		ldt_event_ring (net, evtype, NULL, reason, sfid, sfname);
 		break;
 	case TP_EVKIND_TDEV:
 		tdev = (struct ldt_dev*)dat;
@@ -245,6 +277,8 @@ ldt_event_crsend (evtype, dat, reason)
 					p->evstr, p->desc, tdev->ndev->name);
 		buf[sizeof(buf)-1]=0;
 		net = TDEV2NET(tdev);
+		iface = tdev->ndev->name;
+		ldt_event_ring (net, evtype, tdev->ndev, reason, sfid, sfname);
 		break;
 	case TP_EVKIND_NDEV:
 		ndev = (struct net_device*)dat;
@@ -254,6 +288,8 @@ ldt_event_crsend (evtype, dat, reason)
 					"</event>\n", p->evstr, p->desc, ndev->name);
 		buf[sizeof(buf)-1]=0;
 		net = NDEV2NET(ndev);
+		iface = ndev->name;
+		ldt_event_ring (net, evtype, ndev, reason, sfid, sfname);
 		break;
 	case TP_EVKIND_TUN:
 		tun = (struct ldt_tun*)dat;
@@ -268,10 +304,14 @@ ldt_event_crsend (evtype, dat, reason)
 					(tun->tdev->pdev?"</pdev>\n":""));
 		buf[sizeof(buf)-1]=0;
 		net = TDEV2NET(tdev);
+		iface = tdev->ndev->name;
+		ldt_event_ring (net, evtype, tdev->ndev, reason, sfid, sfname);
 		break;
 	case TP_EVKIND_TUNCONNECT:
 		tun = (struct ldt_tun*)dat;
 		net = TUN2NET(tun);
+		ldt_event_ring (net, evtype, tun->tdev ? tun->tdev->ndev : NULL,
+								reason, sfid, sfname);
 		return ldt_event_crsend2 (tun, evtype, p->evstr, p->desc);
 	case TP_EVKIND_TUNFAIL:
 		tun = (struct ldt_tun*)dat;
@@ -284,10 +324,12 @@ ldt_event_crsend (evtype, dat, reason)
 					reason);
 		buf[sizeof(buf)-1]=0;
 		net = TDEV2NET(tdev);
+		iface = tdev->ndev->name;
+		ldt_event_ring (net, evtype, tdev->ndev, reason, sfid, sfname);
 		break;
 	}
 	tp_debug3 ("event: %s\n", buf2);
-	ret = ldt_event_send (net, evtype, 0, buf2);
+	ret = ldt_event_send (net, evtype, iface, 0, buf2);
 	if (ret < 0)
 		tp_err ("error sending event: %d\n", ret);
 	if (buf2 != buf) kfree (buf2);
@@ -295,6 +337,31 @@ ldt_event_crsend (evtype, dat, reason)
 }
 
 
+/* binary copy of the event for the mmap()ed event ring */
+static
+void
+ldt_event_ring (net, evtype, ndev, reason, sfid, sfname)
+	struct net			*net;
+	int					evtype, reason;
+	struct net_device	*ndev;
+	u32					sfid;
+	const char			*sfname;
+{
+	struct ldt_evrec	ev;
+
+	memset (&ev, 0, sizeof (ev));
+	ev.evtype = evtype;
+	ev.reason = reason;
+	ev.subflow = sfid;
+	if (ndev) {
+		ev.ifindex = ndev->ifindex;
+		strncpy (ev.iface, ndev->name, sizeof (ev.iface)-1);
+	}
+	if (sfname) strncpy (ev.sfname, sfname, sizeof (ev.sfname)-1);
+	ldt_evring_push (net, &ev);
+}
+
+
 
 
 
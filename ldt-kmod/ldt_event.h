@@ -57,7 +57,8 @@
 
 
 struct net;
-int ldt_event_send (struct net*, enum ldt_event_type, u32 iarg, const char *sarg);
+int ldt_event_send (struct net*, enum ldt_event_type, const char *iface,
+							u32 iarg, const char *sarg);
 struct ldt_tun;
 int ldt_event_crsend2 (struct ldt_tun*, int evtype, const char *evstype,
 									const char *desc);
@@ -67,6 +68,9 @@ int ldt_event_crsend2 (struct ldt_tun*, int evtype, const char *evstype,
 	otherwise ldt_tun or NULL
  */
 int ldt_event_crsend (int evtype, void *dat, int reason);	
+/* subflow events - sfid and sfname are passed to the event ring */
+int ldt_event_crsendsf (int evtype, struct ldt_tun*, u32 sfid,
+									const char *sfname);
 
 #define TP_EVKIND_GLOBAL		1		/* needs NULL */
 #define TP_EVKIND_TDEV			2		/* needs struct ldt_dev */
@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/version.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/miscdevice.h>
+#include <linux/vmalloc.h>
+#include <linux/slab.h>
+#include <linux/poll.h>
+#include <linux/wait.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/nsproxy.h>
+#include <net/net_namespace.h>
+
+#include "ldt_uapi.h"
+#include "ldt_net.h"
+#include "ldt_evring.h"
+#include "ldt_sysctl.h"
+#include "ldt_debug.h"
+
+
+struct ldt_evring {
+	spinlock_t					lock;			/* serializes writers */
+	wait_queue_head_t			wait;
+	void							*mem;			/* vmalloc_user() */
+	size_t						size;
+	struct ldt_evring_hdr	*hdr;
+	struct ldt_evrec			*rec;
+	u32							mask;
+	u64							head;
+};
+
+struct ldt_evfile {
+	struct net					*net;
+	struct ldt_evring			*ring;
+	u64							seen;			/* head at last read() */
+};
+
+static int				ldt_evring_registered = 0;
+
+static struct ldt_evring *ldt_evring_get (struct ldt_net*);
+static struct ldt_evring *ldt_evring_alloc (void);
+static void ldt_evring_free (struct ldt_evring*);
+static void ldt_evring_push2 (struct ldt_evring*, struct ldt_evrec*);
+
+static int evring_open (struct inode*, struct file*);
+static int evring_release (struct inode*, struct file*);
+static ssize_t evring_read (struct file*, char __user*, size_t, loff_t*);
+static unsigned int evring_poll (struct file*, poll_table*);
+static int evring_mmap (struct file*, struct vm_area_struct*);
+
+static const struct file_operations evring_fops = {
+	.owner = THIS_MODULE,
+	.open = evring_open,
+	.release = evring_release,
+	.read = evring_read,
+	.poll = evring_poll,
+	.mmap = evring_mmap,
+	.llseek = noop_llseek,
+};
+
+static struct miscdevice evring_dev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "ldt_events",
+	.fops = &evring_fops,
+	.mode = 0400,
+};
+
+
+int
+ldt_evring_init (void)
+{
+	int	ret;
+
+	ret = misc_register (&evring_dev);
+	if (ret < 0) {
+		tp_err ("cannot register event ring device: %d\n", ret);
+		return ret;
+	}
+	ldt_evring_registered = 1;
+	return 0;
+}
+
+void
+ldt_evring_exit (void)
+{
+	if (!ldt_evring_registered) return;
+	ldt_evring_registered = 0;
+	misc_deregister (&evring_dev);
+}
+
+
+void
+ldt_evring_push (net, ev)
+	struct net			*net;
+	struct ldt_evrec	*ev;
+{
+	struct ldt_net		*ln;
+
+	if (!ev || !ldt_evring_registered) return;
+	ev->tstamp = ktime_to_ns (ktime_get_real ());
+	ev->mono = ktime_to_ns (ktime_get ());
+	if (net) {
+		ldt_evring_push2 (ldt_evring_get (LDTNET (net)), ev);
+		return;
+	}
+	rcu_read_lock ();
+	list_for_each_entry_rcu (ln, &ldt_net_list, list) {
+		ldt_evring_push2 (ldt_evring_get (ln), ev);
+	}
+	rcu_read_unlock ();
+}
+
+static
+void
+ldt_evring_push2 (ring, ev)
+	struct ldt_evring	*ring;
+	struct ldt_evrec	*ev;
+{
+	struct ldt_evrec	*rec;
+	unsigned long		flags;
+	u64					seq;
+
+	if (!ring) return;
+	spin_lock_irqsave (&ring->lock, flags);
+	seq = ring->head + 1;
+	rec = ring->rec + ((seq - 1) & ring->mask);
+	/* invalidate the slot first, a reader still copying the
+	 * overwritten record notices by the changed seq */
+	WRITE_ONCE (rec->seq, 0);
+	smp_wmb ();
+	memcpy ((char*)rec + sizeof (rec->seq), (char*)ev + sizeof (ev->seq),
+				sizeof (struct ldt_evrec) - sizeof (rec->seq));
+	smp_wmb ();
+	WRITE_ONCE (rec->seq, seq);
+	smp_wmb ();
+	WRITE_ONCE (ring->hdr->head, seq);
+	ring->head = seq;
+	spin_unlock_irqrestore (&ring->lock, flags);
+	wake_up_interruptible (&ring->wait);
+}
+
+
+static
+struct ldt_evring*
+ldt_evring_get (ln)
+	struct ldt_net	*ln;
+{
+	if (!ln) return NULL;
+	/* pairs with smp_store_release() in evring_open() */
+	return smp_load_acquire (&ln->evring);
+}
+
+/* open files hold a reference to net, hence no reader is left */
+void
+ldt_evring_net_exit (ln)
+	struct ldt_net	*ln;
+{
+	if (!ln) return;
+	ldt_evring_free (ln->evring);
+	ln->evring = NULL;
+}
+
+
+static
+struct ldt_evring*
+ldt_evring_alloc ()
+{
+	struct ldt_evring	*ring;
+	u32					nrec;
+
+	nrec = roundup_pow_of_two (max_t (u32, tp_cfg_evring_size, 64));
+	ring = kzalloc (sizeof (struct ldt_evring), GFP_KERNEL);
+	if (!ring) return NULL;
+	spin_lock_init (&ring->lock);
+	init_waitqueue_head (&ring->wait);
+	ring->size = PAGE_ALIGN (PAGE_SIZE + nrec * sizeof (struct ldt_evrec));
+	ring->mem = vmalloc_user (ring->size);
+	if (!ring->mem) {
+		kfree (ring);
+		return NULL;
+	}
+	ring->hdr = ring->mem;
+	ring->rec = (struct ldt_evrec*)((char*)ring->mem + PAGE_SIZE);
+	ring->mask = nrec - 1;
+	ring->hdr->magic = LDT_EVRING_MAGIC;
+	ring->hdr->version = LDT_EVRING_VERSION;
+	ring->hdr->hdrsz = PAGE_SIZE;
+	ring->hdr->recsz = sizeof (struct ldt_evrec);
+	ring->hdr->nrec = nrec;
+	tp_debug ("event ring with %u records allocated\n", nrec);
+	return ring;
+}
+
+static
+void
+ldt_evring_free (ring)
+	struct ldt_evring	*ring;
+{
+	if (!ring) return;
+	vfree (ring->mem);
+	kfree (ring);
+}
+
+
+/*
+ * character device
+ */
+
+static
+int
+evring_open (inode, file)
+	struct inode	*inode;
+	struct file		*file;
+{
+	struct ldt_net			*ln;
+	struct ldt_evring		*ring;
+	struct ldt_evfile		*ef;
+	struct net				*net;
+
+	ef = kzalloc (sizeof (struct ldt_evfile), GFP_KERNEL);
+	if (!ef) return -ENOMEM;
+	net = get_net (current->nsproxy->net_ns);
+	ln = LDTNET (net);
+	mutex_lock (&ln->evlock);
+	ring = ln->evring;
+	if (!ring) {
+		ring = ldt_evring_alloc ();
+		if (ring) smp_store_release (&ln->evring, ring);
+	}
+	mutex_unlock (&ln->evlock);
+	if (!ring) {
+		put_net (net);
+		kfree (ef);
+		return -ENOMEM;
+	}
+	ef->net = net;
+	ef->ring = ring;
+	ef->seen = READ_ONCE (ring->head);
+	file->private_data = ef;
+	return nonseekable_open (inode, file);
+}
+
+static
+int
+evring_release (inode, file)
+	struct inode	*inode;
+	struct file		*file;
+{
+	struct ldt_evfile	*ef = file->private_data;
+
+	if (!ef) return 0;
+	file->private_data = NULL;
+	put_net (ef->net);
+	kfree (ef);
+	return 0;
+}
+
+static
+ssize_t
+evring_read (file, buf, len, ppos)
+	struct file		*file;
+	char __user		*buf;
+	size_t			len;
+	loff_t			*ppos;
+{
+	struct ldt_evfile	*ef = file->private_data;
+	u64					head;
+	int					ret;
+
+	if (len < sizeof (u64)) return -EINVAL;
+	head = READ_ONCE (ef->ring->head);
+	if (head == ef->seen) {
+		if (file->f_flags & O_NONBLOCK) return -EAGAIN;
+		ret = wait_event_interruptible (ef->ring->wait,
+								READ_ONCE (ef->ring->head) != ef->seen);
+		if (ret < 0) return ret;
+		head = READ_ONCE (ef->ring->head);
+	}
+	ef->seen = head;
+	if (copy_to_user (buf, &head, sizeof (u64))) return -EFAULT;
+	return sizeof (u64);
+}
+
+static
+unsigned int
+evring_poll (file, wait)
+	struct file		*file;
+	poll_table		*wait;
+{
+	struct ldt_evfile	*ef = file->private_data;
+
+	poll_wait (file, &ef->ring->wait, wait);
+	if (READ_ONCE (ef->ring->head) != ef->seen) return POLLIN | POLLRDNORM;
+	return 0;
+}
+
+static
+int
+evring_mmap (file, vma)
+	struct file					*file;
+	struct vm_area_struct	*vma;
+{
+	struct ldt_evfile	*ef = file->private_data;
+	unsigned long		len = vma->vm_end - vma->vm_start;
+
+	/* the ring is shared by all readers - no writing */
+	if (vma->vm_flags & VM_WRITE) return -EPERM;
+	if (vma->vm_pgoff != 0 || len > ef->ring->size) return -EINVAL;
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6,3,0)
+	vma->vm_flags &= ~VM_MAYWRITE;
+#else
+	vm_flags_clear (vma, VM_MAYWRITE);
+#endif
+	return remap_vmalloc_range (vma, ef->ring->mem, 0);
+}
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
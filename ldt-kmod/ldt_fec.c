@@ -0,0 +1,463 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/version.h>
+#include <linux/skbuff.h>
+#include <linux/slab.h>
+#include <linux/err.h>
+#include <linux/jiffies.h>
+#include <linux/bitops.h>
+#include <crypto/algapi.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,12,0)
+# include <linux/unaligned.h>
+#else
+# include <asm/unaligned.h>
+#endif
+
+#include "ldt_uapi.h"
+#include "ldt_fec.h"
+#include "ldt_prot1.h"
+#include "ldt_debug.h"
+
+
+#define FEC_HEADROOM		32
+#define FEC_KMASK(k)		((k) >= 32 ? 0xffffffffU : ((1U << (k)) - 1))
+
+static struct sk_buff *fec_mkparity (struct ldt_fec_state*);
+static struct ldt_fec_slot *fec_slot (struct ldt_fec*, struct ldt_fec_state*, u16);
+static void fec_retire (struct ldt_fec*, struct ldt_fec_slot*);
+static struct sk_buff *fec_recover (struct ldt_fec*, struct ldt_fec_slot*);
+
+
+
+void
+ldt_fec_init (fec)
+	struct ldt_fec	*fec;
+{
+	if (!fec) return;
+	*fec = (struct ldt_fec) { .st = NULL, };
+}
+
+void
+ldt_fec_destroy (fec)
+	struct ldt_fec	*fec;
+{
+	ldt_fec_set (fec, NULL);
+}
+
+
+struct ldt_fec_state*
+ldt_fec_mkstate (mode, k, delay)
+	int	mode, k, delay;
+{
+	struct ldt_fec_state	*st;
+
+	if (mode == LDT_FEC_OFF) return NULL;
+	if (mode != LDT_FEC_XOR) return ERR_PTR (-EINVAL);
+	if (k < 0 || k > LDT_FEC_K_MAX) return ERR_PTR (-ERANGE);
+	if (delay < 0 || delay > LDT_FEC_DELAY_MAX) return ERR_PTR (-ERANGE);
+	if (delay == 0) delay = LDT_FEC_DELAY_DEF;
+	st = kzalloc (sizeof (*st), GFP_KERNEL);
+	if (!st) return ERR_PTR (-ENOMEM);
+	spin_lock_init (&st->txlock);
+	spin_lock_init (&st->rxlock);
+	st->k = k;
+	st->delay = msecs_to_jiffies (delay);
+	if (st->delay == 0) st->delay = 1;
+	/* the parity of a group may be sent up to delay after its first packet */
+	st->rxhold = max_t (unsigned long, 4 * st->delay, HZ / 10);
+	return st;
+}
+
+void
+ldt_fec_set (fec, st)
+	struct ldt_fec				*fec;
+	struct ldt_fec_state		*st;
+{
+	struct ldt_fec_state	*old;
+
+	if (!fec) return;
+	old = rcu_dereference_protected (fec->st, 1);
+	rcu_assign_pointer (fec->st, st);
+	if (old) kfree_rcu (old, rcu);
+}
+
+
+long
+ldt_fec_encode (fec, skb, parity)
+	struct ldt_fec		*fec;
+	struct sk_buff		*skb;
+	struct sk_buff		**parity;
+{
+	struct ldt_fec_state	*st;
+	u8							*hdr;
+	int						len, type;
+	long						started = 0;
+
+	if (!fec || !skb || !parity) return -EINVAL;
+	*parity = NULL;
+	if (!rcu_access_pointer (fec->st) || !skb->len) return 0;
+	/* only ip packets - neither control, nor already protected ones */
+	type = TP_GETPKTTYPE (skb->data[0]);
+	if (type != 4 && type != 6) return 0;
+	if (skb->len > LDT_FEC_MAXLEN) return 0;
+	if (skb_linearize (skb) < 0) return -ENOMEM;
+	if (skb_cow_head (skb, LDT_FEC_HDRLEN) < 0) return -ENOMEM;
+
+	rcu_read_lock_bh ();
+	st = rcu_dereference_bh (fec->st);
+	if (!st || !st->k) {
+		rcu_read_unlock_bh ();
+		return 0;
+	}
+	spin_lock (&st->txlock);
+	len = skb->len;
+	if (st->txidx == 0) {
+		memset (st->txbuf, 0, st->txmaxlen);
+		st->txmaxlen = 0;
+		st->txlenx = 0;
+		st->txstart = jiffies;
+		started = st->delay;
+	}
+	crypto_xor (st->txbuf, skb->data, len);
+	st->txlenx ^= len;
+	if (len > st->txmaxlen) st->txmaxlen = len;
+	hdr = skb_push (skb, LDT_FEC_HDRLEN);
+	hdr[0] = 0x30 | LDT_FEC_T_DATA;
+	hdr[1] = st->k;
+	hdr[2] = st->txidx;
+	hdr[3] = 0;
+	put_unaligned_be16 (st->txgid, hdr + 4);
+	hdr[6] = hdr[7] = 0;
+	if (++st->txidx >= st->k) *parity = fec_mkparity (st);
+	spin_unlock (&st->txlock);
+	rcu_read_unlock_bh ();
+	atomic64_inc (&fec->txdata);
+	if (*parity) atomic64_inc (&fec->txparity);
+	return started;
+}
+
+struct sk_buff*
+ldt_fec_flush (fec, next)
+	struct ldt_fec		*fec;
+	unsigned long		*next;
+{
+	struct ldt_fec_state	*st;
+	struct sk_buff			*skb = NULL;
+	unsigned long			age;
+
+	if (next) *next = 0;
+	if (!fec) return NULL;
+	rcu_read_lock_bh ();
+	st = rcu_dereference_bh (fec->st);
+	if (st && st->k) {
+		spin_lock (&st->txlock);
+		if (st->txidx > 0) {
+			age = jiffies - st->txstart;
+			if (age >= st->delay) {
+				skb = fec_mkparity (st);
+			} else if (next) {
+				*next = st->delay - age;
+			}
+		}
+		spin_unlock (&st->txlock);
+	}
+	rcu_read_unlock_bh ();
+	if (skb) atomic64_inc (&fec->txparity);
+	return skb;
+}
+
+/* called with txlock held - closes the group */
+static
+struct sk_buff*
+fec_mkparity (st)
+	struct ldt_fec_state	*st;
+{
+	struct sk_buff	*skb;
+	u8					*hdr;
+
+	/* tailroom for the aead tag */
+	skb = alloc_skb (FEC_HEADROOM + LDT_FEC_HDRLEN + st->txmaxlen
+							+ LDT_AEAD_TAGLEN, GFP_ATOMIC);
+	if (skb) {
+		skb_reserve (skb, FEC_HEADROOM);
+		hdr = skb_put (skb, LDT_FEC_HDRLEN + st->txmaxlen);
+		hdr[0] = 0x30 | LDT_FEC_T_PARITY;
+		hdr[1] = st->txidx;
+		hdr[2] = hdr[3] = 0;
+		put_unaligned_be16 (st->txgid, hdr + 4);
+		put_unaligned_be16 (st->txlenx, hdr + 6);
+		memcpy (hdr + LDT_FEC_HDRLEN, st->txbuf, st->txmaxlen);
+	}
+	st->txgid++;
+	st->txidx = 0;
+	return skb;
+}
+
+
+int
+ldt_fec_decode (fec, skb, rec)
+	struct ldt_fec		*fec;
+	struct sk_buff		*skb;
+	struct sk_buff		**rec;
+{
+	struct ldt_fec_state	*st;
+	struct ldt_fec_slot	*slot;
+	u8							*hdr;
+	int						kind, n, idx, plen;
+	int						dup = 0;
+	u16						gid, lenx;
+
+	if (!fec || !skb || !rec) return -EINVAL;
+	*rec = NULL;
+	if (skb_linearize (skb) < 0) return -ENOMEM;
+	if (skb->len < LDT_FEC_HDRLEN) return -EBADMSG;
+	hdr = skb->data;
+	kind = hdr[0] & 0x0f;
+	n = hdr[1];
+	idx = hdr[2];
+	gid = get_unaligned_be16 (hdr + 4);
+	lenx = get_unaligned_be16 (hdr + 6);
+	plen = skb->len - LDT_FEC_HDRLEN;
+	if (plen > LDT_FEC_MAXLEN) return -EBADMSG;
+	switch (kind) {
+	case LDT_FEC_T_DATA:
+		if (idx >= LDT_FEC_K_MAX || plen == 0) return -EBADMSG;
+		atomic64_inc (&fec->rxdata);
+		break;
+	case LDT_FEC_T_PARITY:
+		if (n == 0 || n > LDT_FEC_K_MAX) return -EBADMSG;
+		atomic64_inc (&fec->rxparity);
+		break;
+	default:
+		return -EBADMSG;
+	}
+
+	rcu_read_lock_bh ();
+	st = rcu_dereference_bh (fec->st);
+	if (st) {
+		spin_lock (&st->rxlock);
+		slot = fec_slot (fec, st, gid);
+		if (slot && kind == LDT_FEC_T_DATA && !(slot->rcvd & (1U << idx))) {
+			slot->rcvd |= 1U << idx;
+			crypto_xor (slot->buf, hdr + LDT_FEC_HDRLEN, plen);
+			slot->lenx ^= plen;
+			if (plen > slot->maxlen) slot->maxlen = plen;
+		} else if (slot && kind == LDT_FEC_T_DATA) {
+			/* already received - or rebuilt from the parity */
+			dup = 1;
+		} else if (slot && kind == LDT_FEC_T_PARITY && !slot->parity) {
+			slot->parity = 1;
+			slot->k = n;
+			crypto_xor (slot->buf, hdr + LDT_FEC_HDRLEN, plen);
+			slot->lenx ^= lenx;
+			if (plen > slot->maxlen) slot->maxlen = plen;
+		}
+		if (slot) *rec = fec_recover (fec, slot);
+		spin_unlock (&st->rxlock);
+	}
+	rcu_read_unlock_bh ();
+	if (kind == LDT_FEC_T_PARITY) {
+		consume_skb (skb);
+		return 1;
+	}
+	if (dup) {
+		atomic64_inc (&fec->late);
+		kfree_skb (skb);
+		return 1;
+	}
+	__skb_pull (skb, LDT_FEC_HDRLEN);
+	return 0;
+}
+
+/* called with rxlock held - returns NULL for late packets */
+static
+struct ldt_fec_slot*
+fec_slot (fec, st, gid)
+	struct ldt_fec				*fec;
+	struct ldt_fec_state		*st;
+	u16							gid;
+{
+	struct ldt_fec_slot	*slot = &st->slot[gid % LDT_FEC_SLOTS];
+	unsigned long			now = jiffies;
+
+	if (slot->valid) {
+		if (slot->gid == gid && time_before (now, slot->tstamp + st->rxhold))
+			return slot;
+		if ((s16)(gid - slot->gid) < 0 &&
+				time_before (now, slot->tstamp + st->rxhold)) {
+			atomic64_inc (&fec->late);
+			return NULL;
+		}
+		fec_retire (fec, slot);
+	}
+	memset (slot->buf, 0, slot->maxlen);
+	slot->gid = gid;
+	slot->k = 0;
+	slot->valid = 1;
+	slot->parity = 0;
+	slot->done = 0;
+	slot->rcvd = 0;
+	slot->lenx = 0;
+	slot->maxlen = 0;
+	slot->tstamp = now;
+	return slot;
+}
+
+static
+void
+fec_retire (fec, slot)
+	struct ldt_fec			*fec;
+	struct ldt_fec_slot	*slot;
+{
+	int	have;
+
+	if (slot->valid && slot->parity && !slot->done) {
+		have = hweight32 (slot->rcvd & FEC_KMASK(slot->k));
+		if (have < slot->k) atomic64_add (slot->k - have, &fec->lost);
+	}
+	slot->valid = 0;
+}
+
+/* called with rxlock held */
+static
+struct sk_buff*
+fec_recover (fec, slot)
+	struct ldt_fec			*fec;
+	struct ldt_fec_slot	*slot;
+{
+	struct sk_buff	*skb;
+	int				have, len, type;
+
+	if (!slot->parity || slot->done) return NULL;
+	have = hweight32 (slot->rcvd & FEC_KMASK(slot->k));
+	if (have >= slot->k) {
+		slot->done = 1;
+		return NULL;
+	}
+	if (have != slot->k - 1) return NULL;
+	/* the remaining packet is what is left in the buffer */
+	slot->done = 1;
+	len = slot->lenx;
+	type = TP_GETPKTTYPE (slot->buf[0]);
+	if (len == 0 || len > slot->maxlen || (type != 4 && type != 6)) {
+		atomic64_inc (&fec->lost);
+		return NULL;
+	}
+	skb = dev_alloc_skb (len);
+	if (!skb) {
+		atomic64_inc (&fec->lost);
+		return NULL;
+	}
+	memcpy (skb_put (skb, len), slot->buf, len);
+	/* the original arriving late must not be delivered again */
+	slot->rcvd |= FEC_KMASK(slot->k);
+	atomic64_inc (&fec->recovered);
+	return skb;
+}
+
+
+int
+ldt_fec_prtinfo (fec, buf, blen, spc)
+	struct ldt_fec	*fec;
+	char				*buf;
+	size_t			blen;
+	unsigned			spc;
+{
+	struct ldt_fec_state	*st;
+	int						len = 0;
+
+	if (!fec) return 0;
+	if (!rcu_access_pointer (fec->st) && !atomic64_read (&fec->rxdata)) return 0;
+#define _FSTR	(buf ? buf + len : NULL)
+#define _FLEN	(blen > len ? blen - len : 0)
+	rcu_read_lock ();
+	st = rcu_dereference (fec->st);
+	if (st) {
+		len += snprintf (_FSTR, _FLEN, "%*c<fec mode=\"xor\" k=\"%d\" delay=\"%u\"",
+								spc, ' ', st->k, jiffies_to_msecs (st->delay));
+	} else {
+		len += snprintf (_FSTR, _FLEN, "%*c<fec mode=\"off\"", spc, ' ');
+	}
+	rcu_read_unlock ();
+	len += snprintf (_FSTR, _FLEN, " txdata=\"%lld\" txparity=\"%lld\" "
+							"txdrop=\"%lld\" rxdata=\"%lld\" rxparity=\"%lld\" recovered=\"%lld\" "
+							"lost=\"%lld\" late=\"%lld\"/>\n",
+							(long long)atomic64_read (&fec->txdata),
+							(long long)atomic64_read (&fec->txparity),
+							(long long)atomic64_read (&fec->txdrop),
+							(long long)atomic64_read (&fec->rxdata),
+							(long long)atomic64_read (&fec->rxparity),
+							(long long)atomic64_read (&fec->recovered),
+							(long long)atomic64_read (&fec->lost),
+							(long long)atomic64_read (&fec->late));
+	return len;
+#undef _FSTR
+#undef _FLEN
+}
+
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
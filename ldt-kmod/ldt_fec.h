@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#ifndef _R__KERNEL_LDT_FEC_H
+#define _R__KERNEL_LDT_FEC_H
+
+#include <linux/types.h>
+#include <linux/skbuff.h>
+#include <linux/rcupdate.h>
+#include <linux/spinlock.h>
+#include <linux/atomic.h>
+#include "ldt_uapi.h"
+
+/* xor forward error correction - the sender xors the data packets of a
+ * group into one parity packet, the receiver delivers data packets at
+ * once and rebuilds a single missing packet per group from the parity.
+ */
+
+#define LDT_FEC_SLOTS	8		/* groups tracked by the receiver */
+
+struct ldt_fec_slot {
+	u16					gid;
+	u8						k;				/* from parity - 0 = unknown */
+	u8						valid:1,
+							parity:1,
+							done:1;
+	u32					rcvd;			/* bitmap of data packets */
+	u16					lenx;
+	u16					maxlen;
+	unsigned long		tstamp;		/* jiffies */
+	u8						buf[LDT_FEC_MAXLEN];
+};
+
+struct ldt_fec_state {
+	struct rcu_head		rcu;
+	int						k;				/* 0 = receive only */
+	unsigned long			delay;		/* jiffies */
+	unsigned long			rxhold;		/* jiffies */
+	spinlock_t				txlock;
+	u16						txgid;
+	int						txidx;
+	u16						txlenx;
+	u16						txmaxlen;
+	unsigned long			txstart;		/* jiffies */
+	u8							txbuf[LDT_FEC_MAXLEN];
+	spinlock_t				rxlock;
+	struct ldt_fec_slot	slot[LDT_FEC_SLOTS];
+};
+
+struct ldt_fec {
+	struct ldt_fec_state __rcu	*st;
+	atomic64_t						txdata;
+	atomic64_t						txparity;
+	atomic64_t						txdrop;		/* parity dropped, queue full */
+	atomic64_t						rxdata;
+	atomic64_t						rxparity;
+	atomic64_t						recovered;
+	atomic64_t						lost;			/* known lost and not recovered */
+	atomic64_t						late;			/* group retired or rebuilt */
+};
+
+
+void ldt_fec_init (struct ldt_fec*);
+void ldt_fec_destroy (struct ldt_fec*);
+
+/* may sleep - returns NULL for LDT_FEC_OFF */
+struct ldt_fec_state *ldt_fec_mkstate (int mode, int k, int delay);
+/* takes over st - may be called from atomic context */
+void ldt_fec_set (struct ldt_fec*, struct ldt_fec_state*);
+
+/* data packets (ip only) get the fec header pushed - parity is set if a
+ * group was completed. Returns the jiffies until the group has to be
+ * closed if a new group was started, 0 otherwise.
+ */
+long ldt_fec_encode (struct ldt_fec*, struct sk_buff*, struct sk_buff **parity);
+/* closes a group older than delay - otherwise next is set to the
+ * jiffies until it has to be closed (0 = no open group)
+ */
+struct sk_buff *ldt_fec_flush (struct ldt_fec*, unsigned long *next);
+/* returns 0 for data packets (header removed), 1 for parity packets
+ * and duplicates of data already delivered (consumed), rec is set to a
+ * recovered packet
+ */
+int ldt_fec_decode (struct ldt_fec*, struct sk_buff*, struct sk_buff **rec);
+
+int ldt_fec_prtinfo (struct ldt_fec*, char *buf, size_t blen, unsigned spc);
+
+
+
+#endif	/* _R__KERNEL_LDT_FEC_H */
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
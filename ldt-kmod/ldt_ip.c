@@ -129,6 +129,24 @@ ldt_iphdrlen (data, sz, l4prot)
 	return sz;
 }
 
+/* dscp (ipv4) resp. upper 6 bits of the traffic class (ipv6) -
+ * negative if data is no ip packet */
+int
+ldt_ipdscp (data, sz)
+	char	*data;
+	int	sz;
+{
+	if (!data || sz < 2) return -EINVAL;
+	switch (TP_GETPKTTYPE(data[0])) {
+	case 4:
+		return ((unsigned)(u8)data[1]) >> 2;
+	case 6:
+		return ((((unsigned)(u8)data[0] & 0x0f) << 4) |
+					(((unsigned)(u8)data[1]) >> 4)) >> 2;
+	}
+	return -EBADMSG;
+}
+
 int
 ldt_ipv4hdrlen (data, sz, l4prot)
 	char	*data;
@@ -140,6 +158,7 @@ ldt_ipv4hdrlen (data, sz, l4prot)
 	if (!data || sz < 0) return -EINVAL;
 	if (sz < 20) return sz;
 	len = (data[0] & 0x0f) << 2;
+	if (len < 20) return -EBADMSG;
 	if (sz < len) return sz;
 	if (l4prot) *l4prot = ((unsigned)(u8)(data[9]));
 	return len;
@@ -156,7 +175,7 @@ ldt_ipv6hdrlen (data, sz, l4prot)
 
 	if (!data || sz < 0) return -EINVAL;
 	if (sz < 40) return sz;
-	ret = getipv6exthdrlen ((unsigned)data[6], data+40, sz-40, l4prot);
+	ret = getipv6exthdrlen ((unsigned)(u8)data[6], data+40, sz-40, l4prot);
 	if (ret < 0) return ret;
 	return ret + 40;
 }
@@ -176,15 +195,16 @@ getipv6exthdrlen (prot, data, sz, l4prot)
 	case 43: /* routing */
 	case 60: /* destination options */
 		if (sz < 2) return sz;
-		len = (((unsigned)data[1]) << 3) + 1;
-		prot = (unsigned)data[0];
+		/* length is in units of 8 octets, not counting the first 8 */
+		len = (((unsigned)(u8)data[1]) + 1) << 3;
+		prot = (unsigned)(u8)data[0];
 		if (sz < len) return sz;
 		ret = getipv6exthdrlen (prot, data+len, sz-len, l4prot);
 		if (ret < 0) return ret;
 		return len + ret;
 	case 44: /* fragment */
-		prot = (unsigned)data[0];
 		if (sz < 8) return sz;
+		prot = (unsigned)(u8)data[0];
 		ret = getipv6exthdrlen (prot, data+8, sz-8, l4prot);
 		if (ret < 0) return ret;
 		return 8 + ret;
@@ -205,17 +225,21 @@ ldt_l4hdrlen (prot, data, sz)
 	int	prot, sz;
 	char	*data;
 {
+	int	len;
+
 	if (!data || sz < 0) return -EINVAL;
 	switch (prot) {
 	case 6: /* TCP */
-		if (sz < 12) return -EBADMSG;
-		return (((u8)data[12]) & 0xf0) >> 2;
+		if (sz < 20) return -EBADMSG;
+		len = (((u8)data[12]) & 0xf0) >> 2;
+		return len < 20 ? -EBADMSG : len;
 	case 17: /* UDP */
 	case 136: /* UDPLite */
 		return 8;
 	case 33: /* DCCP */
-		if (sz < 4) return -EBADMSG;
-		return ((unsigned)(u8)(data[4])) << 2;
+		if (sz < 12) return -EBADMSG;
+		len = ((unsigned)(u8)(data[4])) << 2;
+		return len < 12 ? -EBADMSG : len;
 	}
 	return sz;
 }
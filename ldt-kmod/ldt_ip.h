@@ -62,6 +62,7 @@ int ldt_l4hdrlen (int prot, char *data, int sz);
 int ldt_iphdrlen (char *data, int sz, int *l4prot);
 int ldt_ipv4hdrlen (char *data, int sz, int *l4prot);
 int ldt_ipv6hdrlen (char *data, int sz, int *l4prot);
+int ldt_ipdscp (char *data, int sz);
 
 
 
@@ -0,0 +1,690 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/hash.h>
+#include <linux/jhash.h>
+#include <linux/rculist.h>
+#include <linux/net.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/inetdevice.h>
+#include <linux/version.h>
+#include <net/sock.h>
+#include <net/ipv6.h>
+
+#include "ldt_mc.h"
+#include "ldt_prot1.h"
+#include "ldt_debug.h"
+
+
+struct ldt_mcroute {
+	struct list_head	list;
+	tp_addr_t			raddr;		/* port 0 matches any port */
+	tp_addr_t			inner;
+	int					plen;
+};
+
+static void mc_gc_handler (struct work_struct*);
+static void mc_unlink (struct ldt_mc*, struct ldt_mcpeer*);
+static int mc_setinner (struct ldt_mc*, struct ldt_mcpeer*, tp_addr_t*, int, int);
+static void mc_unhash_inner (struct ldt_mc*, struct ldt_mcpeer*);
+static struct ldt_mcpeer *mc_find_inner (struct ldt_mc*, tp_addr_t*, int);
+static void mc_mkkey (tp_addr_t*, tp_addr_t*, int);
+static int mc_routematch (struct ldt_mcroute*, tp_addr_t*);
+static int mc_getpeername (struct socket*, tp_addr_t*);
+static void mc_freepeer (struct ldt_mcpeer*);
+
+
+#define MC_HASH_SK(sk)	hash_ptr ((sk), LDT_MC_HBITS)
+
+static inline
+u32
+mc_hash_inner (
+	tp_addr_t	*key,
+	int			plen)
+{
+	u32	h;
+
+	if (TP_ADDRP_ISIPV6(key)) {
+		h = jhash (key->v6.sin6_addr.s6_addr, 16, plen);
+	} else {
+		h = jhash_1word (key->v4.sin_addr.s_addr, plen);
+	}
+	return h & (LDT_MC_HSIZE - 1);
+}
+
+
+struct ldt_mc*
+ldt_mc_new (owner, ops, gfp)
+	void							*owner;
+	const struct ldt_mc_ops	*ops;
+	gfp_t							gfp;
+{
+	struct ldt_mc	*mc;
+
+	mc = kzalloc (sizeof (struct ldt_mc), gfp);
+	if (!mc) return NULL;
+	mc->owner = owner;
+	mc->ops = ops;
+	spin_lock_init (&mc->lock);
+	INIT_LIST_HEAD (&mc->peers);
+	INIT_LIST_HEAD (&mc->graveyard);
+	INIT_LIST_HEAD (&mc->routes);
+	INIT_WORK (&mc->work_gc, mc_gc_handler);
+	return mc;
+}
+
+/* the hash tables are too big for atomic allocation - hence they are
+ * allocated separately from process context
+ */
+int
+ldt_mc_start (mc)
+	struct ldt_mc	*mc;
+{
+	struct hlist_head	*tbl;
+	int					i;
+
+	if (!mc) return -EINVAL;
+	if (mc->bysk) return 0;
+	tbl = vzalloc (2 * LDT_MC_HSIZE * sizeof (struct hlist_head));
+	if (!tbl) return -ENOMEM;
+	for (i=0; i<2*LDT_MC_HSIZE; i++)
+		INIT_HLIST_HEAD (&tbl[i]);
+	spin_lock_bh (&mc->lock);
+	if (mc->bysk) {
+		spin_unlock_bh (&mc->lock);
+		vfree (tbl);
+		return 0;
+	}
+	mc->byinner = tbl + LDT_MC_HSIZE;
+	smp_store_release (&mc->bysk, tbl);
+	spin_unlock_bh (&mc->lock);
+	return 0;
+}
+
+void
+ldt_mc_flush (mc)
+	struct ldt_mc	*mc;
+{
+	struct ldt_mcpeer	*peer, *tmp;
+
+	if (!mc) return;
+	spin_lock_bh (&mc->lock);
+	list_for_each_entry_safe (peer, tmp, &mc->peers, list) {
+		mc_unlink (mc, peer);
+	}
+	spin_unlock_bh (&mc->lock);
+	queue_work (system_wq, &mc->work_gc);
+}
+
+/* the owner must not be used by the peer table after this call - the table
+ * itself is freed by the gc handler once all peers are gone
+ */
+void
+ldt_mc_destroy (mc)
+	struct ldt_mc	*mc;
+{
+	struct ldt_mcpeer	*peer, *tmp;
+
+	if (!mc) return;
+	spin_lock_bh (&mc->lock);
+	list_for_each_entry_safe (peer, tmp, &mc->peers, list) {
+		mc_unlink (mc, peer);
+	}
+	mc->owner = NULL;
+	mc->destroy = 1;
+	spin_unlock_bh (&mc->lock);
+	queue_work (system_wq, &mc->work_gc);
+}
+
+static
+void
+mc_gc_handler (work)
+	struct work_struct	*work;
+{
+	struct ldt_mc			*mc;
+	struct ldt_mcpeer		*peer, *tmp;
+	struct ldt_mcroute	*route, *rtmp;
+	void						*owner;
+	int						destroy;
+	LIST_HEAD				(dead);
+
+	mc = container_of (work, struct ldt_mc, work_gc);
+	spin_lock_bh (&mc->lock);
+	list_splice_init (&mc->graveyard, &dead);
+	owner = mc->owner;
+	destroy = mc->destroy;
+	spin_unlock_bh (&mc->lock);
+
+	if (!list_empty (&dead)) {
+		/* wait for readers still holding a pointer from the hash tables */
+		synchronize_rcu ();
+		list_for_each_entry_safe (peer, tmp, &dead, list) {
+			list_del (&peer->list);
+			if (owner && mc->ops && mc->ops->peerdown)
+				mc->ops->peerdown (owner, peer);
+			ldt_mc_put (peer);
+		}
+	}
+	if (!destroy) return;
+
+	tp_debug2 ("free peer table\n");
+	list_for_each_entry_safe (route, rtmp, &mc->routes, list) {
+		list_del (&route->list);
+		kfree (route);
+	}
+	if (mc->bysk) vfree (mc->bysk);
+	kfree (mc);
+}
+
+
+int
+ldt_mc_addpeer (mc, sock, peerp)
+	struct ldt_mc			*mc;
+	struct socket			*sock;
+	struct ldt_mcpeer		**peerp;
+{
+	struct ldt_mcpeer		*peer;
+	struct ldt_mcroute	*route;
+	int						ret;
+
+	if (!mc || !sock || !sock->sk || !peerp) return -EINVAL;
+	if (!mc->bysk) return -ENOTCONN;
+	peer = kzalloc (sizeof (struct ldt_mcpeer), GFP_KERNEL);
+	if (!peer) return -ENOMEM;
+	ret = mc_getpeername (sock, &peer->raddr);
+	if (ret < 0) {
+		tp_debug ("cannot get peer address: %d\n", ret);
+		kfree (peer);
+		return ret;
+	}
+	peer->mc = mc;
+	peer->sock = sock;
+	peer->inner_plen = -1;
+	peer->ctime = jiffies;
+	atomic_set (&peer->refcnt, 1);
+	INIT_HLIST_NODE (&peer->hn_sk);
+	INIT_HLIST_NODE (&peer->hn_inner);
+
+	spin_lock_bh (&mc->lock);
+	if (mc->destroy) {
+		spin_unlock_bh (&mc->lock);
+		kfree (peer);
+		return -EPERM;
+	}
+	peer->id = ++mc->lastid;
+	list_for_each_entry (route, &mc->routes, list) {
+		if (mc_routematch (route, &peer->raddr)) {
+			mc_setinner (mc, peer, &route->inner, route->plen, 1);
+			break;
+		}
+	}
+	hlist_add_head_rcu (&peer->hn_sk, &mc->bysk[MC_HASH_SK(sock->sk)]);
+	list_add_tail (&peer->list, &mc->peers);
+	mc->num++;
+	spin_unlock_bh (&mc->lock);
+	tp_debug ("new peer %u (%pISpc)\n", peer->id, &peer->raddr.ad);
+	*peerp = peer;
+	return 0;
+}
+
+void
+ldt_mc_peerdead (peer)
+	struct ldt_mcpeer	*peer;
+{
+	struct ldt_mc	*mc;
+
+	if (!peer || !peer->mc) return;
+	mc = peer->mc;
+	spin_lock_bh (&mc->lock);
+	if (peer->dead) {
+		spin_unlock_bh (&mc->lock);
+		return;
+	}
+	mc_unlink (mc, peer);
+	spin_unlock_bh (&mc->lock);
+	tp_debug ("peer %u gone\n", peer->id);
+	queue_work (system_wq, &mc->work_gc);
+}
+
+/* mc->lock must be held */
+static
+void
+mc_unlink (mc, peer)
+	struct ldt_mc			*mc;
+	struct ldt_mcpeer		*peer;
+{
+	if (peer->dead) return;
+	peer->dead = 1;
+	hlist_del_init_rcu (&peer->hn_sk);
+	if (peer->hasinner) mc_unhash_inner (mc, peer);
+	list_move_tail (&peer->list, &mc->graveyard);
+	mc->num--;
+	/* the socket must not call back into the owner anymore */
+	if (mc->owner && mc->ops && mc->ops->detach)
+		mc->ops->detach (mc->owner, peer);
+}
+
+void
+ldt_mc_put (peer)
+	struct ldt_mcpeer	*peer;
+{
+	if (!peer) return;
+	if (!atomic_dec_and_test (&peer->refcnt)) return;
+	mc_freepeer (peer);
+}
+
+static
+void
+mc_freepeer (peer)
+	struct ldt_mcpeer	*peer;
+{
+	struct socket	*sock = peer->sock;
+
+	if (sock) {
+		kernel_sock_shutdown (sock, SHUT_RDWR);
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4,2,0)
+		sk_release_kernel (sock->sk);
+#else
+		sock_release (sock);
+#endif
+	}
+	kfree (peer);
+}
+
+
+/* mc->lock must be held
+ * steal: if another peer owns the same prefix, it looses it
+ */
+static
+int
+mc_setinner (mc, peer, inner, plen, steal)
+	struct ldt_mc			*mc;
+	struct ldt_mcpeer		*peer;
+	tp_addr_t				*inner;
+	int						plen, steal;
+{
+	struct ldt_mcpeer	*old;
+	tp_addr_t			key;
+
+	mc_mkkey (&key, inner, plen);
+	old = mc_find_inner (mc, &key, plen);
+	if (old == peer) return 0;
+	if (old) {
+		if (!steal) return -EEXIST;
+		tp_debug ("peer %u takes over inner prefix of peer %u\n",
+						peer->id, old->id);
+		mc_unhash_inner (mc, old);
+	}
+	if (peer->hasinner) mc_unhash_inner (mc, peer);
+	tp_addr_cp (&peer->inner, &key);
+	peer->inner_plen = plen;
+	peer->hasinner = 1;
+	hlist_add_head_rcu (&peer->hn_inner, &mc->byinner[mc_hash_inner (&key, plen)]);
+	if (TP_ADDR_ISIPV6(key)) {
+		mc->plen6[plen]++;
+	} else {
+		mc->plen4[plen]++;
+	}
+	return 0;
+}
+
+/* mc->lock must be held */
+static
+void
+mc_unhash_inner (mc, peer)
+	struct ldt_mc			*mc;
+	struct ldt_mcpeer		*peer;
+{
+	if (!peer->hasinner) return;
+	hlist_del_init_rcu (&peer->hn_inner);
+	if (TP_ADDR_ISIPV6(peer->inner)) {
+		mc->plen6[peer->inner_plen]--;
+	} else {
+		mc->plen4[peer->inner_plen]--;
+	}
+	peer->hasinner = 0;
+	peer->learned = 0;
+	peer->inner_plen = -1;
+}
+
+static
+struct ldt_mcpeer*
+mc_find_inner (mc, key, plen)
+	struct ldt_mc	*mc;
+	tp_addr_t		*key;
+	int				plen;
+{
+	struct ldt_mcpeer	*peer;
+
+	hlist_for_each_entry_rcu (peer, &mc->byinner[mc_hash_inner (key, plen)], hn_inner) {
+		if (peer->inner_plen == plen && tp_addr_eq (&peer->inner, key))
+			return peer;
+	}
+	return NULL;
+}
+
+static
+void
+mc_mkkey (key, ad, plen)
+	tp_addr_t	*key, *ad;
+	int			plen;
+{
+	if (TP_ADDRP_ISIPV6(ad)) {
+		tp_addr_setipv6 (key, ad->v6.sin6_addr.s6_addr, 0);
+		ipv6_addr_prefix (&key->v6.sin6_addr, &ad->v6.sin6_addr, plen);
+	} else {
+		tp_addr_setipv4 (key, ad->v4.sin_addr.s_addr & inet_make_mask (plen), 0);
+	}
+}
+
+
+struct ldt_mcpeer*
+ldt_mc_bysk (mc, sk)
+	struct ldt_mc	*mc;
+	struct sock		*sk;
+{
+	struct hlist_head	*tbl;
+	struct ldt_mcpeer	*peer;
+
+	if (!mc || !sk) return NULL;
+	tbl = smp_load_acquire (&mc->bysk);
+	if (!tbl) return NULL;
+	hlist_for_each_entry_rcu (peer, &tbl[MC_HASH_SK(sk)], hn_sk) {
+		if (peer->sock && peer->sock->sk == sk) return peer;
+	}
+	return NULL;
+}
+
+/* longest prefix match on the inner destination address - we only probe
+ * prefix lengths that are actually in use
+ */
+struct ldt_mcpeer*
+ldt_mc_lookup (mc, skb)
+	struct ldt_mc		*mc;
+	struct sk_buff		*skb;
+{
+	struct ldt_mcpeer	*peer;
+	tp_addr_t			dst, key;
+	int					plen;
+
+	if (!mc || !skb || !pskb_may_pull (skb, 1)) return NULL;
+	if (!smp_load_acquire (&mc->bysk)) return NULL;
+	switch (TP_GETPKTTYPE (skb->data[0])) {
+	case 4:
+		if (!pskb_may_pull (skb, sizeof (struct iphdr))) return NULL;
+		tp_addr_setipv4 (&dst, ((struct iphdr*)skb->data)->daddr, 0);
+		for (plen=32; plen>=0; plen--) {
+			if (!READ_ONCE (mc->plen4[plen])) continue;
+			mc_mkkey (&key, &dst, plen);
+			peer = mc_find_inner (mc, &key, plen);
+			if (peer) return peer;
+		}
+		break;
+	case 6:
+		if (!pskb_may_pull (skb, sizeof (struct ipv6hdr))) return NULL;
+		tp_addr_setipv6 (&dst, ((struct ipv6hdr*)skb->data)->daddr.s6_addr, 0);
+		for (plen=128; plen>=0; plen--) {
+			if (!READ_ONCE (mc->plen6[plen])) continue;
+			mc_mkkey (&key, &dst, plen);
+			peer = mc_find_inner (mc, &key, plen);
+			if (peer) return peer;
+		}
+		break;
+	}
+	return NULL;
+}
+
+/* peers without configured route get the inner source address of their
+ * first packet assigned - an address already in use is never taken over
+ */
+void
+ldt_mc_learn (peer, skb)
+	struct ldt_mcpeer	*peer;
+	struct sk_buff		*skb;
+{
+	struct ldt_mc	*mc;
+	tp_addr_t		src;
+	int				plen;
+
+	if (!peer || !skb || !pskb_may_pull (skb, 1)) return;
+	if (peer->hasinner || peer->dead) return;
+	mc = peer->mc;
+	switch (TP_GETPKTTYPE (skb->data[0])) {
+	case 4:
+		if (!pskb_may_pull (skb, sizeof (struct iphdr))) return;
+		tp_addr_setipv4 (&src, ((struct iphdr*)skb->data)->saddr, 0);
+		plen = 32;
+		break;
+	case 6:
+		if (!pskb_may_pull (skb, sizeof (struct ipv6hdr))) return;
+		tp_addr_setipv6 (&src, ((struct ipv6hdr*)skb->data)->saddr.s6_addr, 0);
+		plen = 128;
+		break;
+	default:
+		return;
+	}
+	if (tp_addr_isany (&src)) return;
+	spin_lock_bh (&mc->lock);
+	if (!peer->hasinner && !peer->dead) {
+		if (mc_setinner (mc, peer, &src, plen, 0) == 0) {
+			peer->learned = 1;
+			tp_debug2 ("peer %u: learned inner address %pISc\n",
+							peer->id, &src.ad);
+		}
+	}
+	spin_unlock_bh (&mc->lock);
+}
+
+
+int
+ldt_mc_setroute (mc, raddr, inner, plen, del)
+	struct ldt_mc	*mc;
+	tp_addr_t		*raddr, *inner;
+	int				plen, del;
+{
+	struct ldt_mcroute	*route = NULL, *p;
+	struct ldt_mcpeer		*peer;
+
+	if (!mc || !raddr) return -EINVAL;
+	if (!del) {
+		if (!inner) return -EINVAL;
+		if (plen < 0) plen = TP_ADDRP_ISIPV6(inner) ? 128 : 32;
+		if (plen > (TP_ADDRP_ISIPV6(inner) ? 128 : 32)) return -EINVAL;
+	}
+	spin_lock_bh (&mc->lock);
+	list_for_each_entry (p, &mc->routes, list) {
+		if (tp_addr_eq (&p->raddr, raddr)) {
+			route = p;
+			break;
+		}
+	}
+	if (del) {
+		if (!route) {
+			spin_unlock_bh (&mc->lock);
+			return -ENOENT;
+		}
+		list_del (&route->list);
+		list_for_each_entry (peer, &mc->peers, list) {
+			if (peer->hasinner && !peer->learned && mc_routematch (route, &peer->raddr))
+				mc_unhash_inner (mc, peer);
+		}
+		spin_unlock_bh (&mc->lock);
+		kfree (route);
+		return 0;
+	}
+	if (!route) {
+		route = kzalloc (sizeof (struct ldt_mcroute), GFP_ATOMIC);
+		if (!route) {
+			spin_unlock_bh (&mc->lock);
+			return -ENOMEM;
+		}
+		tp_addr_cp (&route->raddr, raddr);
+		list_add_tail (&route->list, &mc->routes);
+	}
+	mc_mkkey (&route->inner, inner, plen);
+	route->plen = plen;
+	/* apply to already connected peers */
+	list_for_each_entry (peer, &mc->peers, list) {
+		if (mc_routematch (route, &peer->raddr))
+			mc_setinner (mc, peer, &route->inner, plen, 1);
+	}
+	spin_unlock_bh (&mc->lock);
+	return 0;
+}
+
+static
+int
+mc_routematch (route, raddr)
+	struct ldt_mcroute	*route;
+	tp_addr_t				*raddr;
+{
+	u16	port;
+
+	if (TP_ADDR_FAM(route->raddr) != TP_ADDRP_FAM(raddr)) return 0;
+	port = tp_addr_getport (&route->raddr);
+	if (port && port != tp_addr_getport (raddr)) return 0;
+	if (TP_ADDRP_ISIPV6(raddr)) {
+		return ipv6_addr_equal (&route->raddr.v6.sin6_addr, &raddr->v6.sin6_addr);
+	}
+	return route->raddr.v4.sin_addr.s_addr == raddr->v4.sin_addr.s_addr;
+}
+
+static
+int
+mc_getpeername (sock, addr)
+	struct socket	*sock;
+	tp_addr_t		*addr;
+{
+	int	ret;
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4,17,0)
+	int	len = sizeof (tp_addr_t);
+
+	ret = kernel_getpeername (sock, &addr->ad, &len);
+#else
+	ret = kernel_getpeername (sock, &addr->ad);
+#endif
+	if (ret < 0) return ret;
+	if (TP_ADDRP_FAM(addr) != AF_INET && TP_ADDRP_FAM(addr) != AF_INET6)
+		return -EAFNOSUPPORT;
+	return 0;
+}
+
+
+ssize_t
+ldt_mc_prtinfo (mc, buf, blen, spc)
+	struct ldt_mc	*mc;
+	char				*buf;
+	size_t			blen;
+	unsigned			spc;
+{
+	struct ldt_mcpeer	*peer;
+	int					len=0;
+	char					xbuf[sizeof("xxxx:xxxx:xxxx:xxxx:xxxx:xxxx:255.255.255.255")+2];
+
+	if (!mc) return 0;
+#define MYPRTIP(ad) (tp_addr_sprt_ip (xbuf, sizeof (xbuf), &(ad)) > 0 ? xbuf : "")
+#define _FSTR	(buf ? buf + len : NULL)
+#define _FLEN	(blen > len ? blen - len : 0)
+	spin_lock_bh (&mc->lock);
+	len += snprintf (_FSTR, _FLEN, "%*c<numclients>%d</numclients>\n",
+							spc, ' ', mc->num);
+	len += snprintf (_FSTR, _FLEN, "%*c<clientlist>\n", spc, ' ');
+	list_for_each_entry (peer, &mc->peers, list) {
+		len += snprintf (_FSTR, _FLEN, "%*c<client id=\"%u\" age=\"%u\">\n",
+							spc+2, ' ', peer->id,
+							jiffies_to_msecs (jiffies - peer->ctime) / 1000);
+		len += snprintf (_FSTR, _FLEN, "%*c<remaddr>%s</remaddr>\n",
+							spc+4, ' ', MYPRTIP(peer->raddr));
+		len += snprintf (_FSTR, _FLEN, "%*c<remport>%u</remport>\n",
+							spc+4, ' ', tp_addr_getuport (&peer->raddr));
+		if (peer->hasinner) {
+			len += snprintf (_FSTR, _FLEN, "%*c<inner%s>%s/%d</inner>\n",
+							spc+4, ' ', peer->learned ? " learned=\"1\"" : "",
+							MYPRTIP(peer->inner), peer->inner_plen);
+		}
+		len += snprintf (_FSTR, _FLEN, "%*c<stats rx_packets=\"%llu\" "
+							"rx_bytes=\"%llu\" tx_packets=\"%llu\" tx_bytes=\"%llu\" "
+							"tx_dropped=\"%llu\"/>\n", spc+4, ' ',
+							(unsigned long long)peer->stats.rx_packets,
+							(unsigned long long)peer->stats.rx_bytes,
+							(unsigned long long)peer->stats.tx_packets,
+							(unsigned long long)peer->stats.tx_bytes,
+							(unsigned long long)peer->stats.tx_dropped);
+		len += snprintf (_FSTR, _FLEN, "%*c</client>\n", spc+2, ' ');
+	}
+	len += snprintf (_FSTR, _FLEN, "%*c</clientlist>\n", spc, ' ');
+	spin_unlock_bh (&mc->lock);
+	return len;
+#undef _FSTR
+#undef _FLEN
+#undef MYPRTIP
+}
+
+
+
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
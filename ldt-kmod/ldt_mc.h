@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#ifndef _R__KERNEL_LDT_MC_H
+#define _R__KERNEL_LDT_MC_H
+
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/skbuff.h>
+#include <linux/workqueue.h>
+#include <linux/atomic.h>
+#include <linux/spinlock.h>
+#include "ldt_addr.h"
+
+struct socket;
+struct sock;
+
+/* peer table for servers handling many clients on one device */
+
+#define LDT_MC_HBITS		10
+#define LDT_MC_HSIZE		(1 << LDT_MC_HBITS)
+
+struct ldt_mcpeer_stats {
+	u64	rx_packets, rx_bytes;
+	u64	tx_packets, tx_bytes;
+	u64	tx_dropped;
+};
+
+struct ldt_mc;
+struct ldt_mcpeer {
+	struct hlist_node			hn_sk;
+	struct hlist_node			hn_inner;
+	struct list_head			list;
+	struct ldt_mc				*mc;
+	struct socket				*sock;
+	void							(*old_state_change)(struct sock*);
+	atomic_t						refcnt;
+	u32							id;
+	u32							hasinner:1,
+									learned:1,
+									dead:1;
+	tp_addr_t					raddr;		/* outer remote address */
+	tp_addr_t					inner;		/* inner prefix */
+	int							inner_plen;
+	unsigned long				ctime;		/* jiffies */
+	struct ldt_mcpeer_stats	stats;
+};
+
+struct ldt_mc_ops {
+	/* called from process context once the peer is gone */
+	void (*peerdown)(void *owner, struct ldt_mcpeer*);
+	/* must not sleep */
+	void (*detach)(void *owner, struct ldt_mcpeer*);
+};
+
+struct ldt_mc {
+	void							*owner;
+	const struct ldt_mc_ops	*ops;
+	spinlock_t					lock;					/* bh - learn runs in softirq */
+	struct list_head			peers;
+	struct list_head			graveyard;
+	struct list_head			routes;
+	int							num;
+	u32							lastid;
+	u32							destroy:1;
+	int							plen4[33];		/* # of peers per prefix length */
+	int							plen6[129];
+	struct work_struct		work_gc;
+	struct hlist_head			*bysk;			/* allocated by ldt_mc_start() */
+	struct hlist_head			*byinner;
+};
+
+
+struct ldt_mc *ldt_mc_new (void *owner, const struct ldt_mc_ops *ops, gfp_t);
+int ldt_mc_start (struct ldt_mc*);
+void ldt_mc_destroy (struct ldt_mc*);
+void ldt_mc_flush (struct ldt_mc*);
+
+int ldt_mc_addpeer (struct ldt_mc*, struct socket*, struct ldt_mcpeer**);
+void ldt_mc_peerdead (struct ldt_mcpeer*);
+int ldt_mc_setroute (struct ldt_mc*, tp_addr_t *raddr, tp_addr_t *inner,
+								int plen, int del);
+void ldt_mc_learn (struct ldt_mcpeer*, struct sk_buff*);
+
+/* need rcu_read_lock held */
+struct ldt_mcpeer *ldt_mc_bysk (struct ldt_mc*, struct sock*);
+struct ldt_mcpeer *ldt_mc_lookup (struct ldt_mc*, struct sk_buff*);
+
+static inline int ldt_mc_get (struct ldt_mcpeer *peer)
+{
+	return peer && atomic_inc_not_zero (&peer->refcnt);
+}
+void ldt_mc_put (struct ldt_mcpeer*);
+
+ssize_t ldt_mc_prtinfo (struct ldt_mc*, char *buf, size_t blen, unsigned spc);
+
+
+
+
+#endif	/* _R__KERNEL_LDT_MC_H */
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
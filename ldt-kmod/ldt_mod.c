@@ -60,12 +60,23 @@
 #include "ldt_sysctl.h"
 #include "ldt_dev.h"
 #include "ldt_version.h"
+#include "ldt_debugfs.h"
+#include "ldt_rxsteer.h"
+#include "ldt_evring.h"
+#include "ldt_net.h"
+#include "ldt_aead.h"
 #include "ldt_uapi.h"
 #if IS_ENABLED(CONFIG_IP_DCCP)
 # include "ldt_mpdccp.h"
 #endif
+#if IS_ENABLED(CONFIG_NET_UDP_TUNNEL)
+# include "ldt_bond.h"
+#endif
 #include "ldt_debug.h"
 
+#define CREATE_TRACE_POINTS
+#include "ldt_trace.h"
+
 
 static
 int
@@ -75,18 +86,58 @@ ldt_module_init (void)
 	int	ret;
 
 	tp_prtk ("load module version %s", LDT_VERSION);
-	ret = ldt_nl_register ();
+	ret = ldt_net_init ();
 	if (ret < 0) return ret;
+	ret = ldt_nl_register ();
+	if (ret < 0) goto err_nl;
 	ret = ldt_sysctl_init ();
-	if (ret < 0) return ret;
+	if (ret < 0) goto err_sysctl;
+	ret = ldt_rxsteer_global_init ();
+	if (ret < 0) goto err_rxsteer;
+	ret = ldt_evring_init ();
+	if (ret < 0) goto err_evring;
+	ret = ldt_aead_global_init ();
+	if (ret < 0) goto err_aead;
 	ret = ldt_dev_global_init ();
-	if (ret < 0) return ret;
+	if (ret < 0) goto err_dev;
+	ret = ldt_debugfs_init ();
+	if (ret < 0) goto err_debugfs;
 #if IS_ENABLED(CONFIG_IP_DCCP)
 	ret = ldt_mpdccp_register ();
-	if (ret < 0) return ret;
+	if (ret < 0) goto err_mpdccp;
+#endif
+#if IS_ENABLED(CONFIG_NET_UDP_TUNNEL)
+	ret = ldt_bond_register ();
+	if (ret < 0) goto err_bond;
 #endif
 	tp_prtk ("module version %s successfully loaded\n", LDT_VERSION);
 	return 0;
+
+	/* undo in reverse order */
+#if IS_ENABLED(CONFIG_NET_UDP_TUNNEL)
+err_bond:
+#endif
+#if IS_ENABLED(CONFIG_IP_DCCP)
+	ldt_mpdccp_unregister ();
+err_mpdccp:
+#endif
+	ldt_debugfs_exit ();
+err_debugfs:
+	ldt_dev_global_destroy ();
+err_dev:
+	ldt_aead_global_exit ();
+err_aead:
+	ldt_evring_exit ();
+err_evring:
+	ldt_rxsteer_global_exit ();
+err_rxsteer:
+	ldt_sysctl_exit ();
+err_sysctl:
+	ldt_nl_unregister ();
+err_nl:
+	ldt_net_exit ();
+	tp_err ("loading module failed: %d\n", ret);
+	return ret;
 }
 
 
@@ -95,13 +146,21 @@ void
 __exit
 ldt_module_exit (void)
 {
+	ldt_debugfs_exit ();
 	ldt_dev_global_destroy ();
 #if IS_ENABLED(CONFIG_IP_DCCP)
 	ldt_mpdccp_unregister ();
+#endif
+#if IS_ENABLED(CONFIG_NET_UDP_TUNNEL)
+	ldt_bond_unregister ();
 #endif
 	ldt_event_crsend (LDT_EVTYPE_TPDOWN, NULL, 0);
+	ldt_aead_global_exit ();
+	ldt_evring_exit ();
+	ldt_rxsteer_global_exit ();
 	ldt_sysctl_exit ();
 	ldt_nl_unregister ();
+	ldt_net_exit ();
 	tp_prtk ("module ver %s unloaded\n", LDT_VERSION);
 }
 
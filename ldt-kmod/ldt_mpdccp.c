@@ -68,6 +68,8 @@
 #include <linux/netdevice.h>
 #include <linux/ip.h>
 #include <linux/delay.h>
+#include <linux/mutex.h>
+#include <linux/ktime.h>
 #include <linux/interrupt.h>
 #include <linux/etherdevice.h>
 #include <linux/crypto.h>
@@ -78,6 +80,9 @@
 #include <linux/inetdevice.h>
 #include <net/ipv6.h>
 #include <net/udp.h>
+#include <net/ip.h>
+#include <net/icmp.h>
+#include <linux/icmpv6.h>
 #ifdef CONFIG_NET_UDP_TUNNEL
 # include <net/udp_tunnel.h>
 #endif
@@ -88,6 +93,7 @@
 # include <net/mpdccp.h>
 #endif
 #include <uapi/linux/dccp.h>
+#include <linux/tfrc.h>
 
 #include "ldt_uapi.h"
 #include "ldt_dev.h"
@@ -96,10 +102,19 @@
 #include "ldt_event.h"
 #include "ldt_addr.h"
 #include "ldt_prot1.h"
+#include "ldt_trace.h"
+#include "ldt_lathist.h"
 #include "ldt_ip.h"
 #include "ldt_tunaddr.h"
 #include "ldt_queue.h"
 #include "ldt_lock.h"
+#include "ldt_mc.h"
+#include "ldt_rxsteer.h"
+#include "ldt_aead.h"
+#include "ldt_pace.h"
+#include "ldt_fec.h"
+#include "ldt_qos.h"
+#include "ldt_sysctl.h"
 
 
 #ifdef NET_IP_ALIGN
@@ -132,10 +147,13 @@
 #define TP_MIN6HEADROOM	(TP_HDR6LEN + NET_SKB_PAD)
 
 struct mpdccptun;
+struct mpdccp_race;
 static int mpdccptun_new (struct ldt_tun*, const char *);
 static int mpdccptun_bind (struct mpdccptun*, tp_addr_t*, int);
 static int mpdccptun_dobind (struct mpdccptun*);
+static int mpdccptun_mksock (struct mpdccptun*, tp_addr_t*, struct socket**);
 static int mpdccptun_peer (struct mpdccptun*, tp_addr_t*);
+static int mpdccptun_peerlist (struct mpdccptun*, tp_addr_t*, tp_addr_t*, int, int, int, u32, int);
 static void mpdccptun_remove (struct mpdccptun*);
 static netdev_tx_t ldt_mpdccptun_xmit (struct mpdccptun*, struct sk_buff*);
 static int mpdccptun_elab_xmit2 (struct mpdccptun*, struct sk_buff*);
@@ -146,18 +164,40 @@ static int mpdccptun_check_enqueue (struct mpdccptun*, struct sk_buff*);
 static int mpdccptun_do_enqueue (struct mpdccptun*, struct sk_buff*);
 static ssize_t mpdccptun_getinfo (struct mpdccptun*, char*, size_t);
 static int mpdccptun_eventcreate (struct mpdccptun*, char*, size_t, const char*, const char*);
-static int mpdccptun_elab_recv (struct mpdccptun*, struct sk_buff*);
+static int mpdccptun_elab_recv (struct mpdccptun*, struct ldt_mcpeer*, struct sk_buff*);
+static int mpdccptun_deliver (struct mpdccptun*, struct ldt_mcpeer*, struct sk_buff*);
 static void mpdccptun_scrub_skb (struct sk_buff*);
 #if IS_ENABLED(CONFIG_IP_MPDCCP)
 static void tp_subflow_report (int, struct sock*, struct sock*, struct mpdccp_link_info*, int);
 static int tp_subflow_reg (struct sock*);
 static int tp_subflow_dereg (struct sock*);
 #endif
-static int mpdccptun_serverstart (struct mpdccptun*);
+static int mpdccptun_serverstart (struct mpdccptun*, int);
+static int mpdccptun_clientroute (struct mpdccptun*, tp_addr_t*, tp_addr_t*, int, int);
+static int mpdccptun_getlatency (struct mpdccptun*, struct ldt_latency*, int);
+static int mpdccptun_setsockopt (struct mpdccptun*, struct ldt_sockopt*);
+static int mpdccptun_setrxsteer (struct mpdccptun*, struct ldt_rxsteer_cfg*);
+static int mpdccptun_setrebind (struct mpdccptun*, int, int);
+static int mpdccptun_setaead (struct mpdccptun*, struct ldt_aead_key*, struct ldt_aead_key*, u32);
+static int mpdccptun_setpace (struct mpdccptun*, s64, int, int);
+static int mpdccptun_setfec (struct mpdccptun*, struct ldt_fec_state*);
+static int mpdccptun_setqos (struct mpdccptun*, struct ldt_qos_state*);
+static int mpdccptun_applysockopt (struct mpdccptun*, struct socket*);
+static void mpdccptun_setbuf (struct mpdccptun*, struct socket*);
+static void mpdccptun_kick_xmit (struct mpdccptun*);
+static void mpdccptun_pace_kick (void*);
+static void mpdccptun_pace_learn (struct mpdccptun*);
+static int mpdccptun_fec_encode (struct mpdccptun*, struct sk_buff*);
+static int mpdccptun_fec_queue (struct mpdccptun*, struct sk_buff*);
+static void mpdccptun_setoverhead (struct mpdccptun*);
+static void mpdccptun_toobig (struct mpdccptun*, struct sk_buff*, int);
 static int mpdccptun_doserverstart (struct mpdccptun*);
-static int mpdccptun_setqueue (struct mpdccptun*, int, int);
+static int mpdccptun_setqueue (struct mpdccptun*, int, int, struct ldt_qbands*);
 static void _myclose (struct socket*);
 static int mpdccptun_elab_accept (struct mpdccptun*);
+static int mpdccptun_mc_accept (struct mpdccptun*, struct socket*);
+static void mpdccptun_mc_peerdown (void*, struct ldt_mcpeer*);
+static void mpdccptun_mc_detach (void*, struct ldt_mcpeer*);
 static void accept_handler (struct work_struct*);
 static void listen_handler (struct work_struct*);
 static void xmit_handler (struct work_struct*);
@@ -165,6 +205,26 @@ static void xmit_handler_delayed (struct work_struct*);
 static void do_xmit_handler (struct mpdccptun*);
 static int mpdccptun_elab_connect (struct mpdccptun*);
 static void connect_handler (struct work_struct*);
+static int mpdccptun_mbb_rebind (struct mpdccptun*);
+static void mpdccptun_drain_old (struct mpdccptun*, struct socket*);
+static void mpdccptun_close_old (struct mpdccptun*, struct socket*);
+static void drain_handler (struct work_struct*);
+static void reconn_handler (struct work_struct*);
+static void fec_handler (struct work_struct*);
+static void free_handler (struct work_struct*);
+static void mpdccptun_cancel_works (struct mpdccptun*);
+static void rcv_handler (struct work_struct*);
+static void mpdccptun_schedule_reconnect (struct mpdccptun*, int);
+static void mpdccptun_conndead (struct mpdccptun*);
+static void mpdccptun_connected (struct mpdccptun*);
+static int mpdccptun_race_start (struct mpdccptun*);
+static void mpdccptun_race_stop (struct mpdccptun*);
+static struct mpdccp_race *mpdccptun_race_detach (struct mpdccptun*);
+static void mpdccptun_race_wait (struct mpdccp_race*);
+static void race_handler (struct work_struct*);
+static void race_won (struct mpdccp_race*, int, struct socket*, u32);
+static void race_put (struct mpdccp_race*);
+static int race_better (struct mpdccptun*, int, int);
 #if IS_ENABLED(CONFIG_IP_MPDCCP)
 static int mpdccptun_linkdown (struct mpdccptun*);
 #endif
@@ -172,7 +232,7 @@ static void conn_timer_handler (unsigned long data);
 
 static int do_xmit_skb (struct mpdccptun *, struct sk_buff*);
 static int mpdccptun_needheadroom (struct mpdccptun*);
-static int mpdccptun_getmtu (void*);
+static int mpdccptun_getmtu (struct mpdccptun*);
 static void mpdccptun_closesk (struct mpdccptun*);
 static void mpdccptun_close_listen (struct mpdccptun*);
 
@@ -188,8 +248,18 @@ struct ldt_tunops	mpdccptun_ops = {
 	.tp_createvent = (void*)mpdccptun_eventcreate,
 	.tp_prot1xmit = (void*)mpdccptun_xmit,
 	.tp_needheadroom = (void*)mpdccptun_needheadroom,
-	.tp_getmtu = mpdccptun_getmtu,
+	.tp_getmtu = (void*)mpdccptun_getmtu,
 	.tp_setqueue = (void*)mpdccptun_setqueue,
+	.tp_peerlist = (void*)mpdccptun_peerlist,
+	.tp_clientroute = (void*)mpdccptun_clientroute,
+	.tp_getlatency = (void*)mpdccptun_getlatency,
+	.tp_setsockopt = (void*)mpdccptun_setsockopt,
+	.tp_setrxsteer = (void*)mpdccptun_setrxsteer,
+	.tp_setrebind = (void*)mpdccptun_setrebind,
+	.tp_setaead = (void*)mpdccptun_setaead,
+	.tp_setpace = (void*)mpdccptun_setpace,
+	.tp_setfec = (void*)mpdccptun_setfec,
+	.tp_setqos = (void*)mpdccptun_setqos,
 	.ipv6 = 0,
 };
 
@@ -204,11 +274,26 @@ struct ldt_tunops	mpdccptun_ops6 = {
 	.tp_createvent = (void*)mpdccptun_eventcreate,
 	.tp_prot1xmit = (void*)mpdccptun_xmit,
 	.tp_needheadroom = (void*)mpdccptun_needheadroom,
-	.tp_getmtu = mpdccptun_getmtu,
+	.tp_getmtu = (void*)mpdccptun_getmtu,
 	.tp_setqueue = (void*)mpdccptun_setqueue,
+	.tp_peerlist = (void*)mpdccptun_peerlist,
+	.tp_clientroute = (void*)mpdccptun_clientroute,
+	.tp_getlatency = (void*)mpdccptun_getlatency,
+	.tp_setsockopt = (void*)mpdccptun_setsockopt,
+	.tp_setrxsteer = (void*)mpdccptun_setrxsteer,
+	.tp_setrebind = (void*)mpdccptun_setrebind,
+	.tp_setaead = (void*)mpdccptun_setaead,
+	.tp_setpace = (void*)mpdccptun_setpace,
+	.tp_setfec = (void*)mpdccptun_setfec,
+	.tp_setqos = (void*)mpdccptun_setqos,
 	.ipv6 = 1,
 };
 
+static const struct ldt_mc_ops	mpdccptun_mc_ops = {
+	.peerdown = mpdccptun_mc_peerdown,
+	.detach = mpdccptun_mc_detach,
+};
+
 
 #define MPDCCPTUN_MAGIC	(0xcaee6c49)
 #define ISMPDCCPTUN(tdat) ((tdat) && (tdat)->MAGIC == MPDCCPTUN_MAGIC)
@@ -216,6 +301,21 @@ struct ldt_tunops	mpdccptun_ops6 = {
 
 typedef struct { char s[IFNAMSIZ+1]; } subflow_str;
 
+/* receive batches - the data ready callback drains up to
+ * net.ldt.rcv_budget datagrams, sockets with data left are handed
+ * over to the receive work
+ */
+#define LDT_RCV_DEFER_MAX	32
+#define LDT_RCV_HIST			8		/* batch sizes 1, 2-3, 4-7, ..., 128+ */
+struct mpdccp_rcvstats {
+	atomic64_t					batches;
+	atomic64_t					pkts;
+	atomic64_t					defer;
+	atomic64_t					defer_full;		/* no slot - drained unbudgeted */
+	atomic64_t					hist[LDT_RCV_HIST];
+	u32							maxbatch;
+};
+
 struct mpdccptun {
 	u32							MAGIC;
 	struct ldt_tun		*tun;
@@ -233,17 +333,35 @@ struct mpdccptun {
 									isconnected:1,
 									wasconnected:1,
 									has_delayed_work:1,
-									has_subflow_report:1;
+									has_subflow_report:1,
+									has_peer_report:1,
+									has_switch_report:1,
+									multiclient:1,
+									mbb:1;				/* make before break rebind */
 	u16							tx_qlen;
 	u16							qpolicy;
+	struct ldt_sockopt		sockopt;
+	struct ldt_rxsteer		rxsteer;
+	struct ldt_aead			aead;
+	int							overhead;			/* aead and fec bytes added to each packet */
+	struct ldt_pace			pace;
+	struct ldt_fec				fec;
+	struct ldt_qos				qos;
 	unsigned long				last_unconnect;
 	subflow_str					*subflow;
 	int							num_subflow;
 	int							bufsz_subflow;
 	subflow_str					subflow_report;
+	struct ldt_latency		lat;
+	unsigned long				lat_reset;		/* jiffies */
+	s64							xmit_qtime;		/* nsec - xmit work queued */
 	tp_tunaddr_t				addr;
 	struct socket				*sock;
 	struct socket				*active;
+	struct socket				*oldsock;			/* draining after mbb rebind */
+	unsigned long				drain;				/* jiffies */
+	u32							switch_lat;			/* usec - last mbb switchover */
+	struct delayed_work		work_drain;
 	struct work_struct		work_conn;
 	struct work_struct		work_listen;
 	struct work_struct		work_accept;
@@ -251,16 +369,61 @@ struct mpdccptun {
 	struct delayed_work		work_xmit_delayed;
 	struct tp_queue			xmit_queue;
 	struct timer_list			conn_timer;
+	tp_addr_t					peercand[LDT_PEERLIST_MAX];
+	tp_addr_t					peerlocal[LDT_PEERLIST_MAX];	/* AF_UNSPEC - tunnel address */
+	u32							peerlat[LDT_PEERLIST_MAX];		/* connect latency (usec) */
+	u16							peerfail[LDT_PEERLIST_MAX];	/* consecutive failures */
+	int							num_peercand;
+	int							cur_peercand;
+	u32							peerflags;
+	unsigned long				stagger;								/* jiffies */
+	struct mpdccp_race		*race;
+	struct mpdccp_race		*race_gone;		/* waited for by the free work */
+	unsigned long				backoff_min, backoff_max, backoff;	/* jiffies */
+	struct delayed_work		work_reconn;
+	struct delayed_work		work_fec;			/* closes partial fec groups */
+	struct work_struct		work_free;			/* teardown after remove */
+	struct delayed_work		work_rcv;			/* drains deferred sockets */
+	struct sock					*rcv_defer[LDT_RCV_DEFER_MAX];	/* held */
+	int							num_rcv_defer;
+	struct mpdccp_rcvstats	rcvstats;
+	spinlock_t					rcvlock;				/* bh - also taken in process context */
+	struct ldt_mc				*mc;					/* multi client server */
+	struct ldt_mcpeer			*mcpeer_report;
 	struct tp_lock				lock;
 	struct tp_lock				lock2;
 };
 
+/* connection racing - all peer candidates are connected in parallel
+ * (started with a small stagger), the first connection established
+ * is kept, the others are aborted
+ */
+#define LDT_RACE_TMO		(5*HZ)
+struct mpdccp_racer {
+	struct mpdccp_race	*race;
+	struct delayed_work	work;
+	struct socket			*sock;		/* while connecting */
+	int						idx;
+};
+struct mpdccp_race {
+	struct mpdccptun		*tdat;
+	struct mutex			mtx;
+	atomic_t					refcnt;
+	u32						dead;
+	int						won;
+	int						num, left;
+	struct mpdccp_racer	racer[LDT_PEERLIST_MAX];
+};
+
 
 
 static int mpdccptun_xmit_skb (struct mpdccptun*, struct sk_buff*);
-static int mpdccptun_dorcv_all (struct mpdccptun*, struct sock*);
-static int mpdccptun_dorcv (struct mpdccptun*, struct sock*);
-static int mpdccptun_dorcv2 (struct mpdccptun*, struct sock*);
+static int mpdccptun_dorcv_all (struct mpdccptun*, struct ldt_mcpeer*, struct sock*);
+static int mpdccptun_dorcv_batch (struct mpdccptun*, struct ldt_mcpeer*, struct sock*);
+static int mpdccptun_dorcv2 (struct mpdccptun*, struct ldt_mcpeer*, struct sock*);
+static int mpdccptun_rcv_defer (struct mpdccptun*, struct sock*);
+static void mpdccptun_rcv_flush (struct mpdccptun*);
+static void mpdccptun_rcv_account (struct mpdccptun*, int);
 static int rcv_prepare_skb (struct sk_buff**, struct sk_buff*);
 static int dorcv_datagram (struct sk_buff**, struct sock*, int);
 static int mpdccptun_needrcvcpy (struct sk_buff*);
@@ -274,6 +437,9 @@ static void tp_cli_data_ready (struct sock *);
 static void tp_srv_data_ready (struct sock *);
 static void tp_listen_ready (struct sock *);
 #endif
+static void tp_srv_state_change (struct sock *);
+static void tp_cli_state_change (struct sock *);
+static void tp_cli_watch (struct sock *);
 static void tp_set_tdat (struct socket*, struct mpdccptun*);
 static void tp_unset_tdat (struct socket*);
 #if IS_ENABLED(CONFIG_IP_MPDCCP)
@@ -304,23 +470,43 @@ static int tp_subflow_global_dereg (void);
 	_myclose (_sock); \
 } while (0)
 
-static int mpdccptun_getmtu (void *t)
+/* the device mtu is left as configured, the inner packets have to
+ * leave room for the overhead - but not below the ipv6 minimum
+ */
+static int mpdccptun_getmtu (tdat)
+	struct mpdccptun	*tdat;
 {
-	return 0;
+	int	mtu;
+
+	if (!tdat || !tdat->ndev) return 0;
+	mtu = (int)READ_ONCE (tdat->ndev->mtu) - READ_ONCE (tdat->overhead);
+	return mtu < IPV6_MIN_MTU ? IPV6_MIN_MTU : mtu;
 }
+/* the device headroom is taken at creation, hence the aead and fec
+ * headers are reserved whether they are used or not
+ */
+#define MPDCCPTUN_ENCAPHEAD	(LDT_AEAD_HDRLEN + LDT_FEC_HDRLEN)
 static int mpdccptun_needheadroom (tdat)
 	struct mpdccptun	*tdat;
 {
-	if (!tdat) return TP_MINHEADROOM > TP_MIN6HEADROOM ? TP_MINHEADROOM : TP_MIN6HEADROOM;
-	if (tdat->ipv6) return TP_MIN6HEADROOM;
-	return TP_MINHEADROOM;
+	if (!tdat) return (TP_MINHEADROOM > TP_MIN6HEADROOM ? TP_MINHEADROOM
+								: TP_MIN6HEADROOM) + MPDCCPTUN_ENCAPHEAD;
+	if (tdat->ipv6) return TP_MIN6HEADROOM + MPDCCPTUN_ENCAPHEAD;
+	return TP_MINHEADROOM + MPDCCPTUN_ENCAPHEAD;
 }
 
+/* removed tunnels are freed by a work, because remove is called under
+ * the device lock and cannot wait for running handlers
+ */
+static struct workqueue_struct	*mpdccp_free_wq = NULL;
+
 int
 ldt_mpdccp_register (void)
 {
 	int	ret;
 
+	mpdccp_free_wq = alloc_workqueue ("ldt_mpdccp_free", 0, 0);
+	if (!mpdccp_free_wq) return -ENOMEM;
 #if IS_ENABLED(CONFIG_IP_MPDCCP)
 	ret = ldt_tun_register ("mpdccp", &mpdccptun_ops);
 	if (ret < 0) return ret;
@@ -356,6 +542,9 @@ ldt_mpdccp_unregister (void)
 	ldt_tun_unregister ("dccp");
 	ldt_tun_unregister ("dccp4");
 	ldt_tun_unregister ("dccp6");
+	/* waits for tunnels still being freed */
+	if (mpdccp_free_wq) destroy_workqueue (mpdccp_free_wq);
+	mpdccp_free_wq = NULL;
 }
 
 static
@@ -400,7 +589,21 @@ mpdccptun_new (tun, type)
 #else
 			.qpolicy = DCCPQ_POLICY_SIMPLE,
 #endif
+			.backoff_min = msecs_to_jiffies (LDT_PEERLIST_BACKOFF_MIN),
+			.backoff_max = msecs_to_jiffies (LDT_PEERLIST_BACKOFF_MAX),
+			.stagger = msecs_to_jiffies (LDT_PEERLIST_STAGGER),
+			.drain = msecs_to_jiffies (LDT_REBIND_DRAIN_DEF),
+			.lat_reset = jiffies,
+			.sockopt = { .cscov = -1, .service = -1 },
 	};
+	if (ldt_rxsteer_init (&tdat->rxsteer, GFP_KERNEL) < 0) {
+		kfree (tdat);
+		return -ENOMEM;
+	}
+	ldt_aead_init (&tdat->aead);
+	ldt_pace_init (&tdat->pace, mpdccptun_pace_kick, tdat);
+	ldt_fec_init (&tdat->fec);
+	ldt_qos_init (&tdat->qos);
 	ldt_tunaddr_init (&tdat->addr, ipv6);
 	tun->tundata = tdat;
 	tun->tunops = ipv6 ? &mpdccptun_ops6 : &mpdccptun_ops;
@@ -409,9 +612,16 @@ mpdccptun_new (tun, type)
 	INIT_WORK (&tdat->work_conn, connect_handler);
 	INIT_WORK (&tdat->work_xmit, xmit_handler);
 	INIT_DELAYED_WORK (&tdat->work_xmit_delayed, xmit_handler_delayed);
+	INIT_DELAYED_WORK (&tdat->work_reconn, reconn_handler);
+	INIT_DELAYED_WORK (&tdat->work_drain, drain_handler);
+	INIT_DELAYED_WORK (&tdat->work_fec, fec_handler);
+	INIT_WORK (&tdat->work_free, free_handler);
+	INIT_DELAYED_WORK (&tdat->work_rcv, rcv_handler);
 	tpq_init (&tdat->xmit_queue, TP_QUEUE_DROP_NEWEST, 1000);
+	tpq_set_name (&tdat->xmit_queue, tdat->name);
 	tp_lock_init (&tdat->lock);
 	tp_lock_init (&tdat->lock2);
+	spin_lock_init (&tdat->rcvlock);
 	setup_timer(&tdat->conn_timer, conn_timer_handler, (unsigned long)tdat);
 	tp_debug3 ("tdat=%p, tun=%p\n", tdat, tdat->tun);
 	return 0;
@@ -475,6 +685,10 @@ mpdccptun_close_listen (tdat)
 	tdat->listening = 0;
 	tdat->isconnected = 0;
 	DOUNLOCK (tdat);
+	if (tdat->mc) {
+		tp_debug3 ("close client sockets");
+		ldt_mc_flush (tdat->mc);
+	}
 	if (_pending) {
 		tp_debug3 ("close pending socket");
 		_myclose (_pending);
@@ -496,9 +710,11 @@ mpdccptun_closesk (tdat)
 {
 	struct socket	*_active = NULL;
 	struct socket	*_sock = NULL;
+	struct socket	*_old;
 
 	if (!tdat) return;
 	tp_debug3 ("release old socket");
+	_old = xchg (&tdat->oldsock, NULL);
 	DOLOCK (tdat);
 	if (tdat->active) {
 		tp_unset_tdat (tdat->active);
@@ -515,6 +731,10 @@ mpdccptun_closesk (tdat)
 	tdat->listening = 0;
 	tdat->isconnected = 0;
 	DOUNLOCK (tdat);
+	if (tdat->mc) {
+		tp_debug3 ("close client sockets");
+		ldt_mc_flush (tdat->mc);
+	}
 	if (_active) {
 		tp_debug3 ("close active socket");
 		_myclose (_active);
@@ -523,6 +743,11 @@ mpdccptun_closesk (tdat)
 		tp_debug3 ("close listen/client socket");
 		_myclose (_sock);
 	}
+	if (_old) {
+		tp_debug3 ("close draining socket");
+		tp_unset_tdat (_old);
+		_myclose (_old);
+	}
 }
 
 static
@@ -546,9 +771,8 @@ int
 mpdccptun_dobind (tdat)
 	struct mpdccptun	*tdat;
 {
-	int			ret;
-	int			val;
-	mm_segment_t old_fs;
+	struct socket	*sock;
+	int				ret;
 
 	tp_debug3 ("enter");
 	if (!tdat) return -EINVAL;
@@ -561,15 +785,40 @@ mpdccptun_dobind (tdat)
 		if (!tdat->rebind) return 0;
 		mpdccptun_closesk (tdat);
 	}
-		
+	ret = mpdccptun_mksock (tdat, &tdat->addr.laddr, &sock);
+	if (ret < 0) return ret;
+	DOLOCK(tdat);
+	tdat->sock = sock;
+	DOUNLOCK(tdat);
+	tp_set_tdat (tdat->sock, tdat);
+	tdat->bound = 1;
+
+	tp_debug3 ("done");
+
+	return 0;
+}
+
+/* creates a socket for the tunnel bound to laddr */
+static
+int
+mpdccptun_mksock (tdat, laddr, osock)
+	struct mpdccptun	*tdat;
+	tp_addr_t			*laddr;
+	struct socket		**osock;
+{
+	struct socket	*sock;
+	int				ret;
+	int				val;
+	mm_segment_t	old_fs;
+
 	tp_debug3 ("create socket");
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4,2,0)
-	ret = sock_create_kern (TP_ADDR_FAM(tdat->addr.laddr), SOCK_DCCP,
-									IPPROTO_DCCP, &tdat->sock);
+	ret = sock_create_kern (TP_ADDRP_FAM(laddr), SOCK_DCCP,
+									IPPROTO_DCCP, &sock);
 	// Todo: setting network namespace manually
 #else
-	ret = sock_create_kern (NDEV2NET(tdat->ndev), TP_ADDR_FAM(tdat->addr.laddr),
-									SOCK_DCCP, IPPROTO_DCCP, &tdat->sock);
+	ret = sock_create_kern (NDEV2NET(tdat->ndev), TP_ADDRP_FAM(laddr),
+									SOCK_DCCP, IPPROTO_DCCP, &sock);
 #endif
 	if (ret < 0) {
 		tp_err ("error creating socket: %d", ret);
@@ -578,9 +827,9 @@ mpdccptun_dobind (tdat)
 	old_fs = get_fs();
 	set_fs(KERNEL_DS);
 
-	if (tp_addr_getport (&tdat->addr.laddr) > 0) {
+	if (tp_addr_getport (laddr) > 0) {
 		val = 1;
-		ret = tdat->sock->ops->setsockopt(tdat->sock, SOL_SOCKET, SO_REUSEADDR,
+		ret = sock->ops->setsockopt(sock, SOL_SOCKET, SO_REUSEADDR,
               	(char*)&val, sizeof(val));
 		if (ret < 0) {
 			tp_warn ("warn: error setting reuseaddr: %d", ret);
@@ -592,7 +841,7 @@ mpdccptun_dobind (tdat)
 		if(is_mpdccp_link(tdat)){
 			tp_debug2 ("switch to multipath");
 			val = 1;
-			ret = tdat->sock->ops->setsockopt(tdat->sock, SOL_DCCP, 
+			ret = sock->ops->setsockopt(sock, SOL_DCCP, 
 					DCCP_SOCKOPT_MULTIPATH, (char*)&val, sizeof(val));
 		} else {
 			tp_err ("error binding mpdccp socket, link is not mp-capable\n");
@@ -610,7 +859,7 @@ mpdccptun_dobind (tdat)
 #if defined DCCP_SOCKOPT_QPOLICY_TXQLEN
 	tpq_set_maxlen (&tdat->xmit_queue, tdat->tx_qlen);
 	val = tdat->tx_qlen;
-	ret = tdat->sock->ops->setsockopt(tdat->sock, SOL_DCCP, DCCP_SOCKOPT_QPOLICY_TXQLEN,
+	ret = sock->ops->setsockopt(sock, SOL_DCCP, DCCP_SOCKOPT_QPOLICY_TXQLEN,
               (char*)&val, sizeof(val));
 	if (ret < 0) {
 		tp_err ("error setting tx qlen: %d\n", ret);
@@ -618,30 +867,32 @@ mpdccptun_dobind (tdat)
 		goto dorelease;
 	}
 #endif
+	ret = mpdccptun_applysockopt (tdat, sock);
+	if (ret < 0) {
+		set_fs(old_fs);
+		goto dorelease;
+	}
 #if defined DCCP_SOCKOPT_QPOLICY_ID
 	val = tdat->qpolicy;
-	ret = tdat->sock->ops->setsockopt(tdat->sock, SOL_DCCP, DCCP_SOCKOPT_QPOLICY_ID,
+	ret = sock->ops->setsockopt(sock, SOL_DCCP, DCCP_SOCKOPT_QPOLICY_ID,
               (char*)&val, sizeof(val));
 	set_fs(old_fs);
 	if (ret < 0) {
 		tp_err ("error setting qpolicy: %d\n", ret);
 		goto dorelease;
 	}
+#else
+	set_fs(old_fs);
 #endif
 	tp_debug3 ("bind socket to address");
-	ret = kernel_bind (	tdat->sock, &tdat->addr.laddr.ad,
-								TP_ADDR_SIZE (tdat->addr.laddr));
+	ret = kernel_bind (sock, &laddr->ad, TP_ADDR_SIZE (*laddr));
 	if (ret < 0) {
 		tp_err ("error binding socket: %d\n", ret);
 dorelease:
-		MYCLOSE(tdat, sock);
+		_myclose (sock);
 		return ret;
 	}
-	tp_set_tdat (tdat->sock, tdat);
-	tdat->bound = 1;
-
-	tp_debug3 ("done");
-
+	*osock = sock;
 	return 0;
 }
 
@@ -674,6 +925,68 @@ mpdccptun_peer (tdat, addr)
 	return 0;
 }
 
+static
+int
+mpdccptun_peerlist (tdat, list, local, num, backoff_min, backoff_max, flags, stagger)
+	struct mpdccptun	*tdat;
+	tp_addr_t			*list, *local;
+	int					num, backoff_min, backoff_max;
+	u32					flags;
+	int					stagger;
+{
+	int	i;
+
+	if (!tdat) return -EINVAL;
+	if (num < 0 || num > LDT_PEERLIST_MAX || (num > 0 && !list)) return -EINVAL;
+	CHKSTOP(-EPERM);
+	if (local && !(flags & LDT_PEERLIST_F_RACE)) {
+		tp_debug ("local addresses per peer candidate need race mode");
+		return -EINVAL;
+	}
+	for (i=0; i<num; i++) {
+		if (TP_ADDRP_FAM(&list[i]) != TP_ADDR_FAM(tdat->addr.raddr)) {
+			tp_debug ("peer candidate %d - wrong address family, expecting %s",
+							i, tdat->ipv6 ? "ipv6" : "ipv4");
+			return -EINVAL;
+		}
+		if (local && TP_ADDRP_FAM(&local[i]) != AF_UNSPEC &&
+				TP_ADDRP_FAM(&local[i]) != TP_ADDR_FAM(tdat->addr.raddr)) {
+			tp_debug ("local address %d - wrong address family", i);
+			return -EINVAL;
+		}
+	}
+	cancel_delayed_work (&tdat->work_reconn);
+	cancel_delayed_work (&tdat->work_drain);
+	mpdccptun_race_stop (tdat);
+	DOLOCK2(tdat);
+	if (backoff_min > 0) tdat->backoff_min = msecs_to_jiffies (backoff_min);
+	if (backoff_max > 0) tdat->backoff_max = msecs_to_jiffies (backoff_max);
+	if (tdat->backoff_max < tdat->backoff_min)
+		tdat->backoff_max = tdat->backoff_min;
+	tdat->stagger = msecs_to_jiffies (stagger >= 0 ? stagger : LDT_PEERLIST_STAGGER);
+	tdat->peerflags = flags;
+	for (i=0; i<num; i++) {
+		tp_addr_cp (&tdat->peercand[i], &list[i]);
+		if (local) {
+			tp_addr_cp (&tdat->peerlocal[i], &local[i]);
+		} else {
+			TP_ADDR_FAM(tdat->peerlocal[i]) = AF_UNSPEC;
+		}
+		tdat->peerlat[i] = 0;
+		tdat->peerfail[i] = 0;
+	}
+	tdat->num_peercand = num;
+	tdat->cur_peercand = 0;
+	tdat->backoff = tdat->backoff_min;
+	DOUNLOCK2(tdat);
+	tp_debug ("%d peer candidates set%s\n", num,
+					(flags & LDT_PEERLIST_F_RACE) ? " (race mode)" : "");
+	if (num == 0) return 0;
+	/* (re-)connect to first candidate */
+	mpdccptun_schedule_reconnect (tdat, 0);
+	return 0;
+}
+
 
 static
 void
@@ -686,15 +999,533 @@ connect_handler(work)
 	if (!work) return;
 	tdat = container_of (work, struct mpdccptun, work_conn);
 	tp_debug3 ("tdat=%p, tun=%p\n", tdat, tdat->tun);
+	if (tdat->mbb && tdat->rebind && tdat->isconnected && !tdat->isserver) {
+		ret = mpdccptun_mbb_rebind (tdat);
+		if (ret == 0) return;
+		/* the old connection is still up, fall back to break before make */
+		tp_note ("%s: make before break rebind failed (%d) - reconnect\n",
+					tdat->name, ret);
+	}
 	ret = mpdccptun_elab_connect (tdat);
 	if (ret < 0) {
 		tp_err ("error connecting to peer: %d\n", ret);
 		ldt_event_crsend (LDT_EVTYPE_CONN_ESTAB_FAIL, tdat->tun, (-1)*ret);
+		mpdccptun_schedule_reconnect (tdat, 1);
 		return;
 	}
+	mpdccptun_connected (tdat);
+	return;
+}
+
+/* make before break: the new socket is connected while the old
+ * connection keeps carrying traffic. Then the transmit path is switched
+ * (do_xmit_skb picks up the new socket with the next packet) and the old
+ * socket is kept open for the drain time to receive what is still in
+ * flight on the old path.
+ */
+static
+int
+mpdccptun_mbb_rebind (tdat)
+	struct mpdccptun	*tdat;
+{
+	struct socket	*sock, *old;
+	ktime_t			start;
+	int				ret;
+
+	if (!tdat) return -EINVAL;
+	CHKSTOP(-EPERM);
+	if (!tdat->haspeer) return -ENOTCONN;
+	start = ktime_get ();
+	ret = mpdccptun_mksock (tdat, &tdat->addr.laddr, &sock);
+	if (ret < 0) return ret;
+	tp_cli_watch (sock->sk);
+	ret = kernel_connect (sock, &tdat->addr.raddr.ad, TP_ADDR_SIZE(tdat->addr.raddr), 0);
+	trace_ldt_connect (tdat->name, &tdat->addr.raddr, ret);
+	if (ret < 0) {
+		_myclose (sock);
+		return ret;
+	}
+	if (ISSTOP(tdat)) {
+		_myclose (sock);
+		return -EPERM;
+	}
+	tp_set_tdat (sock, tdat);
+	DOLOCK(tdat);
+	old = tdat->sock;
+	WRITE_ONCE (tdat->sock, sock);
+	tdat->rebind = 0;
+	tdat->bound = 1;
+	tdat->isconnected = 1;
+	DOUNLOCK(tdat);
+	tdat->switch_lat = (u32)ktime_us_delta (ktime_get (), start);
+	tp_debug ("%s: switched to new connection (%u usec)\n", tdat->name,
+					tdat->switch_lat);
+	mpdccptun_drain_old (tdat, old);
+	if (tdat->ismpdccp) {
+		mod_timer(&tdat->conn_timer, jiffies + 5*HZ);	/* 5 secs */
+	}
+	tdat->has_switch_report = 1;
+	mpdccptun_connected (tdat);
+	tdat->has_switch_report = 0;
+	return 0;
+}
+
+static
+void
+mpdccptun_drain_old (tdat, old)
+	struct mpdccptun	*tdat;
+	struct socket		*old;
+{
+	struct socket	*prev;
+
+	if (!tdat || !old) return;
+	/* a previous socket still draining is dropped now */
+	prev = xchg (&tdat->oldsock, old);
+	if (prev) mpdccptun_close_old (tdat, prev);
+	mod_delayed_work (system_wq, &tdat->work_drain, tdat->drain);
+}
+
+/* must not be called under device lock - the xmit work is flushed,
+ * because do_xmit_skb might still send on the socket it read before
+ * the switch. Later runs see the new socket.
+ */
+static
+void
+mpdccptun_close_old (tdat, old)
+	struct mpdccptun	*tdat;
+	struct socket		*old;
+{
+	if (!tdat || !old) return;
+	tp_unset_tdat (old);
+	flush_work (&tdat->work_xmit);
+	flush_work (&tdat->work_xmit_delayed.work);
+	_myclose (old);
+}
+
+static
+void
+drain_handler (work)
+	struct work_struct	*work;
+{
+	struct delayed_work	*dwork;
+	struct mpdccptun		*tdat;
+	struct socket			*old;
+
+	if (!work) return;
+	dwork = container_of(work, struct delayed_work, work);
+	tdat = container_of (dwork, struct mpdccptun, work_drain);
+	CHKSTOPVOID;
+	old = xchg (&tdat->oldsock, NULL);
+	if (!old) return;
+	tp_debug2 ("%s: close drained socket\n", tdat->name);
+	mpdccptun_close_old (tdat, old);
+}
+
+static
+void
+reconn_handler (work)
+	struct work_struct	*work;
+{
+	struct delayed_work	*dwork;
+	struct mpdccptun		*tdat;
+	tp_addr_t				addr;
+	int						ret, idx, race;
+
+	if (!work) return;
+	dwork = container_of(work, struct delayed_work, work);
+	tdat = container_of (dwork, struct mpdccptun, work_reconn);
+	CHKSTOPVOID;
+	if (tdat->isserver || tdat->num_peercand == 0) return;
+	/* drop old connection - if any */
+	mpdccptun_closesk (tdat);
+	DOLOCK2(tdat);
+	idx = tdat->cur_peercand;
+	tp_addr_cp (&addr, &tdat->peercand[idx]);
+	race = (tdat->peerflags & LDT_PEERLIST_F_RACE) ? 1 : 0;
+	DOUNLOCK2(tdat);
+	if (race) {
+		ret = mpdccptun_race_start (tdat);
+		if (ret < 0) {
+			tp_note ("%s: cannot start connection race: %d\n", tdat->name, ret);
+			ldt_event_crsend (LDT_EVTYPE_CONN_ESTAB_FAIL, tdat->tun, (-1)*ret);
+			mpdccptun_schedule_reconnect (tdat, 1);
+		}
+		return;
+	}
+	tp_debug ("%s: try peer candidate %d (%pISpc)\n", tdat->name, idx, &addr);
+	ret = ldt_tunaddr_setpeer (&tdat->addr, &addr, 0);
+	if (ret == 0) {
+		tdat->haspeer = 1;
+		ret = mpdccptun_elab_connect (tdat);
+	}
+	if (ret < 0) {
+		tp_note ("%s: connecting to peer candidate %d failed: %d\n",
+					tdat->name, idx, ret);
+		ldt_event_crsend (LDT_EVTYPE_CONN_ESTAB_FAIL, tdat->tun, (-1)*ret);
+		mpdccptun_schedule_reconnect (tdat, 1);
+		return;
+	}
+	mpdccptun_connected (tdat);
+}
+
+/* connection racing:
+ * all peer candidates are connected in parallel, the n-th best
+ * candidate is started n*stagger after the first one. The first
+ * connection established wins, the others are aborted. Candidates
+ * are ranked by failure count and measured connect latency.
+ * The race object is reference counted (one reference per racer plus
+ * one for the tunnel), hence it survives the tunnel being removed while
+ * racers are blocked in connect.
+ */
+static
+int
+mpdccptun_race_start (tdat)
+	struct mpdccptun	*tdat;
+{
+	struct mpdccp_race	*race;
+	int						order[LDT_PEERLIST_MAX];
+	unsigned long			stagger;
+	int						i, j, num;
+
+	if (!tdat) return -EINVAL;
+	CHKSTOP(-EPERM);
+	mpdccptun_race_stop (tdat);
+	race = kzalloc (sizeof (struct mpdccp_race), GFP_KERNEL);
+	if (!race) return -ENOMEM;
+	race->tdat = tdat;
+	mutex_init (&race->mtx);
+	DOLOCK2(tdat);
+	num = tdat->num_peercand;
+	for (i=0; i<num; i++) {
+		for (j=i; j>0 && race_better (tdat, i, order[j-1]); j--)
+			order[j] = order[j-1];
+		order[j] = i;
+	}
+	stagger = tdat->stagger;
+	DOUNLOCK2(tdat);
+	if (num == 0) {
+		kfree (race);
+		return 0;
+	}
+	race->num = race->left = num;
+	atomic_set (&race->refcnt, num + 1);
+	for (i=0; i<num; i++) {
+		race->racer[i].race = race;
+		race->racer[i].idx = order[i];
+		INIT_DELAYED_WORK (&race->racer[i].work, race_handler);
+	}
+	DOLOCK2(tdat);
+	tdat->race = race;
+	DOUNLOCK2(tdat);
+	tp_debug ("%s: race %d peer candidates (stagger %u msec)\n", tdat->name,
+					num, jiffies_to_msecs (stagger));
+	for (i=0; i<num; i++) {
+		queue_delayed_work (system_wq, &race->racer[i].work, i * stagger);
+	}
+	return 0;
+}
+
+/* aborts a running race - does not sleep, racers blocked in connect
+ * notice it when they return */
+static
+void
+mpdccptun_race_stop (tdat)
+	struct mpdccptun	*tdat;
+{
+	race_put (mpdccptun_race_detach (tdat));
+}
+
+/* stops the race - the reference of the tunnel is returned, racers
+ * already running might still use the tunnel
+ */
+static
+struct mpdccp_race*
+mpdccptun_race_detach (tdat)
+	struct mpdccptun	*tdat;
+{
+	struct mpdccp_race	*race;
+	int						i;
+
+	if (!tdat) return NULL;
+	DOLOCK2(tdat);
+	race = tdat->race;
+	tdat->race = NULL;
+	DOUNLOCK2(tdat);
+	if (!race) return NULL;
+	smp_store_release (&(race->dead), 1);
+	for (i=0; i<race->num; i++) {
+		if (cancel_delayed_work (&race->racer[i].work))
+			race_put (race);
+	}
+	return race;
+}
+
+/* waits for running racers and drops the reference - may sleep */
+static
+void
+mpdccptun_race_wait (race)
+	struct mpdccp_race	*race;
+{
+	int	i;
+
+	if (!race) return;
+	for (i=0; i<race->num; i++) {
+		/* pending ones were cancelled (and put) by detach */
+		cancel_delayed_work_sync (&race->racer[i].work);
+	}
+	race_put (race);
+}
+
+static
+void
+race_put (race)
+	struct mpdccp_race	*race;
+{
+	if (!race) return;
+	if (!atomic_dec_and_test (&race->refcnt)) return;
+	mutex_destroy (&race->mtx);
+	kfree (race);
+}
+
+/* returns true if candidate a should be tried before candidate b */
+static
+int
+race_better (tdat, a, b)
+	struct mpdccptun	*tdat;
+	int					a, b;
+{
+	if (tdat->peerfail[a] != tdat->peerfail[b])
+		return tdat->peerfail[a] < tdat->peerfail[b];
+	if (tdat->peerlat[a] && tdat->peerlat[b])
+		return tdat->peerlat[a] < tdat->peerlat[b];
+	return tdat->peerlat[a] && !tdat->peerlat[b];
+}
+
+static
+void
+race_handler (work)
+	struct work_struct	*work;
+{
+	struct delayed_work	*dwork;
+	struct mpdccp_racer	*racer;
+	struct mpdccp_race	*race;
+	struct mpdccptun		*tdat;
+	struct socket			*sock = NULL;
+	tp_addr_t				laddr, raddr;
+	ktime_t					start;
+	int						ret, i, idx, won = 0, last, dead;
+
+	if (!work) return;
+	dwork = container_of(work, struct delayed_work, work);
+	racer = container_of (dwork, struct mpdccp_racer, work);
+	race = racer->race;
+	tdat = race->tdat;
+	idx = racer->idx;
+	if (smp_load_acquire (&(race->dead)) || READ_ONCE (race->won)) {
+		ret = -ECANCELED;
+		goto out;
+	}
+	DOLOCK2(tdat);
+	tp_addr_cp (&raddr, &tdat->peercand[idx]);
+	if (TP_ADDR_FAM(tdat->peerlocal[idx]) != AF_UNSPEC) {
+		tp_addr_cp (&laddr, &tdat->peerlocal[idx]);
+	} else {
+		tp_addr_cp (&laddr, &tdat->addr.laddr);
+	}
+	DOUNLOCK2(tdat);
+	tp_debug2 ("%s: race peer candidate %d (%pISpc)\n", tdat->name, idx, &raddr);
+	ret = mpdccptun_mksock (tdat, &laddr, &sock);
+	if (ret < 0) {
+		sock = NULL;
+		goto out;
+	}
+	sock->sk->sk_sndtimeo = LDT_RACE_TMO;
+	mutex_lock (&race->mtx);
+	if (race->won || smp_load_acquire (&(race->dead))) {
+		mutex_unlock (&race->mtx);
+		ret = -ECANCELED;
+		goto out;
+	}
+	/* publish socket, so the winner can abort us */
+	racer->sock = sock;
+	mutex_unlock (&race->mtx);
+	start = ktime_get ();
+	ret = kernel_connect (sock, &raddr.ad, TP_ADDR_SIZE(raddr), 0);
+	if (ret == -EINPROGRESS) ret = -ETIMEDOUT;
+	trace_ldt_connect (tdat->name, &raddr, ret);
+	mutex_lock (&race->mtx);
+	racer->sock = NULL;
+	if (ret == 0 && !race->won && !smp_load_acquire (&(race->dead))) {
+		race->won = won = 1;
+		for (i=0; i<race->num; i++) {
+			if (race->racer[i].sock)
+				kernel_sock_shutdown (race->racer[i].sock, SHUT_RDWR);
+		}
+	} else if (ret == 0) {
+		ret = -ECANCELED;
+	}
+	mutex_unlock (&race->mtx);
+	if (won) {
+		for (i=0; i<race->num; i++) {
+			if (&race->racer[i] != racer &&
+					cancel_delayed_work (&race->racer[i].work))
+				race_put (race);
+		}
+		race_won (race, idx, sock, (u32)ktime_us_delta (ktime_get (), start));
+		race_put (race);
+		return;
+	}
+
+out:
+	if (sock) _myclose (sock);
+	mutex_lock (&race->mtx);
+	last = (--race->left == 0) && !race->won;
+	dead = smp_load_acquire (&(race->dead));
+	won = race->won;
+	mutex_unlock (&race->mtx);
+	if (!dead && !won && ret != -ECANCELED) {
+		tp_note ("%s: connecting to peer candidate %d failed: %d\n",
+					tdat->name, idx, ret);
+		DOLOCK2(tdat);
+		if (tdat->peerfail[idx] < U16_MAX) tdat->peerfail[idx]++;
+		DOUNLOCK2(tdat);
+	}
+	if (last && !dead) {
+		ldt_event_crsend (LDT_EVTYPE_CONN_ESTAB_FAIL, tdat->tun, (-1)*ret);
+		mpdccptun_schedule_reconnect (tdat, 1);
+	}
+	race_put (race);
+}
+
+/* installs the winning connection as tunnel socket */
+static
+void
+race_won (race, idx, sock, lat)
+	struct mpdccp_race	*race;
+	int						idx;
+	struct socket			*sock;
+	u32						lat;
+{
+	struct mpdccptun	*tdat = race->tdat;
+	tp_addr_t			raddr;
+	int					ret, busy = 0;
+
+	DOLOCK2(tdat);
+	/* exponentially weighted moving average */
+	tdat->peerlat[idx] = tdat->peerlat[idx] ?
+								(tdat->peerlat[idx] * 7 + lat) / 8 : lat;
+	if (!tdat->peerlat[idx]) tdat->peerlat[idx] = 1;
+	tdat->peerfail[idx] = 0;
+	tdat->cur_peercand = idx;
+	tp_addr_cp (&raddr, &tdat->peercand[idx]);
+	DOUNLOCK2(tdat);
+	tp_debug ("%s: peer candidate %d won race (%u usec)\n", tdat->name, idx, lat);
+	ret = ldt_tunaddr_setpeer (&tdat->addr, &raddr, 0);
+	if (ret < 0) {
+		tp_err ("%s: cannot set peer address: %d\n", tdat->name, ret);
+		_myclose (sock);
+		ldt_event_crsend (LDT_EVTYPE_CONN_ESTAB_FAIL, tdat->tun, (-1)*ret);
+		mpdccptun_schedule_reconnect (tdat, 1);
+		return;
+	}
+	tdat->haspeer = 1;
+	if (timer_pending (&tdat->conn_timer)) {
+		del_timer (&tdat->conn_timer);
+		setup_timer(&tdat->conn_timer, conn_timer_handler, (unsigned long)tdat);
+	}
+	sock->sk->sk_sndtimeo = MAX_SCHEDULE_TIMEOUT;
+	tp_cli_watch (sock->sk);
+	DOLOCK(tdat);
+	if (tdat->sock) {
+		busy = 1;
+	} else {
+		tdat->sock = sock;
+		tdat->bound = 1;
+		tdat->isconnected = 1;
+		tdat->wasconnected = 1;
+	}
+	DOUNLOCK(tdat);
+	if (busy) {
+		tp_note ("%s: tunnel socket in use - drop race winner\n", tdat->name);
+		_myclose (sock);
+		return;
+	}
+	tp_set_tdat (sock, tdat);
+	if (tdat->ismpdccp) {
+		mod_timer(&tdat->conn_timer, jiffies + 5*HZ);	/* 5 secs */
+	}
+	mpdccptun_connected (tdat);
+}
+
+/* schedules the next connection attempt - on failure we rotate to the
+ * next candidate and double the backoff (up to backoff_max)
+ */
+static
+void
+mpdccptun_schedule_reconnect (tdat, failed)
+	struct mpdccptun	*tdat;
+	int					failed;
+{
+	unsigned long	delay = 0;
+
+	if (!tdat || ISSTOP(tdat)) return;
+	if (tdat->isserver || tdat->num_peercand == 0) return;
+	if (failed) {
+		DOLOCK2(tdat);
+		tdat->cur_peercand = (tdat->cur_peercand + 1) % tdat->num_peercand;
+		delay = tdat->backoff;
+		tdat->backoff *= 2;
+		if (tdat->backoff > tdat->backoff_max) tdat->backoff = tdat->backoff_max;
+		DOUNLOCK2(tdat);
+	}
+	tp_debug2 ("%s: reconnect in %u msec\n", tdat->name, jiffies_to_msecs (delay));
+	queue_delayed_work (system_wq, &tdat->work_reconn, delay);
+}
+
+/* the connection of a client died - the candidate counts as failed
+ * may be called in softirq context
+ */
+static
+void
+mpdccptun_conndead (tdat)
+	struct mpdccptun	*tdat;
+{
+	int	wasup;
+
+	if (!tdat || ISSTOP(tdat) || tdat->isserver) return;
+	/* send errors and the state change may both report it */
+	DOLOCK2(tdat);
+	wasup = tdat->isconnected;
+	if (wasup) {
+		tdat->last_unconnect = jiffies;
+		tdat->isconnected = 0;
+	}
+	DOUNLOCK2(tdat);
+	if (!wasup) return;
+	tp_note ("%s: connection lost\n", tdat->name);
+	/* the reconnect handler closes the old socket */
+	mpdccptun_schedule_reconnect (tdat, 1);
+}
+
+static
+void
+mpdccptun_connected (tdat)
+	struct mpdccptun	*tdat;
+{
+	if (!tdat) return;
+	DOLOCK2(tdat);
+	tdat->backoff = tdat->backoff_min;
+	DOUNLOCK2(tdat);
 	tp_debug2 ("new connection established\n");
+	tdat->has_peer_report = 1;
 	ldt_event_crsend (LDT_EVTYPE_CONN_ESTAB, tdat->tun, 0);
-	return;
+	tdat->has_peer_report = 0;
+	/* flush what has been buffered while we were not connected */
+	if (tdat->has_delayed_work) {
+		mod_delayed_work (system_wq, &tdat->work_xmit_delayed, 0);
+	} else {
+		mpdccptun_kick_xmit (tdat);
+	}
 }
 
 static
@@ -716,8 +1547,9 @@ mpdccptun_elab_connect (tdat)
 	}
 	CHKSTOP(-EPERM);
 	if (!tdat->haspeer) return -ENOTCONN;
-	tdat->sock->sk->sk_data_ready = tp_cli_data_ready;
+	tp_cli_watch (tdat->sock->sk);
 	ret = kernel_connect (tdat->sock, &tdat->addr.raddr.ad, TP_ADDR_SIZE(tdat->addr.raddr), 0);
+	trace_ldt_connect (tdat->name, &tdat->addr.raddr, ret);
 	if (ret < 0) {
 		tp_err ("error in connect: %d\n", ret);
 		return ret;
@@ -747,20 +1579,322 @@ conn_timer_handler (data)
 
 static
 int
-mpdccptun_serverstart (tdat)
+mpdccptun_serverstart (tdat, flags)
 	struct mpdccptun	*tdat;
+	int					flags;
 {
+	int	multi = (flags & LDT_SERVERSTART_F_MULTICLIENT) ? 1 : 0;
+
 	if (!tdat) return -EINVAL;
 	if (tdat->isconnected) {
 		tp_err ("we are already client, cannot become server");
 		return -ENOTCONN;
 	}
-	if (tdat->isserver) return 0;
+	if (tdat->isserver) {
+		if (tdat->multiclient != multi) {
+			tp_err ("server already started in %s client mode",
+						tdat->multiclient ? "multi" : "single");
+			return -EBUSY;
+		}
+		return 0;
+	}
+	if (multi && !tdat->mc) {
+		/* we are called under device lock - the hash tables are
+		 * allocated in listen_handler */
+		tdat->mc = ldt_mc_new (tdat, &mpdccptun_mc_ops, GFP_ATOMIC);
+		if (!tdat->mc) return -ENOMEM;
+	}
+	tdat->multiclient = multi;
 	tdat->isserver = 1;
 	queue_work (system_wq, &tdat->work_listen);
 	return 0;
 }
 
+static
+int
+mpdccptun_clientroute (tdat, raddr, inner, plen, flags)
+	struct mpdccptun	*tdat;
+	tp_addr_t			*raddr, *inner;
+	int					plen, flags;
+{
+	if (!tdat || !raddr) return -EINVAL;
+	CHKSTOP(-EPERM);
+	if (!tdat->mc) {
+		tp_note ("%s: client routes need a multi client server\n", tdat->name);
+		return -EOPNOTSUPP;
+	}
+	if (TP_ADDRP_ISIPV6(raddr) != tdat->ipv6) {
+		tp_debug ("client address - wrong address family, expecting %s",
+						tdat->ipv6 ? "ipv6" : "ipv4");
+		return -EINVAL;
+	}
+	return ldt_mc_setroute (tdat->mc, raddr, inner, plen,
+									flags & LDT_CLIENTROUTE_F_DEL);
+}
+
+/* called under device lock - must not sleep
+ * ccid, service code and checksum coverage are negotiated on connect,
+ * they are applied to the next socket created (see mpdccptun_mksock).
+ * buffer sizes are set on the running sockets, too.
+ */
+static
+int
+mpdccptun_setsockopt (tdat, opt)
+	struct mpdccptun		*tdat;
+	struct ldt_sockopt	*opt;
+{
+	struct ldt_sockopt	*so;
+
+	if (!tdat || !opt) return -EINVAL;
+	CHKSTOP(-EPERM);
+	so = &tdat->sockopt;
+	if (opt->txccid >= 0) so->txccid = opt->txccid;
+	if (opt->rxccid >= 0) so->rxccid = opt->rxccid;
+	if (opt->cscov >= 0) so->cscov = opt->cscov;
+	if (opt->service >= 0) so->service = opt->service;
+	if (opt->sndbuf >= 0 || opt->rcvbuf >= 0) {
+		if (opt->sndbuf >= 0) so->sndbuf = opt->sndbuf;
+		if (opt->rcvbuf >= 0) so->rcvbuf = opt->rcvbuf;
+		so->flags = opt->flags;
+		if (tdat->sock) mpdccptun_setbuf (tdat, tdat->sock);
+		if (tdat->active) mpdccptun_setbuf (tdat, tdat->active);
+	}
+	return 0;
+}
+
+/* sets the buffer sizes like SO_SNDBUF / SO_RCVBUF (or the FORCE
+ * variants) do, but without taking the socket lock, so that it can be
+ * called from atomic context. */
+static
+void
+mpdccptun_setbuf (tdat, sock)
+	struct mpdccptun	*tdat;
+	struct socket		*sock;
+{
+	struct sock	*sk = sock ? sock->sk : NULL;
+	int			val;
+	int			force = tdat->sockopt.flags & LDT_SOCKOPT_F_FORCEBUF;
+
+	if (!sk) return;
+	if (tdat->sockopt.sndbuf > 0) {
+		val = tdat->sockopt.sndbuf;
+		if (!force) val = min_t (u32, val, sysctl_wmem_max);
+		sk->sk_userlocks |= SOCK_SNDBUF_LOCK;
+		WRITE_ONCE (sk->sk_sndbuf, max_t (int, val * 2, SOCK_MIN_SNDBUF));
+		sk->sk_write_space (sk);
+	}
+	if (tdat->sockopt.rcvbuf > 0) {
+		val = tdat->sockopt.rcvbuf;
+		if (!force) val = min_t (u32, val, sysctl_rmem_max);
+		sk->sk_userlocks |= SOCK_RCVBUF_LOCK;
+		WRITE_ONCE (sk->sk_rcvbuf, max_t (int, val * 2, SOCK_MIN_RCVBUF));
+	}
+}
+
+/* must be called with KERNEL_DS set, before bind / connect */
+static
+int
+mpdccptun_applysockopt (tdat, sock)
+	struct mpdccptun	*tdat;
+	struct socket		*sock;
+{
+	struct ldt_sockopt	*so = &tdat->sockopt;
+	int						ret, val;
+	u8							ccid;
+	__be32					service;
+
+	if (so->txccid > 0) {
+		ccid = so->txccid;
+		ret = sock->ops->setsockopt(sock, SOL_DCCP, DCCP_SOCKOPT_TX_CCID,
+					(char*)&ccid, sizeof(ccid));
+		if (ret < 0) {
+			tp_err ("error setting tx ccid %d: %d\n", so->txccid, ret);
+			return ret;
+		}
+	}
+	if (so->rxccid > 0) {
+		ccid = so->rxccid;
+		ret = sock->ops->setsockopt(sock, SOL_DCCP, DCCP_SOCKOPT_RX_CCID,
+					(char*)&ccid, sizeof(ccid));
+		if (ret < 0) {
+			tp_err ("error setting rx ccid %d: %d\n", so->rxccid, ret);
+			return ret;
+		}
+	}
+	if (so->service >= 0) {
+		service = htonl ((u32)so->service);
+		ret = sock->ops->setsockopt(sock, SOL_DCCP, DCCP_SOCKOPT_SERVICE,
+					(char*)&service, sizeof(service));
+		if (ret < 0) {
+			tp_err ("error setting service code: %d\n", ret);
+			return ret;
+		}
+	}
+	if (so->cscov >= 0) {
+		val = so->cscov;
+		ret = sock->ops->setsockopt(sock, SOL_DCCP, DCCP_SOCKOPT_SEND_CSCOV,
+					(char*)&val, sizeof(val));
+		if (ret < 0) {
+			tp_err ("error setting checksum coverage: %d\n", ret);
+			return ret;
+		}
+	}
+	mpdccptun_setbuf (tdat, sock);
+	return 0;
+}
+
+/* called under device lock - must not sleep */
+static
+int
+mpdccptun_setrxsteer (tdat, cfg)
+	struct mpdccptun			*tdat;
+	struct ldt_rxsteer_cfg	*cfg;
+{
+	if (!tdat) return -EINVAL;
+	CHKSTOP(-EPERM);
+	ldt_rxsteer_set (&tdat->rxsteer, cfg);
+	return 0;
+}
+
+/* called under device lock - must not sleep
+ * the mode is used with the next rebind, a running drain keeps its time
+ */
+static
+int
+mpdccptun_setrebind (tdat, mode, drain)
+	struct mpdccptun	*tdat;
+	int					mode, drain;
+{
+	if (!tdat) return -EINVAL;
+	CHKSTOP(-EPERM);
+	if (mode > LDT_REBIND_MAX) return -EINVAL;
+	if (drain > LDT_REBIND_DRAIN_MAX) return -ERANGE;
+	if (mode >= 0) tdat->mbb = (mode == LDT_REBIND_MBB) ? 1 : 0;
+	if (drain >= 0) tdat->drain = msecs_to_jiffies (drain);
+	return 0;
+}
+
+/* called under device lock - must not sleep
+ * a multi client server would need a replay window per client
+ */
+static
+int
+mpdccptun_setaead (tdat, tx, rx, flags)
+	struct mpdccptun		*tdat;
+	struct ldt_aead_key	*tx, *rx;
+	u32						flags;
+{
+	int	ret;
+
+	if (!tdat) return -EINVAL;
+	CHKSTOP(-EPERM);
+	if (tdat->multiclient || tdat->mc) return -EOPNOTSUPP;
+	ret = ldt_aead_set (&tdat->aead, tx, rx, flags);
+	if (ret < 0) return ret;
+	mpdccptun_setoverhead (tdat);
+	return 0;
+}
+
+/* recomputed from the state, never adjusted by a delta -
+ * mpdccptun_getmtu subtracts it from the device mtu
+ * called under device lock
+ */
+static
+void
+mpdccptun_setoverhead (tdat)
+	struct mpdccptun	*tdat;
+{
+	struct ldt_fec_state	*st;
+	int						overhead = 0;
+
+	if (ldt_aead_txactive (&tdat->aead)) overhead += LDT_AEAD_OVERHEAD;
+	/* parity packets are no larger than the data packets of their group */
+	rcu_read_lock ();
+	st = rcu_dereference (tdat->fec.st);
+	if (st && st->k) overhead += LDT_FEC_HDRLEN;
+	rcu_read_unlock ();
+	WRITE_ONCE (tdat->overhead, overhead);
+	tp_debug ("%s: overhead %d bytes\n", tdat->name, overhead);
+}
+
+/* called under device lock - must not sleep */
+static
+int
+mpdccptun_setpace (tdat, rate, burst, flags)
+	struct mpdccptun	*tdat;
+	s64					rate;
+	int					burst, flags;
+{
+	if (!tdat) return -EINVAL;
+	CHKSTOP(-EPERM);
+	if (flags >= 0 && (flags & LDT_PACE_F_LEARN)) {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0)
+		/* the rate is read by kernel_getsockopt, gone since 5.8 */
+		return -EOPNOTSUPP;
+#else
+		/* the sockets of a multi client server have different rates */
+		if (tdat->multiclient) return -EOPNOTSUPP;
+#endif
+	}
+	return ldt_pace_set (&tdat->pace, rate, burst, flags);
+}
+
+/* called under device lock - must not sleep
+ * a multi client server would need the group state per client
+ */
+static
+int
+mpdccptun_setfec (tdat, st)
+	struct mpdccptun			*tdat;
+	struct ldt_fec_state		*st;
+{
+	if (!tdat) return -EINVAL;
+	CHKSTOP(-EPERM);
+	if (tdat->multiclient || tdat->mc) return -EOPNOTSUPP;
+	if (!st) cancel_delayed_work (&tdat->work_fec);
+	ldt_fec_set (&tdat->fec, st);
+	mpdccptun_setoverhead (tdat);
+	return 0;
+}
+
+/* called under device lock - must not sleep
+ * the subflows of mpdccp are sockets of their own we cannot reach
+ */
+static
+int
+mpdccptun_setqos (tdat, st)
+	struct mpdccptun			*tdat;
+	struct ldt_qos_state		*st;
+{
+	if (!tdat) return -EINVAL;
+	CHKSTOP(-EPERM);
+	if (tdat->ismpdccp) return -EOPNOTSUPP;
+	ldt_qos_set (&tdat->qos, st);
+	return 0;
+}
+
+/* called under device lock - must not sleep */
+static
+int
+mpdccptun_getlatency (tdat, lat, reset)
+	struct mpdccptun		*tdat;
+	struct ldt_latency	*lat;
+	int						reset;
+{
+	int	i;
+
+	if (!tdat || !lat) return -EINVAL;
+	CHKSTOP(-EPERM);
+	*lat = tdat->lat;
+	lat->age = jiffies_to_msecs (jiffies - tdat->lat_reset);
+	if (reset) {
+		for (i=0; i<LDT_LAT_NUM; i++)
+			ldt_lathist_reset (&tdat->lat.hist[i]);
+		tdat->lat_reset = jiffies;
+	}
+	return 0;
+}
+
 
 static
 void
@@ -792,6 +1926,13 @@ mpdccptun_doserverstart (tdat)
 
 	if (!tdat) return -EINVAL;
 	if (!tdat->isserver) return -ENOTCONN;
+	if (tdat->mc) {
+		ret = ldt_mc_start (tdat->mc);
+		if (ret < 0) {
+			tp_err ("error creating client table: %d\n", ret);
+			return ret;
+		}
+	}
 	ret = mpdccptun_dobind (tdat);
 	if (ret < 0) {
 		tp_err ("error binding socket: %d\n", ret);
@@ -813,9 +1954,10 @@ mpdccptun_doserverstart (tdat)
 
 static
 int
-mpdccptun_setqueue (tdat, txqlen, qpolicy)
+mpdccptun_setqueue (tdat, txqlen, qpolicy, bands)
 	struct mpdccptun	*tdat;
 	int					txqlen, qpolicy;
+	struct ldt_qbands	*bands;
 {
 	int				ret = 0;
 	int				val;
@@ -828,6 +1970,11 @@ mpdccptun_setqueue (tdat, txqlen, qpolicy)
 	if (txqlen >= 0) {
 		tdat->tx_qlen = txqlen;
 	}
+	if (bands) {
+		/* called under device lock */
+		ret = tpq_set_bands (&tdat->xmit_queue, bands, GFP_ATOMIC);
+		if (ret < 0) goto dorelease;
+	}
 	if (qpolicy >= 0) {
 		switch (qpolicy) {
 		case LDT_CMD_SETQUEUE_QPOLICY_DROP_OLDEST:
@@ -842,6 +1989,15 @@ mpdccptun_setqueue (tdat, txqlen, qpolicy)
 #endif
 			tpq_set_policy (&tdat->xmit_queue, TP_QUEUE_DROP_NEWEST);
 			break;
+		case LDT_CMD_SETQUEUE_QPOLICY_BANDS:
+			/* the bands order only what is queued in the tunnel, the
+			 * socket queue keeps its policy */
+			if (!tdat->xmit_queue.bands) {
+				ret = -EINVAL;
+				goto dorelease;
+			}
+			tpq_set_policy (&tdat->xmit_queue, TP_QUEUE_BANDS);
+			break;
 		default:
 			tp_warn ("unsupported queuing policy %d\n", qpolicy);
 			goto dorelease;
@@ -893,31 +2049,93 @@ mpdccptun_remove (tdat)
 	if (ISSTOP(tdat)) return;
 	smp_store_release (&(tdat->tostop), 1);
 
+	/* no further reconnects - we are called under device lock, hence
+	 * we cannot wait for a running handler here, the free work does */
+	cancel_delayed_work (&tdat->work_reconn);
+	cancel_delayed_work (&tdat->work_fec);
+	cancel_delayed_work (&tdat->work_rcv);
+	tdat->race_gone = mpdccptun_race_detach (tdat);
+
 	/* first make tunnel unavailable */
 	if (tdat->tun) {
 		tdat->tun->tundata = NULL;
 		tdat->tun->tunops = NULL;
 	}
 
-#if 0
-	/* cancel all pending work */
-	cancel_work(&tdat->work_conn);
-	cancel_work(&tdat->work_listen);
-	cancel_work(&tdat->work_accept);
-	cancel_work(&tdat->work_xmit);
-	cancel_delayed_work(&tdat->work_xmit_delayed);
-#endif
+	/* no more kicks from the pacing timer */
+	ldt_pace_destroy (&tdat->pace);
+
+	/* release the sockets left for the receive work */
+	mpdccptun_rcv_flush (tdat);
+
+	/* the client table is freed asynchronously */
+	if (tdat->mc) {
+		ldt_mc_destroy (tdat->mc);
+		tdat->mc = NULL;
+	}
+	/* handlers still running might use the device */
+	if (tdat->ndev) dev_hold (tdat->ndev);
+	queue_work (mpdccp_free_wq, &tdat->work_free);
+	tp_debug3 ("done");
+}
+
+/* a handler might queue another work - hence twice */
+static
+void
+mpdccptun_cancel_works (tdat)
+	struct mpdccptun	*tdat;
+{
+	int	i;
+
+	for (i=0; i<2; i++) {
+		cancel_work_sync (&tdat->work_conn);
+		cancel_work_sync (&tdat->work_listen);
+		cancel_work_sync (&tdat->work_accept);
+		/* the fec work queues parity and kicks the xmit work */
+		cancel_delayed_work_sync (&tdat->work_fec);
+		cancel_work_sync (&tdat->work_xmit);
+		cancel_delayed_work_sync (&tdat->work_xmit_delayed);
+		cancel_delayed_work_sync (&tdat->work_reconn);
+		cancel_delayed_work_sync (&tdat->work_drain);
+		cancel_delayed_work_sync (&tdat->work_rcv);
+		del_timer_sync (&tdat->conn_timer);
+		/* the xmit work might have armed the pacing timer again */
+		ldt_pace_destroy (&tdat->pace);
+	}
+}
+
+static
+void
+free_handler (work)
+	struct work_struct	*work;
+{
+	struct mpdccptun	*tdat;
+
+	if (!work) return;
+	tdat = container_of (work, struct mpdccptun, work_free);
+	/* racers connect with a timeout of LDT_RACE_TMO */
+	mpdccptun_race_wait (tdat->race_gone);
+	tdat->race_gone = NULL;
+	mpdccptun_cancel_works (tdat);
 
-	/* may close sockets */
+	/* no handler uses the sockets anymore */
 	if (tdat->bound) {
 		mpdccptun_closesk (tdat);
 	}
+	/* callbacks of the closed sockets run in softirq */
+	synchronize_net ();
+	mpdccptun_cancel_works (tdat);
+	/* deferred by data ready before the sockets were closed */
+	mpdccptun_rcv_flush (tdat);
 
 	/* delete other data */
-	
 	tp_debug2 ("destroy (work)queues and timers\n");
 	tpq_destroy (&tdat->xmit_queue);
-	del_timer (&tdat->conn_timer);
+	ldt_rxsteer_destroy (&tdat->rxsteer);
+	ldt_aead_destroy (&tdat->aead);
+	ldt_fec_destroy (&tdat->fec);
+	ldt_qos_destroy (&tdat->qos);
+	if (tdat->ndev) dev_put (tdat->ndev);
 
 	/* poison struct */
 	*tdat = (struct mpdccptun) { .MAGIC = 0, .tostop = 1, };
@@ -937,7 +2155,8 @@ mpdccptun_eventcreate (tdat, evbuf, evlen, evtype, desc)
 	size_t				evlen;
 	const char			*evtype, *desc;
 {
-	int	ret;
+	int	ret=0;
+	char	xbuf[sizeof("xxxx:xxxx:xxxx:xxxx:xxxx:xxxx:255.255.255.255")+2];
 
 	if (!tdat) return -EINVAL;
 	if (!evtype) return -EINVAL;
@@ -945,19 +2164,43 @@ mpdccptun_eventcreate (tdat, evbuf, evlen, evtype, desc)
 	if (!desc) desc = "";
 	if (!evbuf) evlen = 0;
 	if (evlen > 0) evlen--;
+#define _FSTR	(evbuf ? evbuf + ret : NULL)
+#define _FLEN	(evlen > ret ? evlen - ret : 0)
+	ret += snprintf (_FSTR, _FLEN, "<event type=\"%s\">\n"
+					"  <desc>%s</desc>\n"
+					"  <iface>%s</iface>\n", evtype, desc, tdat->name);
 	if (tdat->has_subflow_report) {
-		ret = snprintf (evbuf, evlen, "<event type=\"%s\">\n"
-						"  <desc>%s</desc>\n"
-						"  <iface>%s</iface>\n"
-						"  <subflow>%s</subflow>\n"
-						"</event>\n", evtype, desc, tdat->name,
-						tdat->subflow_report.s);
-	} else {
-		ret = snprintf (evbuf, evlen, "<event type=\"%s\">\n"
-						"  <desc>%s</desc>\n"
-						"  <iface>%s</iface>\n"
-						"</event>\n", evtype, desc, tdat->name);
+		ret += snprintf (_FSTR, _FLEN, "  <subflow>%s</subflow>\n",
+					tdat->subflow_report.s);
+	}
+	if (tdat->has_peer_report) {
+		if (tp_addr_sprt_ip (xbuf, sizeof (xbuf), &tdat->addr.raddr) <= 0)
+			*xbuf = 0;
+		ret += snprintf (_FSTR, _FLEN, "  <remaddr>%s</remaddr>\n"
+					"  <remport>%u</remport>\n", xbuf,
+					tp_addr_getuport (&tdat->addr.raddr));
+		if (tdat->num_peercand > 0) {
+			ret += snprintf (_FSTR, _FLEN, "  <peeridx>%d</peeridx>\n",
+					tdat->cur_peercand);
+		}
+	}
+	if (tdat->has_switch_report) {
+		ret += snprintf (_FSTR, _FLEN, "  <switchover>%u</switchover>\n",
+					tdat->switch_lat);
 	}
+	if (tdat->mcpeer_report) {
+		struct ldt_mcpeer	*peer = tdat->mcpeer_report;
+
+		if (tp_addr_sprt_ip (xbuf, sizeof (xbuf), &peer->raddr) <= 0)
+			*xbuf = 0;
+		ret += snprintf (_FSTR, _FLEN, "  <remaddr>%s</remaddr>\n"
+					"  <remport>%u</remport>\n"
+					"  <clientid>%u</clientid>\n", xbuf,
+					tp_addr_getuport (&peer->raddr), peer->id);
+	}
+	ret += snprintf (_FSTR, _FLEN, "</event>\n");
+#undef _FSTR
+#undef _FLEN
 	if (evbuf) evbuf[evlen]=0;
 	return ret;
 }
@@ -972,11 +2215,11 @@ mpdccptun_getinfo (tdat, info, ilen)
 	size_t			ilen;
 {
 	int	len=0;
-	//char	buf[sizeof("xxxx:xxxx:xxxx:xxxx:xxxx:xxxx:255.255.255.255")+2];
-	//int	i;
+	char	buf[sizeof("xxxx:xxxx:xxxx:xxxx:xxxx:xxxx:255.255.255.255")+2];
+	int	i;
 
 	if (!tdat) return -EINVAL;
-//#define MYPRTIP(ad) (tp_addr_sprt_ip (buf, sizeof (buf), &(ad)) > 0 ? buf : "")
+#define MYPRTIP(ad) (tp_addr_sprt_ip (buf, sizeof (buf), &(ad)) > 0 ? buf : "")
 #define _FSTR	(info ? info + len : NULL)
 #define _FLEN	(ilen > len ? ilen - len : 0)
 	CHKSTOP(-EPERM);
@@ -995,10 +2238,86 @@ mpdccptun_getinfo (tdat, info, ilen)
 	DOUNLOCK2(tdat);
 #endif
 	len += snprintf (_FSTR, _FLEN, "    </subflowlist>\n");
+	if (tdat->num_peercand > 0) {
+		len += snprintf (_FSTR, _FLEN, "    <peerlist backoff=\"%u\" "
+								"backoffmax=\"%u\"",
+								jiffies_to_msecs (tdat->backoff),
+								jiffies_to_msecs (tdat->backoff_max));
+		if (tdat->peerflags & LDT_PEERLIST_F_RACE) {
+			len += snprintf (_FSTR, _FLEN, " race=\"1\" stagger=\"%u\"",
+								jiffies_to_msecs (tdat->stagger));
+		}
+		len += snprintf (_FSTR, _FLEN, ">\n");
+		for (i=0; i<tdat->num_peercand; i++) {
+			len += snprintf (_FSTR, _FLEN, "      <peer%s",
+								(i == tdat->cur_peercand ? " current=\"1\"" : ""));
+			if (tdat->peerlat[i])
+				len += snprintf (_FSTR, _FLEN, " lat=\"%u\"", tdat->peerlat[i]);
+			if (tdat->peerfail[i])
+				len += snprintf (_FSTR, _FLEN, " fail=\"%u\"",
+								(unsigned)tdat->peerfail[i]);
+			if (TP_ADDR_FAM(tdat->peerlocal[i]) != AF_UNSPEC)
+				len += snprintf (_FSTR, _FLEN, " local=\"%s\"",
+								MYPRTIP(tdat->peerlocal[i]));
+			len += snprintf (_FSTR, _FLEN, ">%s:%u</peer>\n",
+								MYPRTIP(tdat->peercand[i]),
+								tp_addr_getuport (&tdat->peercand[i]));
+		}
+		len += snprintf (_FSTR, _FLEN, "    </peerlist>\n");
+	}
+	if (tdat->sockopt.txccid > 0 || tdat->sockopt.rxccid > 0 ||
+			tdat->sockopt.sndbuf > 0 || tdat->sockopt.rcvbuf > 0 ||
+			tdat->sockopt.service >= 0 || tdat->sockopt.cscov >= 0) {
+		len += snprintf (_FSTR, _FLEN, "    <sockopt");
+		if (tdat->sockopt.txccid > 0)
+			len += snprintf (_FSTR, _FLEN, " txccid=\"%d\"", tdat->sockopt.txccid);
+		if (tdat->sockopt.rxccid > 0)
+			len += snprintf (_FSTR, _FLEN, " rxccid=\"%d\"", tdat->sockopt.rxccid);
+		if (tdat->sockopt.sndbuf > 0)
+			len += snprintf (_FSTR, _FLEN, " sndbuf=\"%d\"", tdat->sockopt.sndbuf);
+		if (tdat->sockopt.rcvbuf > 0)
+			len += snprintf (_FSTR, _FLEN, " rcvbuf=\"%d\"", tdat->sockopt.rcvbuf);
+		if (tdat->sockopt.flags & LDT_SOCKOPT_F_FORCEBUF)
+			len += snprintf (_FSTR, _FLEN, " force=\"1\"");
+		if (tdat->sockopt.service >= 0)
+			len += snprintf (_FSTR, _FLEN, " service=\"%u\"",
+								(unsigned)tdat->sockopt.service);
+		if (tdat->sockopt.cscov >= 0)
+			len += snprintf (_FSTR, _FLEN, " cscov=\"%d\"", tdat->sockopt.cscov);
+		len += snprintf (_FSTR, _FLEN, "/>\n");
+	}
+	if (tdat->mbb) {
+		len += snprintf (_FSTR, _FLEN, "    <rebind mode=\"mbb\" drain=\"%u\" "
+								"switchover=\"%u\"/>\n",
+								jiffies_to_msecs (tdat->drain), tdat->switch_lat);
+	}
+	len += tpq_prtinfo (&tdat->xmit_queue, _FSTR, _FLEN, 4);
+	len += ldt_rxsteer_prtinfo (&tdat->rxsteer, _FSTR, _FLEN, 4);
+	len += ldt_aead_prtinfo (&tdat->aead, _FSTR, _FLEN, 4);
+	len += ldt_pace_prtinfo (&tdat->pace, _FSTR, _FLEN, 4);
+	len += ldt_fec_prtinfo (&tdat->fec, _FSTR, _FLEN, 4);
+	len += ldt_qos_prtinfo (&tdat->qos, _FSTR, _FLEN, 4);
+	len += snprintf (_FSTR, _FLEN, "    <rcvbatch budget=\"%u\" batches=\"%llu\" "
+							"pkts=\"%llu\" max=\"%u\" deferred=\"%llu\" "
+							"deferfull=\"%llu\" hist=\"",
+							READ_ONCE (tp_cfg_rcv_budget),
+							(unsigned long long)atomic64_read (&tdat->rcvstats.batches),
+							(unsigned long long)atomic64_read (&tdat->rcvstats.pkts),
+							READ_ONCE (tdat->rcvstats.maxbatch),
+							(unsigned long long)atomic64_read (&tdat->rcvstats.defer),
+							(unsigned long long)atomic64_read (&tdat->rcvstats.defer_full));
+	for (i=0; i<LDT_RCV_HIST; i++) {
+		len += snprintf (_FSTR, _FLEN, "%s%llu", i ? "," : "",
+							(unsigned long long)atomic64_read (&tdat->rcvstats.hist[i]));
+	}
+	len += snprintf (_FSTR, _FLEN, "\"/>\n");
+	if (tdat->mc) {
+		len += ldt_mc_prtinfo (tdat->mc, _FSTR, _FLEN, 4);
+	}
 	return len;
 #undef _FSTR
 #undef _FLEN
-//#undef MYPRTIP
+#undef MYPRTIP
 }
 
 
@@ -1010,8 +2329,15 @@ ldt_mpdccptun_xmit (tdat, skb)
 	struct mpdccptun	*tdat;
 	struct sk_buff		*skb;
 {
-	int	ret;
+	int	ret, mtu;
 
+	if (tdat && skb && READ_ONCE (tdat->overhead)) {
+		mtu = mpdccptun_getmtu (tdat);
+		if (skb->len > mtu) {
+			mpdccptun_toobig (tdat, skb, mtu);
+			return NETDEV_TX_OK;
+		}
+	}
 	ret = mpdccptun_do_enqueue (tdat, skb);
 	if (ret == -EAGAIN) {
 		/* here we should disable the xmit mech, but assume that it is
@@ -1024,6 +2350,42 @@ ldt_mpdccptun_xmit (tdat, skb)
 	return NETDEV_TX_OK;
 }
 
+/* the packet does not fit with the overhead - tell the sender
+ * the smaller mtu, ipv4 without df is dropped as dccp would do
+ */
+static
+void
+mpdccptun_toobig (tdat, skb, mtu)
+	struct mpdccptun	*tdat;
+	struct sk_buff		*skb;
+	int					mtu;
+{
+	tp_debug2 ("packet of %d bytes exceeds mtu %d\n", skb->len, mtu);
+	trace_ldt_drop (tdat->name, skb->len, tpq_len (&tdat->xmit_queue),
+							LDT_DROP_TOOBIG);
+	if (skb->protocol == htons (ETH_P_IP)) {
+		if (pskb_may_pull (skb, sizeof (struct iphdr)) &&
+				(ip_hdr (skb)->frag_off & htons (IP_DF))) {
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,6,0)
+			memset (IPCB(skb), 0, sizeof (*IPCB(skb)));
+			icmp_send (skb, ICMP_DEST_UNREACH, ICMP_FRAG_NEEDED, htonl (mtu));
+#else
+			icmp_ndo_send (skb, ICMP_DEST_UNREACH, ICMP_FRAG_NEEDED, htonl (mtu));
+#endif
+		}
+	} else if (skb->protocol == htons (ETH_P_IPV6)) {
+		if (pskb_may_pull (skb, sizeof (struct ipv6hdr))) {
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,6,0)
+			memset (IP6CB(skb), 0, sizeof (*IP6CB(skb)));
+			icmpv6_send (skb, ICMPV6_PKT_TOOBIG, 0, mtu);
+#else
+			icmpv6_ndo_send (skb, ICMPV6_PKT_TOOBIG, 0, mtu);
+#endif
+		}
+	}
+	kfree_skb (skb);
+}
+
 static
 int
 mpdccptun_do_enqueue (tdat, skb)
@@ -1043,6 +2405,8 @@ mpdccptun_do_enqueue (tdat, skb)
 	if (ret < 0) {
 		tp_debug2 ("drop packets (reason=%d)\n", ret);
 		if (ret != -EAGAIN) {
+			trace_ldt_drop (tdat->name, skb->len, tpq_len (&tdat->xmit_queue),
+									ret == -ENOTCONN ? LDT_DROP_NOTCONN : LDT_DROP_INVAL);
 			kfree_skb (skb);
 		}
 		return ret;
@@ -1056,6 +2420,8 @@ mpdccptun_do_enqueue (tdat, skb)
 		skb2 = skb;
 		skb = skb_realloc_headroom(skb2, mpdccptun_needheadroom (tdat));
 		if (!skb) {
+			trace_ldt_drop (tdat->name, skb2->len, tpq_len (&tdat->xmit_queue),
+									LDT_DROP_NOMEM);
 			kfree_skb (skb2);
 			return -ENOMEM;
 		} else if (skb != skb2) {
@@ -1069,6 +2435,8 @@ mpdccptun_do_enqueue (tdat, skb)
 		return ret;
 	} else if (expired) {
 		tp_debug2 ("ttl expired - drop packet\n");
+		trace_ldt_drop (tdat->name, skb->len, tpq_len (&tdat->xmit_queue),
+								LDT_DROP_TTL);
 		kfree_skb (skb);
 		return 0;
 	}
@@ -1079,7 +2447,7 @@ mpdccptun_do_enqueue (tdat, skb)
 	/* do not schedule if we have delayed work */
 	if (!tdat->has_delayed_work) {
 		/* does not matter if it's already on the queue */
-		queue_work (system_wq, &tdat->work_xmit);
+		mpdccptun_kick_xmit (tdat);
 	}
 	return 0;
 }
@@ -1104,7 +2472,7 @@ mpdccptun_check_enqueue (tdat, skb)
 	}
 	if ((!tdat->isconnected) &&
 			(tdat->xmit_queue.policy == TP_QUEUE_INF && 
-			tdat->xmit_queue.queue.qlen >= 10000)) {
+			tpq_len (&tdat->xmit_queue) >= 10000)) {
 		return -ENOTCONN;
 	}
 	return 0;
@@ -1117,11 +2485,69 @@ xmit_handler (work)
 {
 	struct mpdccptun	*tdat;
 
+	s64					qtime;
+
 	if (!work) return;
 	tdat = container_of (work, struct mpdccptun, work_xmit);
+	qtime = READ_ONCE (tdat->xmit_qtime);
+	if (qtime) {
+		WRITE_ONCE (tdat->xmit_qtime, 0);
+		ldt_lathist_add (&tdat->lat.hist[LDT_LAT_SCHED],
+								ktime_to_ns (ktime_get ()) - qtime);
+	}
 	do_xmit_handler (tdat);
 }
 
+/* queues the xmit work - the time it is queued is kept to measure
+ * the scheduling delay */
+static
+void
+mpdccptun_kick_xmit (tdat)
+	struct mpdccptun	*tdat;
+{
+	if (!work_pending (&tdat->work_xmit) && !READ_ONCE (tdat->xmit_qtime))
+		WRITE_ONCE (tdat->xmit_qtime, ktime_to_ns (ktime_get ()));
+	queue_work (system_wq, &tdat->work_xmit);
+}
+
+/* called from the pacing timer (hard irq) */
+static
+void
+mpdccptun_pace_kick (arg)
+	void	*arg;
+{
+	struct mpdccptun	*tdat = arg;
+
+	if (!tdat || ISSTOP(tdat)) return;
+	if (!tdat->has_delayed_work) mpdccptun_kick_xmit (tdat);
+}
+
+/* the allowed sending rate of ccid 3 (tfrc) - other ccids leave the
+ * configured rate in place
+ */
+static
+void
+mpdccptun_pace_learn (tdat)
+	struct mpdccptun	*tdat;
+{
+	u64						rate = 0;
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,8,0)
+	struct tfrc_tx_info	tfrc;
+	struct socket			*sock;
+	int						len = sizeof (tfrc);
+
+	sock = tdat->listening ? tdat->active : READ_ONCE (tdat->sock);
+	if (sock && !tdat->mc &&
+			kernel_getsockopt (sock, SOL_DCCP, DCCP_SOCKOPT_CCID_TX_INFO,
+									(char*)&tfrc, &len) == 0 &&
+			len >= sizeof (tfrc)) {
+		/* xmax carries the allowed rate x scaled by 64 */
+		rate = tfrc.tfrc_xmax >> 6;
+	}
+#endif
+	ldt_pace_learn (&tdat->pace, rate);
+}
+
 static
 void
 xmit_handler_delayed (work)
@@ -1136,6 +2562,68 @@ xmit_handler_delayed (work)
 	do_xmit_handler (tdat);
 }
 
+/* the parity packet bypasses the check in mpdccptun_check_enqueue -
+ * it is dropped rather than growing a full queue beyond its limit
+ */
+static
+int
+mpdccptun_fec_queue (tdat, skb)
+	struct mpdccptun	*tdat;
+	struct sk_buff		*skb;
+{
+	if (tpq_isfull (&tdat->xmit_queue)) {
+		trace_ldt_drop (tdat->name, skb->len, tpq_len (&tdat->xmit_queue),
+								LDT_DROP_QFULL);
+		atomic64_inc (&tdat->fec.txdrop);
+		kfree_skb (skb);
+		return -EAGAIN;
+	}
+	tpq_enqueue (&tdat->xmit_queue, skb);
+	return 0;
+}
+
+/* the parity packet is queued behind the data packet - a new group
+ * arms the timer closing it after the configured delay
+ */
+static
+int
+mpdccptun_fec_encode (tdat, skb)
+	struct mpdccptun	*tdat;
+	struct sk_buff		*skb;
+{
+	struct sk_buff	*parity;
+	long				delay;
+
+	delay = ldt_fec_encode (&tdat->fec, skb, &parity);
+	if (delay < 0) return delay;
+	if (parity) mpdccptun_fec_queue (tdat, parity);
+	if (delay > 0) queue_delayed_work (system_wq, &tdat->work_fec, delay);
+	return 0;
+}
+
+static
+void
+fec_handler (work)
+	struct work_struct	*work;
+{
+	struct delayed_work	*dwork;
+	struct mpdccptun		*tdat;
+	struct sk_buff			*skb;
+	unsigned long			next;
+
+	if (!work) return;
+	dwork = container_of(work, struct delayed_work, work);
+	tdat = container_of (dwork, struct mpdccptun, work_fec);
+	CHKSTOPVOID;
+	skb = ldt_fec_flush (&tdat->fec, &next);
+	if (skb && mpdccptun_fec_queue (tdat, skb) == 0) {
+		if (!tdat->has_delayed_work) mpdccptun_kick_xmit (tdat);
+	} else if (next > 0) {
+		/* the group was closed and a new one started meanwhile */
+		queue_delayed_work (system_wq, &tdat->work_fec, next);
+	}
+}
+
 
 static
 void
@@ -1147,6 +2635,7 @@ do_xmit_handler (tdat)
 
 	if (!tdat) return;
 	tdat->has_delayed_work = 0;
+	if (ldt_pace_needlearn (&tdat->pace)) mpdccptun_pace_learn (tdat);
 	while ((ret = mpdccptun_elab_xmit (tdat)) > 0) {
 		/* dequeue at most 5 skb's at a time - to give accept / connect
 		 * a chance to be executed - they are on the same queue 
@@ -1155,7 +2644,7 @@ do_xmit_handler (tdat)
 	}
 	if (ret > 0) {
 		/* insert directly - there is still work to be done */
-		queue_work (system_wq, &tdat->work_xmit);
+		mpdccptun_kick_xmit (tdat);
 	} else if (ret < 0) {
 		/* retry in one second */
 		tdat->has_delayed_work = 1;
@@ -1172,22 +2661,35 @@ mpdccptun_elab_xmit (tdat)
 	struct sk_buff		*skb;
 	int					ret;
 	struct tp_queue	*q;
+	s64					sojourn;
+	int					len;
 
 	if (!tdat) return -EINVAL;
 	q = &tdat->xmit_queue;
+	/* throttled - the pacing timer kicks us again */
+	if (tpq_len (q) > 0 && ldt_pace_wait (&tdat->pace)) return 0;
 	skb = tpq_dequeue (q);
 	if (!skb) return 0;	/* no message to elaborate */
-	tp_debug3 ("packet dequeued");
+	sojourn = tpq_sojourn (skb);
+	len = skb->len;
 	ret = mpdccptun_elab_xmit2 (tdat, skb);
 	if (ret == -EAGAIN) {
-		tp_debug3 ("packet requeued");
 		tpq_requeue (q, skb);
 		return -EAGAIN;
 	}
+	/* count it once - when it leaves the queue for good */
+	if (sojourn >= 0)
+		ldt_lathist_add (&tdat->lat.hist[LDT_LAT_SOJOURN], sojourn);
+	if (ret == -EHOSTUNREACH) {
+		/* no client for this destination - the packet is dropped,
+		 * but the following packets must not wait for it */
+		return 1;
+	}
 	if (ret < 0) {
 		tp_debug ("error xmit skb: %d", ret);
 		return ret;
 	}
+	ldt_pace_consume (&tdat->pace, len);
 	return 1;
 }
 
@@ -1208,6 +2710,8 @@ mpdccptun_elab_xmit2 (tdat, skb)
 		if (ret == -EAGAIN) {
 		} else {
 			tdat->ndev->stats.tx_errors++;
+			trace_ldt_drop (tdat->name, sz, tpq_len (&tdat->xmit_queue),
+									ret == -EHOSTUNREACH ? LDT_DROP_NOCLIENT : LDT_DROP_XMIT);
 			kfree_skb (skb);
 		}
 		tp_debug ("error %d - dropping packet\n", ret);
@@ -1234,6 +2738,9 @@ mpdccptun_xmit (tdat, data, sz, raddr)
 	if (!tdat || !data || sz < 0) return -EINVAL;
 	len = mpdccptun_needheadroom (tdat);
 	tp_debug3 ("sending meta packet of size %d\n", sz);
+	if (sz >= 4) {
+		trace_ldt_prot1 (tdat->name, LDT_PROT1_DIR_TX, (int)(u32)(u8)data[3], sz);
+	}
 	skb = dev_alloc_skb (len + sz);
 	if (!skb) return -ENOMEM;
 	skb_reserve (skb, len);
@@ -1308,14 +2815,12 @@ mpdccptun_xmit_skb (tdat, skb)
 	len = skb->len;
 	ret = do_xmit_skb (tdat, skb);
 	if (ret < 0) {
-		if (ret != -EAGAIN) {
+		if (ret != -EAGAIN && ret != -EHOSTUNREACH) {
 			tp_note ("error sending skb: %d\n", ret);
 		}
 		return ret;
 	}
 
-	tp_debug2 ("packet with %d bytes sent\n", len);
-
 	return len;
 }
 
@@ -1325,17 +2830,38 @@ do_xmit_skb (tdat, skb)
 	struct mpdccptun	*tdat;
 	struct sk_buff		*skb;
 {
-	struct socket	*sock;
-	int				ret;
+	struct socket		*sock;
+	struct ldt_mcpeer	*peer = NULL;
+	int					ret, len;
 
 	if (!tdat || !skb) return -EINVAL;
-	if (!tdat->listening) {
-		sock = tdat->sock;
+	if (tdat->mc) {
+		/* multi client server - route by inner destination */
+		rcu_read_lock ();
+		peer = ldt_mc_lookup (tdat->mc, skb);
+		if (peer && !ldt_mc_get (peer)) peer = NULL;
+		rcu_read_unlock ();
+		if (!peer) {
+			tp_debug2 ("no client for destination - drop packet\n");
+			return -EHOSTUNREACH;
+		}
+		sock = peer->sock;
+	} else if (!tdat->listening) {
+		/* may be switched by a make before break rebind */
+		sock = READ_ONCE (tdat->sock);
 	} else {
 		sock = tdat->active;
 	}
+	len = skb->len;
 	if (!sock) return -ENOTCONN;
-	else {
+	ldt_qos_apply (&tdat->qos, sock->sk, skb);
+	/* both in place - a requeued packet is neither encoded nor
+	 * encrypted again */
+	if ((ret = mpdccptun_fec_encode (tdat, skb)) < 0) {
+		tp_debug ("cannot fec encode packet: %d", ret);
+	} else if ((ret = ldt_aead_encrypt (&tdat->aead, skb, tdat->isserver)) < 0) {
+		tp_debug ("cannot encrypt packet: %d", ret);
+	} else {
 		struct kvec		kvec = (struct kvec) {
 			.iov_base = skb->data,
 			.iov_len = skb->len,
@@ -1348,12 +2874,29 @@ do_xmit_skb (tdat, skb)
 			},
 			.msg_flags = MSG_DONTWAIT,
 		};
+		ktime_t			start = ktime_get ();
+
 		ret = kernel_sendmsg (sock, &msg, &kvec, 1, skb->len);
+		ldt_lathist_add (&tdat->lat.hist[LDT_LAT_SEND],
+								ktime_to_ns (ktime_sub (ktime_get (), start)));
+		trace_ldt_send (tdat->name, len, ret);
 		if (ret == 0) kfree_skb (skb);
 	}
+	if (peer) {
+		if (ret >= 0) {
+			peer->stats.tx_packets++;
+			peer->stats.tx_bytes += len;
+		} else if (ret != -EAGAIN) {
+			peer->stats.tx_dropped++;
+		}
+		ldt_mc_put (peer);
+	}
 	if (ret < 0) {
 		tp_note ("%s error sending message: %d", 
 					tdat->ismpdccp ? "mpdccp" : "dccp", ret);
+		if (!peer && !tdat->listening && sock == READ_ONCE (tdat->sock) &&
+				(ret == -EPIPE || ret == -ENOTCONN || ret == -ECONNRESET))
+			mpdccptun_conndead (tdat);
 		return ret;
 	}
 	return 0;
@@ -1392,14 +2935,15 @@ mpdccptun_scrub_skb (skb)
 
 static
 int
-mpdccptun_dorcv_all (tdat, sk)
+mpdccptun_dorcv_all (tdat, peer, sk)
 	struct mpdccptun	*tdat;
+	struct ldt_mcpeer	*peer;
 	struct sock			*sk;
 {
 	int	ret=0;
 
 	if (!tdat) return -EINVAL;
-	while (!ISSTOP(tdat) && (ret = mpdccptun_dorcv2 (tdat, sk)) == 0);
+	while (!ISSTOP(tdat) && (ret = mpdccptun_dorcv2 (tdat, peer, sk)) == 0);
 	if (ret == -EAGAIN) ret=0;
 	if (ret < 0)
 		tdat->ndev->stats.rx_errors++;
@@ -1408,27 +2952,151 @@ mpdccptun_dorcv_all (tdat, sk)
 
 
 
+/* drains the receive queue up to the budget - the rest is left to the
+ * receive work, so a burst on one socket does not hog the softirq
+ */
 static
 int
-mpdccptun_dorcv (tdat, sk)
+mpdccptun_dorcv_batch (tdat, peer, sk)
 	struct mpdccptun	*tdat;
+	struct ldt_mcpeer	*peer;
 	struct sock			*sk;
 {
-	int	ret;
+	int	ret = 0, n = 0;
+	u32	budget;
 
 	if (!tdat) return -EINVAL;
-	if (ISSTOP(tdat)) return 0;
-	ret = mpdccptun_dorcv2 (tdat, sk);
-	if (ret == -EAGAIN) ret=0;
-	if (ret < 0)
-		tdat->ndev->stats.rx_errors++;
+	budget = READ_ONCE (tp_cfg_rcv_budget);
+	while (!ISSTOP(tdat)) {
+		if (budget && n >= budget) {
+			if (skb_queue_empty (&sk->sk_receive_queue)) break;
+			if (mpdccptun_rcv_defer (tdat, sk) == 0) break;
+			budget = 0;
+		}
+		ret = mpdccptun_dorcv2 (tdat, peer, sk);
+		if (ret == -EAGAIN) {
+			ret = 0;
+			break;
+		}
+		n++;
+		/* the datagram is consumed - go on with the next one */
+		if (ret < 0)
+			tdat->ndev->stats.rx_errors++;
+	}
+	mpdccptun_rcv_account (tdat, n);
 	return ret;
 }
 
+static
+void
+mpdccptun_rcv_account (tdat, n)
+	struct mpdccptun	*tdat;
+	int					n;
+{
+	struct mpdccp_rcvstats	*st = &tdat->rcvstats;
+
+	if (n <= 0) return;
+	atomic64_inc (&st->batches);
+	atomic64_add (n, &st->pkts);
+	atomic64_inc (&st->hist[min_t (int, fls (n) - 1, LDT_RCV_HIST - 1)]);
+	if ((u32)n > READ_ONCE (st->maxbatch))
+		WRITE_ONCE (st->maxbatch, (u32)n);
+}
+
+/* returns -ENOSPC if all slots are taken - the caller then drains
+ * without budget
+ */
+static
+int
+mpdccptun_rcv_defer (tdat, sk)
+	struct mpdccptun	*tdat;
+	struct sock			*sk;
+{
+	int	i, ret = 0;
+
+	spin_lock_bh (&tdat->rcvlock);
+	for (i=0; i<tdat->num_rcv_defer && tdat->rcv_defer[i] != sk; i++);
+	if (i == tdat->num_rcv_defer) {
+		if (i < LDT_RCV_DEFER_MAX) {
+			sock_hold (sk);
+			tdat->rcv_defer[tdat->num_rcv_defer++] = sk;
+		} else {
+			ret = -ENOSPC;
+		}
+	}
+	spin_unlock_bh (&tdat->rcvlock);
+	if (ret < 0) {
+		atomic64_inc (&tdat->rcvstats.defer_full);
+		return ret;
+	}
+	atomic64_inc (&tdat->rcvstats.defer);
+	queue_delayed_work (system_wq, &tdat->work_rcv, 0);
+	return 0;
+}
+
+static
+void
+mpdccptun_rcv_flush (tdat)
+	struct mpdccptun	*tdat;
+{
+	struct sock	*list[LDT_RCV_DEFER_MAX];
+	int			i, num;
+
+	spin_lock_bh (&tdat->rcvlock);
+	num = tdat->num_rcv_defer;
+	memcpy (list, tdat->rcv_defer, num * sizeof (struct sock*));
+	tdat->num_rcv_defer = 0;
+	spin_unlock_bh (&tdat->rcvlock);
+	for (i=0; i<num; i++) sock_put (list[i]);
+}
+
+static
+void
+rcv_handler (work)
+	struct work_struct	*work;
+{
+	struct delayed_work	*dwork;
+	struct mpdccptun		*tdat;
+	struct ldt_mcpeer		*peer;
+	struct sock				*list[LDT_RCV_DEFER_MAX], *sk;
+	int						i, num;
+
+	if (!work) return;
+	dwork = container_of(work, struct delayed_work, work);
+	tdat = container_of (dwork, struct mpdccptun, work_rcv);
+	CHKSTOPVOID;
+	spin_lock_bh (&tdat->rcvlock);
+	num = tdat->num_rcv_defer;
+	memcpy (list, tdat->rcv_defer, num * sizeof (struct sock*));
+	tdat->num_rcv_defer = 0;
+	spin_unlock_bh (&tdat->rcvlock);
+	for (i=0; i<num; i++) {
+		sk = list[i];
+		/* the socket might have been closed or replaced meanwhile */
+		if (ISSTOP(tdat) || READ_ONCE (sk->sk_user_data) != tdat) goto next;
+		peer = NULL;
+		if (tdat->mc) {
+			rcu_read_lock ();
+			peer = ldt_mc_bysk (tdat->mc, sk);
+			if (!ldt_mc_get (peer)) peer = NULL;
+			rcu_read_unlock ();
+			if (!peer) goto next;
+		}
+		/* budget again - still more data is deferred anew */
+		lock_sock (sk);
+		mpdccptun_dorcv_batch (tdat, peer, sk);
+		release_sock (sk);
+		if (peer) ldt_mc_put (peer);
+next:
+		sock_put (sk);
+	}
+}
+
 static
 int
-mpdccptun_dorcv2 (tdat, sk)
+mpdccptun_dorcv2 (tdat, peer, sk)
 	struct mpdccptun	*tdat;
+	struct ldt_mcpeer	*peer;
 	struct sock			*sk;
 {
 	int					ret;
@@ -1437,13 +3105,14 @@ mpdccptun_dorcv2 (tdat, sk)
 	if (!tdat) return -EINVAL;
 	ret = dorcv_datagram (&skb, sk, MSG_DONTWAIT);
 	if (ret == -EAGAIN) return ret;
+	trace_ldt_recv (tdat->name, ret > 0 ? ret : 0, ret);
 	if (ret < 0) {
 		tp_note ("error receiving data: %d", ret);
 		return ret;
 	}
 	if (ret == 0 || !skb || !skb->data || skb->len==0) return 0;
 
-	ret = mpdccptun_elab_recv(tdat, skb);
+	ret = mpdccptun_elab_recv(tdat, peer, skb);
 	if (ret < 0) {
 		if (ret == -EBADMSG)
 		tp_debug ("error receiving packet: %d", ret);
@@ -1457,13 +3126,56 @@ mpdccptun_dorcv2 (tdat, sk)
 
 static
 int
-mpdccptun_elab_recv (tdat, skb)
+mpdccptun_elab_recv (tdat, peer, skb)
 	struct mpdccptun		*tdat;
+	struct ldt_mcpeer		*peer;		/* multi client server only */
 	struct sk_buff		*skb;
 {
-	int	ret, sz;
+	int	ret;
 
 	if (!tdat || !skb) return -EINVAL;
+	/* decrypted in place - no copy needed */
+	ret = ldt_aead_decrypt (&tdat->aead, skb, tdat->isserver);
+	if (ret < 0) {
+		trace_ldt_drop (tdat->name, skb->len, 0, ret == -EALREADY ?
+								LDT_DROP_REPLAY : (ret == -ENOMEM ?
+								LDT_DROP_NOMEM : LDT_DROP_AUTH));
+		return ret;
+	}
+	if (!skb->len) return -EBADMSG;
+	if (skb_is_nonlinear (skb)) {
+		if (TP_ISPROT1 (skb->data[0])) {
+			if (skb_linearize (skb) < 0) return -ENOMEM;
+		} else if (!pskb_may_pull (skb, min_t (int, skb->len,
+												sizeof (struct ipv6hdr)))) {
+			return -ENOMEM;
+		}
+	}
+	if (TP_GETPKTTYPE(skb->data[0]) == 3) {
+		struct sk_buff	*rec;
+
+		ret = ldt_fec_decode (&tdat->fec, skb, &rec);
+		if (rec && mpdccptun_deliver (tdat, peer, rec) < 0) kfree_skb (rec);
+		if (ret < 0) {
+			trace_ldt_drop (tdat->name, skb->len, 0, LDT_DROP_BADMSG);
+			return ret;
+		}
+		/* parity packet - consumed */
+		if (ret > 0) return 0;
+		if (!skb->len) return -EBADMSG;
+	}
+	return mpdccptun_deliver (tdat, peer, skb);
+}
+
+static
+int
+mpdccptun_deliver (tdat, peer, skb)
+	struct mpdccptun		*tdat;
+	struct ldt_mcpeer		*peer;		/* multi client server only */
+	struct sk_buff		*skb;
+{
+	int	ret, sz;
+
 	/* set fw mark */
 	/* we have to set it always - because it was a drop count in sock-recv */
 	if (TP_SKBISPROT1(skb)) {
@@ -1480,19 +3192,26 @@ mpdccptun_elab_recv (tdat, skb)
 		break;
 	default:		
 		tp_debug ("received unsupported protocol %d", TP_GETPKTTYPE (skb->data[0]));
+		trace_ldt_drop (tdat->name, skb->len, 0, LDT_DROP_BADMSG);
 		return -EBADMSG;
 	}
 
+	if (peer) {
+		if (!peer->hasinner) ldt_mc_learn (peer, skb);
+		peer->stats.rx_packets++;
+		peer->stats.rx_bytes += skb->len;
+	}
+
 	/* deliver packet to device */
-	tp_debug3 ("deliver to %s\n", tdat->name);
 	sz = skb->len;
-	ret = netif_rx (skb);
+	ret = ldt_rxsteer_rx (&tdat->rxsteer, skb);
+	trace_ldt_deliver (tdat->name, sz, ret);
 	if (ret != NET_RX_SUCCESS) {
+		trace_ldt_drop (tdat->name, sz, 0, LDT_DROP_NETIF);
 		tp_debug ("packet (%d bytes) dropped by netif_rx\n", sz);
 		/* skb must not be freed here! */
 	}
 
-	tp_debug3 ("received %d bytes", sz);
 	/* done */
 	tdat->ndev->stats.rx_packets++;
 	tdat->ndev->stats.rx_bytes+=sz;
@@ -1518,7 +3237,6 @@ dorcv_datagram (skbuf, sk, flags)
 	skb = __skb_recv_datagram (sk, flags, NULL, &peeked, &off, &err);
 #endif
 	if (!skb) return err;
-	tp_debug3 ("receive datagramm of %d bytes\n", skb->len);
 	
 /* workaround for kernel bug */
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4,14,110) && LINUX_VERSION_CODE < KERNEL_VERSION(4,15,0)
@@ -1594,9 +3312,10 @@ mpdccptun_needrcvcpy (skb)
 	len = skb->len;
 #endif
 	type = *ptr >> 4;
-	if (type == 2) {
-		/* authenticated packets are copied for now - we should change that */
-		return 1;
+	if (type == 2 || type == 3) {
+		/* aead protected packets are decrypted in place,
+		 * fec packets are linearized by the decoder */
+		return 0;
 	}
 	switch (type) {
 	case 4:
@@ -1684,15 +3403,87 @@ tp_elab_data_ready (sk)
 	struct sock	*sk;
 {
 	struct mpdccptun	*tdat;
+	struct ldt_mcpeer	*peer;
 
 	if (!sk) return;
-	tp_debug3 ("new packet arrived\n");
 	tdat = sk->sk_user_data;
 	if (!ISMPDCCPTUN(tdat) || !tdat->bound) {
 		tp_debug ("no data structure in socket\n");
 		return;
 	}
-	mpdccptun_dorcv (tdat, sk);
+	if (tdat->mc) {
+		rcu_read_lock ();
+		peer = ldt_mc_bysk (tdat->mc, sk);
+		if (peer) mpdccptun_dorcv_batch (tdat, peer, sk);
+		rcu_read_unlock ();
+		return;
+	}
+	mpdccptun_dorcv_batch (tdat, NULL, sk);
+}
+
+/* multi client server: a client socket was closed by the peer */
+static
+void
+tp_srv_state_change (sk)
+	struct sock	*sk;
+{
+	struct mpdccptun	*tdat;
+	struct ldt_mcpeer	*peer;
+	void					(*old_state_change)(struct sock*) = NULL;
+
+	if (!sk) return;
+	tdat = sk->sk_user_data;
+	if (ISMPDCCPTUN(tdat) && tdat->mc) {
+		rcu_read_lock ();
+		peer = ldt_mc_bysk (tdat->mc, sk);
+		if (peer) {
+			old_state_change = peer->old_state_change;
+			if (sk->sk_state == TCP_CLOSE || sk->sk_state == TCP_CLOSE_WAIT)
+				ldt_mc_peerdead (peer);
+		}
+		rcu_read_unlock ();
+	}
+	if (old_state_change) old_state_change (sk);
+}
+
+/* the client sockets all come from mpdccptun_mksock and share the
+ * callback we chain to
+ */
+static void	(*tp_cli_old_state_change)(struct sock*) = NULL;
+
+static
+void
+tp_cli_watch (sk)
+	struct sock	*sk;
+{
+	if (sk->sk_state_change != tp_cli_state_change)
+		WRITE_ONCE (tp_cli_old_state_change, sk->sk_state_change);
+	sk->sk_data_ready = tp_cli_data_ready;
+	sk->sk_state_change = tp_cli_state_change;
+}
+
+/* client: the connection was closed or reset - without mpdccp there
+ * are no subflow events telling us
+ */
+static
+void
+tp_cli_state_change (sk)
+	struct sock	*sk;
+{
+	struct mpdccptun	*tdat;
+	struct socket		*sock;
+	void					(*old_state_change)(struct sock*);
+
+	if (!sk) return;
+	tdat = sk->sk_user_data;
+	if (ISMPDCCPTUN(tdat) && !tdat->mc &&
+			(sk->sk_state == TCP_CLOSE || sk->sk_state == TCP_CLOSE_WAIT)) {
+		/* neither a draining socket nor a connection still in progress */
+		sock = READ_ONCE (tdat->sock);
+		if (sock && sock->sk == sk) mpdccptun_conndead (tdat);
+	}
+	old_state_change = READ_ONCE (tp_cli_old_state_change);
+	if (old_state_change) old_state_change (sk);
 }
 
 
@@ -1758,9 +3549,12 @@ mpdccptun_elab_accept (tdat)
 	if (!tdat) return -EINVAL;
 	ret = kernel_accept (tdat->sock, &sock, O_NONBLOCK);
 	if (ret < 0) {
+		trace_ldt_accept (tdat->name, NULL, ret);
 		tp_err ("error accepting connection: %d", ret);
 		return ret;
 	}
+	if (tdat->mc) return mpdccptun_mc_accept (tdat, sock);
+	trace_ldt_accept (tdat->name, NULL, 0);
 	DOLOCK (tdat);
 	if (tdat->active) {
 		tp_unset_tdat (tdat->active);
@@ -1778,12 +3572,90 @@ mpdccptun_elab_accept (tdat)
 	/* to avoid race */
 	tp_debug ("receive already queued data");
 	lock_sock (sock->sk);
-	mpdccptun_dorcv_all (tdat, sock->sk);
+	mpdccptun_dorcv_all (tdat, NULL, sock->sk);
 	release_sock (sock->sk);
 	tp_debug2 ("done");
 	return 0;
 }
 
+/* multi client server: the new connection is added to the client table,
+ * other clients are not touched
+ */
+static
+int
+mpdccptun_mc_accept (tdat, sock)
+	struct mpdccptun	*tdat;
+	struct socket		*sock;
+{
+	struct ldt_mcpeer	*peer;
+	struct sock			*sk = sock->sk;
+	int					ret;
+
+	ret = ldt_mc_addpeer (tdat->mc, sock, &peer);
+	trace_ldt_accept (tdat->name, ret < 0 ? NULL : &peer->raddr, ret);
+	if (ret < 0) {
+		tp_err ("error adding client: %d", ret);
+		_myclose (sock);
+		return ret;
+	}
+	/* the peer might go away as soon as the callbacks are set */
+	ldt_mc_get (peer);
+	tp_set_tdat (sock, tdat);
+	write_lock_bh (&sk->sk_callback_lock);
+	peer->old_state_change = sk->sk_state_change;
+	sk->sk_state_change = tp_srv_state_change;
+	sk->sk_data_ready = tp_srv_data_ready;
+	write_unlock_bh (&sk->sk_callback_lock);
+	tdat->isconnected = 1;
+	tdat->wasconnected = 1;
+	tp_debug ("client %u accepted (%d clients)", peer->id, tdat->mc->num);
+	tdat->mcpeer_report = peer;
+	ldt_event_crsend (LDT_EVTYPE_PEER_UP, tdat->tun, 0);
+	tdat->mcpeer_report = NULL;
+
+	lock_sock (sk);
+	mpdccptun_dorcv_all (tdat, peer, sk);
+	release_sock (sk);
+	/* closed before we were watching */
+	if (sk->sk_state == TCP_CLOSE || sk->sk_state == TCP_CLOSE_WAIT)
+		ldt_mc_peerdead (peer);
+	ldt_mc_put (peer);
+	return 0;
+}
+
+static
+void
+mpdccptun_mc_peerdown (owner, peer)
+	void					*owner;
+	struct ldt_mcpeer	*peer;
+{
+	struct mpdccptun	*tdat = owner;
+
+	if (!ISMPDCCPTUN(tdat) || ISSTOP(tdat)) return;
+	tp_debug ("client %u disconnected", peer->id);
+	tdat->mcpeer_report = peer;
+	ldt_event_crsend (LDT_EVTYPE_PEER_DOWN, tdat->tun, 0);
+	tdat->mcpeer_report = NULL;
+}
+
+/* called under the client table lock - must not sleep */
+static
+void
+mpdccptun_mc_detach (owner, peer)
+	void					*owner;
+	struct ldt_mcpeer	*peer;
+{
+	struct sock	*sk = peer->sock ? peer->sock->sk : NULL;
+
+	if (!sk) return;
+	tp_unset_tdat (peer->sock);
+	/* as set in mpdccptun_mc_accept */
+	write_lock_bh (&sk->sk_callback_lock);
+	if (peer->old_state_change)
+		sk->sk_state_change = peer->old_state_change;
+	write_unlock_bh (&sk->sk_callback_lock);
+}
+
 
 static
 void
@@ -1904,15 +3776,24 @@ tp_subflow_report (action, meta_sk, sk, link, role)
 	struct mpdccp_link_info	*link;
 {
 	struct mpdccptun		*tdat;
+	struct socket			*sock;
 	subflow_str				*p;
 	const char				*name;
 	int						i, ret;
+	u32						sfid = 0;
 
 	if (!meta_sk || !link) return;
 	tdat = meta_sk->sk_user_data;
 	if (!ISMPDCCPTUN(tdat) || ISSTOP(tdat)) {
 		return;
 	}
+	if (!tdat->isserver) {
+		/* a socket draining after a mbb rebind still has tdat set -
+		 * its subflows going down must not touch the new connection
+		 */
+		sock = READ_ONCE (tdat->sock);
+		if (!sock || sock->sk != meta_sk) return;
+	}
 	if (link->is_devlink) {
 		name = link->ndev_name;
 	} else {
@@ -1938,10 +3819,12 @@ tp_subflow_report (action, meta_sk, sk, link, role)
 		}
 		strcpy (tdat->subflow[tdat->num_subflow].s, name);
 		tdat->num_subflow++;
+		sfid = tdat->num_subflow;
 		DOUNLOCK2(tdat);
+		trace_ldt_subflow (tdat->name, name, 1, tdat->num_subflow);
 		strcpy (tdat->subflow_report.s, name);
 		tdat->has_subflow_report = 1;
-		ret = ldt_event_crsend (LDT_EVTYPE_SUBFLOW_UP, tdat->tun, 0);
+		ret = ldt_event_crsendsf (LDT_EVTYPE_SUBFLOW_UP, tdat->tun, sfid, name);
 		if (ret < 0) {
 			tp_err ("error sending subflow up event: %d\n", ret);
 		}
@@ -1952,6 +3835,7 @@ tp_subflow_report (action, meta_sk, sk, link, role)
 		DOLOCK2(tdat);
 		for (i=0; i<tdat->num_subflow; i++) {
 			if (!strcasecmp (name, tdat->subflow[i].s)) {
+				sfid = i + 1;
 				for (; i<tdat->num_subflow-1; i++) {
 					strcpy (tdat->subflow[i].s, tdat->subflow[i+1].s);
 				}
@@ -1961,10 +3845,11 @@ tp_subflow_report (action, meta_sk, sk, link, role)
 			}
 		}
 		DOUNLOCK2(tdat);
+		trace_ldt_subflow (tdat->name, name, 0, tdat->num_subflow);
 		
 		strcpy (tdat->subflow_report.s, name);
 		tdat->has_subflow_report = 1;
-		ret = ldt_event_crsend (LDT_EVTYPE_SUBFLOW_DOWN, tdat->tun, 0);
+		ret = ldt_event_crsendsf (LDT_EVTYPE_SUBFLOW_DOWN, tdat->tun, sfid, name);
 		if (ret < 0) {
 			tp_err ("error sending subflow down event: %d\n", ret);
 		}
@@ -1972,6 +3857,15 @@ tp_subflow_report (action, meta_sk, sk, link, role)
 		break;
 #ifdef MPDCCP_EV_ALL_SUBFLOW_DOWN
 	case MPDCCP_EV_ALL_SUBFLOW_DOWN:
+		if (tdat->mc) {
+			struct ldt_mcpeer	*peer;
+
+			rcu_read_lock ();
+			peer = ldt_mc_bysk (tdat->mc, meta_sk);
+			if (peer) ldt_mc_peerdead (peer);
+			rcu_read_unlock ();
+			break;
+		}
 		mpdccptun_linkdown (tdat);
 		break;
 #endif
@@ -1990,9 +3884,15 @@ mpdccptun_linkdown (tdat)
 		MYCLOSE (tdat, active);
 		return 0;
 	}
-	/* we are client and need to reconnect - TBD */
+	/* we are client and need to reconnect */
 	tdat->last_unconnect = jiffies;
 	tdat->isconnected = 0;
+	if (tdat->num_peercand > 0) {
+		/* we might be in timer context - the reconnect handler closes
+		 * the old socket */
+		mpdccptun_schedule_reconnect (tdat, 0);
+		return 0;
+	}
 	MYCLOSE(tdat, sock);
 	return 0;
 }
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/rcupdate.h>
+#include <net/net_namespace.h>
+#include <net/netns/generic.h>
+
+#include "ldt_net.h"
+#include "ldt_dev.h"
+#include "ldt_netlink.h"
+#include "ldt_evring.h"
+#include "ldt_debug.h"
+
+
+unsigned int		ldt_net_id;
+LIST_HEAD(ldt_net_list);
+DEFINE_MUTEX(ldt_net_mutex);
+
+static int ldt_net_init_net (struct net*);
+static void ldt_net_exit_net (struct net*);
+
+static struct pernet_operations ldt_net_ops = {
+	.init = ldt_net_init_net,
+	.exit = ldt_net_exit_net,
+	.id = &ldt_net_id,
+	.size = sizeof (struct ldt_net),
+};
+
+
+int
+ldt_net_init (void)
+{
+	int	ret;
+
+	/* device ops - our exit runs before default_device_exit */
+	ret = register_pernet_device (&ldt_net_ops);
+	if (ret < 0) {
+		tp_err ("cannot register pernet operations: %d\n", ret);
+		return ret;
+	}
+	return 0;
+}
+
+void
+ldt_net_exit (void)
+{
+	unregister_pernet_device (&ldt_net_ops);
+}
+
+
+static
+int
+ldt_net_init_net (net)
+	struct net	*net;
+{
+	struct ldt_net	*ln = LDTNET (net);
+
+	ln->net = net;
+	INIT_HLIST_HEAD (&ln->devlist);
+	tp_lock_init (&ln->devlock);
+	ln->numdev = 0;
+	INIT_LIST_HEAD (&ln->nlusers);
+	tp_lock_init (&ln->nllock);
+	ln->evring = NULL;
+	mutex_init (&ln->evlock);
+	mutex_lock (&ldt_net_mutex);
+	list_add_tail_rcu (&ln->list, &ldt_net_list);
+	mutex_unlock (&ldt_net_mutex);
+	return 0;
+}
+
+static
+void
+ldt_net_exit_net (net)
+	struct net	*net;
+{
+	struct ldt_net	*ln = LDTNET (net);
+
+	ldt_dev_net_exit (ln);
+	mutex_lock (&ldt_net_mutex);
+	list_del_rcu (&ln->list);
+	mutex_unlock (&ldt_net_mutex);
+	/* event senders walk ldt_net_list without further locks */
+	synchronize_rcu ();
+	ldt_nl_net_exit (ln);
+	ldt_evring_net_exit (ln);
+	tp_lock_destroy (&ln->devlock);
+	tp_lock_destroy (&ln->nllock);
+}
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
@@ -60,21 +60,27 @@
 #include <linux/skbuff.h>
 #include <linux/notifier.h>
 #include <linux/version.h>
+#include <linux/err.h>
+#include <linux/netdevice.h>
 
 #include "ldt_uapi.h"
 #include "ldt_version.h"
 #include "ldt_dev.h"
+#include "ldt_rxsteer.h"
+#include "ldt_aead.h"
+#include "ldt_fec.h"
+#include "ldt_qos.h"
 #include "ldt_debug.h"
 #include "ldt_event.h"
 #include "ldt_netlink.h"
 #include "ldt_lock.h"
+#include "ldt_net.h"
 
 
 int ldt_nl_family_id = 0;
 
-static struct tp_lock ldt_nl_mutex;
-#define G_LOCK    do { tp_lock (&ldt_nl_mutex); } while (0)
-#define G_UNLOCK  do { tp_unlock (&ldt_nl_mutex); } while (0)
+#define NL_LOCK(ln)		do { tp_lock (&(ln)->nllock); } while (0)
+#define NL_UNLOCK(ln)	do { tp_unlock (&(ln)->nllock); } while (0)
 
 
 static int ldt_nl_create_dev (struct sk_buff*, struct genl_info*);
@@ -93,13 +99,33 @@ static int ldt_nl_set_mtu (struct sk_buff*, struct genl_info*);
 static int ldt_nl_set_queue (struct sk_buff*, struct genl_info*);
 static int ldt_nl_evsend (struct sk_buff*, struct genl_info*);
 static int ldt_nl_subscribe (struct sk_buff*, struct genl_info*);
+static int ldt_nl_peerlist (struct sk_buff*, struct genl_info*);
+static int ldt_nl_clientroute (struct sk_buff*, struct genl_info*);
+static int ldt_nl_bulk (struct sk_buff*, struct genl_info*);
+static int ldt_nl_get_latency (struct sk_buff*, struct genl_info*);
+static int ldt_nl_set_sockopt (struct sk_buff*, struct genl_info*);
+static int ldt_nl_set_rxsteer (struct sk_buff*, struct genl_info*);
+static int ldt_nl_set_rebind (struct sk_buff*, struct genl_info*);
+static int ldt_nl_set_aead (struct sk_buff*, struct genl_info*);
+static int ldt_nl_set_pace (struct sk_buff*, struct genl_info*);
+static int ldt_nl_set_fec (struct sk_buff*, struct genl_info*);
+static int ldt_nl_set_paths (struct sk_buff*, struct genl_info*);
+static int ldt_nl_set_qos (struct sk_buff*, struct genl_info*);
+static int ldt_nl_subscribe_update (struct sk_buff*, struct genl_info*);
 
 static int ldt_nl_release_notifier (struct notifier_block*, unsigned long, void*);
-static int send_info (struct net*, u32, int, const char *, u32);
-static int send_ret (struct net*, u32, int);
-static int ldt_nl_adduser (u32, struct net*);
+static int send_info (struct net*, const struct nlmsghdr*, int, const char *, u32);
+static int send_ret (struct net*, const struct nlmsghdr*, int);
+struct ldt_nl_filter;
+struct ldt_nl_user;
+static int ldt_nl_adduser (u32, struct net*, struct ldt_nl_filter*);
 static void ldt_nl_rmuser (u32, struct net*);
 static void ldt_nl_rmalluser (void);
+static void ldt_nl_freeuser (struct ldt_nl_user*);
+static int ldt_nl_mkfilter (struct genl_info*, struct ldt_nl_filter**);
+static int ldt_nl_filter_match (struct ldt_nl_user*, u32, const char*, int);
+static void ldt_nl_send_event2 (struct ldt_net*, u32, const char*, u32,
+											const char*);
 static int do_send_event (struct net*, u32, u32, u32, const char*);
 
 
@@ -157,6 +183,7 @@ static const struct nla_policy ldt_nl_policy_peer[LDT_CMD_PEER_ATTR_MAX + 1] = {
 
 static const struct nla_policy ldt_nl_policy_serverstart[LDT_CMD_SERVERSTART_ATTR_MAX + 1] = {
 	[LDT_CMD_SERVERSTART_ATTR_NAME] 	= {	.type = NLA_NUL_STRING },
+	[LDT_CMD_SERVERSTART_ATTR_FLAGS]	= {	.type = NLA_U32 },
 };
 
 static const struct nla_policy ldt_nl_policy_set_mtu[LDT_CMD_SET_MTU_ATTR_MAX + 1] = {
@@ -169,6 +196,8 @@ static const struct nla_policy ldt_nl_policy_set_queue[LDT_CMD_SETQUEUE_ATTR_MAX
    [LDT_CMD_SETQUEUE_ATTR_NAME]		= { .type = NLA_NUL_STRING },
    [LDT_CMD_SETQUEUE_ATTR_TXQLEN]	= { .type = NLA_U16 },
    [LDT_CMD_SETQUEUE_ATTR_QPOLICY]	= { .type = NLA_U16 },
+   [LDT_CMD_SETQUEUE_ATTR_BANDS]	= { .type = NLA_BINARY,
+												 .len = sizeof (struct ldt_qbands) },
 };
 
 
@@ -178,7 +207,121 @@ static const struct nla_policy ldt_nl_policy_evsend[LDT_CMD_EVSEND_ATTR_MAX + 1]
 	[LDT_CMD_EVSEND_ATTR_REASON]	= { .type = NLA_U32 },
 };
 
-static const struct nla_policy ldt_nl_policy_subscribe[LDT_CMD_GET_VERSION_ATTR_MAX+1] = {};
+static const struct nla_policy ldt_nl_policy_subscribe[LDT_CMD_SUBSCRIBE_ATTR_MAX + 1] = {
+	[LDT_CMD_SUBSCRIBE_ATTR_IFLIST]	= { .type = NLA_BINARY,
+							.len = LDT_SUBSCRIBE_MAXIF * IFNAMSIZ },
+	[LDT_CMD_SUBSCRIBE_ATTR_EVMASK]	= { .type = NLA_U32 },
+};
+
+static const struct nla_policy ldt_nl_policy_peerlist[LDT_CMD_PEERLIST_ATTR_MAX + 1] = {
+	[LDT_CMD_PEERLIST_ATTR_NAME]			= { .type = NLA_NUL_STRING },
+	[LDT_CMD_PEERLIST_ATTR_LIST]			= { .type = NLA_BINARY,
+							.len = LDT_PEERLIST_MAX * sizeof (struct ldt_peeraddr) },
+	[LDT_CMD_PEERLIST_ATTR_BACKOFF_MIN]	= { .type = NLA_U32 },
+	[LDT_CMD_PEERLIST_ATTR_BACKOFF_MAX]	= { .type = NLA_U32 },
+	[LDT_CMD_PEERLIST_ATTR_LOCAL]			= { .type = NLA_BINARY,
+							.len = LDT_PEERLIST_MAX * sizeof (struct ldt_peeraddr) },
+	[LDT_CMD_PEERLIST_ATTR_FLAGS]			= { .type = NLA_U32 },
+	[LDT_CMD_PEERLIST_ATTR_STAGGER]		= { .type = NLA_U32 },
+};
+
+static const struct nla_policy ldt_nl_policy_clientroute[LDT_CMD_CLIENTROUTE_ATTR_MAX + 1] = {
+	[LDT_CMD_CLIENTROUTE_ATTR_NAME]		= { .type = NLA_NUL_STRING },
+	[LDT_CMD_CLIENTROUTE_ATTR_ADDR4]		= { .type = NLA_U32 },
+	[LDT_CMD_CLIENTROUTE_ATTR_ADDR6]		= { .type = NLA_BINARY },
+	[LDT_CMD_CLIENTROUTE_ATTR_PORT]		= { .type = NLA_U16 },
+	[LDT_CMD_CLIENTROUTE_ATTR_INNER4]	= { .type = NLA_U32 },
+	[LDT_CMD_CLIENTROUTE_ATTR_INNER6]	= { .type = NLA_BINARY },
+	[LDT_CMD_CLIENTROUTE_ATTR_PREFIXLEN]	= { .type = NLA_U8 },
+	[LDT_CMD_CLIENTROUTE_ATTR_FLAGS]		= { .type = NLA_U32 },
+};
+
+static const struct nla_policy ldt_nl_policy_get_latency[LDT_CMD_GET_LATENCY_ATTR_MAX + 1] = {
+	[LDT_CMD_GET_LATENCY_ATTR_NAME]	= { .type = NLA_NUL_STRING },
+	[LDT_CMD_GET_LATENCY_ATTR_FLAGS]	= { .type = NLA_U32 },
+};
+
+static const struct nla_policy ldt_nl_policy_set_sockopt[LDT_CMD_SET_SOCKOPT_ATTR_MAX + 1] = {
+	[LDT_CMD_SET_SOCKOPT_ATTR_NAME]		= { .type = NLA_NUL_STRING },
+	[LDT_CMD_SET_SOCKOPT_ATTR_TXCCID]	= { .type = NLA_U8 },
+	[LDT_CMD_SET_SOCKOPT_ATTR_RXCCID]	= { .type = NLA_U8 },
+	[LDT_CMD_SET_SOCKOPT_ATTR_SNDBUF]	= { .type = NLA_U32 },
+	[LDT_CMD_SET_SOCKOPT_ATTR_RCVBUF]	= { .type = NLA_U32 },
+	[LDT_CMD_SET_SOCKOPT_ATTR_SERVICE]	= { .type = NLA_U32 },
+	[LDT_CMD_SET_SOCKOPT_ATTR_CSCOV]		= { .type = NLA_U8 },
+	[LDT_CMD_SET_SOCKOPT_ATTR_FLAGS]		= { .type = NLA_U32 },
+};
+
+static const struct nla_policy ldt_nl_policy_set_rxsteer[LDT_CMD_SET_RXSTEER_ATTR_MAX + 1] = {
+	[LDT_CMD_SET_RXSTEER_ATTR_NAME]		= { .type = NLA_NUL_STRING },
+	[LDT_CMD_SET_RXSTEER_ATTR_MODE]		= { .type = NLA_U32 },
+	[LDT_CMD_SET_RXSTEER_ATTR_CPUS]		= { .type = NLA_BINARY,
+														 .len = LDT_RXSTEER_MAXCPUS / 8 },
+};
+
+static const struct nla_policy ldt_nl_policy_set_rebind[LDT_CMD_SET_REBIND_ATTR_MAX + 1] = {
+	[LDT_CMD_SET_REBIND_ATTR_NAME]		= { .type = NLA_NUL_STRING },
+	[LDT_CMD_SET_REBIND_ATTR_MODE]		= { .type = NLA_U32 },
+	[LDT_CMD_SET_REBIND_ATTR_DRAIN]		= { .type = NLA_U32 },
+};
+
+static const struct nla_policy ldt_nl_policy_set_aead[LDT_CMD_SET_AEAD_ATTR_MAX + 1] = {
+	[LDT_CMD_SET_AEAD_ATTR_NAME]		= { .type = NLA_NUL_STRING },
+	[LDT_CMD_SET_AEAD_ATTR_ALG]		= { .type = NLA_U32 },
+	[LDT_CMD_SET_AEAD_ATTR_KEY]		= { .type = NLA_BINARY,
+													 .len = LDT_AEAD_MAXKEYLEN },
+	[LDT_CMD_SET_AEAD_ATTR_KEYID]		= { .type = NLA_U8 },
+	[LDT_CMD_SET_AEAD_ATTR_FLAGS]		= { .type = NLA_U32 },
+};
+
+static const struct nla_policy ldt_nl_policy_set_pace[LDT_CMD_SET_PACE_ATTR_MAX + 1] = {
+	[LDT_CMD_SET_PACE_ATTR_NAME]		= { .type = NLA_NUL_STRING },
+	[LDT_CMD_SET_PACE_ATTR_RATE]		= { .type = NLA_U64 },
+	[LDT_CMD_SET_PACE_ATTR_BURST]		= { .type = NLA_U32 },
+	[LDT_CMD_SET_PACE_ATTR_FLAGS]		= { .type = NLA_U32 },
+};
+
+static const struct nla_policy ldt_nl_policy_set_fec[LDT_CMD_SET_FEC_ATTR_MAX + 1] = {
+	[LDT_CMD_SET_FEC_ATTR_NAME]		= { .type = NLA_NUL_STRING },
+	[LDT_CMD_SET_FEC_ATTR_MODE]		= { .type = NLA_U32 },
+	[LDT_CMD_SET_FEC_ATTR_K]			= { .type = NLA_U8 },
+	[LDT_CMD_SET_FEC_ATTR_DELAY]		= { .type = NLA_U32 },
+};
+
+static const struct nla_policy ldt_nl_policy_set_paths[LDT_CMD_SET_PATHS_ATTR_MAX + 1] = {
+	[LDT_CMD_SET_PATHS_ATTR_NAME]		= { .type = NLA_NUL_STRING },
+	[LDT_CMD_SET_PATHS_ATTR_LIST]		= { .type = NLA_BINARY,
+							.len = LDT_BOND_MAXPATH * sizeof (struct ldt_bondpath) },
+	[LDT_CMD_SET_PATHS_ATTR_REORDER]	= { .type = NLA_U32 },
+};
+
+static const struct nla_policy ldt_nl_policy_set_qos[LDT_CMD_SET_QOS_ATTR_MAX + 1] = {
+	[LDT_CMD_SET_QOS_ATTR_NAME]		= { .type = NLA_NUL_STRING },
+	[LDT_CMD_SET_QOS_ATTR_CFG]			= { .type = NLA_BINARY,
+							.len = sizeof (struct ldt_qoscfg) },
+};
+
+static const struct nla_policy ldt_nl_policy_bulk[LDT_CMD_BULK_ATTR_MAX + 1] = {
+	[LDT_CMD_BULK_ATTR_LIST]		= { .type = NLA_NESTED },
+	[LDT_CMD_BULK_ATTR_FLAGS]		= { .type = NLA_U32 },
+};
+
+static const struct nla_policy ldt_nl_policy_bulkdev[LDT_BULKDEV_ATTR_MAX + 1] = {
+	[LDT_BULKDEV_ATTR_NAME]			= { .type = NLA_NUL_STRING },
+	[LDT_BULKDEV_ATTR_DEVFLAGS]	= { .type = NLA_U32 },
+	[LDT_BULKDEV_ATTR_TUN_TYPE]	= { .type = NLA_NUL_STRING },
+	[LDT_BULKDEV_ATTR_LADDR4]		= { .type = NLA_U32 },
+	[LDT_BULKDEV_ATTR_LADDR6]		= { .type = NLA_BINARY },
+	[LDT_BULKDEV_ATTR_LPORT]		= { .type = NLA_U16 },
+	[LDT_BULKDEV_ATTR_BIND2DEV]	= { .type = NLA_NUL_STRING },
+	[LDT_BULKDEV_ATTR_RADDR4]		= { .type = NLA_U32 },
+	[LDT_BULKDEV_ATTR_RADDR6]		= { .type = NLA_BINARY },
+	[LDT_BULKDEV_ATTR_RPORT]		= { .type = NLA_U16 },
+	[LDT_BULKDEV_ATTR_SERVER]		= { .type = NLA_U32 },
+	[LDT_BULKDEV_ATTR_TXQLEN]		= { .type = NLA_U16 },
+	[LDT_BULKDEV_ATTR_QPOLICY]		= { .type = NLA_U16 },
+	[LDT_BULKDEV_ATTR_MTU]			= { .type = NLA_U32 },
+};
 
 
 static const struct genl_ops ldt_nl_ops[] = {
@@ -278,6 +421,84 @@ static const struct genl_ops ldt_nl_ops[] = {
 		.policy = ldt_nl_policy_subscribe,
 		/* can be retrieved by unprivileged users */
 	},
+	{
+		.cmd = LDT_CMD_PEERLIST,
+		.flags = GENL_ADMIN_PERM,
+		.doit = ldt_nl_peerlist,
+		.policy = ldt_nl_policy_peerlist,
+	},
+	{
+		.cmd = LDT_CMD_CLIENTROUTE,
+		.flags = GENL_ADMIN_PERM,
+		.doit = ldt_nl_clientroute,
+		.policy = ldt_nl_policy_clientroute,
+	},
+	{
+		.cmd = LDT_CMD_BULK,
+		.flags = GENL_ADMIN_PERM,
+		.doit = ldt_nl_bulk,
+		.policy = ldt_nl_policy_bulk,
+	},
+	{
+		.cmd = LDT_CMD_GET_LATENCY,
+		.flags = GENL_ADMIN_PERM,
+		.doit = ldt_nl_get_latency,
+		.policy = ldt_nl_policy_get_latency,
+	},
+	{
+		.cmd = LDT_CMD_SET_SOCKOPT,
+		.flags = GENL_ADMIN_PERM,
+		.doit = ldt_nl_set_sockopt,
+		.policy = ldt_nl_policy_set_sockopt,
+	},
+	{
+		.cmd = LDT_CMD_SET_RXSTEER,
+		.flags = GENL_ADMIN_PERM,
+		.doit = ldt_nl_set_rxsteer,
+		.policy = ldt_nl_policy_set_rxsteer,
+	},
+	{
+		.cmd = LDT_CMD_SET_REBIND,
+		.flags = GENL_ADMIN_PERM,
+		.doit = ldt_nl_set_rebind,
+		.policy = ldt_nl_policy_set_rebind,
+	},
+	{
+		.cmd = LDT_CMD_SET_AEAD,
+		.flags = GENL_ADMIN_PERM,
+		.doit = ldt_nl_set_aead,
+		.policy = ldt_nl_policy_set_aead,
+	},
+	{
+		.cmd = LDT_CMD_SET_PACE,
+		.flags = GENL_ADMIN_PERM,
+		.doit = ldt_nl_set_pace,
+		.policy = ldt_nl_policy_set_pace,
+	},
+	{
+		.cmd = LDT_CMD_SET_FEC,
+		.flags = GENL_ADMIN_PERM,
+		.doit = ldt_nl_set_fec,
+		.policy = ldt_nl_policy_set_fec,
+	},
+	{
+		.cmd = LDT_CMD_SET_PATHS,
+		.flags = GENL_ADMIN_PERM,
+		.doit = ldt_nl_set_paths,
+		.policy = ldt_nl_policy_set_paths,
+	},
+	{
+		.cmd = LDT_CMD_SET_QOS,
+		.flags = GENL_ADMIN_PERM,
+		.doit = ldt_nl_set_qos,
+		.policy = ldt_nl_policy_set_qos,
+	},
+	{
+		.cmd = LDT_CMD_SUBSCRIBE_UPDATE,
+		.doit = ldt_nl_subscribe_update,
+		.policy = ldt_nl_policy_subscribe,
+		/* as subscribe - only changes the callers own subscription */
+	},
 };
 
 static struct genl_family ldt_nl_family = {
@@ -301,19 +522,26 @@ static struct notifier_block ldt_netlink_notifier = {
         .notifier_call = ldt_nl_release_notifier
 };
 
+/* event filter of a subscriber - NULL filter passes all events */
+struct ldt_nl_filter {
+	struct rcu_head			rcu;
+	u32							evmask;		/* 0 - all event types */
+	int							nif;			/* 0 - all interfaces */
+	char							iface[LDT_SUBSCRIBE_MAXIF][IFNAMSIZ];
+	int							ifindex[LDT_SUBSCRIBE_MAXIF];	/* 0 - by name */
+};
+
 struct ldt_nl_user {
 	struct list_head			list;
 	struct list_head			dellist;
 	u32							pid;
 	struct net					*net;
 	int							valid;
+	struct ldt_nl_filter __rcu	*filter;
 };
 
 #define LDT_NL_USER_NULL ((struct ldt_nl_user) { .valid = 0, })
 
-//static struct list_head	tpnl_head = (struct list_head) { .next = &tpnl_head, .prev = &tpnl_head };
-static struct list_head	tpnl_head;
-
 
 int
 ldt_nl_register (void)
@@ -324,7 +552,6 @@ ldt_nl_register (void)
 	int					nops = ARRAY_SIZE (ldt_nl_ops);
 #endif
 
-	INIT_LIST_HEAD (&tpnl_head);
 #if LINUX_VERSION_CODE < KERNEL_VERSION(3,13,0) 
 	ops = kmalloc (sizeof (struct genl_ops)*nops, GFP_KERNEL);
 	if (!ops) return -ENOMEM;
@@ -367,7 +594,6 @@ ldt_nl_create_dev (skb, info)
 	struct genl_info	*info;
 {
 	const char					*name;
-	u32							pid;
 	const struct nlmsghdr	*nlh;
 	const struct nlattr		*attr;
 	struct net					*net;
@@ -378,7 +604,6 @@ ldt_nl_create_dev (skb, info)
 	if (!info) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
 	attr = info->attrs[LDT_CMD_CREATE_DEV_ATTR_NAME];
@@ -397,8 +622,8 @@ ldt_nl_create_dev (skb, info)
 	tp_debug ("add device %s (flags=%x)\n",
 						name?name:"tp%d", flags);
 	ret = ldt_create_dev (net, name, &name, flags);
-	if (ret < 0 || !name || !*name) return send_ret (net, pid, ret);
-	return send_info (net, pid, 0, name, strlen (name) + 1);
+	if (ret < 0 || !name || !*name) return send_ret (net, nlh, ret);
+	return send_info (net, nlh, 0, name, strlen (name) + 1);
 }
 
 static
@@ -408,7 +633,6 @@ ldt_nl_rm_dev (skb, info)
 	struct genl_info	*info;
 {
 	const char					*name;
-	u32							pid;
 	const struct nlmsghdr	*nlh;
 	const struct nlattr		*attr;
 	struct net					*net;
@@ -417,15 +641,14 @@ ldt_nl_rm_dev (skb, info)
 	if (!info) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
 	attr = info->attrs[LDT_CMD_RM_DEV_ATTR_NAME];
-	if (!attr) return send_ret (net, pid, -EINVAL);
+	if (!attr) return send_ret (net, nlh, -EINVAL);
 	name = (const char*)nla_data (attr);
 	tp_debug ("remove device %s\n", name);
 	ldt_free_dev (LDTDEV_BYNAME (net, name));
-	return send_ret (net, pid, 0);
+	return send_ret (net, nlh, 0);
 }
 
 static
@@ -434,7 +657,6 @@ ldt_nl_get_version (skb, info)
 	struct sk_buff		*skb;
 	struct genl_info	*info;
 {
-	u32							pid;
 	const struct nlmsghdr	*nlh;
 	struct net					*net;
 	int							ret;
@@ -442,12 +664,11 @@ ldt_nl_get_version (skb, info)
 	if (!skb) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	if (!info) return -EINVAL;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
 	tp_debug ("return ldt version %s", LDT_VERSION);
-	ret = send_info (net, pid, 0, LDT_VERSION, strlen (LDT_VERSION)+1);
+	ret = send_info (net, nlh, 0, LDT_VERSION, strlen (LDT_VERSION)+1);
 	if (ret < 0) return ret;
 	return 0;
 }
@@ -458,7 +679,6 @@ ldt_nl_get_devlist (skb, info)
 	struct sk_buff		*skb;
 	struct genl_info	*info;
 {
-	u32							pid;
 	const struct nlmsghdr	*nlh;
 	struct net					*net;
 	int							ret;
@@ -468,14 +688,13 @@ ldt_nl_get_devlist (skb, info)
 	if (!skb) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	if (!info) return -EINVAL;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
 	tp_debug ("show info for all devices\n");
 	ret = ldt_get_devlist (net, &data, &len);
-	if (ret < 0) return send_ret (net, pid, ret);
-	ret = send_info (net, pid, 0, data, len);
+	if (ret < 0) return send_ret (net, nlh, ret);
+	ret = send_info (net, nlh, 0, data, len);
 	kfree (data);
 	if (ret < 0) return ret;
 	return 0;
@@ -487,7 +706,6 @@ ldt_nl_show_dev (skb, info)
 	struct sk_buff		*skb;
 	struct genl_info	*info;
 {
-	u32							pid;
 	const struct nlmsghdr	*nlh;
 	const struct nlattr		*attr;
 	const char					*name;
@@ -500,22 +718,21 @@ ldt_nl_show_dev (skb, info)
 	if (!skb) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	if (!info) return -EINVAL;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
 	attr = info->attrs[LDT_CMD_SHOW_DEV_ATTR_NAME];
-	if (!attr) return send_ret (net, pid, -EINVAL);
+	if (!attr) return send_ret (net, nlh, -EINVAL);
 	name = (const char*)nla_data (attr);
-	if (!name || !*name) return send_ret (net, pid, -EINVAL);
+	if (!name || !*name) return send_ret (net, nlh, -EINVAL);
 	tp_debug ("show dev [%s]", name);
 	tdev = LDTDEV_BYNAME (net, name);
-	if (!tdev) return send_ret (net, pid, -EINVAL);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
 	ret = ldt_get_devinfo (tdev, &data);
 	dev_put (tdev->ndev);
-	if (ret < 0) return send_ret (net, pid, ret);
+	if (ret < 0) return send_ret (net, nlh, ret);
 	len = (u32)ret;
-	ret = send_info (net, pid, 0, data, len);
+	ret = send_info (net, nlh, 0, data, len);
 	kfree (data);
 	if (ret < 0) return ret;
 	return 0;
@@ -527,7 +744,6 @@ ldt_nl_show_devlist (skb, info)
 	struct sk_buff		*skb;
 	struct genl_info	*info;
 {
-	u32							pid;
 	const struct nlmsghdr	*nlh;
 	struct net					*net;
 	ssize_t						ret;
@@ -537,15 +753,14 @@ ldt_nl_show_devlist (skb, info)
 	if (!skb) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	if (!info) return -EINVAL;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
 	tp_debug ("show info for all devices\n");
 	ret = ldt_get_alldevinfo (net, &data);
-	if (ret < 0) return send_ret (net, pid, ret);
+	if (ret < 0) return send_ret (net, nlh, ret);
 	len = (u32)ret;
-	ret = send_info (net, pid, 0, data, len);
+	ret = send_info (net, nlh, 0, data, len);
 	kfree (data);
 	if (ret < 0) return ret;
 	return 0;
@@ -557,7 +772,6 @@ ldt_nl_rm_tun (skb, info)
 	struct sk_buff		*skb;
 	struct genl_info	*info;
 {
-	u32							pid;
 	const struct nlmsghdr	*nlh;
 	const struct nlattr		*attr;
 	const char					*name;
@@ -568,19 +782,18 @@ ldt_nl_rm_tun (skb, info)
 	if (!skb) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	if (!info) return -EINVAL;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
 	attr = info->attrs[LDT_CMD_RM_TUN_ATTR_NAME];
-	if (!attr) return send_ret (net, pid, -EINVAL);
+	if (!attr) return send_ret (net, nlh, -EINVAL);
 	name = (const char*)nla_data (attr);
 	tp_debug ("remove tunnel [%s]", name);
 	tdev = LDTDEV_BYNAME (net, name);
-	if (!tdev) return send_ret (net, pid, -EINVAL);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
 	ret = ldt_rm_tun (tdev);
 	dev_put (tdev->ndev);
-	return send_ret (net, pid, ret);
+	return send_ret (net, nlh, ret);
 }
 
 
@@ -590,7 +803,6 @@ ldt_nl_newtun (skb, info)
 	struct sk_buff		*skb;
 	struct genl_info	*info;
 {
-	u32							pid;
 	const struct nlmsghdr	*nlh;
 	const struct nlattr		*attr;
 	struct net					*net;
@@ -602,22 +814,21 @@ ldt_nl_newtun (skb, info)
 	if (!skb) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	if (!info) return -EINVAL;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
 	attr = info->attrs[LDT_CMD_NEWTUN_ATTR_NAME];
-	if (!attr) return send_ret (net, pid, -EINVAL);
+	if (!attr) return send_ret (net, nlh, -EINVAL);
 	name = (const char*)nla_data (attr);
 	attr = info->attrs[LDT_CMD_NEWTUN_ATTR_TUN_TYPE];
-	if (!attr) return send_ret (net, pid, -EINVAL);
+	if (!attr) return send_ret (net, nlh, -EINVAL);
 	tuntype = (const char*)nla_data (attr);
 	tp_debug ("create new tunnel [%s] of type %s\n", name, tuntype);
 	tdev = LDTDEV_BYNAME (net, name);
-	if (!tdev) return send_ret (net, pid, -EINVAL);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
 	ret = ldt_dev_newtun (	tdev, tuntype);
 	dev_put (tdev->ndev);
-	return send_ret (net, pid, ret);
+	return send_ret (net, nlh, ret);
 }
 
 static
@@ -626,7 +837,7 @@ ldt_nl_bind (skb, info)
 	struct sk_buff		*skb;
 	struct genl_info	*info;
 {
-	u32							pid, addr4;
+	u32							addr4;
 	u8								addr6[16];
 	u16							port=0;
 	tp_addr_t					laddr;
@@ -641,12 +852,11 @@ ldt_nl_bind (skb, info)
 	if (!skb) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	if (!info) return -EINVAL;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
 	attr = info->attrs[LDT_CMD_BIND_ATTR_NAME];
-	if (!attr) return send_ret (net, pid, -EINVAL);
+	if (!attr) return send_ret (net, nlh, -EINVAL);
 	name = (const char*)nla_data (attr);
 	hasladdr = 0;
 	attr = info->attrs[LDT_CMD_BIND_ATTR_ADDR4];
@@ -657,7 +867,7 @@ ldt_nl_bind (skb, info)
 	} else {
 		attr = info->attrs[LDT_CMD_BIND_ATTR_ADDR6];
 		if (attr) {
-			if (nla_len(attr) != 16) return send_ret (net, pid, -EINVAL);
+			if (nla_len(attr) != 16) return send_ret (net, nlh, -EINVAL);
 			memcpy (addr6, nla_data (attr), 16);
 			hasladdr = 1;
 			ipv6 = 1;
@@ -665,7 +875,7 @@ ldt_nl_bind (skb, info)
 	}
 	if (hasladdr) {
 		attr = info->attrs[LDT_CMD_BIND_ATTR_PORT];
-		if (!attr) return send_ret (net, pid, -EINVAL);
+		if (!attr) return send_ret (net, nlh, -EINVAL);
 		port = nla_get_u16 (attr);
 		if (!ipv6) {
 			tp_addr_setipv4 (&laddr, addr4, port);
@@ -684,13 +894,13 @@ ldt_nl_bind (skb, info)
 	tdev = LDTDEV_BYNAME (net, name);
 	if (!tdev) {
 		tp_note ("cannot find device %s\n", name);
-		return send_ret (net, pid, -EINVAL);
+		return send_ret (net, nlh, -EINVAL);
 	}
 	tp_debug2 ("call ldt_dev_bind\n");
 	ret = ldt_dev_bind (tdev, &laddr);
 	dev_put (tdev->ndev);
 	tp_debug ("done -> %d\n", ret);
-	return send_ret (net, pid, ret);
+	return send_ret (net, nlh, ret);
 }
 
 static
@@ -699,7 +909,6 @@ ldt_nl_bind2dev (skb, info)
 	struct sk_buff		*skb;
 	struct genl_info	*info;
 {
-	u32							pid;
 	const char					*dev;
 	const struct nlmsghdr	*nlh;
 	const struct nlattr		*attr;
@@ -711,28 +920,27 @@ ldt_nl_bind2dev (skb, info)
 	if (!skb) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	if (!info) return -EINVAL;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
 	attr = info->attrs[LDT_CMD_BIND2DEV_ATTR_NAME];
-	if (!attr) return send_ret (net, pid, -EINVAL);
+	if (!attr) return send_ret (net, nlh, -EINVAL);
 	name = (const char*)nla_data (attr);
 	attr = info->attrs[LDT_CMD_BIND2DEV_ATTR_DEV];
-	if (!attr) return send_ret (net, pid, -EINVAL);
+	if (!attr) return send_ret (net, nlh, -EINVAL);
 	dev = (const char*)nla_data (attr);
 	
 	tp_debug ("bind tunnel [%s] to dev %s", name, dev);
 	tdev = LDTDEV_BYNAME (net, name);
 	if (!tdev) {
 		tp_note ("cannot find device %s\n", name);
-		return send_ret (net, pid, -EINVAL);
+		return send_ret (net, nlh, -EINVAL);
 	}
 	tp_debug2 ("call ldt_dev_bind2dev\n");
 	ret = ldt_dev_bind2dev (tdev, dev);
 	dev_put (tdev->ndev);
 	tp_debug ("done -> %d\n", ret);
-	return send_ret (net, pid, ret);
+	return send_ret (net, nlh, ret);
 }
 
 static
@@ -741,7 +949,7 @@ ldt_nl_peer (skb, info)
 	struct sk_buff		*skb;
 	struct genl_info	*info;
 {
-	u32							pid, addr4;
+	u32							addr4;
 	u8								addr6[16];
 	u16							port;
 	tp_addr_t					raddr;
@@ -757,12 +965,11 @@ ldt_nl_peer (skb, info)
 	if (!skb) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	if (!info) return -EINVAL;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
 	attr = info->attrs[LDT_CMD_PEER_ATTR_NAME];
-	if (!attr) return send_ret (net, pid, -EINVAL);
+	if (!attr) return send_ret (net, nlh, -EINVAL);
 	name = (const char*)nla_data (attr);
 	attr = info->attrs[LDT_CMD_PEER_ATTR_ADDR4];
 	if (attr) {
@@ -771,14 +978,14 @@ ldt_nl_peer (skb, info)
 	} else {
 		attr = info->attrs[LDT_CMD_PEER_ATTR_ADDR6];
 		if (attr) {
-			if (nla_len(attr) != 16) return send_ret (net, pid, -EINVAL);
+			if (nla_len(attr) != 16) return send_ret (net, nlh, -EINVAL);
 			memcpy (addr6, nla_data (attr), 16);
 			ipv6 = 1;
 		}
 	}
 	if (attr) {
 		attr = info->attrs[LDT_CMD_PEER_ATTR_PORT];
-		if (!attr) return send_ret (net, pid, -EINVAL);
+		if (!attr) return send_ret (net, nlh, -EINVAL);
 		port = nla_get_u16 (attr);
 		if (!ipv6) {
 			tp_addr_setipv4 (&raddr, addr4, port);
@@ -791,10 +998,10 @@ ldt_nl_peer (skb, info)
 	}
 	tp_debug ("tunnel [%s] peer is %pISc\n", name, &raddr);
 	tdev = LDTDEV_BYNAME (net, name);
-	if (!tdev) return send_ret (net, pid, -EINVAL);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
 	ret = ldt_dev_peer (tdev, hasaddr ? &raddr : NULL);
 	dev_put (tdev->ndev);
-	return send_ret (net, pid, ret);
+	return send_ret (net, nlh, ret);
 }
 
 static
@@ -803,30 +1010,31 @@ ldt_nl_serverstart (skb, info)
 	struct sk_buff		*skb;
 	struct genl_info	*info;
 {
-	u32							pid;
 	const struct nlmsghdr	*nlh;
 	const struct nlattr		*attr;
 	const char					*name;
 	struct net					*net;
 	int							ret;
+	int							flags = 0;
 	struct ldt_dev		*tdev;
 
 	if (!skb) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	if (!info) return -EINVAL;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
 	attr = info->attrs[LDT_CMD_SERVERSTART_ATTR_NAME];
-	if (!attr) return send_ret (net, pid, -EINVAL);
+	if (!attr) return send_ret (net, nlh, -EINVAL);
 	name = (const char*)nla_data (attr);
-	tp_debug ("start server [%s]\n", name);
+	attr = info->attrs[LDT_CMD_SERVERSTART_ATTR_FLAGS];
+	if (attr) flags = (int)nla_get_u32 (attr);
+	tp_debug ("start server [%s] (flags=0x%x)\n", name, flags);
 	tdev = LDTDEV_BYNAME (net, name);
-	if (!tdev) return send_ret (net, pid, -EINVAL);
-	ret = ldt_dev_serverstart (tdev);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
+	ret = ldt_dev_serverstart (tdev, flags);
 	dev_put (tdev->ndev);
-	return send_ret (net, pid, ret);
+	return send_ret (net, nlh, ret);
 }
 
 
@@ -837,7 +1045,6 @@ ldt_nl_set_mtu (skb, info)
 	struct genl_info	*info;
 {
 	const char					*name;
-	u32							pid;
 	const struct nlmsghdr	*nlh;
 	const struct nlattr		*attr;
 	struct net					*net;
@@ -849,21 +1056,20 @@ ldt_nl_set_mtu (skb, info)
 	if (!info) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
 	attr = info->attrs[LDT_CMD_SET_MTU_ATTR_NAME];
-	if (!attr) return send_ret (net, pid, -EINVAL);
+	if (!attr) return send_ret (net, nlh, -EINVAL);
 	name = (const char*)nla_data (attr);
 	attr = info->attrs[LDT_CMD_SET_MTU_ATTR_MTU];
-	if (!attr) return send_ret (net, pid, -EINVAL);
+	if (!attr) return send_ret (net, nlh, -EINVAL);
 	mtu = nla_get_u32 (attr);
 	tp_debug ("set mtu on device %s\n", name?name:"???");
 	tdev = LDTDEV_BYNAME (net, name);
-	if (!tdev) return send_ret (net, pid, -EINVAL);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
 	ret = ldt_dev_set_mtu (tdev, mtu);
 	dev_put (tdev->ndev);
-	return send_ret (net, pid, ret);
+	return send_ret (net, nlh, ret);
 }
 
 static
@@ -873,9 +1079,9 @@ ldt_nl_set_queue (skb, info)
 	struct genl_info	*info;
 {
 	const char					*name;
-	u32							pid;
 	int							txqlen;
 	int							qpolicy;
+	struct ldt_qbands			bands, *pbands = NULL;
 	const struct nlmsghdr	*nlh;
 	const struct nlattr		*attr;
 	struct net					*net;
@@ -886,11 +1092,10 @@ ldt_nl_set_queue (skb, info)
 	if (!info) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
 	attr = info->attrs[LDT_CMD_SETQUEUE_ATTR_NAME];
-	if (!attr) return send_ret (net, pid, -EINVAL);
+	if (!attr) return send_ret (net, nlh, -EINVAL);
 	name = (const char*)nla_data (attr);
 	attr = info->attrs[LDT_CMD_SETQUEUE_ATTR_TXQLEN];
 	if (!attr) {
@@ -905,163 +1110,1075 @@ ldt_nl_set_queue (skb, info)
 		qpolicy = (int)(unsigned)nla_get_u16 (attr);
 		if (qpolicy > LDT_CMD_SETQUEUE_QPOLICY_MAX) {
 			tp_note ("invalid queueing policy %d\n", qpolicy);
-			return send_ret (net, pid, -ERANGE);
+			return send_ret (net, nlh, -ERANGE);
 		}
 	}
-	tp_debug ("set queue (txqlen = %d, qpolicy = %d)", txqlen, qpolicy);
+	attr = info->attrs[LDT_CMD_SETQUEUE_ATTR_BANDS];
+	if (attr) {
+		if (nla_len (attr) != sizeof (struct ldt_qbands))
+			return send_ret (net, nlh, -EINVAL);
+		memcpy (&bands, nla_data (attr), sizeof (struct ldt_qbands));
+		pbands = &bands;
+	}
+	tp_debug ("set queue (txqlen = %d, qpolicy = %d, bands = %d)", txqlen,
+					qpolicy, pbands ? pbands->nbands : 0);
 	tdev = LDTDEV_BYNAME (net, name);
-	if (!tdev) return send_ret (net, pid, -EINVAL);
-	ret = ldt_dev_setqueue (tdev, txqlen, qpolicy);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
+	ret = ldt_dev_setqueue (tdev, txqlen, qpolicy, pbands);
 	dev_put (tdev->ndev);
-	return send_ret (net, pid, ret);
+	return send_ret (net, nlh, ret);
 }
 
-
 static
 int
-ldt_nl_evsend (skb, info)
+ldt_nl_peerlist (skb, info)
 	struct sk_buff		*skb;
 	struct genl_info	*info;
 {
 	const char					*name;
-	u32							pid;
 	const struct nlmsghdr	*nlh;
 	const struct nlattr		*attr;
 	struct net					*net;
+	struct ldt_dev				*tdev;
+	struct ldt_peeraddr		*pa;
+	tp_addr_t					list[LDT_PEERLIST_MAX];
+	tp_addr_t					local[LDT_PEERLIST_MAX];
+	int							num = 0, nlocal = 0, i;
+	int							bmin = -1, bmax = -1, stagger = -1;
+	u32							flags = 0;
 	int							ret;
-	struct ldt_dev		*tdev;
-	u32							reason;
-	u32							evtype;
 
 	if (!skb) return -EINVAL;
 	if (!info) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
-	attr = info->attrs[LDT_CMD_EVSEND_ATTR_NAME];
-	if (!attr) return send_ret (net, pid, -EINVAL);
+	attr = info->attrs[LDT_CMD_PEERLIST_ATTR_NAME];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
 	name = (const char*)nla_data (attr);
-	attr = info->attrs[LDT_CMD_EVSEND_ATTR_EVTYPE];
-	if (!attr) return send_ret (net, pid, -EINVAL);
-	evtype = nla_get_u32 (attr);
-	attr = info->attrs[LDT_CMD_EVSEND_ATTR_REASON];
-	if (!attr) return send_ret (net, pid, -EINVAL);
-	reason = nla_get_u32 (attr);
-	tp_debug ("send event %d for device %s\n", 
-					evtype, name?name:"???");
+	attr = info->attrs[LDT_CMD_PEERLIST_ATTR_LIST];
+	if (attr) {
+		if (nla_len (attr) % sizeof (struct ldt_peeraddr))
+			return send_ret (net, nlh, -EINVAL);
+		num = nla_len (attr) / sizeof (struct ldt_peeraddr);
+		if (num > LDT_PEERLIST_MAX) return send_ret (net, nlh, -ERANGE);
+		pa = (struct ldt_peeraddr*)nla_data (attr);
+		for (i=0; i<num; i++) {
+			if (!pa[i].ipv6) {
+				tp_addr_setipv4 (&list[i], pa[i].addr.v4, pa[i].port);
+			} else {
+				tp_addr_setipv6 (&list[i], pa[i].addr.v6, pa[i].port);
+			}
+		}
+	}
+	attr = info->attrs[LDT_CMD_PEERLIST_ATTR_LOCAL];
+	if (attr) {
+		if (nla_len (attr) != num * (int)sizeof (struct ldt_peeraddr))
+			return send_ret (net, nlh, -EINVAL);
+		nlocal = num;
+		pa = (struct ldt_peeraddr*)nla_data (attr);
+		for (i=0; i<nlocal; i++) {
+			if (!pa[i].ipv6) {
+				tp_addr_setipv4 (&local[i], pa[i].addr.v4, pa[i].port);
+			} else {
+				tp_addr_setipv6 (&local[i], pa[i].addr.v6, pa[i].port);
+			}
+			/* unset entry - use tunnel address */
+			if (!pa[i].port && tp_addr_isany (&local[i]))
+				local[i].ad.sa_family = AF_UNSPEC;
+		}
+	}
+	attr = info->attrs[LDT_CMD_PEERLIST_ATTR_BACKOFF_MIN];
+	if (attr) bmin = (int)nla_get_u32 (attr);
+	attr = info->attrs[LDT_CMD_PEERLIST_ATTR_BACKOFF_MAX];
+	if (attr) bmax = (int)nla_get_u32 (attr);
+	attr = info->attrs[LDT_CMD_PEERLIST_ATTR_FLAGS];
+	if (attr) flags = nla_get_u32 (attr);
+	attr = info->attrs[LDT_CMD_PEERLIST_ATTR_STAGGER];
+	if (attr) stagger = (int)nla_get_u32 (attr);
+	tp_debug ("tunnel [%s] set %d peer candidates\n", name, num);
 	tdev = LDTDEV_BYNAME (net, name);
-	if (!tdev) return send_ret (net, pid, -EINVAL);
-	ret = ldt_dev_evsend (tdev, evtype, reason);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
+	ret = ldt_dev_peerlist (tdev, list, nlocal ? local : NULL, num, bmin, bmax,
+									flags, stagger);
 	dev_put (tdev->ndev);
-	return send_ret (net, pid, ret);
+	return send_ret (net, nlh, ret);
 }
 
-
-
 static
 int
-ldt_nl_subscribe (skb, info)
+ldt_nl_clientroute (skb, info)
 	struct sk_buff		*skb;
 	struct genl_info	*info;
 {
-	u32							pid;
+	const char					*name;
 	const struct nlmsghdr	*nlh;
+	const struct nlattr		*attr;
 	struct net					*net;
+	struct ldt_dev				*tdev;
+	tp_addr_t					raddr, inner;
+	u16							port = 0;
+	int							plen = -1, flags = 0;
 	int							ret;
 
 	if (!skb) return -EINVAL;
 	if (!info) return -EINVAL;
 	nlh = nlmsg_hdr(skb);
 	if (!nlh) return -EINVAL;
-	pid = nlh->nlmsg_pid;
 	net = genl_info_net (info);
 	if (!net) return -EINVAL;
-	tp_debug ("got event subscription");
-	ret = ldt_nl_adduser (pid, net);
-	return send_ret (net, pid, ret);
+	attr = info->attrs[LDT_CMD_CLIENTROUTE_ATTR_NAME];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
+	name = (const char*)nla_data (attr);
+	attr = info->attrs[LDT_CMD_CLIENTROUTE_ATTR_FLAGS];
+	if (attr) flags = (int)nla_get_u32 (attr);
+	attr = info->attrs[LDT_CMD_CLIENTROUTE_ATTR_PORT];
+	if (attr) port = nla_get_u16 (attr);
+	if ((attr = info->attrs[LDT_CMD_CLIENTROUTE_ATTR_ADDR4])) {
+		tp_addr_setipv4 (&raddr, nla_get_u32 (attr), port);
+	} else if ((attr = info->attrs[LDT_CMD_CLIENTROUTE_ATTR_ADDR6])) {
+		if (nla_len(attr) != 16) return send_ret (net, nlh, -EINVAL);
+		tp_addr_setipv6 (&raddr, nla_data (attr), port);
+	} else {
+		return send_ret (net, nlh, -EINVAL);
+	}
+	if ((attr = info->attrs[LDT_CMD_CLIENTROUTE_ATTR_INNER4])) {
+		tp_addr_setipv4 (&inner, nla_get_u32 (attr), 0);
+	} else if ((attr = info->attrs[LDT_CMD_CLIENTROUTE_ATTR_INNER6])) {
+		if (nla_len(attr) != 16) return send_ret (net, nlh, -EINVAL);
+		tp_addr_setipv6 (&inner, nla_data (attr), 0);
+	} else if (!(flags & LDT_CLIENTROUTE_F_DEL)) {
+		return send_ret (net, nlh, -EINVAL);
+	}
+	attr = info->attrs[LDT_CMD_CLIENTROUTE_ATTR_PREFIXLEN];
+	if (attr) plen = (int)nla_get_u8 (attr);
+	tp_debug ("tunnel [%s] %s client route for %pISpc\n", name,
+					(flags & LDT_CLIENTROUTE_F_DEL) ? "delete" : "set", &raddr.ad);
+	tdev = LDTDEV_BYNAME (net, name);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
+	ret = ldt_dev_clientroute (tdev, &raddr, &inner, plen, flags);
+	dev_put (tdev->ndev);
+	return send_ret (net, nlh, ret);
+}
+
+static
+int
+bulk_getaddr (tb, a4, a6, aport, addr)
+	struct nlattr	**tb;
+	int				a4, a6, aport;
+	tp_addr_t		*addr;
+{
+	u16	port;
+
+	port = tb[aport] ? nla_get_u16 (tb[aport]) : 0;
+	if (tb[a4]) {
+		tp_addr_setipv4 (addr, nla_get_u32 (tb[a4]), port);
+	} else if (tb[a6]) {
+		if (nla_len (tb[a6]) != 16) return -EINVAL;
+		tp_addr_setipv6 (addr, nla_data (tb[a6]), port);
+	} else if (tb[aport]) {
+		/* port only - bind to any address */
+		tp_addr_setipv4 (addr, 0, port);
+	} else {
+		return 0;
+	}
+	return 1;
 }
 
+static
+void
+ldt_nl_bulk_one (net, nla, flags, res)
+	struct net				*net;
+	struct nlattr			*nla;
+	int						flags;
+	struct ldt_bulkres	*res;
+{
+	struct nlattr			*tb[LDT_BULKDEV_ATTR_MAX+1];
+	struct net_device		*ndev;
+	struct ldt_dev			*tdev = NULL;
+	const char				*name = NULL, *oname;
+	tp_addr_t				addr;
+	int						ret, created = 0;
+	int						txqlen, qpolicy;
+
+	res->step = LDT_BULK_STEP_PARSE;
+	if (nla_type (nla) != LDT_BULK_ATTR_DEV) {
+		ret = -EINVAL;
+		goto out;
+	}
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4,12,0)
+	ret = nla_parse_nested (tb, LDT_BULKDEV_ATTR_MAX, nla,
+									ldt_nl_policy_bulkdev);
+#else
+	ret = nla_parse_nested (tb, LDT_BULKDEV_ATTR_MAX, nla,
+									ldt_nl_policy_bulkdev, NULL);
+#endif
+	if (ret < 0) goto out;
+	if (tb[LDT_BULKDEV_ATTR_SERVER] && (tb[LDT_BULKDEV_ATTR_RADDR4] ||
+				tb[LDT_BULKDEV_ATTR_RADDR6] || tb[LDT_BULKDEV_ATTR_RPORT])) {
+		/* either server or client - not both */
+		ret = -EINVAL;
+		goto out;
+	}
+	if (tb[LDT_BULKDEV_ATTR_NAME]) {
+		name = (const char*)nla_data (tb[LDT_BULKDEV_ATTR_NAME]);
+		if (!*name) name = NULL;
+	}
+	if (name) strncpy (res->name, name, sizeof (res->name) - 1);
+
+	/* get or create device */
+	res->step = LDT_BULK_STEP_CREATE;
+	if (name && (flags & LDT_BULK_F_EXIST)) {
+		ndev = dev_get_by_name (net, name);
+		if (ndev) {
+			tdev = LDTDEV (ndev);
+			if (!tdev) {
+				dev_put (ndev);
+				ret = -EEXIST;
+				goto out;
+			}
+		}
+	}
+	if (!tdev) {
+		ret = ldt_create_dev (net, name, &oname,
+						tb[LDT_BULKDEV_ATTR_DEVFLAGS] ?
+						(int)nla_get_u32 (tb[LDT_BULKDEV_ATTR_DEVFLAGS]) : 0);
+		if (ret < 0) goto out;
+		if (oname) strncpy (res->name, oname, sizeof (res->name) - 1);
+		tdev = LDTDEV_BYNAME (net, res->name);
+		if (!tdev) {
+			ret = -ENODEV;
+			goto out;
+		}
+		created = 1;
+	}
+
+	/* configure it */
+	if (tb[LDT_BULKDEV_ATTR_MTU]) {
+		res->step = LDT_BULK_STEP_MTU;
+		ret = ldt_dev_set_mtu (tdev, nla_get_u32 (tb[LDT_BULKDEV_ATTR_MTU]));
+		if (ret < 0) goto fail;
+	}
+	if (tb[LDT_BULKDEV_ATTR_TUN_TYPE]) {
+		res->step = LDT_BULK_STEP_NEWTUN;
+		ret = ldt_dev_newtun (tdev,
+						(const char*)nla_data (tb[LDT_BULKDEV_ATTR_TUN_TYPE]));
+		if (ret < 0) goto fail;
+	}
+	if (tb[LDT_BULKDEV_ATTR_TXQLEN] || tb[LDT_BULKDEV_ATTR_QPOLICY]) {
+		res->step = LDT_BULK_STEP_QUEUE;
+		txqlen = tb[LDT_BULKDEV_ATTR_TXQLEN] ?
+					(int)(unsigned)nla_get_u16 (tb[LDT_BULKDEV_ATTR_TXQLEN]) : -1;
+		qpolicy = tb[LDT_BULKDEV_ATTR_QPOLICY] ?
+					(int)(unsigned)nla_get_u16 (tb[LDT_BULKDEV_ATTR_QPOLICY]) : -1;
+		if (qpolicy > LDT_CMD_SETQUEUE_QPOLICY_MAX) {
+			ret = -ERANGE;
+			goto fail;
+		}
+		ret = ldt_dev_setqueue (tdev, txqlen, qpolicy, NULL);
+		if (ret < 0) goto fail;
+	}
+	res->step = LDT_BULK_STEP_BIND;
+	if (tb[LDT_BULKDEV_ATTR_BIND2DEV]) {
+		ret = ldt_dev_bind2dev (tdev,
+						(const char*)nla_data (tb[LDT_BULKDEV_ATTR_BIND2DEV]));
+		if (ret < 0) goto fail;
+	}
+	ret = bulk_getaddr (tb, LDT_BULKDEV_ATTR_LADDR4, LDT_BULKDEV_ATTR_LADDR6,
+								LDT_BULKDEV_ATTR_LPORT, &addr);
+	if (ret > 0) ret = ldt_dev_bind (tdev, &addr);
+	if (ret < 0) goto fail;
+	if (tb[LDT_BULKDEV_ATTR_SERVER]) {
+		res->step = LDT_BULK_STEP_SERVER;
+		ret = ldt_dev_serverstart (tdev,
+						(int)nla_get_u32 (tb[LDT_BULKDEV_ATTR_SERVER]));
+		if (ret < 0) goto fail;
+	} else if (tb[LDT_BULKDEV_ATTR_RADDR4] || tb[LDT_BULKDEV_ATTR_RADDR6]) {
+		res->step = LDT_BULK_STEP_PEER;
+		if (!tb[LDT_BULKDEV_ATTR_RPORT]) {
+			ret = -EINVAL;
+			goto fail;
+		}
+		ret = bulk_getaddr (tb, LDT_BULKDEV_ATTR_RADDR4,
+						LDT_BULKDEV_ATTR_RADDR6, LDT_BULKDEV_ATTR_RPORT, &addr);
+		if (ret > 0) ret = ldt_dev_peer (tdev, &addr);
+		if (ret < 0) goto fail;
+	}
+	ret = 0;
+	dev_put (tdev->ndev);
+	goto out;
+
+fail:
+	if (created && !(flags & LDT_BULK_F_NOROLLBACK)) {
+		tp_debug ("bulk: remove device %s (step %d failed: %d)\n",
+					res->name, (int)res->step, ret);
+		/* ldt_free_dev releases our reference */
+		ldt_free_dev (tdev);
+	} else {
+		dev_put (tdev->ndev);
+	}
+out:
+	res->ret = ret;
+	if (ret == 0) res->step = LDT_BULK_STEP_NONE;
+}
 
 static
 int
-ldt_nl_release_notifier (nb, action, data)
-	struct notifier_block	*nb;
-	unsigned long				action;
-	void							*data;
+ldt_nl_bulk (skb, info)
+	struct sk_buff		*skb;
+	struct genl_info	*info;
 {
-	struct netlink_notify	*n = data;
+	const struct nlmsghdr	*nlh;
+	const struct nlattr		*attr;
+	struct nlattr				*list, *pos;
+	struct net					*net;
+	struct ldt_bulkres		*res;
+	int							ret, rem, num, i, nfail;
+	int							flags = 0;
 
-	if (n && action==NETLINK_URELEASE) {
-		ldt_nl_rmuser (n->portid, n->net);
+	if (!skb) return -EINVAL;
+	nlh = nlmsg_hdr(skb);
+	if (!nlh) return -EINVAL;
+	if (!info) return -EINVAL;
+	net = genl_info_net (info);
+	if (!net) return -EINVAL;
+	list = info->attrs[LDT_CMD_BULK_ATTR_LIST];
+	if (!list) return send_ret (net, nlh, -EINVAL);
+	attr = info->attrs[LDT_CMD_BULK_ATTR_FLAGS];
+	if (attr) flags = (int)nla_get_u32 (attr);
+	num = 0;
+	nla_for_each_nested (pos, list, rem) num++;
+	if (num == 0) return send_ret (net, nlh, 0);
+	if (num > LDT_BULK_MAX) return send_ret (net, nlh, -E2BIG);
+	res = kcalloc (num, sizeof (struct ldt_bulkres), GFP_KERNEL);
+	if (!res) return send_ret (net, nlh, -ENOMEM);
+	i = nfail = 0;
+	nla_for_each_nested (pos, list, rem) {
+		if (i >= num) break;
+		ldt_nl_bulk_one (net, pos, flags, res+i);
+		if (res[i].ret < 0) nfail++;
+		i++;
 	}
-	return NOTIFY_DONE;
+	tp_debug ("bulk request: %d entries, %d failed\n", num, nfail);
+	ret = send_info (net, nlh, 0, (const char*)res,
+							num * sizeof (struct ldt_bulkres));
+	kfree (res);
+	return ret;
 }
 
 static
 int
-send_ret (net, pid, rval)
-	struct net	*net;
-	u32			pid;
-	int			rval;
+ldt_nl_get_latency (skb, info)
+	struct sk_buff		*skb;
+	struct genl_info	*info;
 {
-	int	ret;
+	const char					*name;
+	const struct nlmsghdr	*nlh;
+	const struct nlattr		*attr;
+	struct net					*net;
+	struct ldt_dev				*tdev;
+	struct ldt_latency		*lat;
+	u32							flags = 0;
+	int							ret;
 
-	tp_debug ("send return value: %d to %d\n", rval, (int) pid);
-	if (rval != 0) {
-		/* don't really send it */
-		return rval;
+	if (!skb) return -EINVAL;
+	if (!info) return -EINVAL;
+	nlh = nlmsg_hdr(skb);
+	if (!nlh) return -EINVAL;
+	net = genl_info_net (info);
+	if (!net) return -EINVAL;
+	attr = info->attrs[LDT_CMD_GET_LATENCY_ATTR_NAME];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
+	name = (const char*)nla_data (attr);
+	attr = info->attrs[LDT_CMD_GET_LATENCY_ATTR_FLAGS];
+	if (attr) flags = nla_get_u32 (attr);
+	lat = kzalloc (sizeof (struct ldt_latency), GFP_KERNEL);
+	if (!lat) return send_ret (net, nlh, -ENOMEM);
+	tdev = LDTDEV_BYNAME (net, name);
+	if (!tdev) {
+		kfree (lat);
+		return send_ret (net, nlh, -EINVAL);
 	}
-	ret = send_info (net, pid, rval, NULL, 0);
+	ret = ldt_dev_getlatency (tdev, lat, (flags & LDT_LATENCY_F_RESET) ? 1 : 0);
+	dev_put (tdev->ndev);
 	if (ret < 0) {
-		tp_err ("error sending return value (%d) to %d: %d\n",
-					rval, (int)pid, ret);
-		return ret;
+		kfree (lat);
+		return send_ret (net, nlh, ret);
 	}
-	return rval;
+	ret = send_info (net, nlh, 0, (const char*)lat, sizeof (struct ldt_latency));
+	kfree (lat);
+	return ret;
 }
 
-static int ldt_sndinfo_seq = 0;
 static
 int
-send_info (net, pid, rval, data, len)
-	struct net	*net;
-	u32			pid;
-	const char	*data;
-	u32			len;
-	int			rval;
+ldt_nl_set_sockopt (skb, info)
+	struct sk_buff		*skb;
+	struct genl_info	*info;
 {
-	struct sk_buff *skb;
-	void				*p;
-	int				ret, num;
-	u32				xval;
-	const char		*s;
+	const char					*name;
+	const struct nlmsghdr	*nlh;
+	const struct nlattr		*attr;
+	struct net					*net;
+	struct ldt_dev				*tdev;
+	struct ldt_sockopt		opt = LDT_SOCKOPT_UNSET;
+	u32							val;
+	int							ret;
 
-#define CHUNKSZ	4096
+	if (!skb) return -EINVAL;
+	if (!info) return -EINVAL;
+	nlh = nlmsg_hdr(skb);
+	if (!nlh) return -EINVAL;
+	net = genl_info_net (info);
 	if (!net) return -EINVAL;
-	tp_debug ("send data to %d\n", (int)pid);
-	if (!len && data) len = strlen (data) + 1;
-	if (!data) len = 0;
-	skb = genlmsg_new (len+(len/CHUNKSZ*4)+128, GFP_KERNEL);
-	if (!skb) return -ENOMEM;
-	/* create the message headers */
-	p = genlmsg_put (	skb, pid, ldt_sndinfo_seq++, &ldt_nl_family,
-							/* flags = */ 0, LDT_CMD_SEND_INFO);
-	if (!p) {
-		nlmsg_free (skb);
-		tp_err ("error creating message\n");
-		return -ENOMEM;
+	attr = info->attrs[LDT_CMD_SET_SOCKOPT_ATTR_NAME];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
+	name = (const char*)nla_data (attr);
+	attr = info->attrs[LDT_CMD_SET_SOCKOPT_ATTR_TXCCID];
+	if (attr) opt.txccid = nla_get_u8 (attr);
+	attr = info->attrs[LDT_CMD_SET_SOCKOPT_ATTR_RXCCID];
+	if (attr) opt.rxccid = nla_get_u8 (attr);
+	attr = info->attrs[LDT_CMD_SET_SOCKOPT_ATTR_SNDBUF];
+	if (attr) {
+		val = nla_get_u32 (attr);
+		opt.sndbuf = val > INT_MAX / 2 ? INT_MAX / 2 : (int)val;
 	}
-	/* add attribute */
-	xval = (rval < 0) ? (rval * (-1)) : rval;
-	ret = nla_put_u32 (skb, LDT_CMD_SEND_INFO_ATTR_RET, xval);
-	if (ret < 0) {
-		nlmsg_free (skb);
-		tp_err ("error creating message: %d\n", ret);
-		return ret;
+	attr = info->attrs[LDT_CMD_SET_SOCKOPT_ATTR_RCVBUF];
+	if (attr) {
+		val = nla_get_u32 (attr);
+		opt.rcvbuf = val > INT_MAX / 2 ? INT_MAX / 2 : (int)val;
 	}
-	if (data) {
+	attr = info->attrs[LDT_CMD_SET_SOCKOPT_ATTR_SERVICE];
+	if (attr) opt.service = nla_get_u32 (attr);
+	attr = info->attrs[LDT_CMD_SET_SOCKOPT_ATTR_CSCOV];
+	if (attr) {
+		opt.cscov = nla_get_u8 (attr);
+		if (opt.cscov > LDT_SOCKOPT_CSCOV_MAX) {
+			tp_note ("invalid checksum coverage %d\n", opt.cscov);
+			return send_ret (net, nlh, -ERANGE);
+		}
+	}
+	attr = info->attrs[LDT_CMD_SET_SOCKOPT_ATTR_FLAGS];
+	if (attr) opt.flags = nla_get_u32 (attr);
+	tp_debug ("set sockopt (ccid = %d/%d, buf = %d/%d, service = %lld, "
+				"cscov = %d)", opt.txccid, opt.rxccid, opt.sndbuf, opt.rcvbuf,
+				(long long)opt.service, opt.cscov);
+	tdev = LDTDEV_BYNAME (net, name);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
+	ret = ldt_dev_setsockopt (tdev, &opt);
+	dev_put (tdev->ndev);
+	return send_ret (net, nlh, ret);
+}
+
+static
+int
+ldt_nl_set_rxsteer (skb, info)
+	struct sk_buff		*skb;
+	struct genl_info	*info;
+{
+	const char					*name;
+	const struct nlmsghdr	*nlh;
+	const struct nlattr		*attr;
+	struct net					*net;
+	struct ldt_dev				*tdev;
+	struct ldt_rxsteer_cfg	*cfg;
+	const u32					*cpus = NULL;
+	int							mode, nwords = 0;
+	int							ret;
+
+	if (!skb) return -EINVAL;
+	if (!info) return -EINVAL;
+	nlh = nlmsg_hdr(skb);
+	if (!nlh) return -EINVAL;
+	net = genl_info_net (info);
+	if (!net) return -EINVAL;
+	attr = info->attrs[LDT_CMD_SET_RXSTEER_ATTR_NAME];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
+	name = (const char*)nla_data (attr);
+	attr = info->attrs[LDT_CMD_SET_RXSTEER_ATTR_MODE];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
+	mode = (int)nla_get_u32 (attr);
+	attr = info->attrs[LDT_CMD_SET_RXSTEER_ATTR_CPUS];
+	if (attr) {
+		cpus = (const u32*)nla_data (attr);
+		nwords = nla_len (attr) / sizeof (u32);
+	}
+	tp_debug ("set rxsteer (mode = %d, %d cpu words)", mode, nwords);
+	tdev = LDTDEV_BYNAME (net, name);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
+	cfg = ldt_rxsteer_mkcfg (mode, cpus, nwords, tdev->ndev->ifindex);
+	if (IS_ERR (cfg)) {
+		dev_put (tdev->ndev);
+		return send_ret (net, nlh, PTR_ERR (cfg));
+	}
+	ret = ldt_dev_setrxsteer (tdev, cfg);
+	dev_put (tdev->ndev);
+	if (ret < 0) kfree (cfg);
+	return send_ret (net, nlh, ret);
+}
+
+static
+int
+ldt_nl_set_rebind (skb, info)
+	struct sk_buff		*skb;
+	struct genl_info	*info;
+{
+	const char					*name;
+	const struct nlmsghdr	*nlh;
+	const struct nlattr		*attr;
+	struct net					*net;
+	struct ldt_dev				*tdev;
+	int							mode = -1, drain = -1;
+	int							ret;
+
+	if (!skb) return -EINVAL;
+	if (!info) return -EINVAL;
+	nlh = nlmsg_hdr(skb);
+	if (!nlh) return -EINVAL;
+	net = genl_info_net (info);
+	if (!net) return -EINVAL;
+	attr = info->attrs[LDT_CMD_SET_REBIND_ATTR_NAME];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
+	name = (const char*)nla_data (attr);
+	attr = info->attrs[LDT_CMD_SET_REBIND_ATTR_MODE];
+	if (attr) {
+		mode = (int)nla_get_u32 (attr);
+		if (mode < 0 || mode > LDT_REBIND_MAX) return send_ret (net, nlh, -EINVAL);
+	}
+	attr = info->attrs[LDT_CMD_SET_REBIND_ATTR_DRAIN];
+	if (attr) {
+		if (nla_get_u32 (attr) > LDT_REBIND_DRAIN_MAX)
+			return send_ret (net, nlh, -ERANGE);
+		drain = (int)nla_get_u32 (attr);
+	}
+	tp_debug ("set rebind (mode = %d, drain = %d)", mode, drain);
+	tdev = LDTDEV_BYNAME (net, name);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
+	ret = ldt_dev_setrebind (tdev, mode, drain);
+	dev_put (tdev->ndev);
+	return send_ret (net, nlh, ret);
+}
+
+static
+int
+ldt_nl_set_aead (skb, info)
+	struct sk_buff		*skb;
+	struct genl_info	*info;
+{
+	const char					*name;
+	const struct nlmsghdr	*nlh;
+	const struct nlattr		*attr;
+	struct net					*net;
+	struct ldt_dev				*tdev;
+	struct ldt_aead_key		*tx = NULL, *rx = NULL;
+	const u8						*key = NULL;
+	int							alg = LDT_AEAD_NONE, keylen = 0, keyid = 0;
+	u32							flags = 0;
+	int							ret;
+
+	if (!skb) return -EINVAL;
+	if (!info) return -EINVAL;
+	nlh = nlmsg_hdr(skb);
+	if (!nlh) return -EINVAL;
+	net = genl_info_net (info);
+	if (!net) return -EINVAL;
+	attr = info->attrs[LDT_CMD_SET_AEAD_ATTR_NAME];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
+	name = (const char*)nla_data (attr);
+	attr = info->attrs[LDT_CMD_SET_AEAD_ATTR_FLAGS];
+	if (attr) flags = nla_get_u32 (attr);
+	attr = info->attrs[LDT_CMD_SET_AEAD_ATTR_ALG];
+	if (attr) alg = (int)nla_get_u32 (attr);
+	attr = info->attrs[LDT_CMD_SET_AEAD_ATTR_KEY];
+	if (attr) {
+		key = (const u8*)nla_data (attr);
+		keylen = nla_len (attr);
+	}
+	attr = info->attrs[LDT_CMD_SET_AEAD_ATTR_KEYID];
+	if (attr) keyid = nla_get_u8 (attr);
+	tp_debug ("set aead (alg = %d, keyid = %d, flags = 0x%x)", alg, keyid, flags);
+	/* set up the transforms before taking the device lock */
+	if (flags & (LDT_AEAD_F_TX | LDT_AEAD_F_RX)) {
+		if (!key) return send_ret (net, nlh, -EINVAL);
+		if (flags & LDT_AEAD_F_TX) {
+			tx = ldt_aead_mkkey (alg, key, keylen, keyid);
+			if (IS_ERR (tx)) return send_ret (net, nlh, PTR_ERR (tx));
+		}
+		if (flags & LDT_AEAD_F_RX) {
+			rx = ldt_aead_mkkey (alg, key, keylen, keyid);
+			if (IS_ERR (rx)) {
+				ldt_aead_freekey (tx);
+				return send_ret (net, nlh, PTR_ERR (rx));
+			}
+		}
+	}
+	tdev = LDTDEV_BYNAME (net, name);
+	if (!tdev) {
+		ret = -EINVAL;
+	} else {
+		ret = ldt_dev_setaead (tdev, tx, rx, flags);
+		dev_put (tdev->ndev);
+	}
+	if (ret < 0) {
+		ldt_aead_freekey (tx);
+		ldt_aead_freekey (rx);
+	}
+	return send_ret (net, nlh, ret);
+}
+
+static
+int
+ldt_nl_set_pace (skb, info)
+	struct sk_buff		*skb;
+	struct genl_info	*info;
+{
+	const char					*name;
+	const struct nlmsghdr	*nlh;
+	const struct nlattr		*attr;
+	struct net					*net;
+	struct ldt_dev				*tdev;
+	s64							rate = -1;
+	int							burst = -1, flags = -1;
+	int							ret;
+
+	if (!skb) return -EINVAL;
+	if (!info) return -EINVAL;
+	nlh = nlmsg_hdr(skb);
+	if (!nlh) return -EINVAL;
+	net = genl_info_net (info);
+	if (!net) return -EINVAL;
+	attr = info->attrs[LDT_CMD_SET_PACE_ATTR_NAME];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
+	name = (const char*)nla_data (attr);
+	attr = info->attrs[LDT_CMD_SET_PACE_ATTR_RATE];
+	if (attr) {
+		if (nla_get_u64 (attr) > LDT_PACE_RATE_MAX)
+			return send_ret (net, nlh, -ERANGE);
+		rate = (s64)nla_get_u64 (attr);
+	}
+	attr = info->attrs[LDT_CMD_SET_PACE_ATTR_BURST];
+	if (attr) {
+		if (nla_get_u32 (attr) > LDT_PACE_BURST_MAX)
+			return send_ret (net, nlh, -ERANGE);
+		burst = (int)nla_get_u32 (attr);
+	}
+	attr = info->attrs[LDT_CMD_SET_PACE_ATTR_FLAGS];
+	if (attr) flags = (int)(nla_get_u32 (attr) & LDT_PACE_F_LEARN);
+	tp_debug ("set pace (rate = %lld, burst = %d, flags = %d)",
+				(long long)rate, burst, flags);
+	tdev = LDTDEV_BYNAME (net, name);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
+	ret = ldt_dev_setpace (tdev, rate, burst, flags);
+	dev_put (tdev->ndev);
+	return send_ret (net, nlh, ret);
+}
+
+static
+int
+ldt_nl_set_fec (skb, info)
+	struct sk_buff		*skb;
+	struct genl_info	*info;
+{
+	const char					*name;
+	const struct nlmsghdr	*nlh;
+	const struct nlattr		*attr;
+	struct net					*net;
+	struct ldt_dev				*tdev;
+	struct ldt_fec_state		*st;
+	int							mode = LDT_FEC_XOR;
+	int							k = LDT_FEC_K_DEF;
+	int							delay = LDT_FEC_DELAY_DEF;
+	int							ret;
+
+	if (!skb) return -EINVAL;
+	if (!info) return -EINVAL;
+	nlh = nlmsg_hdr(skb);
+	if (!nlh) return -EINVAL;
+	net = genl_info_net (info);
+	if (!net) return -EINVAL;
+	attr = info->attrs[LDT_CMD_SET_FEC_ATTR_NAME];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
+	name = (const char*)nla_data (attr);
+	attr = info->attrs[LDT_CMD_SET_FEC_ATTR_MODE];
+	if (attr) {
+		if (nla_get_u32 (attr) > LDT_FEC_MAX)
+			return send_ret (net, nlh, -EINVAL);
+		mode = (int)nla_get_u32 (attr);
+	}
+	attr = info->attrs[LDT_CMD_SET_FEC_ATTR_K];
+	if (attr) k = nla_get_u8 (attr);
+	attr = info->attrs[LDT_CMD_SET_FEC_ATTR_DELAY];
+	if (attr) {
+		if (nla_get_u32 (attr) > LDT_FEC_DELAY_MAX)
+			return send_ret (net, nlh, -ERANGE);
+		delay = (int)nla_get_u32 (attr);
+	}
+	tp_debug ("set fec (mode = %d, k = %d, delay = %d)", mode, k, delay);
+	/* allocated here - the device lock must not sleep */
+	st = ldt_fec_mkstate (mode, k, delay);
+	if (IS_ERR (st)) return send_ret (net, nlh, PTR_ERR (st));
+	tdev = LDTDEV_BYNAME (net, name);
+	if (!tdev) {
+		kfree (st);
+		return send_ret (net, nlh, -EINVAL);
+	}
+	ret = ldt_dev_setfec (tdev, st);
+	dev_put (tdev->ndev);
+	if (ret < 0) kfree (st);
+	return send_ret (net, nlh, ret);
+}
+
+static
+int
+ldt_nl_set_paths (skb, info)
+	struct sk_buff		*skb;
+	struct genl_info	*info;
+{
+	const char					*name;
+	const struct nlmsghdr	*nlh;
+	const struct nlattr		*attr;
+	struct net					*net;
+	struct ldt_dev				*tdev;
+	struct ldt_bondpath		*bp;
+	struct ldt_pathcfg		list[LDT_BOND_MAXPATH];
+	int							num = -1, reorder = -1, i;
+	int							ret;
+
+	if (!skb) return -EINVAL;
+	if (!info) return -EINVAL;
+	nlh = nlmsg_hdr(skb);
+	if (!nlh) return -EINVAL;
+	net = genl_info_net (info);
+	if (!net) return -EINVAL;
+	attr = info->attrs[LDT_CMD_SET_PATHS_ATTR_NAME];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
+	name = (const char*)nla_data (attr);
+	attr = info->attrs[LDT_CMD_SET_PATHS_ATTR_LIST];
+	if (attr) {
+		if (nla_len (attr) % sizeof (struct ldt_bondpath))
+			return send_ret (net, nlh, -EINVAL);
+		num = nla_len (attr) / sizeof (struct ldt_bondpath);
+		if (num > LDT_BOND_MAXPATH) return send_ret (net, nlh, -ERANGE);
+		bp = (struct ldt_bondpath*)nla_data (attr);
+		for (i=0; i<num; i++) {
+			memset (&list[i], 0, sizeof (list[i]));
+			if (!bp[i].local.ipv6) {
+				tp_addr_setipv4 (&list[i].local, bp[i].local.addr.v4,
+										bp[i].local.port);
+			} else {
+				tp_addr_setipv6 (&list[i].local, bp[i].local.addr.v6,
+										bp[i].local.port);
+			}
+			/* unset entry - any address */
+			if (!bp[i].local.port && tp_addr_isany (&list[i].local))
+				list[i].local.ad.sa_family = AF_UNSPEC;
+			strscpy (list[i].dev, bp[i].dev, sizeof (list[i].dev));
+			list[i].rate = bp[i].rate;
+		}
+	}
+	attr = info->attrs[LDT_CMD_SET_PATHS_ATTR_REORDER];
+	if (attr) {
+		if (nla_get_u32 (attr) > LDT_BOND_REORDER_MAX)
+			return send_ret (net, nlh, -ERANGE);
+		reorder = (int)nla_get_u32 (attr);
+	}
+	tp_debug ("tunnel [%s] set %d paths (reorder = %d)\n", name, num, reorder);
+	tdev = LDTDEV_BYNAME (net, name);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
+	ret = ldt_dev_setpaths (tdev, list, num, reorder);
+	dev_put (tdev->ndev);
+	return send_ret (net, nlh, ret);
+}
+
+static
+int
+ldt_nl_set_qos (skb, info)
+	struct sk_buff		*skb;
+	struct genl_info	*info;
+{
+	const char					*name;
+	const struct nlmsghdr	*nlh;
+	const struct nlattr		*attr;
+	struct net					*net;
+	struct ldt_dev				*tdev;
+	struct ldt_qoscfg			cfg = { .dscp = LDT_QOS_DSCP_OFF, };
+	struct ldt_qos_state		*st;
+	int							ret;
+
+	if (!skb) return -EINVAL;
+	if (!info) return -EINVAL;
+	nlh = nlmsg_hdr(skb);
+	if (!nlh) return -EINVAL;
+	net = genl_info_net (info);
+	if (!net) return -EINVAL;
+	attr = info->attrs[LDT_CMD_SET_QOS_ATTR_NAME];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
+	name = (const char*)nla_data (attr);
+	/* no config - switch off */
+	attr = info->attrs[LDT_CMD_SET_QOS_ATTR_CFG];
+	if (attr) {
+		if (nla_len (attr) != sizeof (struct ldt_qoscfg))
+			return send_ret (net, nlh, -EINVAL);
+		memcpy (&cfg, nla_data (attr), sizeof (cfg));
+	}
+	tp_debug ("set qos (dscp = %d, flags = 0x%x)", (int)cfg.dscp, cfg.flags);
+	/* allocated here - the device lock must not sleep */
+	st = ldt_qos_mkstate (&cfg);
+	if (IS_ERR (st)) return send_ret (net, nlh, PTR_ERR (st));
+	tdev = LDTDEV_BYNAME (net, name);
+	if (!tdev) {
+		kfree (st);
+		return send_ret (net, nlh, -EINVAL);
+	}
+	ret = ldt_dev_setqos (tdev, st);
+	dev_put (tdev->ndev);
+	if (ret < 0) kfree (st);
+	return send_ret (net, nlh, ret);
+}
+
+
+
+static
+int
+ldt_nl_evsend (skb, info)
+	struct sk_buff		*skb;
+	struct genl_info	*info;
+{
+	const char					*name;
+	const struct nlmsghdr	*nlh;
+	const struct nlattr		*attr;
+	struct net					*net;
+	int							ret;
+	struct ldt_dev		*tdev;
+	u32							reason;
+	u32							evtype;
+
+	if (!skb) return -EINVAL;
+	if (!info) return -EINVAL;
+	nlh = nlmsg_hdr(skb);
+	if (!nlh) return -EINVAL;
+	net = genl_info_net (info);
+	if (!net) return -EINVAL;
+	attr = info->attrs[LDT_CMD_EVSEND_ATTR_NAME];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
+	name = (const char*)nla_data (attr);
+	attr = info->attrs[LDT_CMD_EVSEND_ATTR_EVTYPE];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
+	evtype = nla_get_u32 (attr);
+	attr = info->attrs[LDT_CMD_EVSEND_ATTR_REASON];
+	if (!attr) return send_ret (net, nlh, -EINVAL);
+	reason = nla_get_u32 (attr);
+	tp_debug ("send event %d for device %s\n", 
+					evtype, name?name:"???");
+	tdev = LDTDEV_BYNAME (net, name);
+	if (!tdev) return send_ret (net, nlh, -EINVAL);
+	ret = ldt_dev_evsend (tdev, evtype, reason);
+	dev_put (tdev->ndev);
+	return send_ret (net, nlh, ret);
+}
+
+
+
+static
+int
+ldt_nl_subscribe (skb, info)
+	struct sk_buff		*skb;
+	struct genl_info	*info;
+{
+	u32							pid;
+	const struct nlmsghdr	*nlh;
+	struct net					*net;
+	struct ldt_nl_filter		*filter;
+	int							ret;
+
+	if (!skb) return -EINVAL;
+	if (!info) return -EINVAL;
+	nlh = nlmsg_hdr(skb);
+	if (!nlh) return -EINVAL;
+	pid = nlh->nlmsg_pid;
+	net = genl_info_net (info);
+	if (!net) return -EINVAL;
+	ret = ldt_nl_mkfilter (info, &filter);
+	if (ret < 0) return send_ret (net, nlh, ret);
+	tp_debug ("got event subscription");
+	ret = ldt_nl_adduser (pid, net, filter);
+	if (ret < 0) kfree (filter);
+	return send_ret (net, nlh, ret);
+}
+
+static
+int
+ldt_nl_subscribe_update (skb, info)
+	struct sk_buff		*skb;
+	struct genl_info	*info;
+{
+	u32							pid;
+	const struct nlmsghdr	*nlh;
+	struct net					*net;
+	struct ldt_net				*ln;
+	struct ldt_nl_user		*p;
+	struct ldt_nl_filter		*filter, *old = NULL;
+	int							ret = -ENOENT;
+
+	if (!skb) return -EINVAL;
+	if (!info) return -EINVAL;
+	nlh = nlmsg_hdr(skb);
+	if (!nlh) return -EINVAL;
+	pid = nlh->nlmsg_pid;
+	net = genl_info_net (info);
+	if (!net) return -EINVAL;
+	ln = LDTNET (net);
+	if (!ln) return send_ret (net, nlh, -EINVAL);
+	ret = ldt_nl_mkfilter (info, &filter);
+	if (ret < 0) return send_ret (net, nlh, ret);
+	tp_debug ("update event subscription of %d\n", (int)pid);
+	ret = -ENOENT;
+	NL_LOCK(ln);
+	list_for_each_entry_rcu (p, &ln->nlusers, list) {
+		if (p->valid && p->pid == pid) {
+			old = rcu_dereference_protected (p->filter, 1);
+			rcu_assign_pointer (p->filter, filter);
+			ret = 0;
+			break;
+		}
+	}
+	NL_UNLOCK(ln);
+	if (ret < 0) {
+		kfree (filter);
+	} else if (old) {
+		kfree_rcu (old, rcu);
+	}
+	return send_ret (net, nlh, ret);
+}
+
+static
+int
+ldt_nl_mkfilter (info, filter)
+	struct genl_info		*info;
+	struct ldt_nl_filter	**filter;
+{
+	const struct nlattr		*attr;
+	const char					*list = NULL;
+	struct ldt_nl_filter		*p;
+	struct net_device			*ndev;
+	struct net					*net;
+	u32							evmask = 0;
+	int							i, nif = 0;
+
+	*filter = NULL;
+	attr = info->attrs[LDT_CMD_SUBSCRIBE_ATTR_EVMASK];
+	if (attr) evmask = nla_get_u32 (attr);
+	attr = info->attrs[LDT_CMD_SUBSCRIBE_ATTR_IFLIST];
+	if (attr) {
+		if (nla_len (attr) % IFNAMSIZ) return -EINVAL;
+		nif = nla_len (attr) / IFNAMSIZ;
+		if (nif > LDT_SUBSCRIBE_MAXIF) return -EINVAL;
+		list = (const char*)nla_data (attr);
+	}
+	if (!evmask && !nif) return 0;
+	p = kzalloc (sizeof (struct ldt_nl_filter), GFP_KERNEL);
+	if (!p) return -ENOMEM;
+	p->evmask = evmask;
+	net = genl_info_net (info);
+	/* interfaces existing now are matched by index, so they survive a
+	 * rename - the others by the name the event carries */
+	rcu_read_lock ();
+	for (i=0; i<nif; i++) {
+		strncpy (p->iface[p->nif], list + i*IFNAMSIZ, IFNAMSIZ-1);
+		if (!*p->iface[p->nif]) continue;
+		ndev = net ? dev_get_by_name_rcu (net, p->iface[p->nif]) : NULL;
+		if (ndev) p->ifindex[p->nif] = ndev->ifindex;
+		p->nif++;
+	}
+	rcu_read_unlock ();
+	*filter = p;
+	return 0;
+}
+
+
+static
+int
+ldt_nl_release_notifier (nb, action, data)
+	struct notifier_block	*nb;
+	unsigned long				action;
+	void							*data;
+{
+	struct netlink_notify	*n = data;
+
+	if (n && action==NETLINK_URELEASE) {
+		ldt_nl_rmuser (n->portid, n->net);
+	}
+	return NOTIFY_DONE;
+}
+
+static
+int
+send_ret (net, nlh, rval)
+	struct net					*net;
+	const struct nlmsghdr	*nlh;
+	int							rval;
+{
+	int	ret;
+
+	tp_debug ("send return value: %d to %d\n", rval, (int) nlh->nlmsg_pid);
+	if (rval != 0) {
+		/* don't really send it */
+		return rval;
+	}
+	ret = send_info (net, nlh, rval, NULL, 0);
+	if (ret < 0) {
+		tp_err ("error sending return value (%d) to %d: %d\n",
+					rval, (int)nlh->nlmsg_pid, ret);
+		return ret;
+	}
+	return rval;
+}
+
+static int ldt_sndinfo_seq = 0;
+static
+int
+send_info (net, nlh, rval, data, len)
+	struct net					*net;
+	const struct nlmsghdr	*nlh;
+	const char					*data;
+	u32							len;
+	int							rval;
+{
+	struct sk_buff *skb;
+	void				*p;
+	int				ret, num;
+	u32				xval, pid;
+	const char		*s;
+
+#define CHUNKSZ	4096
+	if (!net || !nlh) return -EINVAL;
+	pid = nlh->nlmsg_pid;
+	tp_debug ("send data to %d\n", (int)pid);
+	if (!len && data) len = strlen (data) + 1;
+	if (!data) len = 0;
+	skb = genlmsg_new (len+(len/CHUNKSZ*4)+128, GFP_KERNEL);
+	if (!skb) return -ENOMEM;
+	/* create the message headers */
+	/* echo the request's sequence number, so that users can pipeline
+	 * requests and match the answers
+	 */
+	p = genlmsg_put (	skb, pid, nlh->nlmsg_seq, &ldt_nl_family,
+							/* flags = */ 0, LDT_CMD_SEND_INFO);
+	if (!p) {
+		nlmsg_free (skb);
+		tp_err ("error creating message\n");
+		return -ENOMEM;
+	}
+	/* add attribute */
+	xval = (rval < 0) ? (rval * (-1)) : rval;
+	ret = nla_put_u32 (skb, LDT_CMD_SEND_INFO_ATTR_RET, xval);
+	if (ret < 0) {
+		nlmsg_free (skb);
+		tp_err ("error creating message: %d\n", ret);
+		return ret;
+	}
+	if (data) {
 		s = data;
 		num=0;
 		while (len > CHUNKSZ) {
@@ -1164,24 +2281,106 @@ do_send_event (net, pid, evtype, iarg, sarg)
 
 
 int
-ldt_nl_send_event (net, evtype, iarg, sarg)
+ldt_nl_send_event (net, evtype, iface, iarg, sarg)
 	struct net	*net;
 	u32			evtype;
+	const char	*iface;
 	u32			iarg;
 	const char	*sarg;
 {
-	struct ldt_nl_user	*p;
+	struct ldt_net			*ln;
 
 	tp_debug ("send event %d\n", evtype);
-	list_for_each_entry_rcu (p, &tpnl_head, list) {
-		tp_debug3 ("check user %d (valid==%d)\n", (int) p->pid, p->valid);
-		if (p->valid && (p->net == net || !net)) {
-			do_send_event (p->net, p->pid, evtype, iarg, sarg);
-		}
+	if (net) {
+		ln = LDTNET (net);
+		if (ln) ldt_nl_send_event2 (ln, evtype, iface, iarg, sarg);
+		return 0;
+	}
+	/* to the subscribers of all namespaces */
+	mutex_lock (&ldt_net_mutex);
+	list_for_each_entry (ln, &ldt_net_list, list) {
+		ldt_nl_send_event2 (ln, evtype, iface, iarg, sarg);
 	}
+	mutex_unlock (&ldt_net_mutex);
 	return 0;
 }
 
+static
+int
+ldt_nl_filter_match (user, evtype, iface, ifindex)
+	struct ldt_nl_user	*user;
+	u32						evtype;
+	const char				*iface;
+	int						ifindex;
+{
+	struct ldt_nl_filter	*filter;
+	int						i, match = 1;
+
+	rcu_read_lock ();
+	filter = rcu_dereference (user->filter);
+	if (!filter) goto out;
+	if (filter->evmask && (evtype >= 32 ||
+					!(filter->evmask & (1U << evtype)))) {
+		match = 0;
+		goto out;
+	}
+	/* events not bound to an interface always pass */
+	if (!filter->nif || !iface) goto out;
+	for (i=0; i<filter->nif; i++) {
+		if (filter->ifindex[i] && ifindex) {
+			if (filter->ifindex[i] == ifindex) goto out;
+		} else if (!strncmp (filter->iface[i], iface, IFNAMSIZ)) {
+			goto out;
+		}
+	}
+	match = 0;
+out:
+	rcu_read_unlock ();
+	return match;
+}
+
+static
+void
+ldt_nl_send_event2 (ln, evtype, iface, iarg, sarg)
+	struct ldt_net	*ln;
+	u32				evtype;
+	const char		*iface;
+	u32				iarg;
+	const char		*sarg;
+{
+	struct ldt_nl_user	*p;
+	struct net_device		*ndev;
+	int						ifindex = 0;
+
+	/* 0 if the interface is gone already - matched by name then */
+	if (iface && ln->net) {
+		rcu_read_lock ();
+		ndev = dev_get_by_name_rcu (ln->net, iface);
+		if (ndev) ifindex = ndev->ifindex;
+		rcu_read_unlock ();
+	}
+	list_for_each_entry_rcu (p, &ln->nlusers, list) {
+		tp_debug3 ("check user %d (valid==%d)\n", (int) p->pid, p->valid);
+		if (!p->valid) continue;
+		/* filter before the skb is built */
+		if (!ldt_nl_filter_match (p, evtype, iface, ifindex)) continue;
+		do_send_event (p->net, p->pid, evtype, iarg, sarg);
+	}
+}
+
+static
+void
+ldt_nl_freeuser (user)
+	struct ldt_nl_user	*user;
+{
+	struct ldt_nl_filter	*filter;
+
+	filter = rcu_dereference_protected (user->filter, 1);
+	if (filter) kfree_rcu (filter, rcu);
+	*user = LDT_NL_USER_NULL;
+	kfree (user);
+}
+
 
 /* 
  *	handle the list of users
@@ -1190,21 +2389,36 @@ ldt_nl_send_event (net, evtype, iarg, sarg)
 
 static
 int
-ldt_nl_adduser (pid, net)
-	u32			pid;
-	struct net	*net;
+ldt_nl_adduser (pid, net, filter)
+	u32							pid;
+	struct net					*net;
+	struct ldt_nl_filter		*filter;
 {
 	struct ldt_nl_user	*user, *p;
 	struct list_head			delhead;
+	struct ldt_net				*ln;
+	struct ldt_nl_filter		*old = NULL;
+	int							found = 0;
 
 	if (pid <= 0) return -EINVAL;
-	/* check wether user already exists */
-	list_for_each_entry_rcu (p, &tpnl_head, list) {
-		if (p->pid == pid && p->net == net) {
+	ln = LDTNET (net);
+	if (!ln) return -EINVAL;
+	/* check wether user already exists - resubscribing replaces the filter */
+	NL_LOCK(ln);
+	list_for_each_entry_rcu (p, &ln->nlusers, list) {
+		if (p->pid == pid) {
+			old = rcu_dereference_protected (p->filter, 1);
+			rcu_assign_pointer (p->filter, filter);
 			if (!p->valid) p->valid = 1;
-			return 0;
+			found = 1;
+			break;
 		}
 	}
+	NL_UNLOCK(ln);
+	if (found) {
+		if (old) kfree_rcu (old, rcu);
+		return 0;
+	}
 
 	/* create new user */
 	user = kmalloc (sizeof (struct ldt_nl_user), GFP_KERNEL);
@@ -1214,29 +2428,29 @@ ldt_nl_adduser (pid, net)
 	user->valid = 1;
 	user->pid = pid;
 	user->net = net;
+	RCU_INIT_POINTER (user->filter, filter);
 
 	/* just a dummy list for elements to be deleted */
 	INIT_LIST_HEAD (&delhead);
 
-	G_LOCK;
+	NL_LOCK(ln);
 	/* add new user first */
-	list_add_rcu (&(user->list), &tpnl_head);
+	list_add_rcu (&(user->list), &ln->nlusers);
 	tp_debug ("add user %d\n", (int)pid);
 
 	/* now traverse the list for elements to be deleted */
-	list_for_each_entry_rcu (p, &tpnl_head, list) {
+	list_for_each_entry_rcu (p, &ln->nlusers, list) {
 		if (!p->valid) {
 			list_del_rcu (&(p->list));
 			list_add_rcu (&(p->dellist), &delhead);
 		}
 	}
-	G_UNLOCK;
+	NL_UNLOCK(ln);
 
 	/* now we are safe and can delete users in dellist */
 	list_for_each_entry_safe (user, p, &delhead, dellist) {
 		tp_debug ("delete user %d\n", (int)user->pid);
-		*user = LDT_NL_USER_NULL;
-		kfree (user);
+		ldt_nl_freeuser (user);
 	}
 	return 0;
 }
@@ -1249,9 +2463,12 @@ ldt_nl_rmuser (pid, net)
 	struct net	*net;
 {
 	struct ldt_nl_user	*p;
+	struct ldt_net			*ln;
 
-	list_for_each_entry_rcu (p, &tpnl_head, list) {
-		if (p->valid && (p->net == net || !net) && p->pid == pid) {
+	ln = LDTNET (net);
+	if (!ln) return;
+	list_for_each_entry_rcu (p, &ln->nlusers, list) {
+		if (p->valid && p->pid == pid) {
 			/* we don't realy delete here, this could create dead locks,
 			 * thus we only mark it to be deleted and delete it in next
 			 * add user call */
@@ -1264,25 +2481,39 @@ ldt_nl_rmuser (pid, net)
 static
 void
 ldt_nl_rmalluser (void)
+{
+	struct ldt_net	*ln;
+
+	mutex_lock (&ldt_net_mutex);
+	list_for_each_entry (ln, &ldt_net_list, list) {
+		ldt_nl_net_exit (ln);
+	}
+	mutex_unlock (&ldt_net_mutex);
+}
+
+/* removes all subscribers of the namespace */
+void
+ldt_nl_net_exit (ln)
+	struct ldt_net	*ln;
 {
 	struct ldt_nl_user	*user, *p;
 	struct list_head			delhead;
 
+	if (!ln) return;
 	INIT_LIST_HEAD (&delhead);
 
 	/* first traverse the list and move elements to delhead */
-	G_LOCK;
-	list_for_each_entry_rcu (p, &tpnl_head, list) {
+	NL_LOCK(ln);
+	list_for_each_entry_rcu (p, &ln->nlusers, list) {
 		list_del_rcu (&(p->list));
 		list_add_rcu (&(p->dellist), &delhead);
 	}
-	G_UNLOCK;
+	NL_UNLOCK(ln);
 
 	/* now we are safe and can delete users in dellist */
 
 	list_for_each_entry_safe (user, p, &delhead, dellist) {
-		*user = LDT_NL_USER_NULL;
-		kfree (user);
+		ldt_nl_freeuser (user);
 	}
 }
 
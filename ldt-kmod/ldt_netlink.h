@@ -54,11 +54,16 @@
 
 
 struct net;
-int ldt_nl_send_event (struct net *net, u32 evtype, u32 iarg, const char *sarg);
+/* iface NULL - event is not bound to an interface */
+int ldt_nl_send_event (struct net *net, u32 evtype, const char *iface,
+								u32 iarg, const char *sarg);
 
 int ldt_nl_register (void);
 void ldt_nl_unregister (void);
 
+struct ldt_net;
+void ldt_nl_net_exit (struct ldt_net*);
+
 
 extern int ldt_nl_family_id;
 
@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+
+#include "ldt_uapi.h"
+#include "ldt_pace.h"
+#include "ldt_debug.h"
+
+
+#define PACE_LEARN_INTERVAL	(100 * NSEC_PER_MSEC)
+
+static enum hrtimer_restart pace_timer (struct hrtimer*);
+static void pace_update (struct ldt_pace*, u64, int);
+
+
+
+void
+ldt_pace_init (pace, kick, arg)
+	struct ldt_pace	*pace;
+	void					(*kick)(void*);
+	void					*arg;
+{
+	if (!pace) return;
+	*pace = (struct ldt_pace) {
+			.kick = kick,
+			.arg = arg,
+			.burst = LDT_PACE_BURST_DEF,
+	};
+	spin_lock_init (&pace->lock);
+	hrtimer_init (&pace->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	pace->timer.function = pace_timer;
+}
+
+void
+ldt_pace_destroy (pace)
+	struct ldt_pace	*pace;
+{
+	if (!pace) return;
+	WRITE_ONCE (pace->rate, 0);
+	hrtimer_cancel (&pace->timer);
+	pace->kick = NULL;
+}
+
+
+int
+ldt_pace_set (pace, rate, burst, flags)
+	struct ldt_pace	*pace;
+	s64					rate;
+	int					burst, flags;
+{
+	int	kick;
+
+	if (!pace) return -EINVAL;
+	if (rate > (s64)LDT_PACE_RATE_MAX) return -ERANGE;
+	if (burst > LDT_PACE_BURST_MAX) return -ERANGE;
+	spin_lock_bh (&pace->lock);
+	if (rate >= 0) pace->cfgrate = rate;
+	if (burst > 0) pace->burst = burst;
+	if (flags >= 0) {
+		pace->flags = flags;
+		if (!(flags & LDT_PACE_F_LEARN)) pace->learned = 0;
+	}
+	pace_update (pace, ktime_get_ns (), 1);
+	spin_unlock_bh (&pace->lock);
+	/* a waiting queue has to be drained with the new rate */
+	kick = hrtimer_try_to_cancel (&pace->timer) > 0;
+	if (kick && pace->kick) pace->kick (pace->arg);
+	return 0;
+}
+
+/* called with lock held
+ * refill is set for a new configuration only - a learned rate moves
+ * every interval and must not hand out a fresh burst each time
+ */
+static
+void
+pace_update (pace, now, refill)
+	struct ldt_pace	*pace;
+	u64					now;
+	int					refill;
+{
+	u32	rate = pace->cfgrate;
+
+	if ((pace->flags & LDT_PACE_F_LEARN) && pace->learned > 0) {
+		if (!rate || pace->learned < rate) rate = pace->learned;
+	}
+	if (rate != pace->rate && (refill || !pace->rate)) {
+		/* start with a full bucket - or an empty one when learning */
+		pace->maxtokens = rate ? div_u64 ((u64)pace->burst * NSEC_PER_SEC, rate) : 0;
+		pace->tokens = refill ? pace->maxtokens : 0;
+		pace->last = now;
+	} else if (rate) {
+		pace->maxtokens = div_u64 ((u64)pace->burst * NSEC_PER_SEC, rate);
+		if (pace->tokens > pace->maxtokens) pace->tokens = pace->maxtokens;
+	}
+	if (!rate && pace->throttle_start) {
+		pace->throttled_ns += now - pace->throttle_start;
+		pace->throttle_start = 0;
+	}
+	WRITE_ONCE (pace->rate, rate);
+}
+
+
+void
+ldt_pace_learn (pace, rate)
+	struct ldt_pace	*pace;
+	u64					rate;
+{
+	u64	now = ktime_get_ns ();
+
+	if (!pace) return;
+	spin_lock_bh (&pace->lock);
+	pace->learn_last = now;
+	if (pace->flags & LDT_PACE_F_LEARN) {
+		pace->learned = min_t (u64, rate, LDT_PACE_RATE_MAX);
+		pace_update (pace, now, 0);
+	}
+	spin_unlock_bh (&pace->lock);
+}
+
+int
+ldt_pace_needlearn (pace)
+	struct ldt_pace	*pace;
+{
+	if (!pace || !(READ_ONCE (pace->flags) & LDT_PACE_F_LEARN)) return 0;
+	return ktime_get_ns () - READ_ONCE (pace->learn_last) >= PACE_LEARN_INTERVAL;
+}
+
+
+int
+ldt_pace_wait (pace)
+	struct ldt_pace	*pace;
+{
+	u64	now;
+	s64	wait;
+
+	if (!pace || !READ_ONCE (pace->rate)) return 0;
+	spin_lock_bh (&pace->lock);
+	if (!pace->rate) {
+		spin_unlock_bh (&pace->lock);
+		return 0;
+	}
+	now = ktime_get_ns ();
+	pace->tokens += now - pace->last;
+	if (pace->tokens > pace->maxtokens) pace->tokens = pace->maxtokens;
+	pace->last = now;
+	if (pace->tokens >= 0) {
+		if (pace->throttle_start) {
+			pace->throttled_ns += now - pace->throttle_start;
+			pace->throttle_start = 0;
+		}
+		spin_unlock_bh (&pace->lock);
+		return 0;
+	}
+	if (!pace->throttle_start) {
+		pace->throttle_start = now;
+		pace->throttled++;
+	}
+	wait = -pace->tokens;
+	spin_unlock_bh (&pace->lock);
+	hrtimer_start (&pace->timer, ns_to_ktime (wait), HRTIMER_MODE_REL);
+	return 1;
+}
+
+/* the bucket may run into debt by one packet - the next one waits */
+void
+ldt_pace_consume (pace, len)
+	struct ldt_pace	*pace;
+	int					len;
+{
+	if (!pace || len <= 0 || !READ_ONCE (pace->rate)) return;
+	spin_lock_bh (&pace->lock);
+	if (pace->rate) {
+		pace->tokens -= div_u64 ((u64)len * NSEC_PER_SEC, pace->rate);
+		pace->bytes += len;
+	}
+	spin_unlock_bh (&pace->lock);
+}
+
+static
+enum hrtimer_restart
+pace_timer (timer)
+	struct hrtimer	*timer;
+{
+	struct ldt_pace	*pace = container_of (timer, struct ldt_pace, timer);
+
+	/* only queues the xmit work */
+	if (pace->kick) pace->kick (pace->arg);
+	return HRTIMER_NORESTART;
+}
+
+
+int
+ldt_pace_prtinfo (pace, buf, blen, spc)
+	struct ldt_pace	*pace;
+	char					*buf;
+	size_t				blen;
+	unsigned				spc;
+{
+	u64	throttled_ns;
+	int	len = 0;
+
+	if (!pace) return 0;
+	if (!READ_ONCE (pace->cfgrate) && !(READ_ONCE (pace->flags) & LDT_PACE_F_LEARN))
+		return 0;
+#define _FSTR	(buf ? buf + len : NULL)
+#define _FLEN	(blen > len ? blen - len : 0)
+	spin_lock_bh (&pace->lock);
+	throttled_ns = pace->throttled_ns;
+	if (pace->throttle_start)
+		throttled_ns += ktime_get_ns () - pace->throttle_start;
+	len += snprintf (_FSTR, _FLEN, "%*c<pace rate=\"%u\" burst=\"%u\"",
+							spc, ' ', pace->rate, pace->burst);
+	if (pace->cfgrate)
+		len += snprintf (_FSTR, _FLEN, " maxrate=\"%u\"", pace->cfgrate);
+	if (pace->flags & LDT_PACE_F_LEARN)
+		len += snprintf (_FSTR, _FLEN, " learned=\"%u\"", pace->learned);
+	len += snprintf (_FSTR, _FLEN, " bytes=\"%llu\" throttled=\"%llu\" "
+							"throttled_ms=\"%llu\"/>\n",
+							(unsigned long long)pace->bytes,
+							(unsigned long long)pace->throttled,
+							(unsigned long long)div_u64 (throttled_ns, NSEC_PER_MSEC));
+	spin_unlock_bh (&pace->lock);
+	return len;
+#undef _FSTR
+#undef _FLEN
+}
+
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
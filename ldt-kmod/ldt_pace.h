@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#ifndef _R__KERNEL_LDT_PACE_H
+#define _R__KERNEL_LDT_PACE_H
+
+#include <linux/types.h>
+#include <linux/spinlock.h>
+#include <linux/hrtimer.h>
+
+/* token bucket pacing of the tunnel egress. The bucket is kept as time
+ * credit (nsec) to avoid rounding losses at low rates. When the bucket
+ * is empty the caller stops dequeueing and the timer calls kick() as
+ * soon as the next packet may leave.
+ */
+
+struct ldt_pace {
+	spinlock_t			lock;
+	struct hrtimer		timer;
+	void					(*kick)(void*);
+	void					*arg;
+	u32					rate;				/* bytes/sec - in use, 0 = off */
+	u32					cfgrate;			/* bytes/sec - configured */
+	u32					learned;			/* bytes/sec - from ccid */
+	u32					burst;			/* bytes */
+	u32					flags;			/* LDT_PACE_F_* */
+	s64					tokens;			/* nsec */
+	s64					maxtokens;		/* nsec */
+	u64					last;				/* nsec */
+	u64					learn_last;		/* nsec */
+	u64					throttle_start;	/* nsec - 0 = not throttled */
+	u64					throttled_ns;
+	u64					throttled;		/* number of times */
+	u64					bytes;
+};
+
+
+void ldt_pace_init (struct ldt_pace*, void (*kick)(void*), void *arg);
+/* must not be called from the kick function */
+void ldt_pace_destroy (struct ldt_pace*);
+
+/* negative values are left unchanged - may be called from atomic context */
+int ldt_pace_set (struct ldt_pace*, s64 rate, int burst, int flags);
+/* rate in bytes/sec, 0 = unknown */
+void ldt_pace_learn (struct ldt_pace*, u64 rate);
+int ldt_pace_needlearn (struct ldt_pace*);
+
+/* returns 1 if the caller has to wait - kick() is called later on */
+int ldt_pace_wait (struct ldt_pace*);
+void ldt_pace_consume (struct ldt_pace*, int len);
+
+int ldt_pace_prtinfo (struct ldt_pace*, char *buf, size_t blen, unsigned spc);
+
+
+
+#endif	/* _R__KERNEL_LDT_PACE_H */
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
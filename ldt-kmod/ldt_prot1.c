@@ -64,6 +64,7 @@
 #include "ldt_uapi.h"
 #include "ldt_prot1.h"
 #include "ldt_debug.h"
+#include "ldt_trace.h"
 
 static int tp_prot1_recv (struct ldt_tun*, char*, int);
 
@@ -101,6 +102,8 @@ tp_prot1_recv (tun, data, len)
 	if (len < xlen) return -EBADMSG;
 	len = xlen;
 	type = (int)(u32)data[3];
+	trace_ldt_prot1 ((tun->tdev && tun->tdev->ndev) ? tun->tdev->ndev->name : NULL,
+							LDT_PROT1_DIR_RX, type, len);
 	tp_debug2 ("received prot 1 type %d msg\n", type);
 	switch (type) {
 	case TP_PROT1_T_KEEPALIVE:
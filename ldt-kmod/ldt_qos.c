@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/skbuff.h>
+#include <linux/slab.h>
+#include <linux/err.h>
+#include <net/sock.h>
+#include <net/inet_sock.h>
+#include <net/inet_ecn.h>
+#if IS_ENABLED(CONFIG_IPV6)
+# include <net/ipv6.h>
+#endif
+
+#include "ldt_uapi.h"
+#include "ldt_qos.h"
+#include "ldt_ip.h"
+#include "ldt_prot1.h"
+#include "ldt_debug.h"
+
+
+static int qos_setdscp (struct sock*, int);
+
+
+
+void
+ldt_qos_init (qos)
+	struct ldt_qos	*qos;
+{
+	if (!qos) return;
+	*qos = (struct ldt_qos) { .st = NULL, };
+}
+
+void
+ldt_qos_destroy (qos)
+	struct ldt_qos	*qos;
+{
+	ldt_qos_set (qos, NULL);
+}
+
+
+struct ldt_qos_state*
+ldt_qos_mkstate (cfg)
+	const struct ldt_qoscfg	*cfg;
+{
+	struct ldt_qos_state	*st;
+	int						i;
+
+	if (!cfg) return ERR_PTR (-EINVAL);
+	if (cfg->dscp > LDT_QOS_DSCP_MAX) return ERR_PTR (-EINVAL);
+	if (cfg->flags & ~(LDT_QOS_F_PRIO | LDT_QOS_F_MARK)) return ERR_PTR (-EINVAL);
+	if (cfg->dscp == LDT_QOS_DSCP_MAP) {
+		for (i=0; i<64; i++) {
+			if (cfg->map[i] > 63) return ERR_PTR (-ERANGE);
+		}
+	}
+	if (cfg->dscp == LDT_QOS_DSCP_OFF && !cfg->flags) return NULL;
+	st = kzalloc (sizeof (*st), GFP_KERNEL);
+	if (!st) return ERR_PTR (-ENOMEM);
+	st->cfg = *cfg;
+	if (!st->cfg.markmask) st->cfg.markmask = 0xffffffffU;
+	return st;
+}
+
+void
+ldt_qos_set (qos, st)
+	struct ldt_qos				*qos;
+	struct ldt_qos_state		*st;
+{
+	struct ldt_qos_state	*old;
+
+	if (!qos) return;
+	old = rcu_dereference_protected (qos->st, 1);
+	rcu_assign_pointer (qos->st, st);
+	if (old) kfree_rcu (old, rcu);
+}
+
+
+/* the socket fields are read when the packet leaves the ip layer -
+ * dccp may send a packet delayed by its ccid with the class of a
+ * later one. The fields are only written when they change.
+ */
+void
+ldt_qos_apply (qos, sk, skb)
+	struct ldt_qos		*qos;
+	struct sock			*sk;
+	struct sk_buff		*skb;
+{
+	struct ldt_qos_state	*st;
+	int						dscp, type, changed = 0;
+	u32						mark;
+
+	if (!qos || !sk || !skb || !skb->len) return;
+	if (!rcu_access_pointer (qos->st)) return;
+	/* only ip packets - neither control, nor already protected ones */
+	type = TP_GETPKTTYPE (skb->data[0]);
+	if (type != 4 && type != 6) return;
+	dscp = ldt_ipdscp ((char*)skb->data, skb_headlen (skb));
+	rcu_read_lock ();
+	st = rcu_dereference (qos->st);
+	if (!st) goto out;
+	switch (st->cfg.dscp) {
+	case LDT_QOS_DSCP_COPY:
+		if (dscp >= 0) changed |= qos_setdscp (sk, dscp);
+		break;
+	case LDT_QOS_DSCP_MAP:
+		if (dscp >= 0) changed |= qos_setdscp (sk, st->cfg.map[dscp]);
+		break;
+	}
+	if ((st->cfg.flags & LDT_QOS_F_PRIO) &&
+			READ_ONCE (sk->sk_priority) != skb->priority) {
+		WRITE_ONCE (sk->sk_priority, skb->priority);
+		changed = 1;
+	}
+	if (st->cfg.flags & LDT_QOS_F_MARK) {
+		mark = skb->mark & st->cfg.markmask;
+		if (READ_ONCE (sk->sk_mark) != mark) {
+			WRITE_ONCE (sk->sk_mark, mark);
+			/* policy routing by mark - connected sockets route again */
+			sk_dst_reset (sk);
+			changed = 1;
+		}
+	}
+	atomic64_inc (&qos->applied);
+	if (changed) atomic64_inc (&qos->switched);
+out:
+	rcu_read_unlock ();
+}
+
+static
+int
+qos_setdscp (sk, dscp)
+	struct sock	*sk;
+	int			dscp;
+{
+	int	tos, old;
+
+#if IS_ENABLED(CONFIG_IPV6)
+	if (sk->sk_family == AF_INET6) {
+		old = READ_ONCE (inet6_sk (sk)->tclass);
+		tos = (dscp << 2) | (old & INET_ECN_MASK);
+		if (tos == old) return 0;
+		WRITE_ONCE (inet6_sk (sk)->tclass, tos);
+		return 1;
+	}
+#endif
+	old = READ_ONCE (inet_sk (sk)->tos);
+	tos = (dscp << 2) | (old & INET_ECN_MASK);
+	if (tos == old) return 0;
+	WRITE_ONCE (inet_sk (sk)->tos, tos);
+	return 1;
+}
+
+
+int
+ldt_qos_prtinfo (qos, buf, blen, spc)
+	struct ldt_qos	*qos;
+	char				*buf;
+	size_t			blen;
+	unsigned			spc;
+{
+	struct ldt_qos_state	*st;
+	int						len = 0;
+	static const char		*dscpmode[] = { "off", "copy", "map" };
+
+	if (!qos) return 0;
+#define _FSTR	(buf ? buf + len : NULL)
+#define _FLEN	(blen > len ? blen - len : 0)
+	rcu_read_lock ();
+	st = rcu_dereference (qos->st);
+	if (!st) {
+		rcu_read_unlock ();
+		return 0;
+	}
+	len += snprintf (_FSTR, _FLEN, "%*c<qos dscp=\"%s\" prio=\"%d\"",
+							spc, ' ', dscpmode[st->cfg.dscp],
+							!!(st->cfg.flags & LDT_QOS_F_PRIO));
+	if (st->cfg.flags & LDT_QOS_F_MARK) {
+		len += snprintf (_FSTR, _FLEN, " markmask=\"0x%x\"", st->cfg.markmask);
+	}
+	rcu_read_unlock ();
+	len += snprintf (_FSTR, _FLEN, " applied=\"%lld\" switched=\"%lld\"/>\n",
+							(long long)atomic64_read (&qos->applied),
+							(long long)atomic64_read (&qos->switched));
+	return len;
+#undef _FSTR
+#undef _FLEN
+}
+
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
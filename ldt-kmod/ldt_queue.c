@@ -50,8 +50,27 @@
  */
 
 #include <linux/skbuff.h>
+#include <linux/version.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
 //#include <linux/lockdep.h>
+#include "ldt_uapi.h"
 #include "ldt_queue.h"
+#include "ldt_ip.h"
+#include "ldt_trace.h"
+
+
+/* the enqueue time is kept in skb->tstamp - it is scrubbed before
+ * enqueuing, and the skb's data is copied to the socket, so it is
+ * free for our use */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,10,0)
+# define TPQ_STAMP(skb) do { (skb)->tstamp = ktime_get (); } while (0)
+# define TPQ_SOJOURN(skb) \
+			((skb)->tstamp ? ktime_to_ns (ktime_sub (ktime_get (), (skb)->tstamp)) : -1)
+#else
+# define TPQ_STAMP(skb) do {} while (0)
+# define TPQ_SOJOURN(skb) (-1)
+#endif
 
 
 
@@ -70,6 +89,11 @@ static void tpq_inf_requeue (struct tp_queue*, struct sk_buff*);
 static int tpq_limit_isfull (struct tp_queue*);
 static void tpq_drop_oldest_enqueue (struct tp_queue*, struct sk_buff*);
 static void tpq_drop_newest_enqueue (struct tp_queue*, struct sk_buff*);
+static int tpq_classify (struct tp_qbands*, struct sk_buff*);
+static void tpq_bands_enqueue (struct tp_queue*, struct sk_buff*);
+static struct sk_buff* tpq_bands_dequeue (struct tp_queue*);
+static struct sk_buff* tpq_bands_dequeue2 (struct tp_qbands*);
+static void tpq_bands_requeue (struct tp_queue*, struct sk_buff*);
 
 
 static struct tp_queue_ops queue_tbl[TP_QUEUE_MAX+1] = {
@@ -97,6 +121,12 @@ static struct tp_queue_ops queue_tbl[TP_QUEUE_MAX+1] = {
 		.requeue = tpq_inf_requeue,
 		.isfull = NULL,
 	},
+	[TP_QUEUE_BANDS] = {
+		.enqueue = tpq_bands_enqueue,
+		.dequeue = tpq_bands_dequeue,
+		.requeue = tpq_bands_requeue,
+		.isfull = NULL,
+	},
 };
 
 
@@ -124,6 +154,8 @@ tpq_set_policy (queue, policy)
 {
 	if (!queue) return;
 	if (policy < 0 || policy > TP_QUEUE_MAX) return;
+	/* needs tpq_set_bands () first */
+	if (policy == TP_QUEUE_BANDS && !queue->bands) return;
 	queue->policy = policy;
 }
 
@@ -137,6 +169,15 @@ tpq_set_maxlen (queue, maxlen)
 	queue->q_maxlen = maxlen;
 }
 
+void
+tpq_set_name (queue, name)
+	struct tp_queue	*queue;
+	const char			*name;
+{
+	if (!queue) return;
+	queue->name = name;
+}
+
 void
 tpq_destroy (queue)
 	struct tp_queue	*queue;
@@ -145,7 +186,13 @@ tpq_destroy (queue)
 
 	if (!queue) return;
 	while ((skb = tpq_inf_dequeue (queue))) {
-		kfree (skb);
+		kfree_skb (skb);
+	}
+	if (queue->bands) {
+		while ((skb = tpq_bands_dequeue2 (queue->bands))) {
+			kfree_skb (skb);
+		}
+		kfree (queue->bands);
 	}
 	*queue = (struct tp_queue) { .q_maxlen = 0 };
 }
@@ -158,6 +205,9 @@ tpq_enqueue (queue, skb)
 {
 	if (!queue || !skb || (unsigned) queue->policy > TP_QUEUE_MAX) return;
 	if (!queue_tbl[queue->policy].enqueue) return;
+	TPQ_STAMP(skb);
+	if (trace_ldt_enqueue_enabled())
+		trace_ldt_enqueue (queue->name, skb, tpq_len (queue));
 	queue_tbl[queue->policy].enqueue (queue, skb);
 }
 
@@ -165,9 +215,28 @@ struct sk_buff*
 tpq_dequeue (queue)
 	struct tp_queue	*queue;
 {
+	struct sk_buff	*skb;
+
 	if (!queue || (unsigned) queue->policy > TP_QUEUE_MAX) return NULL;
 	if (!queue_tbl[queue->policy].dequeue) return NULL;
-	return queue_tbl[queue->policy].dequeue (queue);
+	skb = queue_tbl[queue->policy].dequeue (queue);
+	if (unlikely (!skb && queue->bands && queue->policy != TP_QUEUE_BANDS)) {
+		/* left over from before the policy was changed */
+		skb = tpq_bands_dequeue2 (queue->bands);
+	}
+	if (skb && trace_ldt_dequeue_enabled()) {
+		trace_ldt_dequeue (queue->name, skb, tpq_len (queue), TPQ_SOJOURN(skb));
+	}
+	return skb;
+}
+
+/* time in nsec since the skb was enqueued - negative if unknown */
+s64
+tpq_sojourn (skb)
+	struct sk_buff		*skb;
+{
+	if (!skb) return -1;
+	return TPQ_SOJOURN(skb);
 }
 
 void
@@ -177,6 +246,8 @@ tpq_requeue (queue, skb)
 {
 	if (!queue || !skb || (unsigned) queue->policy > TP_QUEUE_MAX) return;
 	if (!queue_tbl[queue->policy].requeue) return;
+	if (trace_ldt_requeue_enabled())
+		trace_ldt_requeue (queue->name, skb, tpq_len (queue));
 	queue_tbl[queue->policy].requeue (queue, skb);
 }
 
@@ -189,6 +260,113 @@ tpq_isfull (queue)
 	return queue_tbl[queue->policy].isfull (queue);
 }
 
+/* number of packets in the queue - all bands */
+int
+tpq_len (queue)
+	struct tp_queue	*queue;
+{
+	int	i, len;
+
+	if (!queue) return 0;
+	len = skb_queue_len (&queue->queue);
+	for (i=0; queue->bands && i<TP_QUEUE_MAXBANDS; i++)
+		len += skb_queue_len (&queue->bands->band[i].queue);
+	return len;
+}
+
+/* sets up the bands for TP_QUEUE_BANDS - the queue might be in use,
+ * hence the band structure, once allocated, stays until tpq_destroy ()
+ * and packets of bands no longer in use are moved to the last band
+ */
+int
+tpq_set_bands (queue, cfg, gfp)
+	struct tp_queue				*queue;
+	const struct ldt_qbands		*cfg;
+	gfp_t								gfp;
+{
+	struct tp_qbands	*bands;
+	struct sk_buff_head	tmp;
+	unsigned long		flags;
+	int					i;
+
+	if (!queue || !cfg) return -EINVAL;
+	if (cfg->nbands < LDT_QBANDS_MIN || cfg->nbands > LDT_QBANDS_MAX)
+		return -ERANGE;
+	if (cfg->classify > LDT_QBANDS_CLS_PRIO || cfg->sched > LDT_QBANDS_SCHED_WRR)
+		return -EINVAL;
+	if (cfg->dflt >= cfg->nbands) return -EINVAL;
+	for (i=0; i<64; i++)
+		if (cfg->map[i] >= cfg->nbands) return -EINVAL;
+	bands = queue->bands;
+	if (!bands) {
+		bands = kzalloc (sizeof (struct tp_qbands), gfp);
+		if (!bands) return -ENOMEM;
+		for (i=0; i<TP_QUEUE_MAXBANDS; i++)
+			skb_queue_head_init (&bands->band[i].queue);
+	}
+	bands->classify = cfg->classify;
+	bands->sched = cfg->sched;
+	bands->dflt = cfg->dflt;
+	memcpy (bands->map, cfg->map, sizeof (bands->map));
+	for (i=0; i<TP_QUEUE_MAXBANDS; i++) {
+		bands->band[i].limit = i < cfg->nbands ? cfg->limit[i] : 0;
+		bands->band[i].weight = (i < cfg->nbands && cfg->weight[i] > 0) ?
+											cfg->weight[i] : 1;
+		bands->band[i].credit = bands->band[i].weight;
+	}
+	WRITE_ONCE (bands->nbands, cfg->nbands);
+	bands->cur = 0;
+	for (i=cfg->nbands; queue->bands && i<TP_QUEUE_MAXBANDS; i++) {
+		if (!skb_queue_len (&bands->band[i].queue)) continue;
+		__skb_queue_head_init (&tmp);
+		spin_lock_irqsave (&bands->band[i].queue.lock, flags);
+		skb_queue_splice_init (&bands->band[i].queue, &tmp);
+		spin_unlock_irqrestore (&bands->band[i].queue.lock, flags);
+		spin_lock_irqsave (&bands->band[cfg->nbands-1].queue.lock, flags);
+		skb_queue_splice_tail_init (&tmp, &bands->band[cfg->nbands-1].queue);
+		spin_unlock_irqrestore (&bands->band[cfg->nbands-1].queue.lock, flags);
+	}
+	if (!queue->bands) smp_store_release (&queue->bands, bands);
+	return 0;
+}
+
+int
+tpq_prtinfo (queue, buf, blen, spc)
+	struct tp_queue	*queue;
+	char					*buf;
+	size_t				blen;
+	unsigned				spc;
+{
+	struct tp_qbands	*bands;
+	struct tp_qband	*b;
+	int					len = 0, i;
+
+	if (!queue || !queue->bands || queue->policy != TP_QUEUE_BANDS) return 0;
+	bands = queue->bands;
+#define _FSTR	(buf ? buf + len : NULL)
+#define _FLEN	(blen > len ? blen - len : 0)
+	len += snprintf (_FSTR, _FLEN, "%*c<qbands classify=\"%s\" sched=\"%s\" "
+							"default=\"%d\">\n", spc, ' ',
+							bands->classify == LDT_QBANDS_CLS_PRIO ? "prio" : "dscp",
+							bands->sched == LDT_QBANDS_SCHED_WRR ? "wrr" : "strict",
+							bands->dflt);
+	for (i=0; i<bands->nbands; i++) {
+		b = &bands->band[i];
+		len += snprintf (_FSTR, _FLEN, "%*c<band id=\"%d\" limit=\"%d\"",
+							spc+2, ' ', i, b->limit > 0 ? b->limit : queue->q_maxlen);
+		if (bands->sched == LDT_QBANDS_SCHED_WRR)
+			len += snprintf (_FSTR, _FLEN, " weight=\"%d\"", b->weight);
+		len += snprintf (_FSTR, _FLEN, " qlen=\"%u\" packets=\"%llu\" "
+							"drops=\"%llu\"/>\n", skb_queue_len (&b->queue),
+							(unsigned long long)b->packets,
+							(unsigned long long)b->drops);
+	}
+	len += snprintf (_FSTR, _FLEN, "%*c</qbands>\n", spc, ' ');
+	return len;
+#undef _FSTR
+#undef _FLEN
+}
+
 
 
 
@@ -256,6 +434,8 @@ tpq_drop_oldest_enqueue (queue, skb)
 	if (tpq_limit_isfull (queue)) {
 		oskb = tpq_inf_dequeue (queue);
 		if (oskb) {
+			trace_ldt_drop (queue->name, oskb->len, queue->queue.qlen,
+									LDT_DROP_QOLDEST);
 			kfree_skb (oskb);
 		}
 	}
@@ -274,6 +454,8 @@ tpq_drop_newest_enqueue (queue, skb)
 	struct sk_buff		*skb;
 {
 	if (tpq_limit_isfull (queue)) {
+		trace_ldt_drop (queue->name, skb->len, queue->queue.qlen,
+								LDT_DROP_QFULL);
 		kfree_skb (skb);
 	} else {
 		tpq_inf_enqueue (queue, skb);
@@ -281,6 +463,127 @@ tpq_drop_newest_enqueue (queue, skb)
 }
 
 
+/*
+ * multi band queue
+ */
+
+static
+int
+tpq_classify (bands, skb)
+	struct tp_qbands	*bands;
+	struct sk_buff		*skb;
+{
+	int	dscp, band, nbands;
+
+	dscp = ldt_ipdscp ((char*)skb->data, skb_headlen (skb));
+	if (dscp < 0) {
+		band = bands->dflt;
+	} else if (bands->classify == LDT_QBANDS_CLS_PRIO) {
+		band = bands->map[skb->priority > 63 ? 63 : skb->priority];
+	} else {
+		band = bands->map[dscp];
+	}
+	/* might be reconfigured concurrently */
+	nbands = READ_ONCE (bands->nbands);
+	return band < nbands ? band : nbands - 1;
+}
+
+static
+void
+tpq_bands_enqueue (queue, skb)
+	struct tp_queue	*queue;
+	struct sk_buff		*skb;
+{
+	struct tp_qband	*b;
+	unsigned long		flags;
+	int					limit;
+
+	if (unlikely (!queue->bands)) {
+		tpq_drop_newest_enqueue (queue, skb);
+		return;
+	}
+	b = &queue->bands->band[tpq_classify (queue->bands, skb)];
+	limit = b->limit > 0 ? b->limit : queue->q_maxlen;
+	spin_lock_irqsave (&b->queue.lock, flags);
+	if (b->queue.qlen >= limit) {
+		b->drops++;
+		spin_unlock_irqrestore (&b->queue.lock, flags);
+		trace_ldt_drop (queue->name, skb->len, tpq_len (queue), LDT_DROP_QFULL);
+		kfree_skb (skb);
+		return;
+	}
+	__skb_queue_head (&b->queue, skb);
+	b->packets++;
+	spin_unlock_irqrestore (&b->queue.lock, flags);
+}
+
+static
+struct sk_buff*
+tpq_bands_dequeue (queue)
+	struct tp_queue	*queue;
+{
+	struct sk_buff	*skb;
+
+	/* left over from before the policy was changed */
+	skb = tpq_inf_dequeue (queue);
+	if (unlikely (skb)) return skb;
+	if (unlikely (!queue->bands)) return NULL;
+	return tpq_bands_dequeue2 (queue->bands);
+}
+
+static
+struct sk_buff*
+tpq_bands_dequeue2 (bands)
+	struct tp_qbands	*bands;
+{
+	struct tp_qband	*b;
+	struct sk_buff		*skb;
+	int					i, nbands;
+
+	nbands = READ_ONCE (bands->nbands);
+	if (bands->sched == LDT_QBANDS_SCHED_WRR) {
+		/* each band may send weight packets per round, an empty band
+		 * or one without credit passes on to the next band */
+		for (i=0; i<=nbands; i++) {
+			if (bands->cur >= nbands) bands->cur = 0;
+			b = &bands->band[bands->cur];
+			if (b->credit > 0 && (skb = skb_dequeue_tail (&b->queue))) {
+				b->credit--;
+				return skb;
+			}
+			b->credit = b->weight;
+			bands->cur++;
+		}
+		return NULL;
+	}
+	/* strict priority - bands above nbands are empty */
+	for (i=0; i<TP_QUEUE_MAXBANDS; i++) {
+		skb = skb_dequeue_tail (&bands->band[i].queue);
+		if (skb) return skb;
+	}
+	return NULL;
+}
+
+static
+void
+tpq_bands_requeue (queue, skb)
+	struct tp_queue	*queue;
+	struct sk_buff		*skb;
+{
+	struct tp_qband	*b;
+
+	if (unlikely (!queue->bands)) {
+		tpq_inf_requeue (queue, skb);
+		return;
+	}
+	/* classification gives the band it was dequeued from (unless the
+	 * map has been changed in between) - do not count it twice */
+	b = &queue->bands->band[tpq_classify (queue->bands, skb)];
+	skb_queue_tail (&b->queue, skb);
+	if (b->credit < b->weight) b->credit++;
+}
+
+
 
 
 
@@ -55,11 +55,35 @@
 
 #include <linux/skbuff.h>
 
+struct ldt_qbands;
+
+#define TP_QUEUE_MAXBANDS	8
+
+struct tp_qband {
+	struct sk_buff_head		queue;
+	int							limit;		/* 0 = q_maxlen */
+	int							weight;
+	int							credit;		/* wrr - left in this round */
+	u64							packets;		/* under queue.lock */
+	u64							drops;
+};
+
+struct tp_qbands {
+	int							nbands;
+	int							classify;
+	int							sched;
+	int							dflt;
+	int							cur;			/* wrr - band being served */
+	u8								map[64];
+	struct tp_qband			band[TP_QUEUE_MAXBANDS];
+};
 
 struct tp_queue {
 	struct sk_buff_head		queue;
 	int							q_maxlen;
 	int							policy;
+	const char					*name;		/* for tracing only */
+	struct tp_qbands			*bands;		/* allocated on first use */
 };
 
 
@@ -67,18 +91,24 @@ struct tp_queue {
 #define TP_QUEUE_LIMIT			1
 #define TP_QUEUE_DROP_OLDEST	2
 #define TP_QUEUE_DROP_NEWEST	3
-#define TP_QUEUE_MAX				3
+#define TP_QUEUE_BANDS			4
+#define TP_QUEUE_MAX				4
 
 
 void tpq_init (struct tp_queue*, int policy, int maxlen);
 void tpq_destroy (struct tp_queue*);
 void tpq_set_policy (struct tp_queue*, int policy);
 void tpq_set_maxlen (struct tp_queue*, int maxlen);
+void tpq_set_name (struct tp_queue*, const char *name);
+int tpq_set_bands (struct tp_queue*, const struct ldt_qbands*, gfp_t);
 
 void tpq_enqueue (struct tp_queue*, struct sk_buff*);
 struct sk_buff* tpq_dequeue (struct tp_queue*);
 void tpq_requeue (struct tp_queue*, struct sk_buff*);
 int tpq_isfull (struct tp_queue*);
+s64 tpq_sojourn (struct sk_buff*);
+int tpq_len (struct tp_queue*);
+int tpq_prtinfo (struct tp_queue*, char *buf, size_t blen, unsigned spc);
 
 
 
@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/netdevice.h>
+#include <linux/skbuff.h>
+#include <linux/percpu.h>
+#include <linux/cpumask.h>
+#include <linux/workqueue.h>
+#include <linux/slab.h>
+#include <linux/err.h>
+
+#include "ldt_uapi.h"
+#include "ldt_rxsteer.h"
+#include "ldt_debug.h"
+
+
+/* per cpu backlog - filled by the receiving cpu, drained by a work
+ * bound to the target cpu. the device is held while the skb is queued.
+ */
+struct rxsteer_backlog {
+	struct sk_buff_head	queue;
+	struct work_struct	work;
+};
+
+static DEFINE_PER_CPU(struct rxsteer_backlog, rxsteer_backlog);
+
+static void rxsteer_work (struct work_struct*);
+static int rxsteer_enqueue (int, struct sk_buff*);
+
+
+
+int
+ldt_rxsteer_global_init (void)
+{
+	struct rxsteer_backlog	*bl;
+	int							cpu;
+
+	for_each_possible_cpu (cpu) {
+		bl = per_cpu_ptr (&rxsteer_backlog, cpu);
+		skb_queue_head_init (&bl->queue);
+		INIT_WORK (&bl->work, rxsteer_work);
+	}
+	return 0;
+}
+
+void
+ldt_rxsteer_global_exit (void)
+{
+	struct rxsteer_backlog	*bl;
+	struct sk_buff				*skb;
+	int							cpu;
+
+	for_each_possible_cpu (cpu) {
+		bl = per_cpu_ptr (&rxsteer_backlog, cpu);
+		cancel_work_sync (&bl->work);
+		while ((skb = skb_dequeue (&bl->queue))) {
+			dev_put (skb->dev);
+			kfree_skb (skb);
+		}
+	}
+}
+
+
+int
+ldt_rxsteer_init (st, flags)
+	struct ldt_rxsteer	*st;
+	gfp_t						flags;
+{
+	if (!st) return -EINVAL;
+	RCU_INIT_POINTER (st->cfg, NULL);
+	st->delivered = kcalloc (nr_cpu_ids, sizeof (atomic64_t), flags);
+	if (!st->delivered) return -ENOMEM;
+	return 0;
+}
+
+void
+ldt_rxsteer_destroy (st)
+	struct ldt_rxsteer	*st;
+{
+	struct ldt_rxsteer_cfg	*cfg;
+
+	if (!st) return;
+	cfg = rcu_dereference_protected (st->cfg, 1);
+	RCU_INIT_POINTER (st->cfg, NULL);
+	if (cfg) kfree_rcu (cfg, rcu);
+	kfree (st->delivered);
+	st->delivered = NULL;
+}
+
+
+struct ldt_rxsteer_cfg*
+ldt_rxsteer_mkcfg (mode, cpus, nwords, seed)
+	int			mode;
+	const u32	*cpus;
+	int			nwords;
+	u32			seed;
+{
+	struct ldt_rxsteer_cfg	*cfg;
+	int							cpu, num = 0;
+
+#define ISSET(cpu) ((cpu) < nwords * 32 && (cpus[(cpu)/32] & (1U << ((cpu)%32))))
+	if (mode < 0 || mode > LDT_RXSTEER_MAX) return ERR_PTR (-ERANGE);
+	if (mode == LDT_RXSTEER_OFF) {
+		cfg = kzalloc (sizeof (*cfg), GFP_KERNEL);
+		return cfg ? cfg : ERR_PTR (-ENOMEM);
+	}
+	if (!cpus || nwords <= 0) return ERR_PTR (-EINVAL);
+	for_each_possible_cpu (cpu) {
+		if (ISSET(cpu)) num++;
+	}
+	if (num == 0) return ERR_PTR (-EINVAL);
+	cfg = kzalloc (sizeof (*cfg) + num * sizeof (u16), GFP_KERNEL);
+	if (!cfg) return ERR_PTR (-ENOMEM);
+	cfg->mode = mode;
+	for_each_possible_cpu (cpu) {
+		if (ISSET(cpu)) cfg->cpus[cfg->num++] = cpu;
+	}
+	cfg->pin = cfg->cpus[seed % cfg->num];
+	return cfg;
+#undef ISSET
+}
+
+void
+ldt_rxsteer_set (st, cfg)
+	struct ldt_rxsteer		*st;
+	struct ldt_rxsteer_cfg	*cfg;
+{
+	struct ldt_rxsteer_cfg	*old;
+
+	if (!st) return;
+	old = rcu_dereference_protected (st->cfg, 1);
+	if (cfg && cfg->mode == LDT_RXSTEER_OFF) {
+		kfree (cfg);
+		cfg = NULL;
+	}
+	rcu_assign_pointer (st->cfg, cfg);
+	if (old) kfree_rcu (old, rcu);
+}
+
+
+int
+ldt_rxsteer_rx (st, skb)
+	struct ldt_rxsteer	*st;
+	struct sk_buff			*skb;
+{
+	struct ldt_rxsteer_cfg	*cfg;
+	int							cpu = -1, here;
+	u32							hash;
+
+	if (!st || !skb) return NET_RX_DROP;
+	rcu_read_lock ();
+	cfg = rcu_dereference (st->cfg);
+	if (cfg) {
+		switch (cfg->mode) {
+		case LDT_RXSTEER_CPU:
+			cpu = cfg->pin;
+			break;
+		case LDT_RXSTEER_HASH:
+			/* the hash of the outer dccp flow is of no use here */
+			skb_reset_network_header (skb);
+			skb_clear_hash (skb);
+			hash = skb_get_hash (skb);
+			cpu = cfg->cpus[reciprocal_scale (hash, cfg->num)];
+			break;
+		}
+	}
+	rcu_read_unlock ();
+	here = raw_smp_processor_id ();
+	if (cpu < 0 || cpu == here || !cpu_online (cpu)) {
+		if (st->delivered) atomic64_inc (&st->delivered[here]);
+		return netif_rx (skb);
+	}
+	if (st->delivered) atomic64_inc (&st->delivered[cpu]);
+	return rxsteer_enqueue (cpu, skb);
+}
+
+static
+int
+rxsteer_enqueue (cpu, skb)
+	int				cpu;
+	struct sk_buff	*skb;
+{
+	struct rxsteer_backlog	*bl = per_cpu_ptr (&rxsteer_backlog, cpu);
+
+	if (skb_queue_len (&bl->queue) >= netdev_max_backlog) {
+		atomic_long_inc (&skb->dev->rx_dropped);
+		kfree_skb (skb);
+		return NET_RX_DROP;
+	}
+	dev_hold (skb->dev);
+	skb_queue_tail (&bl->queue, skb);
+	queue_work_on (cpu, system_highpri_wq, &bl->work);
+	return NET_RX_SUCCESS;
+}
+
+static
+void
+rxsteer_work (work)
+	struct work_struct	*work;
+{
+	struct rxsteer_backlog	*bl;
+	struct sk_buff				*skb;
+	struct net_device			*dev;
+
+	bl = container_of (work, struct rxsteer_backlog, work);
+	local_bh_disable ();
+	while ((skb = skb_dequeue (&bl->queue))) {
+		dev = skb->dev;
+		netif_rx (skb);
+		dev_put (dev);
+	}
+	local_bh_enable ();
+}
+
+
+int
+ldt_rxsteer_prtinfo (st, buf, blen, spc)
+	struct ldt_rxsteer	*st;
+	char						*buf;
+	size_t					blen;
+	unsigned					spc;
+{
+	struct ldt_rxsteer_cfg	*cfg;
+	int							len = 0, i;
+	s64							val;
+
+	if (!st) return 0;
+#define _FSTR	(buf ? buf + len : NULL)
+#define _FLEN	(blen > len ? blen - len : 0)
+	rcu_read_lock ();
+	cfg = rcu_dereference (st->cfg);
+	if (!cfg) {
+		len += snprintf (_FSTR, _FLEN, "%*c<rxsteer mode=\"off\">\n", spc, ' ');
+	} else {
+		len += snprintf (_FSTR, _FLEN, "%*c<rxsteer mode=\"%s\" cpus=\"",
+							spc, ' ', cfg->mode == LDT_RXSTEER_HASH ? "hash" : "cpu");
+		for (i=0; i<cfg->num; i++) {
+			len += snprintf (_FSTR, _FLEN, "%s%u", i ? "," : "", cfg->cpus[i]);
+		}
+		len += snprintf (_FSTR, _FLEN, "\"");
+		if (cfg->mode == LDT_RXSTEER_CPU)
+			len += snprintf (_FSTR, _FLEN, " pin=\"%d\"", cfg->pin);
+		len += snprintf (_FSTR, _FLEN, ">\n");
+	}
+	rcu_read_unlock ();
+	for (i=0; st->delivered && i<nr_cpu_ids; i++) {
+		val = atomic64_read (&st->delivered[i]);
+		if (!val) continue;
+		len += snprintf (_FSTR, _FLEN, "%*c<cpu id=\"%d\">%lld</cpu>\n",
+							spc+2, ' ', i, (long long)val);
+	}
+	len += snprintf (_FSTR, _FLEN, "%*c</rxsteer>\n", spc, ' ');
+	return len;
+#undef _FSTR
+#undef _FLEN
+}
+
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
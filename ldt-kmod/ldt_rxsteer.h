@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#ifndef _R__KERNEL_LDT_RXSTEER_H
+#define _R__KERNEL_LDT_RXSTEER_H
+
+#include <linux/types.h>
+#include <linux/skbuff.h>
+#include <linux/rcupdate.h>
+#include <linux/atomic.h>
+
+/* receive steering - decapsulated packets are handed to the stack on
+ * a configured cpu instead of the cpu the socket's data_ready runs on.
+ * LDT_RXSTEER_CPU pins the whole tunnel to one cpu of the set,
+ * LDT_RXSTEER_HASH spreads inner flows across the set.
+ */
+
+struct ldt_rxsteer_cfg {
+	struct rcu_head	rcu;
+	int					mode;			/* LDT_RXSTEER_* */
+	int					pin;			/* cpu for LDT_RXSTEER_CPU */
+	int					num;
+	u16					cpus[];
+};
+
+struct ldt_rxsteer {
+	struct ldt_rxsteer_cfg __rcu	*cfg;
+	atomic64_t							*delivered;		/* per cpu, nr_cpu_ids */
+};
+
+
+int ldt_rxsteer_global_init (void);
+void ldt_rxsteer_global_exit (void);
+
+int ldt_rxsteer_init (struct ldt_rxsteer*, gfp_t);
+void ldt_rxsteer_destroy (struct ldt_rxsteer*);
+
+/* cpus is a bitmap of nwords u32 words, bit i is cpu i */
+struct ldt_rxsteer_cfg *ldt_rxsteer_mkcfg (int mode, const u32 *cpus,
+											int nwords, u32 seed);
+/* takes over cfg - may be called from atomic context */
+void ldt_rxsteer_set (struct ldt_rxsteer*, struct ldt_rxsteer_cfg*);
+
+/* skb->dev and skb->protocol must be set - returns like netif_rx */
+int ldt_rxsteer_rx (struct ldt_rxsteer*, struct sk_buff*);
+
+int ldt_rxsteer_prtinfo (struct ldt_rxsteer*, char *buf, size_t blen,
+									unsigned spc);
+
+
+
+#endif	/* _R__KERNEL_LDT_RXSTEER_H */
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
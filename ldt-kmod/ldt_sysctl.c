@@ -61,12 +61,16 @@ unsigned int tp_cfg_enable_debug = 0;
 unsigned int tp_cfg_show_key = 0;
 unsigned int tp_cfg_loglevel = 5;
 unsigned int tp_cfg_logflags = TP_CFG_LOG_F_RATELIMIT | TP_CFG_LOG_F_PRTFILE;
+unsigned int tp_cfg_evring_size = 4096;
+unsigned int tp_cfg_rcv_budget = 64;
 
 
 static unsigned i_0 = 0;
 static unsigned i_1 = 1;
 static unsigned i_3 = 3;
 static unsigned i_9 = 9;
+static unsigned i_64 = 64;
+static unsigned i_64k = 65536;
 
 static unsigned old_loglevel = 5;
 
@@ -161,6 +165,24 @@ static struct ctl_table net_ldt_table[] = {
 		.extra1			 = &i_0,
 		.extra2			 = &i_1,
 	},
+	{
+		.procname       = "evring_size",
+		.data           = &tp_cfg_evring_size,
+		.maxlen         = sizeof(unsigned int),
+		.mode           = 0644,
+		.proc_handler   = proc_dointvec_minmax,
+		.extra1			 = &i_64,
+		.extra2			 = &i_64k,
+	},
+	{
+		.procname       = "rcv_budget",
+		.data           = &tp_cfg_rcv_budget,
+		.maxlen         = sizeof(unsigned int),
+		.mode           = 0644,
+		.proc_handler   = proc_dointvec_minmax,
+		.extra1			 = &i_0,
+		.extra2			 = &i_64k,
+	},
 	{ }
 };
 
@@ -57,6 +57,8 @@ extern unsigned int tp_cfg_enable_debug;
 extern unsigned int tp_cfg_show_key;
 extern unsigned int tp_cfg_loglevel;
 extern unsigned int tp_cfg_logflags;
+extern unsigned int tp_cfg_evring_size;	/* records - used on first open */
+extern unsigned int tp_cfg_rcv_budget;		/* datagrams per data ready - 0 no limit */
 
 #define TP_CFG_LOG_F_PRTFILE     0x01
 #define TP_CFG_LOG_F_RATELIMIT   0x02
@@ -0,0 +1,563 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+/* kunit tests of the tx queue policies, the header parsers and fec - a
+ * module of its own, built on request only:
+ *   make LDT_KUNIT=m [LDT_KUNIT_BENCH=1]
+ * The code under test is compiled into this module, hence it does not
+ * need ldt.ko. The bench cases (LDT_KUNIT_BENCH) report ns/op with
+ * kunit_info, no limits are enforced.
+ */
+
+/* the tracepoints live in ldt.ko - they are empty stubs here, this
+ * must come before linux/tracepoint.h is included for the first time
+ */
+#define NOTRACE
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/version.h>
+#include <linux/skbuff.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <kunit/test.h>
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,9,0)
+# error "kunit_test_suites () works in modules since linux 5.9"
+#endif
+
+#include "ldt_ip.c"
+#include "ldt_queue.c"
+#include "ldt_fec.c"
+
+#define TEST_BENCH_LOOPS	100000
+
+static struct sk_buff *test_mkskb (struct kunit*, int, int, u32);
+static void test_expect (struct kunit*, struct tp_queue*, u32);
+static void test_queue_inf (struct kunit*);
+static void test_queue_limit (struct kunit*);
+static void test_queue_drop_oldest (struct kunit*);
+static void test_queue_drop_newest (struct kunit*);
+static void test_queue_bands (struct kunit*);
+static void test_ip_ipv4 (struct kunit*);
+static void test_ip_ipv6 (struct kunit*);
+static void test_ip_l4 (struct kunit*);
+static void test_fec_late (struct kunit*);
+#ifdef LDT_KUNIT_BENCH
+static void bench_queue (struct kunit*, int, const struct ldt_qbands*);
+static void bench_queue_all (struct kunit*);
+static void bench_ip (struct kunit*);
+#endif
+
+
+static
+struct sk_buff*
+test_mkskb (test, type, dscp, id)
+	struct kunit	*test;
+	int				type, dscp;
+	u32				id;
+{
+	struct sk_buff	*skb;
+	u8					*data;
+
+	skb = alloc_skb (64, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL (test, skb);
+	data = skb_put_zero (skb, 40);
+	switch (type) {
+	case 4:
+		data[0] = 0x45;
+		data[1] = dscp << 2;
+		break;
+	case 6:
+		data[0] = 0x60 | ((dscp >> 2) & 0x0f);
+		data[1] = (dscp & 0x03) << 6;
+		break;
+	default:
+		data[0] = (type & 0x0f) << 4;
+		break;
+	}
+	skb->mark = id;
+	return skb;
+}
+
+/* dequeues the next packet and checks its id, the packet is freed */
+static
+void
+test_expect (test, queue, id)
+	struct kunit		*test;
+	struct tp_queue	*queue;
+	u32					id;
+{
+	struct sk_buff	*skb;
+
+	skb = tpq_dequeue (queue);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL (test, skb);
+	KUNIT_EXPECT_EQ (test, skb->mark, id);
+	kfree_skb (skb);
+}
+
+
+static
+void
+test_queue_inf (test)
+	struct kunit	*test;
+{
+	struct tp_queue	queue;
+	struct sk_buff		*skb;
+	u32					i;
+
+	tpq_init (&queue, TP_QUEUE_INF, 2);
+	for (i=1; i<=3; i++)
+		tpq_enqueue (&queue, test_mkskb (test, 4, 0, i));
+	KUNIT_EXPECT_EQ (test, tpq_len (&queue), 3);
+	KUNIT_EXPECT_EQ (test, tpq_isfull (&queue), 0);
+	/* a requeued packet is sent next */
+	skb = tpq_dequeue (&queue);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL (test, skb);
+	KUNIT_EXPECT_EQ (test, skb->mark, 1U);
+	tpq_requeue (&queue, skb);
+	test_expect (test, &queue, 1);
+	test_expect (test, &queue, 2);
+	test_expect (test, &queue, 3);
+	KUNIT_EXPECT_TRUE (test, tpq_dequeue (&queue) == NULL);
+	tpq_destroy (&queue);
+}
+
+static
+void
+test_queue_limit (test)
+	struct kunit	*test;
+{
+	struct tp_queue	queue;
+
+	/* the caller checks tpq_isfull - the queue itself never drops */
+	tpq_init (&queue, TP_QUEUE_LIMIT, 2);
+	tpq_enqueue (&queue, test_mkskb (test, 4, 0, 1));
+	KUNIT_EXPECT_EQ (test, tpq_isfull (&queue), 0);
+	tpq_enqueue (&queue, test_mkskb (test, 4, 0, 2));
+	KUNIT_EXPECT_NE (test, tpq_isfull (&queue), 0);
+	test_expect (test, &queue, 1);
+	KUNIT_EXPECT_EQ (test, tpq_isfull (&queue), 0);
+	/* packets left are freed by tpq_destroy */
+	tpq_destroy (&queue);
+}
+
+static
+void
+test_queue_drop_oldest (test)
+	struct kunit	*test;
+{
+	struct tp_queue	queue;
+	u32					i;
+
+	tpq_init (&queue, TP_QUEUE_DROP_OLDEST, 2);
+	for (i=1; i<=3; i++)
+		tpq_enqueue (&queue, test_mkskb (test, 4, 0, i));
+	KUNIT_EXPECT_EQ (test, tpq_len (&queue), 2);
+	KUNIT_EXPECT_EQ (test, tpq_isfull (&queue), 0);
+	test_expect (test, &queue, 2);
+	test_expect (test, &queue, 3);
+	KUNIT_EXPECT_TRUE (test, tpq_dequeue (&queue) == NULL);
+	tpq_destroy (&queue);
+}
+
+static
+void
+test_queue_drop_newest (test)
+	struct kunit	*test;
+{
+	struct tp_queue	queue;
+	u32					i;
+
+	tpq_init (&queue, TP_QUEUE_DROP_NEWEST, 2);
+	for (i=1; i<=3; i++)
+		tpq_enqueue (&queue, test_mkskb (test, 4, 0, i));
+	KUNIT_EXPECT_EQ (test, tpq_len (&queue), 2);
+	test_expect (test, &queue, 1);
+	test_expect (test, &queue, 2);
+	KUNIT_EXPECT_TRUE (test, tpq_dequeue (&queue) == NULL);
+	tpq_destroy (&queue);
+}
+
+static
+void
+test_queue_bands (test)
+	struct kunit	*test;
+{
+	struct ldt_qbands	cfg = {
+			.nbands = 2,
+			.classify = LDT_QBANDS_CLS_DSCP,
+			.sched = LDT_QBANDS_SCHED_STRICT,
+			.dflt = 1,
+			.limit = { 1, 2 },
+	};
+	struct tp_queue	queue;
+
+	tpq_init (&queue, TP_QUEUE_INF, 4);
+	/* the policy needs the bands first */
+	tpq_set_policy (&queue, TP_QUEUE_BANDS);
+	KUNIT_EXPECT_EQ (test, queue.policy, TP_QUEUE_INF);
+	memset (cfg.map, 1, sizeof (cfg.map));
+	cfg.map[46] = 0;
+	cfg.dflt = 5;
+	KUNIT_EXPECT_EQ (test, tpq_set_bands (&queue, &cfg, GFP_KERNEL), -EINVAL);
+	cfg.dflt = 1;
+	KUNIT_ASSERT_EQ (test, tpq_set_bands (&queue, &cfg, GFP_KERNEL), 0);
+	tpq_set_policy (&queue, TP_QUEUE_BANDS);
+	KUNIT_EXPECT_EQ (test, queue.policy, TP_QUEUE_BANDS);
+
+	/* band 1 holds 2 packets, band 0 one - the rest is dropped */
+	tpq_enqueue (&queue, test_mkskb (test, 4, 0, 1));
+	tpq_enqueue (&queue, test_mkskb (test, 1, 0, 2));
+	tpq_enqueue (&queue, test_mkskb (test, 6, 0, 3));
+	tpq_enqueue (&queue, test_mkskb (test, 6, 46, 4));
+	tpq_enqueue (&queue, test_mkskb (test, 4, 46, 5));
+	KUNIT_EXPECT_EQ (test, tpq_len (&queue), 3);
+	KUNIT_EXPECT_EQ (test, queue.bands->band[0].drops, 1ULL);
+	KUNIT_EXPECT_EQ (test, queue.bands->band[1].drops, 1ULL);
+	test_expect (test, &queue, 4);
+	test_expect (test, &queue, 1);
+	test_expect (test, &queue, 2);
+	KUNIT_EXPECT_TRUE (test, tpq_dequeue (&queue) == NULL);
+
+	/* weighted round robin - 2 packets of band 0 per packet of band 1 */
+	cfg.sched = LDT_QBANDS_SCHED_WRR;
+	cfg.limit[0] = cfg.limit[1] = 0;
+	cfg.weight[0] = 2;
+	cfg.weight[1] = 1;
+	KUNIT_ASSERT_EQ (test, tpq_set_bands (&queue, &cfg, GFP_KERNEL), 0);
+	tpq_enqueue (&queue, test_mkskb (test, 4, 46, 1));
+	tpq_enqueue (&queue, test_mkskb (test, 4, 46, 2));
+	tpq_enqueue (&queue, test_mkskb (test, 4, 46, 3));
+	tpq_enqueue (&queue, test_mkskb (test, 4, 0, 4));
+	test_expect (test, &queue, 1);
+	test_expect (test, &queue, 2);
+	test_expect (test, &queue, 4);
+	test_expect (test, &queue, 3);
+	KUNIT_EXPECT_TRUE (test, tpq_dequeue (&queue) == NULL);
+	tpq_destroy (&queue);
+}
+
+
+static
+void
+test_ip_ipv4 (test)
+	struct kunit	*test;
+{
+	char	buf[64] = { 0x45, (char)0xb8, 0x00, 0x3c, };
+	int	prot = -1;
+
+	buf[9] = 17;
+	KUNIT_EXPECT_EQ (test, ldt_ipv4hdrlen (buf, 20, &prot), 20);
+	KUNIT_EXPECT_EQ (test, prot, 17);
+	KUNIT_EXPECT_EQ (test, ldt_iphdrlen (buf, 28, NULL), 20);
+	KUNIT_EXPECT_EQ (test, ldt_msglen (buf, 20), 60);
+	KUNIT_EXPECT_EQ (test, ldt_ipdscp (buf, 20), 46);
+	/* with options */
+	buf[0] = 0x46;
+	KUNIT_EXPECT_EQ (test, ldt_ipv4hdrlen (buf, 24, NULL), 24);
+	/* truncated - the available size is returned */
+	KUNIT_EXPECT_EQ (test, ldt_ipv4hdrlen (buf, 22, NULL), 22);
+	KUNIT_EXPECT_EQ (test, ldt_ipv4hdrlen (buf, 10, NULL), 10);
+	KUNIT_EXPECT_EQ (test, ldt_iphdrlen (buf, 0, NULL), 0);
+	KUNIT_EXPECT_EQ (test, ldt_msglen (buf, 3), -EMSGSIZE);
+	KUNIT_EXPECT_EQ (test, ldt_ipdscp (buf, 1), -EINVAL);
+	/* malformed */
+	buf[0] = 0x44;
+	KUNIT_EXPECT_EQ (test, ldt_ipv4hdrlen (buf, 20, NULL), -EBADMSG);
+	KUNIT_EXPECT_EQ (test, ldt_ipv4hdrlen (NULL, 20, NULL), -EINVAL);
+	KUNIT_EXPECT_EQ (test, ldt_ipv4hdrlen (buf, -1, NULL), -EINVAL);
+	buf[0] = 0x20;
+	KUNIT_EXPECT_EQ (test, ldt_ipdscp (buf, 20), -EBADMSG);
+	KUNIT_EXPECT_EQ (test, ldt_msglen (buf, 20), -EBADMSG);
+}
+
+static
+void
+test_ip_ipv6 (test)
+	struct kunit	*test;
+{
+	char	buf[96] = { 0x6b, (char)0x80, 0x00, 0x00, 0x00, 0x10, 17, };
+	int	prot = -1;
+
+	KUNIT_EXPECT_EQ (test, ldt_ipv6hdrlen (buf, 40, &prot), 40);
+	KUNIT_EXPECT_EQ (test, prot, 17);
+	KUNIT_EXPECT_EQ (test, ldt_iphdrlen (buf, 56, NULL), 40);
+	KUNIT_EXPECT_EQ (test, ldt_msglen (buf, 40), 56);
+	KUNIT_EXPECT_EQ (test, ldt_ipdscp (buf, 40), 46);
+	/* hop by hop (16 bytes) and fragment header in front of tcp */
+	buf[6] = 0;
+	buf[40] = 44;
+	buf[41] = 1;
+	buf[56] = 6;
+	KUNIT_EXPECT_EQ (test, ldt_ipv6hdrlen (buf, 64, &prot), 64);
+	KUNIT_EXPECT_EQ (test, prot, 6);
+	/* an extension length with the high bit set must not go backwards */
+	buf[41] = (char)0x80;
+	KUNIT_EXPECT_EQ (test, ldt_ipv6hdrlen (buf, 96, NULL), 96);
+	buf[41] = 1;
+	/* truncated - the available size is returned */
+	KUNIT_EXPECT_EQ (test, ldt_ipv6hdrlen (buf, 30, NULL), 30);
+	KUNIT_EXPECT_EQ (test, ldt_ipv6hdrlen (buf, 41, NULL), 41);
+	KUNIT_EXPECT_EQ (test, ldt_ipv6hdrlen (buf, 50, NULL), 50);
+	KUNIT_EXPECT_EQ (test, ldt_ipv6hdrlen (buf, 60, NULL), 60);
+	KUNIT_EXPECT_EQ (test, ldt_msglen (buf, 5), -EMSGSIZE);
+}
+
+static
+void
+test_ip_l4 (test)
+	struct kunit	*test;
+{
+	char	buf[32] = { 0, };
+
+	/* tcp - data offset in the upper nibble of byte 12 */
+	buf[12] = 0x50;
+	KUNIT_EXPECT_EQ (test, ldt_l4hdrlen (6, buf, 20), 20);
+	buf[12] = (char)0x80;
+	KUNIT_EXPECT_EQ (test, ldt_l4hdrlen (6, buf, 20), 32);
+	buf[12] = 0x40;
+	KUNIT_EXPECT_EQ (test, ldt_l4hdrlen (6, buf, 20), -EBADMSG);
+	KUNIT_EXPECT_EQ (test, ldt_l4hdrlen (6, buf, 12), -EBADMSG);
+	/* udp */
+	KUNIT_EXPECT_EQ (test, ldt_l4hdrlen (17, buf, 8), 8);
+	/* dccp - data offset in 32 bit words in byte 4 */
+	buf[4] = 4;
+	KUNIT_EXPECT_EQ (test, ldt_l4hdrlen (33, buf, 16), 16);
+	buf[4] = 2;
+	KUNIT_EXPECT_EQ (test, ldt_l4hdrlen (33, buf, 16), -EBADMSG);
+	KUNIT_EXPECT_EQ (test, ldt_l4hdrlen (33, buf, 4), -EBADMSG);
+	/* unknown protocols take all */
+	KUNIT_EXPECT_EQ (test, ldt_l4hdrlen (132, buf, 24), 24);
+	KUNIT_EXPECT_EQ (test, ldt_l4hdrlen (6, NULL, 20), -EINVAL);
+}
+
+
+/* the parity overtakes the second packet of a group - it is rebuilt,
+ * and the original arriving afterwards is dropped as late
+ */
+static
+void
+test_fec_late (test)
+	struct kunit	*test;
+{
+	struct ldt_fec				tx, rx;
+	struct ldt_fec_state		*st;
+	struct sk_buff				*d1, *d2, *parity, *rec;
+	u8								orig[60];
+
+	ldt_fec_init (&tx);
+	ldt_fec_init (&rx);
+	st = ldt_fec_mkstate (LDT_FEC_XOR, 2, 0);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL (test, st);
+	ldt_fec_set (&tx, st);
+	st = ldt_fec_mkstate (LDT_FEC_XOR, 0, 0);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL (test, st);
+	ldt_fec_set (&rx, st);
+
+	d1 = test_mkskb (test, 4, 0, 1);
+	d2 = test_mkskb (test, 4, 10, 2);
+	memset (skb_put (d2, 20), 0xa5, 20);
+	memcpy (orig, d2->data, sizeof (orig));
+	KUNIT_EXPECT_GT (test, ldt_fec_encode (&tx, d1, &parity), 0L);
+	KUNIT_EXPECT_TRUE (test, parity == NULL);
+	KUNIT_EXPECT_EQ (test, ldt_fec_encode (&tx, d2, &parity), 0L);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL (test, parity);
+
+	KUNIT_EXPECT_EQ (test, ldt_fec_decode (&rx, parity, &rec), 1);
+	KUNIT_EXPECT_TRUE (test, rec == NULL);
+	KUNIT_EXPECT_EQ (test, ldt_fec_decode (&rx, d1, &rec), 0);
+	KUNIT_EXPECT_EQ (test, d1->len, 40U);
+	kfree_skb (d1);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL (test, rec);
+	KUNIT_EXPECT_EQ (test, rec->len, 60U);
+	KUNIT_EXPECT_EQ (test, memcmp (rec->data, orig, sizeof (orig)), 0);
+	kfree_skb (rec);
+
+	/* consumed - not delivered a second time */
+	KUNIT_EXPECT_EQ (test, ldt_fec_decode (&rx, d2, &rec), 1);
+	KUNIT_EXPECT_TRUE (test, rec == NULL);
+	KUNIT_EXPECT_EQ (test, atomic64_read (&rx.recovered), 1LL);
+	KUNIT_EXPECT_EQ (test, atomic64_read (&rx.late), 1LL);
+	ldt_fec_destroy (&tx);
+	ldt_fec_destroy (&rx);
+}
+
+
+#ifdef LDT_KUNIT_BENCH
+/* one packet in and out per loop - the queue stays (nearly) empty */
+static
+void
+bench_queue (test, policy, bands)
+	struct kunit					*test;
+	int								policy;
+	const struct ldt_qbands		*bands;
+{
+	struct tp_queue	queue;
+	struct sk_buff		*skb;
+	u64					start, ns;
+	int					i;
+
+	tpq_init (&queue, TP_QUEUE_INF, 1000);
+	if (bands) KUNIT_ASSERT_EQ (test, tpq_set_bands (&queue, bands, GFP_KERNEL), 0);
+	tpq_set_policy (&queue, policy);
+	skb = test_mkskb (test, 4, 46, 1);
+	start = ktime_get_ns ();
+	for (i=0; i<TEST_BENCH_LOOPS && skb; i++) {
+		tpq_enqueue (&queue, skb);
+		skb = tpq_dequeue (&queue);
+	}
+	ns = ktime_get_ns () - start;
+	KUNIT_EXPECT_NOT_ERR_OR_NULL (test, skb);
+	kfree_skb (skb);
+	tpq_destroy (&queue);
+	kunit_info (test, "policy %d: %llu ns/op\n", policy,
+					div_u64 (ns, TEST_BENCH_LOOPS));
+}
+
+static
+void
+bench_queue_all (test)
+	struct kunit	*test;
+{
+	struct ldt_qbands	cfg = {
+			.nbands = 4,
+			.classify = LDT_QBANDS_CLS_DSCP,
+			.sched = LDT_QBANDS_SCHED_WRR,
+			.dflt = 3,
+	};
+
+	bench_queue (test, TP_QUEUE_INF, NULL);
+	bench_queue (test, TP_QUEUE_LIMIT, NULL);
+	bench_queue (test, TP_QUEUE_DROP_OLDEST, NULL);
+	bench_queue (test, TP_QUEUE_DROP_NEWEST, NULL);
+	bench_queue (test, TP_QUEUE_BANDS, &cfg);
+}
+
+static
+void
+bench_ip (test)
+	struct kunit	*test;
+{
+	char				buf[64] = { 0x60, 0x00, 0x00, 0x00, 0x00, 0x10, 0, };
+	u64				start, ns;
+	int				i, len = 0;
+
+	/* hop by hop header in front of udp */
+	buf[40] = 17;
+	start = ktime_get_ns ();
+	for (i=0; i<TEST_BENCH_LOOPS; i++) {
+		len += ldt_iphdrlen (buf, sizeof (buf), NULL);
+		barrier ();
+	}
+	ns = ktime_get_ns () - start;
+	KUNIT_EXPECT_EQ (test, len, 48 * TEST_BENCH_LOOPS);
+	kunit_info (test, "ldt_iphdrlen (ipv6 + ext): %llu ns/op\n",
+					div_u64 (ns, TEST_BENCH_LOOPS));
+}
+#endif	/* LDT_KUNIT_BENCH */
+
+
+static struct kunit_case ldt_test_cases[] = {
+	KUNIT_CASE (test_queue_inf),
+	KUNIT_CASE (test_queue_limit),
+	KUNIT_CASE (test_queue_drop_oldest),
+	KUNIT_CASE (test_queue_drop_newest),
+	KUNIT_CASE (test_queue_bands),
+	KUNIT_CASE (test_ip_ipv4),
+	KUNIT_CASE (test_ip_ipv6),
+	KUNIT_CASE (test_ip_l4),
+	KUNIT_CASE (test_fec_late),
+	{}
+};
+
+static struct kunit_suite ldt_test_suite = {
+	.name = "ldt",
+	.test_cases = ldt_test_cases,
+};
+
+#ifdef LDT_KUNIT_BENCH
+static struct kunit_case ldt_bench_cases[] = {
+	KUNIT_CASE (bench_queue_all),
+	KUNIT_CASE (bench_ip),
+	{}
+};
+
+static struct kunit_suite ldt_bench_suite = {
+	.name = "ldt_bench",
+	.test_cases = ldt_bench_cases,
+};
+
+kunit_test_suites (&ldt_test_suite, &ldt_bench_suite);
+#else
+kunit_test_suites (&ldt_test_suite);
+#endif
+
+/* the kunit api is exported to gpl compatible modules only */
+MODULE_LICENSE("Dual MIT/GPL");
+MODULE_DESCRIPTION("kunit tests of the ldt queue, header parsers and fec");
+
+
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+/* static tracepoints for the datapath - see
+ *   /sys/kernel/tracing/events/ldt/
+ * they cost nothing but a static branch as long as they are disabled.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ldt
+
+#if !defined(_R__KERNEL_LDT_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _R__KERNEL_LDT_TRACE_H
+
+#include <linux/tracepoint.h>
+#include <linux/skbuff.h>
+#include <linux/ktime.h>
+#include <linux/in6.h>
+#include "ldt_addr.h"
+
+
+#ifndef _R__KERNEL_LDT_TRACE_DEFS
+#define _R__KERNEL_LDT_TRACE_DEFS
+enum ldt_drop_reason {
+	LDT_DROP_NOTCONN,			/* not connected (for too long) */
+	LDT_DROP_QFULL,			/* queue full - newest packet dropped */
+	LDT_DROP_QOLDEST,			/* queue full - oldest packet dropped */
+	LDT_DROP_NOMEM,
+	LDT_DROP_TTL,				/* ttl / hop limit expired */
+	LDT_DROP_NOCLIENT,		/* no client for destination (multi client) */
+	LDT_DROP_XMIT,				/* error sending on socket */
+	LDT_DROP_BADMSG,			/* unsupported packet received */
+	LDT_DROP_NETIF,			/* dropped by netif_rx */
+	LDT_DROP_INVAL,
+	LDT_DROP_AUTH,				/* aead authentication failed or no key */
+	LDT_DROP_REPLAY,			/* aead sequence number replayed */
+	LDT_DROP_TOOBIG,			/* exceeds the mtu less the overhead */
+};
+
+#define LDT_PROT1_DIR_RX	0
+#define LDT_PROT1_DIR_TX	1
+
+#define LDT_TRACE_NAMSZ		16		/* IFNAMSIZ */
+#define LDT_TRACE_CPNAME(dst,src) do { \
+			strncpy ((dst), (src) ? (src) : "", LDT_TRACE_NAMSZ-1); \
+			(dst)[LDT_TRACE_NAMSZ-1] = 0; \
+		} while (0)
+#endif
+
+#define LDT_DROP_REASONS \
+	EM(LDT_DROP_NOTCONN,		"notconn")	\
+	EM(LDT_DROP_QFULL,		"qfull")		\
+	EM(LDT_DROP_QOLDEST,		"qoldest")	\
+	EM(LDT_DROP_NOMEM,		"nomem")		\
+	EM(LDT_DROP_TTL,			"ttl")		\
+	EM(LDT_DROP_NOCLIENT,	"noclient")	\
+	EM(LDT_DROP_XMIT,			"xmit")		\
+	EM(LDT_DROP_BADMSG,		"badmsg")	\
+	EM(LDT_DROP_NETIF,		"netif")		\
+	EM(LDT_DROP_INVAL,		"inval")		\
+	EM(LDT_DROP_AUTH,			"auth")		\
+	EM(LDT_DROP_REPLAY,		"replay")	\
+	EMe(LDT_DROP_TOOBIG,		"toobig")
+
+#undef EM
+#undef EMe
+#define EM(a,b)	TRACE_DEFINE_ENUM(a);
+#define EMe(a,b)	TRACE_DEFINE_ENUM(a);
+LDT_DROP_REASONS
+#undef EM
+#undef EMe
+#define EM(a,b)	{ a, b },
+#define EMe(a,b)	{ a, b }
+
+
+/* queue events */
+
+DECLARE_EVENT_CLASS(ldt_queue_class,
+	TP_PROTO(const char *name, const struct sk_buff *skb, int qlen),
+	TP_ARGS(name, skb, qlen),
+	TP_STRUCT__entry(
+		__array(char, name, LDT_TRACE_NAMSZ)
+		__field(const void*, skbaddr)
+		__field(unsigned int, len)
+		__field(int, qlen)
+	),
+	TP_fast_assign(
+		LDT_TRACE_CPNAME(__entry->name, name);
+		__entry->skbaddr = skb;
+		__entry->len = skb->len;
+		__entry->qlen = qlen;
+	),
+	TP_printk("dev=%s skbaddr=%p len=%u qlen=%d", __entry->name,
+					__entry->skbaddr, __entry->len, __entry->qlen)
+);
+
+DEFINE_EVENT(ldt_queue_class, ldt_enqueue,
+	TP_PROTO(const char *name, const struct sk_buff *skb, int qlen),
+	TP_ARGS(name, skb, qlen)
+);
+
+DEFINE_EVENT(ldt_queue_class, ldt_requeue,
+	TP_PROTO(const char *name, const struct sk_buff *skb, int qlen),
+	TP_ARGS(name, skb, qlen)
+);
+
+/* sojourn is the time (nsec) the packet spent in the queue, -1 if
+ * unknown */
+TRACE_EVENT(ldt_dequeue,
+	TP_PROTO(const char *name, const struct sk_buff *skb, int qlen, s64 sojourn),
+	TP_ARGS(name, skb, qlen, sojourn),
+	TP_STRUCT__entry(
+		__array(char, name, LDT_TRACE_NAMSZ)
+		__field(const void*, skbaddr)
+		__field(unsigned int, len)
+		__field(int, qlen)
+		__field(s64, sojourn)
+	),
+	TP_fast_assign(
+		LDT_TRACE_CPNAME(__entry->name, name);
+		__entry->skbaddr = skb;
+		__entry->len = skb->len;
+		__entry->qlen = qlen;
+		__entry->sojourn = sojourn;
+	),
+	TP_printk("dev=%s skbaddr=%p len=%u qlen=%d sojourn=%lld", __entry->name,
+					__entry->skbaddr, __entry->len, __entry->qlen,
+					(long long)__entry->sojourn)
+);
+
+TRACE_EVENT(ldt_drop,
+	TP_PROTO(const char *name, unsigned int len, int qlen, int reason),
+	TP_ARGS(name, len, qlen, reason),
+	TP_STRUCT__entry(
+		__array(char, name, LDT_TRACE_NAMSZ)
+		__field(unsigned int, len)
+		__field(int, qlen)
+		__field(int, reason)
+	),
+	TP_fast_assign(
+		LDT_TRACE_CPNAME(__entry->name, name);
+		__entry->len = len;
+		__entry->qlen = qlen;
+		__entry->reason = reason;
+	),
+	TP_printk("dev=%s len=%u qlen=%d reason=%s", __entry->name,
+					__entry->len, __entry->qlen,
+					__print_symbolic(__entry->reason, LDT_DROP_REASONS))
+);
+
+
+/* socket events */
+
+DECLARE_EVENT_CLASS(ldt_sock_class,
+	TP_PROTO(const char *name, unsigned int len, int ret),
+	TP_ARGS(name, len, ret),
+	TP_STRUCT__entry(
+		__array(char, name, LDT_TRACE_NAMSZ)
+		__field(unsigned int, len)
+		__field(int, ret)
+	),
+	TP_fast_assign(
+		LDT_TRACE_CPNAME(__entry->name, name);
+		__entry->len = len;
+		__entry->ret = ret;
+	),
+	TP_printk("dev=%s len=%u ret=%d", __entry->name, __entry->len,
+					__entry->ret)
+);
+
+/* result of kernel_sendmsg */
+DEFINE_EVENT(ldt_sock_class, ldt_send,
+	TP_PROTO(const char *name, unsigned int len, int ret),
+	TP_ARGS(name, len, ret)
+);
+
+/* datagram received from socket */
+DEFINE_EVENT(ldt_sock_class, ldt_recv,
+	TP_PROTO(const char *name, unsigned int len, int ret),
+	TP_ARGS(name, len, ret)
+);
+
+/* packet handed to the stack, ret is the netif_rx result */
+DEFINE_EVENT(ldt_sock_class, ldt_deliver,
+	TP_PROTO(const char *name, unsigned int len, int ret),
+	TP_ARGS(name, len, ret)
+);
+
+TRACE_EVENT(ldt_prot1,
+	TP_PROTO(const char *name, int dir, int type, unsigned int len),
+	TP_ARGS(name, dir, type, len),
+	TP_STRUCT__entry(
+		__array(char, name, LDT_TRACE_NAMSZ)
+		__field(int, dir)
+		__field(int, type)
+		__field(unsigned int, len)
+	),
+	TP_fast_assign(
+		LDT_TRACE_CPNAME(__entry->name, name);
+		__entry->dir = dir;
+		__entry->type = type;
+		__entry->len = len;
+	),
+	TP_printk("dev=%s %s type=%d len=%u", __entry->name,
+					__entry->dir == LDT_PROT1_DIR_TX ? "tx" : "rx",
+					__entry->type, __entry->len)
+);
+
+
+/* connection events */
+
+DECLARE_EVENT_CLASS(ldt_conn_class,
+	TP_PROTO(const char *name, const tp_addr_t *raddr, int ret),
+	TP_ARGS(name, raddr, ret),
+	TP_STRUCT__entry(
+		__array(char, name, LDT_TRACE_NAMSZ)
+		__array(u8, raddr, sizeof(struct sockaddr_in6))
+		__field(int, ret)
+	),
+	TP_fast_assign(
+		LDT_TRACE_CPNAME(__entry->name, name);
+		memset(__entry->raddr, 0, sizeof(struct sockaddr_in6));
+		if (raddr)
+			memcpy(__entry->raddr, raddr, TP_ADDRP_SIZE(raddr));
+		__entry->ret = ret;
+	),
+	TP_printk("dev=%s raddr=%pISpc ret=%d", __entry->name,
+					__entry->raddr, __entry->ret)
+);
+
+DEFINE_EVENT(ldt_conn_class, ldt_connect,
+	TP_PROTO(const char *name, const tp_addr_t *raddr, int ret),
+	TP_ARGS(name, raddr, ret)
+);
+
+DEFINE_EVENT(ldt_conn_class, ldt_accept,
+	TP_PROTO(const char *name, const tp_addr_t *raddr, int ret),
+	TP_ARGS(name, raddr, ret)
+);
+
+TRACE_EVENT(ldt_subflow,
+	TP_PROTO(const char *name, const char *link, int up, int num),
+	TP_ARGS(name, link, up, num),
+	TP_STRUCT__entry(
+		__array(char, name, LDT_TRACE_NAMSZ)
+		__array(char, link, LDT_TRACE_NAMSZ)
+		__field(int, up)
+		__field(int, num)
+	),
+	TP_fast_assign(
+		LDT_TRACE_CPNAME(__entry->name, name);
+		LDT_TRACE_CPNAME(__entry->link, link);
+		__entry->up = up;
+		__entry->num = num;
+	),
+	TP_printk("dev=%s link=%s %s num=%d", __entry->name, __entry->link,
+					__entry->up ? "up" : "down", __entry->num)
+);
+
+
+#endif	/* _R__KERNEL_LDT_TRACE_H */
+
+/* this part must be outside the header guard */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE ldt_trace
+#include <trace/define_trace.h>
+
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
@@ -203,25 +203,193 @@ ldt_tun_peer (tun, addr)
 }
 
 int
-ldt_tun_serverstart (tun)
+ldt_tun_serverstart (tun, flags)
 	struct ldt_tun	*tun;
+	int				flags;
 {
 	int	ret;
 
 	TUNFUNCHK(tun,tp_serverstart);
-	ret = tun->tunops->tp_serverstart (tun->tundata);
+	ret = tun->tunops->tp_serverstart (tun->tundata, flags);
 	return ret;
 }
 
 int
-ldt_tun_setqueue (tun, txlen, qpolicy)
+ldt_tun_setqueue (tun, txlen, qpolicy, bands)
 	struct ldt_tun	*tun;
 	int						txlen, qpolicy;
+	struct ldt_qbands		*bands;
 {
 	int	ret;
 
 	TUNFUNCHK(tun,tp_setqueue);
-	ret = tun->tunops->tp_setqueue (tun->tundata, txlen, qpolicy);
+	ret = tun->tunops->tp_setqueue (tun->tundata, txlen, qpolicy, bands);
+	return ret;
+}
+
+int
+ldt_tun_peerlist (tun, list, local, num, backoff_min, backoff_max, flags,
+						stagger)
+	struct ldt_tun	*tun;
+	tp_addr_t		*list, *local;
+	int				num, backoff_min, backoff_max, stagger;
+	u32				flags;
+{
+	int	ret;
+
+	TUNFUNCHK(tun,tp_peerlist);
+	ret = tun->tunops->tp_peerlist (tun->tundata, list, local, num,
+												backoff_min, backoff_max, flags,
+												stagger);
+	tun->mtime = get_seconds();
+	if (ret == 0) 
+		ldt_event_crsend (LDT_EVTYPE_REBIND, tun, 0);
+	return ret;
+}
+
+int
+ldt_tun_clientroute (tun, raddr, inner, plen, flags)
+	struct ldt_tun	*tun;
+	tp_addr_t		*raddr, *inner;
+	int				plen, flags;
+{
+	int	ret;
+
+	TUNFUNCHK(tun,tp_clientroute);
+	ret = tun->tunops->tp_clientroute (tun->tundata, raddr, inner, plen, flags);
+	tun->mtime = get_seconds();
+	return ret;
+}
+
+int
+ldt_tun_getlatency (tun, lat, reset)
+	struct ldt_tun			*tun;
+	struct ldt_latency	*lat;
+	int						reset;
+{
+	TUNFUNCHK(tun,tp_getlatency);
+	return tun->tunops->tp_getlatency (tun->tundata, lat, reset);
+}
+
+int
+ldt_tun_setsockopt (tun, opt)
+	struct ldt_tun			*tun;
+	struct ldt_sockopt	*opt;
+{
+	int	ret;
+
+	TUNFUNCHK(tun,tp_setsockopt);
+	ret = tun->tunops->tp_setsockopt (tun->tundata, opt);
+	tun->mtime = get_seconds();
+	return ret;
+}
+
+/* on success cfg is taken over by the tunnel */
+int
+ldt_tun_setrxsteer (tun, cfg)
+	struct ldt_tun				*tun;
+	struct ldt_rxsteer_cfg	*cfg;
+{
+	int	ret;
+
+	/* cfg would not be freed by the caller on success */
+	if (!tun) return -EINVAL;
+	if (!TUNIFFUNC(tun,tp_setrxsteer)) return -EOPNOTSUPP;
+	ret = tun->tunops->tp_setrxsteer (tun->tundata, cfg);
+	tun->mtime = get_seconds();
+	return ret;
+}
+
+/* negative values are left unchanged */
+int
+ldt_tun_setrebind (tun, mode, drain)
+	struct ldt_tun	*tun;
+	int				mode, drain;
+{
+	int	ret;
+
+	TUNFUNCHK(tun,tp_setrebind);
+	ret = tun->tunops->tp_setrebind (tun->tundata, mode, drain);
+	tun->mtime = get_seconds();
+	return ret;
+}
+
+/* on success the keys are taken over by the tunnel */
+int
+ldt_tun_setaead (tun, tx, rx, flags)
+	struct ldt_tun			*tun;
+	struct ldt_aead_key	*tx, *rx;
+	u32						flags;
+{
+	int	ret;
+
+	/* the keys would not be freed by the caller on success */
+	if (!tun) return -EINVAL;
+	if (!TUNIFFUNC(tun,tp_setaead)) return -EOPNOTSUPP;
+	ret = tun->tunops->tp_setaead (tun->tundata, tx, rx, flags);
+	tun->mtime = get_seconds();
+	return ret;
+}
+
+/* negative values are left unchanged */
+int
+ldt_tun_setpace (tun, rate, burst, flags)
+	struct ldt_tun	*tun;
+	s64				rate;
+	int				burst, flags;
+{
+	int	ret;
+
+	TUNFUNCHK(tun,tp_setpace);
+	ret = tun->tunops->tp_setpace (tun->tundata, rate, burst, flags);
+	tun->mtime = get_seconds();
+	return ret;
+}
+
+/* st is taken over on success - NULL switches fec off */
+int
+ldt_tun_setfec (tun, st)
+	struct ldt_tun				*tun;
+	struct ldt_fec_state		*st;
+{
+	int	ret;
+
+	if (!tun) return -EINVAL;
+	if (!TUNIFFUNC(tun,tp_setfec)) return -EOPNOTSUPP;
+	ret = tun->tunops->tp_setfec (tun->tundata, st);
+	tun->mtime = get_seconds();
+	return ret;
+}
+
+/* num < 0 leaves the path list, reorder < 0 the reorder timeout unchanged */
+int
+ldt_tun_setpaths (tun, cfg, num, reorder)
+	struct ldt_tun			*tun;
+	struct ldt_pathcfg	*cfg;
+	int						num, reorder;
+{
+	int	ret;
+
+	if (!tun) return -EINVAL;
+	/* only bonding tunnels have paths */
+	if (!TUNIFFUNC(tun,tp_setpaths)) return -EOPNOTSUPP;
+	ret = tun->tunops->tp_setpaths (tun->tundata, cfg, num, reorder);
+	tun->mtime = get_seconds();
+	return ret;
+}
+
+/* st is taken over on success - NULL switches the class copying off */
+int
+ldt_tun_setqos (tun, st)
+	struct ldt_tun				*tun;
+	struct ldt_qos_state		*st;
+{
+	int	ret;
+
+	if (!tun) return -EINVAL;
+	if (!TUNIFFUNC(tun,tp_setqos)) return -EOPNOTSUPP;
+	ret = tun->tunops->tp_setqos (tun->tundata, st);
+	tun->mtime = get_seconds();
 	return ret;
 }
 
@@ -62,11 +62,37 @@ struct sock;
 #define LDT_TUN_BIND_F_ADDRCHG	0x02
 
 struct ldt_tun;
+struct ldt_latency;
+struct ldt_rxsteer_cfg;
+struct ldt_aead_key;
+struct ldt_fec_state;
+struct ldt_qos_state;
+struct ldt_qbands;
+
+/* socket options - negative values are left unchanged */
+struct ldt_sockopt {
+	int	txccid, rxccid;		/* 0 = kernel default */
+	int	sndbuf, rcvbuf;		/* 0 = kernel default */
+	int	cscov;
+	s64	service;					/* 0 = none */
+	u32	flags;					/* LDT_SOCKOPT_F_* */
+};
+#define LDT_SOCKOPT_UNSET \
+	((struct ldt_sockopt) { .txccid = -1, .rxccid = -1, .sndbuf = -1, \
+									.rcvbuf = -1, .cscov = -1, .service = -1 })
+
+/* one path of a bonding tunnel */
+struct ldt_pathcfg {
+	tp_addr_t	local;				/* AF_UNSPEC - any address */
+	char			dev[IFNAMSIZ];		/* empty - any interface */
+	u32			rate;					/* bytes/s until measured, 0 - default */
+};
+
 struct ldt_tunops {
 	int (*tp_new)(struct ldt_tun*, const char *);
 	int (*tp_bind)(void*, tp_addr_t*, int);
 	int (*tp_peer)(void*, tp_addr_t*);
-	int (*tp_serverstart)(void*);
+	int (*tp_serverstart)(void*, int);
 	void (*tp_remove)(void*);
 	netdev_tx_t (*tp_xmit)(void*,struct sk_buff*);
 	int (*tp_prot1xmit)(void*, char*, int, tp_addr_t*);
@@ -74,7 +100,18 @@ struct ldt_tunops {
 	int (*tp_createvent)(void*, char*, size_t, const char*, const char*);
 	int (*tp_needheadroom)(void*);
 	int (*tp_getmtu)(void*);
-	int (*tp_setqueue)(void*, int, int);
+	int (*tp_setqueue)(void*, int, int, struct ldt_qbands*);
+	int (*tp_peerlist)(void*, tp_addr_t*, tp_addr_t*, int, int, int, u32, int);
+	int (*tp_clientroute)(void*, tp_addr_t*, tp_addr_t*, int, int);
+	int (*tp_getlatency)(void*, struct ldt_latency*, int);
+	int (*tp_setsockopt)(void*, struct ldt_sockopt*);
+	int (*tp_setrxsteer)(void*, struct ldt_rxsteer_cfg*);
+	int (*tp_setrebind)(void*, int, int);
+	int (*tp_setaead)(void*, struct ldt_aead_key*, struct ldt_aead_key*, u32);
+	int (*tp_setpace)(void*, s64, int, int);
+	int (*tp_setfec)(void*, struct ldt_fec_state*);
+	int (*tp_setpaths)(void*, struct ldt_pathcfg*, int, int);
+	int (*tp_setqos)(void*, struct ldt_qos_state*);
 	int	ipv6;
 };
 
@@ -129,7 +166,7 @@ ldt_tun_xmit (struct ldt_tun *tun, struct sk_buff *skb)
 int ldt_tun_bind (struct ldt_tun*, tp_addr_t *addr);
 int ldt_tun_rebind (struct ldt_tun*, int flags);
 int ldt_tun_peer (struct ldt_tun*, tp_addr_t *addr);
-int ldt_tun_serverstart (struct ldt_tun*);
+int ldt_tun_serverstart (struct ldt_tun*, int flags);
 int ldt_tun_getmtu (struct ldt_tun *tun);
 int ldt_tun_needheadroom (struct ldt_tun *tun);
 ssize_t ldt_tun_gettuninfo (	struct ldt_tun *tun, char *buf,
@@ -140,7 +177,23 @@ int ldt_tun_createvent (	struct ldt_tun *tun, char *evbuf,
 int ldt_tun_prot1xmit (struct ldt_tun *tun, char *buf, int blen,
 									tp_addr_t *addr, int force);
 
-int ldt_tun_setqueue (struct ldt_tun*, int txlen, int qpolicy);
+int ldt_tun_setqueue (struct ldt_tun*, int txlen, int qpolicy,
+							struct ldt_qbands*);
+int ldt_tun_peerlist (struct ldt_tun*, tp_addr_t *list, tp_addr_t *local,
+								int num, int backoff_min, int backoff_max,
+								u32 flags, int stagger);
+int ldt_tun_clientroute (struct ldt_tun*, tp_addr_t *raddr, tp_addr_t *inner,
+								int plen, int flags);
+int ldt_tun_getlatency (struct ldt_tun*, struct ldt_latency*, int reset);
+int ldt_tun_setsockopt (struct ldt_tun*, struct ldt_sockopt*);
+int ldt_tun_setrxsteer (struct ldt_tun*, struct ldt_rxsteer_cfg*);
+int ldt_tun_setrebind (struct ldt_tun*, int mode, int drain);
+int ldt_tun_setaead (struct ldt_tun*, struct ldt_aead_key *tx,
+							struct ldt_aead_key *rx, u32 flags);
+int ldt_tun_setpace (struct ldt_tun*, s64 rate, int burst, int flags);
+int ldt_tun_setfec (struct ldt_tun*, struct ldt_fec_state*);
+int ldt_tun_setpaths (struct ldt_tun*, struct ldt_pathcfg*, int num, int reorder);
+int ldt_tun_setqos (struct ldt_tun*, struct ldt_qos_state*);
 
 
 
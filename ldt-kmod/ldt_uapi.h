@@ -90,6 +90,19 @@ enum ldt_nl_commands {
 	LDT_CMD_SEND_INFO,			/* answer */
 	LDT_CMD_SEND_EVENT,			/* unsolicate event answer */
 	LDT_CMD_EVSEND,
+	LDT_CMD_PEERLIST,
+	LDT_CMD_CLIENTROUTE,
+	LDT_CMD_BULK,
+	LDT_CMD_GET_LATENCY,
+	LDT_CMD_SET_SOCKOPT,
+	LDT_CMD_SET_RXSTEER,
+	LDT_CMD_SET_REBIND,
+	LDT_CMD_SET_AEAD,
+	LDT_CMD_SET_PACE,
+	LDT_CMD_SET_FEC,
+	LDT_CMD_SET_PATHS,
+	LDT_CMD_SET_QOS,
+	LDT_CMD_SUBSCRIBE_UPDATE,	/* changes the filter of a subscription */
 	__LDT_CMD_MAX
 };
 #define LDT_CMD_MAX (__LDT_CMD_MAX - 1)
@@ -188,10 +201,14 @@ enum ldt_attr_peer {
 enum ldt_attr_serverstart {
 	LDT_CMD_SERVERSTART_ATTR_UNSPEC,
 	LDT_CMD_SERVERSTART_ATTR_NAME,		/* NLA_NUL_STRING */
+	LDT_CMD_SERVERSTART_ATTR_FLAGS,		/* NLA_U32 */
 	__LDT_CMD_SERVERSTART_ATTR_MAX
 };
 #define LDT_CMD_SERVERSTART_ATTR_MAX	(__LDT_CMD_SERVERSTART_ATTR_MAX - 1)
 
+/* keep all accepted connections instead of replacing the active one */
+#define LDT_SERVERSTART_F_MULTICLIENT	0x01
+
 
 enum ldt_attrs_set_mtu {
 	LDT_CMD_SET_MTU_ATTR_UNSPEC,
@@ -207,13 +224,36 @@ enum ldt_attrs_setqueue {
 	LDT_CMD_SETQUEUE_ATTR_NAME,			/* NLA_NUL_STRING */
 	LDT_CMD_SETQUEUE_ATTR_TXQLEN,		/* NLA_U16 */
 	LDT_CMD_SETQUEUE_ATTR_QPOLICY,		/* NLA_U16 */
+	LDT_CMD_SETQUEUE_ATTR_BANDS,		/* NLA_BINARY - struct ldt_qbands */
 	__LDT_CMD_SETQUEUE_ATTR_MAX
 };
 #define LDT_CMD_SETQUEUE_ATTR_MAX (__LDT_CMD_SETQUEUE_ATTR_MAX - 1)
 
 #define LDT_CMD_SETQUEUE_QPOLICY_DROP_NEWEST	0
 #define LDT_CMD_SETQUEUE_QPOLICY_DROP_OLDEST	1
-#define LDT_CMD_SETQUEUE_QPOLICY_MAX				1
+#define LDT_CMD_SETQUEUE_QPOLICY_BANDS			2
+#define LDT_CMD_SETQUEUE_QPOLICY_MAX				2
+
+/* multi band tx queue (LDT_CMD_SETQUEUE_QPOLICY_BANDS) - packets are
+ * classified by the dscp (traffic class) of the inner ip header or by
+ * skb->priority (values above 63 use map[63]), band 0 is the highest
+ * priority. Packets that cannot be classified (prot 1, not ip) go to
+ * dflt. Each band drops the newest packet when it is full. */
+#define LDT_QBANDS_MIN				2
+#define LDT_QBANDS_MAX				8
+#define LDT_QBANDS_CLS_DSCP		0
+#define LDT_QBANDS_CLS_PRIO		1
+#define LDT_QBANDS_SCHED_STRICT	0		/* lower band first */
+#define LDT_QBANDS_SCHED_WRR		1		/* weighted round robin */
+struct ldt_qbands {
+	__u8		nbands;							/* LDT_QBANDS_MIN..LDT_QBANDS_MAX */
+	__u8		classify;						/* LDT_QBANDS_CLS_* */
+	__u8		sched;							/* LDT_QBANDS_SCHED_* */
+	__u8		dflt;
+	__u8		map[64];							/* dscp / priority -> band */
+	__u16		limit[LDT_QBANDS_MAX];		/* packets, 0 = tx queue length */
+	__u16		weight[LDT_QBANDS_MAX];		/* wrr - packets per round, 0 = 1 */
+};
 
 
 enum ldt_attrs_send_info {
@@ -233,6 +273,19 @@ enum ldt_attrs_send_event {
 };
 #define LDT_CMD_SEND_EVENT_ATTR_MAX (__LDT_CMD_SEND_EVENT_ATTR_MAX - 1)
 
+/* event filter of LDT_CMD_SUBSCRIBE and LDT_CMD_SUBSCRIBE_UPDATE - a
+ * missing attribute does not filter. Events without interface (e.g.
+ * tpdown) pass the interface filter.
+ */
+enum ldt_attrs_subscribe {
+	LDT_CMD_SUBSCRIBE_ATTR_UNSPEC,
+	LDT_CMD_SUBSCRIBE_ATTR_IFLIST,		/* NLA_BINARY - char[16][] */
+	LDT_CMD_SUBSCRIBE_ATTR_EVMASK,		/* NLA_U32 - 1 << LDT_EVTYPE_* */
+	__LDT_CMD_SUBSCRIBE_ATTR_MAX,
+};
+#define LDT_CMD_SUBSCRIBE_ATTR_MAX (__LDT_CMD_SUBSCRIBE_ATTR_MAX - 1)
+#define LDT_SUBSCRIBE_MAXIF		16
+
 enum ldt_attrs_evsend {
 	LDT_CMD_EVSEND_ATTR_UNSPEC,
 	LDT_CMD_EVSEND_ATTR_NAME,		/* NLA_NUL_STRING */
@@ -242,6 +295,398 @@ enum ldt_attrs_evsend {
 };
 #define LDT_CMD_EVSEND_ATTR_MAX (__LDT_CMD_EVSEND_ATTR_MAX - 1)
 
+enum ldt_attrs_peerlist {
+	LDT_CMD_PEERLIST_ATTR_UNSPEC,
+	LDT_CMD_PEERLIST_ATTR_NAME,			/* NLA_NUL_STRING */
+	LDT_CMD_PEERLIST_ATTR_LIST,			/* NLA_BINARY - struct ldt_peeraddr[] */
+	LDT_CMD_PEERLIST_ATTR_BACKOFF_MIN,	/* NLA_U32 - msec */
+	LDT_CMD_PEERLIST_ATTR_BACKOFF_MAX,	/* NLA_U32 - msec */
+	LDT_CMD_PEERLIST_ATTR_LOCAL,			/* NLA_BINARY - struct ldt_peeraddr[] */
+	LDT_CMD_PEERLIST_ATTR_FLAGS,			/* NLA_U32 */
+	LDT_CMD_PEERLIST_ATTR_STAGGER,		/* NLA_U32 - msec */
+	__LDT_CMD_PEERLIST_ATTR_MAX
+};
+#define LDT_CMD_PEERLIST_ATTR_MAX (__LDT_CMD_PEERLIST_ATTR_MAX - 1)
+
+/* one peer candidate - the list is tried in order, an empty list
+ * switches off automatic reconnect
+ */
+struct ldt_peeraddr {
+	__u8		ipv6;
+	__u8		_pad;
+	__u16		port;				/* host byte order */
+	union {
+		__u32	v4;				/* network byte order */
+		__u8	v6[16];
+	}			addr;
+};
+#define LDT_PEERLIST_MAX				8
+#define LDT_PEERLIST_BACKOFF_MIN		500		/* msec */
+#define LDT_PEERLIST_BACKOFF_MAX		60000		/* msec */
+
+/* race mode: all candidates are connected in parallel, started
+ * LDT_CMD_PEERLIST_ATTR_STAGGER msec apart in the order of their last
+ * connect latency, the first connection established is kept. The
+ * optional local address list (same length as the candidate list,
+ * all zero entries use the tunnel's address) is used in race mode only.
+ */
+#define LDT_PEERLIST_F_RACE			0x01
+#define LDT_PEERLIST_STAGGER			250		/* msec */
+
+/* assigns an inner prefix to the client(s) connecting from the given
+ * outer address (port 0 matches any port) - multi client servers only
+ */
+enum ldt_attrs_clientroute {
+	LDT_CMD_CLIENTROUTE_ATTR_UNSPEC,
+	LDT_CMD_CLIENTROUTE_ATTR_NAME,		/* NLA_NUL_STRING */
+	LDT_CMD_CLIENTROUTE_ATTR_ADDR4,		/* NLA_U32 */
+	LDT_CMD_CLIENTROUTE_ATTR_ADDR6,		/* NLA_BINARY */
+	LDT_CMD_CLIENTROUTE_ATTR_PORT,		/* NLA_U16 */
+	LDT_CMD_CLIENTROUTE_ATTR_INNER4,		/* NLA_U32 */
+	LDT_CMD_CLIENTROUTE_ATTR_INNER6,		/* NLA_BINARY */
+	LDT_CMD_CLIENTROUTE_ATTR_PREFIXLEN,	/* NLA_U8 */
+	LDT_CMD_CLIENTROUTE_ATTR_FLAGS,		/* NLA_U32 */
+	__LDT_CMD_CLIENTROUTE_ATTR_MAX
+};
+#define LDT_CMD_CLIENTROUTE_ATTR_MAX (__LDT_CMD_CLIENTROUTE_ATTR_MAX - 1)
+
+#define LDT_CLIENTROUTE_F_DEL	0x01
+
+/* bulk provisioning - creates and configures a list of devices in one
+ * request, the answer (LDT_CMD_SEND_INFO) carries one struct ldt_bulkres
+ * per entry in the order of the request
+ */
+enum ldt_attrs_bulk {
+	LDT_CMD_BULK_ATTR_UNSPEC,
+	LDT_CMD_BULK_ATTR_LIST,			/* NLA_NESTED - LDT_BULK_ATTR_DEV[] */
+	LDT_CMD_BULK_ATTR_FLAGS,		/* NLA_U32 */
+	__LDT_CMD_BULK_ATTR_MAX
+};
+#define LDT_CMD_BULK_ATTR_MAX (__LDT_CMD_BULK_ATTR_MAX - 1)
+
+#define LDT_BULK_ATTR_DEV		1	/* NLA_NESTED - enum ldt_attrs_bulkdev */
+
+#define LDT_BULK_F_EXIST		0x01	/* reconfigure already existing devices */
+#define LDT_BULK_F_NOROLLBACK	0x02	/* keep created devices on failure */
+
+enum ldt_attrs_bulkdev {
+	LDT_BULKDEV_ATTR_UNSPEC,
+	LDT_BULKDEV_ATTR_NAME,			/* NLA_NUL_STRING */
+	LDT_BULKDEV_ATTR_DEVFLAGS,		/* NLA_U32 - as for create_dev */
+	LDT_BULKDEV_ATTR_TUN_TYPE,		/* NLA_NUL_STRING */
+	LDT_BULKDEV_ATTR_LADDR4,		/* NLA_U32 */
+	LDT_BULKDEV_ATTR_LADDR6,		/* NLA_BINARY */
+	LDT_BULKDEV_ATTR_LPORT,			/* NLA_U16 */
+	LDT_BULKDEV_ATTR_BIND2DEV,		/* NLA_NUL_STRING */
+	LDT_BULKDEV_ATTR_RADDR4,		/* NLA_U32 */
+	LDT_BULKDEV_ATTR_RADDR6,		/* NLA_BINARY */
+	LDT_BULKDEV_ATTR_RPORT,			/* NLA_U16 */
+	LDT_BULKDEV_ATTR_SERVER,		/* NLA_U32 - serverstart flags */
+	LDT_BULKDEV_ATTR_TXQLEN,		/* NLA_U16 */
+	LDT_BULKDEV_ATTR_QPOLICY,		/* NLA_U16 */
+	LDT_BULKDEV_ATTR_MTU,			/* NLA_U32 */
+	__LDT_BULKDEV_ATTR_MAX
+};
+#define LDT_BULKDEV_ATTR_MAX (__LDT_BULKDEV_ATTR_MAX - 1)
+
+/* step an entry failed in */
+enum ldt_bulk_step {
+	LDT_BULK_STEP_NONE,
+	LDT_BULK_STEP_PARSE,
+	LDT_BULK_STEP_CREATE,
+	LDT_BULK_STEP_MTU,
+	LDT_BULK_STEP_NEWTUN,
+	LDT_BULK_STEP_QUEUE,
+	LDT_BULK_STEP_BIND,
+	LDT_BULK_STEP_PEER,
+	LDT_BULK_STEP_SERVER,
+};
+
+struct ldt_bulkres {
+	__s32		ret;					/* 0 or negative errno */
+	__u32		step;					/* enum ldt_bulk_step */
+	char		name[16];			/* device name (IFNAMSIZ) */
+};
+#define LDT_BULK_MAX				256	/* max. entries per request */
+
+/* latency histograms of a tunnel - the answer (LDT_CMD_SEND_INFO)
+ * carries one struct ldt_latency
+ */
+enum ldt_attrs_get_latency {
+	LDT_CMD_GET_LATENCY_ATTR_UNSPEC,
+	LDT_CMD_GET_LATENCY_ATTR_NAME,		/* NLA_NUL_STRING */
+	LDT_CMD_GET_LATENCY_ATTR_FLAGS,		/* NLA_U32 */
+	__LDT_CMD_GET_LATENCY_ATTR_MAX
+};
+#define LDT_CMD_GET_LATENCY_ATTR_MAX (__LDT_CMD_GET_LATENCY_ATTR_MAX - 1)
+
+#define LDT_LATENCY_F_RESET	0x01	/* reset histograms after reading */
+
+/* log2 histogram: bucket 0 counts 0 nsec, bucket i (i>0) counts
+ * [2^(i-1), 2^i) nsec, the last bucket everything above */
+#define LDT_LATHIST_BUCKETS	32
+struct ldt_lathist {
+	__u64		count;
+	__u64		sum;				/* nsec */
+	__u64		max;				/* nsec */
+	__u64		bucket[LDT_LATHIST_BUCKETS];
+};
+
+enum ldt_latency_type {
+	LDT_LAT_SOJOURN,		/* enqueue -> dequeue of tx queue */
+	LDT_LAT_SCHED,			/* xmit work queued -> xmit work running */
+	LDT_LAT_SEND,			/* duration of socket send */
+	LDT_LAT_NUM
+};
+
+struct ldt_latency {
+	__u64						age;			/* msec since last reset */
+	struct ldt_lathist	hist[LDT_LAT_NUM];
+};
+
+
+/* socket options of (mp-)dccp tunnels - missing attributes are left
+ * unchanged. ccid, service code and checksum coverage are negotiated
+ * on connect, hence take effect with the next (re)connect. the buffer
+ * sizes are applied to the running socket, too. */
+enum ldt_attrs_set_sockopt {
+	LDT_CMD_SET_SOCKOPT_ATTR_UNSPEC,
+	LDT_CMD_SET_SOCKOPT_ATTR_NAME,		/* NLA_NUL_STRING */
+	LDT_CMD_SET_SOCKOPT_ATTR_TXCCID,		/* NLA_U8 - 0 = default */
+	LDT_CMD_SET_SOCKOPT_ATTR_RXCCID,		/* NLA_U8 - 0 = default */
+	LDT_CMD_SET_SOCKOPT_ATTR_SNDBUF,		/* NLA_U32 - bytes, 0 = default */
+	LDT_CMD_SET_SOCKOPT_ATTR_RCVBUF,		/* NLA_U32 - bytes, 0 = default */
+	LDT_CMD_SET_SOCKOPT_ATTR_SERVICE,	/* NLA_U32 - dccp service code */
+	LDT_CMD_SET_SOCKOPT_ATTR_CSCOV,		/* NLA_U8 - 0..15, 0 = full */
+	LDT_CMD_SET_SOCKOPT_ATTR_FLAGS,		/* NLA_U32 */
+	__LDT_CMD_SET_SOCKOPT_ATTR_MAX
+};
+#define LDT_CMD_SET_SOCKOPT_ATTR_MAX (__LDT_CMD_SET_SOCKOPT_ATTR_MAX - 1)
+
+#define LDT_SOCKOPT_F_FORCEBUF	0x01	/* ignore net.core.[wr]mem_max */
+#define LDT_SOCKOPT_CSCOV_MAX		15
+
+
+/* receive steering: on which cpu decapsulated packets are handed to
+ * the network stack */
+enum ldt_attrs_set_rxsteer {
+	LDT_CMD_SET_RXSTEER_ATTR_UNSPEC,
+	LDT_CMD_SET_RXSTEER_ATTR_NAME,		/* NLA_NUL_STRING */
+	LDT_CMD_SET_RXSTEER_ATTR_MODE,		/* NLA_U32 - LDT_RXSTEER_* */
+	LDT_CMD_SET_RXSTEER_ATTR_CPUS,		/* NLA_BINARY - u32 words,
+													 * bit i = cpu i */
+	__LDT_CMD_SET_RXSTEER_ATTR_MAX
+};
+#define LDT_CMD_SET_RXSTEER_ATTR_MAX (__LDT_CMD_SET_RXSTEER_ATTR_MAX - 1)
+
+#define LDT_RXSTEER_OFF		0	/* deliver on the receiving cpu */
+#define LDT_RXSTEER_CPU		1	/* pin tunnel to one cpu of the set */
+#define LDT_RXSTEER_HASH	2	/* spread inner flows across the set */
+#define LDT_RXSTEER_MAX		2
+#define LDT_RXSTEER_MAXCPUS	4096
+
+
+/* how a connected tunnel is moved to a new local address (tunbind,
+ * bind2dev, address change of the physical device):
+ * break - close the old connection, then connect the new one
+ * mbb   - make before break: connect the new socket first, switch the
+ *         transmit path over and close the old socket after the drain
+ *         time, packets still arriving on the old path are received
+ * missing attributes are left unchanged */
+enum ldt_attrs_set_rebind {
+	LDT_CMD_SET_REBIND_ATTR_UNSPEC,
+	LDT_CMD_SET_REBIND_ATTR_NAME,		/* NLA_NUL_STRING */
+	LDT_CMD_SET_REBIND_ATTR_MODE,		/* NLA_U32 - LDT_REBIND_* */
+	LDT_CMD_SET_REBIND_ATTR_DRAIN,		/* NLA_U32 - msec */
+	__LDT_CMD_SET_REBIND_ATTR_MAX
+};
+#define LDT_CMD_SET_REBIND_ATTR_MAX (__LDT_CMD_SET_REBIND_ATTR_MAX - 1)
+
+#define LDT_REBIND_BREAK		0
+#define LDT_REBIND_MBB			1
+#define LDT_REBIND_MAX			1
+#define LDT_REBIND_DRAIN_DEF	1000		/* msec */
+#define LDT_REBIND_DRAIN_MAX	60000		/* msec */
+
+
+/* aead protection of the tunnel payload (packet type 2):
+ *   byte 0      - 0x20 | key id (0..15)
+ *   byte 1      - algorithm (LDT_AEAD_*)
+ *   byte 2..3   - 0
+ *   byte 4..11  - sequence number (network byte order), the top bit is
+ *                 set by the server side
+ *   ciphertext of the inner packet, 16 byte tag
+ * the header is authenticated, the nonce is the 4 byte salt followed by
+ * the sequence number - both directions can use the same key. Packets
+ * carrying the receivers own role are dropped. The key attribute is the key followed by the
+ * salt. Keys are rotated by installing the new key with a new key id for
+ * receiving on both sides first, then for sending. Two receive keys are
+ * kept. Missing attributes are left unchanged.
+ */
+enum ldt_attrs_set_aead {
+	LDT_CMD_SET_AEAD_ATTR_UNSPEC,
+	LDT_CMD_SET_AEAD_ATTR_NAME,			/* NLA_NUL_STRING */
+	LDT_CMD_SET_AEAD_ATTR_ALG,				/* NLA_U32 - LDT_AEAD_* */
+	LDT_CMD_SET_AEAD_ATTR_KEY,				/* NLA_BINARY - key + salt */
+	LDT_CMD_SET_AEAD_ATTR_KEYID,			/* NLA_U8 - 0..15 */
+	LDT_CMD_SET_AEAD_ATTR_FLAGS,			/* NLA_U32 - LDT_AEAD_F_* */
+	__LDT_CMD_SET_AEAD_ATTR_MAX
+};
+#define LDT_CMD_SET_AEAD_ATTR_MAX (__LDT_CMD_SET_AEAD_ATTR_MAX - 1)
+
+#define LDT_AEAD_NONE					0
+#define LDT_AEAD_AES_GCM				1		/* key 16, 24 or 32 bytes */
+#define LDT_AEAD_CHACHA20_POLY1305	2		/* key 32 bytes */
+#define LDT_AEAD_MAX						2
+
+#define LDT_AEAD_SALTLEN		4
+#define LDT_AEAD_MAXKEYLEN		(32 + LDT_AEAD_SALTLEN)
+#define LDT_AEAD_HDRLEN			12
+#define LDT_AEAD_TAGLEN			16
+#define LDT_AEAD_OVERHEAD		(LDT_AEAD_HDRLEN + LDT_AEAD_TAGLEN)
+#define LDT_AEAD_KEYID_MAX		15
+
+#define LDT_AEAD_F_TX			0x01	/* use key for sending */
+#define LDT_AEAD_F_RX			0x02	/* accept key for receiving */
+#define LDT_AEAD_F_REQUIRE		0x04	/* drop packets not protected */
+#define LDT_AEAD_F_OPTIONAL	0x08	/* accept unprotected packets */
+#define LDT_AEAD_F_FLUSH		0x10	/* remove all keys */
+
+
+/* pacing of the tunnel egress - a token bucket of the given rate and
+ * burst size, the queue is drained by a high resolution timer when the
+ * bucket is empty. With LDT_PACE_F_LEARN the rate is taken from the
+ * dccp ccid (ccid 3 only) and the configured rate (if any) acts as an
+ * upper limit. Learning fails with EOPNOTSUPP on kernels >= 5.8 (no
+ * kernel_getsockopt) and on multi client servers. A learned rate change
+ * keeps the tokens in the bucket. Missing attributes are left unchanged.
+ */
+enum ldt_attrs_set_pace {
+	LDT_CMD_SET_PACE_ATTR_UNSPEC,
+	LDT_CMD_SET_PACE_ATTR_NAME,			/* NLA_NUL_STRING */
+	LDT_CMD_SET_PACE_ATTR_RATE,			/* NLA_U64 - bytes/sec, 0 = off */
+	LDT_CMD_SET_PACE_ATTR_BURST,			/* NLA_U32 - bytes */
+	LDT_CMD_SET_PACE_ATTR_FLAGS,			/* NLA_U32 - LDT_PACE_F_* */
+	__LDT_CMD_SET_PACE_ATTR_MAX
+};
+#define LDT_CMD_SET_PACE_ATTR_MAX (__LDT_CMD_SET_PACE_ATTR_MAX - 1)
+
+#define LDT_PACE_RATE_MAX		0xffffffffULL	/* bytes/sec */
+#define LDT_PACE_BURST_DEF		15000				/* bytes */
+#define LDT_PACE_BURST_MAX		(16*1024*1024)
+#define LDT_PACE_F_LEARN		0x01
+
+
+/* forward error correction (packet type 3) - one xor parity packet per
+ * group of k data packets, a single lost packet per group is recovered.
+ *   byte 0      - 0x30 | LDT_FEC_T_*
+ *   byte 1      - data: k, parity: number of data packets covered
+ *   byte 2      - data: index within group, parity: 0
+ *   byte 3      - 0
+ *   byte 4..5   - group id (network byte order)
+ *   byte 6..7   - data: 0, parity: xor of the data packet lengths
+ *   data packet or xor of the data packets (zero padded)
+ * A group not completed within delay is closed by an early parity packet.
+ * k = 0 only recovers received packets. Both sides must enable fec.
+ */
+enum ldt_attrs_set_fec {
+	LDT_CMD_SET_FEC_ATTR_UNSPEC,
+	LDT_CMD_SET_FEC_ATTR_NAME,			/* NLA_NUL_STRING */
+	LDT_CMD_SET_FEC_ATTR_MODE,			/* NLA_U32 - LDT_FEC_* */
+	LDT_CMD_SET_FEC_ATTR_K,				/* NLA_U8 - data packets per parity */
+	LDT_CMD_SET_FEC_ATTR_DELAY,		/* NLA_U32 - msec */
+	__LDT_CMD_SET_FEC_ATTR_MAX
+};
+#define LDT_CMD_SET_FEC_ATTR_MAX (__LDT_CMD_SET_FEC_ATTR_MAX - 1)
+
+#define LDT_FEC_OFF			0
+#define LDT_FEC_XOR			1
+#define LDT_FEC_MAX			1
+
+#define LDT_FEC_T_DATA		0
+#define LDT_FEC_T_PARITY	1
+
+#define LDT_FEC_HDRLEN		8
+#define LDT_FEC_MAXLEN		2048		/* larger packets are not protected */
+#define LDT_FEC_K_DEF		8
+#define LDT_FEC_K_MAX		32
+#define LDT_FEC_DELAY_DEF	20			/* msec */
+#define LDT_FEC_DELAY_MAX	1000
+
+
+/* bonding tunnel (type bond, bond4, bond6) - one udp socket per path,
+ * the packets are striped over all paths that are up and put back in
+ * order by the receiver. The server learns the paths of its client.
+ * Packet type 5:
+ *   byte 0      - 0x50 | LDT_BOND_T_*
+ *   byte 1      - path id
+ *   byte 2..3   - 0
+ *   byte 4..7   - data: sequence number, probe/ack: probe number
+ *                 (network byte order)
+ *   data: the tunneled packet
+ *   probe: 8 byte timestamp, 8 byte zero
+ *   ack: 8 byte timestamp of the probe, packets and bytes received on
+ *        this path (4 byte each, network byte order)
+ */
+enum ldt_attrs_set_paths {
+	LDT_CMD_SET_PATHS_ATTR_UNSPEC,
+	LDT_CMD_SET_PATHS_ATTR_NAME,		/* NLA_NUL_STRING */
+	LDT_CMD_SET_PATHS_ATTR_LIST,		/* NLA_BINARY - struct ldt_bondpath[] */
+	LDT_CMD_SET_PATHS_ATTR_REORDER,	/* NLA_U32 - msec */
+	__LDT_CMD_SET_PATHS_ATTR_MAX
+};
+#define LDT_CMD_SET_PATHS_ATTR_MAX (__LDT_CMD_SET_PATHS_ATTR_MAX - 1)
+
+/* one path of a bonding client - an empty list uses the tunnel's
+ * address only
+ */
+struct ldt_bondpath {
+	struct ldt_peeraddr	local;		/* all zero - any address */
+	char						dev[16];		/* interface to bind to, empty - any */
+	__u32						rate;			/* bytes/s until measured, 0 - default */
+};
+#define LDT_BOND_MAXPATH			8
+#define LDT_BOND_REORDER_DEF		50			/* msec */
+#define LDT_BOND_REORDER_MAX		2000
+#define LDT_BOND_RATE_INIT			1250000	/* bytes/s */
+#define LDT_BOND_RATE_MAX			0xffffffffU
+#define LDT_BOND_PROBE				100		/* msec - probe interval */
+#define LDT_BOND_DEAD				1000		/* msec - no ack: path is down */
+
+#define LDT_BOND_T_DATA				0
+#define LDT_BOND_T_PROBE			1
+#define LDT_BOND_T_ACK				2
+
+#define LDT_BOND_HDRLEN				8
+#define LDT_BOND_CTLLEN				16			/* probe and ack payload */
+
+
+/* class of the outer packets - taken from the inner ip packet and
+ * written to the tunnel socket before it is sent. Other packets
+ * (control, fec parity) keep the class of the packet before.
+ */
+enum ldt_attrs_set_qos {
+	LDT_CMD_SET_QOS_ATTR_UNSPEC,
+	LDT_CMD_SET_QOS_ATTR_NAME,			/* NLA_NUL_STRING */
+	LDT_CMD_SET_QOS_ATTR_CFG,			/* NLA_BINARY - struct ldt_qoscfg */
+	__LDT_CMD_SET_QOS_ATTR_MAX
+};
+#define LDT_CMD_SET_QOS_ATTR_MAX (__LDT_CMD_SET_QOS_ATTR_MAX - 1)
+
+#define LDT_QOS_DSCP_OFF		0		/* socket default */
+#define LDT_QOS_DSCP_COPY		1		/* outer dscp = inner dscp */
+#define LDT_QOS_DSCP_MAP		2		/* outer dscp = map[inner dscp] */
+#define LDT_QOS_DSCP_MAX		2
+#define LDT_QOS_F_PRIO			0x01	/* copy skb->priority */
+#define LDT_QOS_F_MARK			0x02	/* copy skb->mark & markmask */
+struct ldt_qoscfg {
+	__u8		dscp;						/* LDT_QOS_DSCP_* */
+	__u8		_pad[3];
+	__u32		flags;					/* LDT_QOS_F_* */
+	__u32		markmask;				/* 0 - all bits */
+	__u8		map[64];					/* inner dscp -> outer dscp */
+};
+
 
 /* event definition */
 
@@ -268,11 +713,50 @@ enum ldt_event_type {
 	LDT_EVTYPE_CONN_ACCEPT_FAIL,		/* connection failed to accept */
 	LDT_EVTYPE_CONN_LISTEN,			/* server listening */
 	LDT_EVTYPE_CONN_LISTEN_FAIL,		/* listening failed */
+	LDT_EVTYPE_PEER_UP,					/* client connected (multi client server) */
+	LDT_EVTYPE_PEER_DOWN,				/* client disconnected (multi client server) */
 	__LDT_EVTYPE_MAX,
 };
 #define LDT_EVTYPE_MAX (__LDT_EVTYPE_MAX - 1)
 
 
+/* binary event ring - every network namespace has its own ring, it is
+ * mmap()ed read only from LDT_EVRING_DEV: the first page holds
+ * struct ldt_evring_hdr, the records start at hdrsz. the kernel never
+ * waits for a reader, old records are overwritten - a reader finds out
+ * about lost records by the sequence numbers.
+ * record n (n>=1) lives in slot (n-1) & (nrec-1), its seq is set last,
+ * hdr->head is the seq of the last complete record.
+ * poll() signals records newer than the last read(), read() returns
+ * the current head (u64) and blocks if there is none newer.
+ */
+#define LDT_EVRING_DEV			"/dev/ldt_events"
+#define LDT_EVRING_MAGIC		0x4c445445		/* "LDTE" */
+#define LDT_EVRING_VERSION		1
+
+struct ldt_evring_hdr {
+	__u32		magic;
+	__u32		version;
+	__u32		hdrsz;			/* offset of first record */
+	__u32		recsz;			/* size of one record */
+	__u32		nrec;				/* number of slots - power of 2 */
+	__u32		resv;
+	__u64		head;				/* seq of last record written, 0 = none */
+};
+
+struct ldt_evrec {
+	__u64		seq;				/* 0 while the slot is written */
+	__u64		tstamp;			/* CLOCK_REALTIME - nsec */
+	__u64		mono;				/* CLOCK_MONOTONIC - nsec */
+	__u32		evtype;			/* LDT_EVTYPE_* */
+	__s32		ifindex;			/* ldt or network device, 0 = none */
+	__s32		reason;			/* errno of *_FAIL events */
+	__u32		subflow;			/* subflow id of LDT_EVTYPE_SUBFLOW_* */
+	char		iface[16];
+	char		sfname[16];		/* subflow (link) name */
+};
+
+
 
 #ifdef __cplusplus
 }	/* extern "C" */
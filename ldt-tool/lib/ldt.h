@@ -79,11 +79,64 @@ int ldt_get_version (char **version);
 int ldt_get_devlist (char ***devlist);
 int ldt_get_devinfo (const char *name, char **info, uint32_t *ilen);
 int ldt_get_alldevinfo (char **info, uint32_t *ilen);
+int ldt_get_latency (const char *name, struct ldt_latency *lat, uint32_t flags);
 
 int ldt_newtun (const char *name, const char *tuntype);
 int ldt_tun_setpeer (const char *name, frad_t *raddr, tmo_t tout);
+int ldt_tun_setpeerlist (const char *name, frad_t *list, int num,
+									int backoff_min, int backoff_max);
+int ldt_tun_setpeerlist2 (const char *name, frad_t *list, frad_t *local, int num,
+									int backoff_min, int backoff_max, uint32_t flags,
+									int stagger);
 int ldt_tun_serverstart (const char *name, tmo_t tout);
+int ldt_tun_serverstart2 (const char *name, uint32_t flags, tmo_t tout);
+int ldt_tun_clientroute (const char *name, frad_t *raddr, frad_t *inner,
+									int plen, int flags);
 int ldt_tun_setqueue (const char *nam, int txqlen, int qpolicy);
+/* bands: NULL = unchanged, required once for LDT_CMD_SETQUEUE_QPOLICY_BANDS */
+int ldt_tun_setqueue2 (const char *name, int txqlen, int qpolicy,
+								const struct ldt_qbands *bands);
+int ldt_qbands_init (struct ldt_qbands *bands, int nbands, int classify);
+
+/* negative values are left unchanged */
+struct ldt_sockopt {
+	int			txccid, rxccid;		/* 0 = kernel default */
+	int			sndbuf, rcvbuf;		/* bytes, 0 = kernel default */
+	int			cscov;					/* 0..15, 0 = full coverage */
+	int64_t		service;					/* dccp service code */
+	uint32_t		flags;					/* LDT_SOCKOPT_F_* */
+};
+#define LDT_SOCKOPT_INIT	{ .txccid = -1, .rxccid = -1, .sndbuf = -1, \
+									  .rcvbuf = -1, .cscov = -1, .service = -1 }
+int ldt_tun_setsockopt (const char *name, const struct ldt_sockopt *opt);
+/* cpus: bitmap of nwords words, bit i is cpu i - ignored for mode off */
+int ldt_tun_setrxsteer (const char *name, int mode, const uint32_t *cpus,
+									int nwords);
+/* mode LDT_REBIND_*, drain in msec - negative values are left unchanged */
+int ldt_tun_setrebind (const char *name, int mode, int drain);
+/* alg LDT_AEAD_*, key is the key followed by the 4 byte salt,
+ * flags LDT_AEAD_F_* - key is needed with LDT_AEAD_F_TX or LDT_AEAD_F_RX only
+ */
+int ldt_tun_setaead (const char *name, int alg, const uint8_t *key,
+							int keylen, int keyid, uint32_t flags);
+/* rate in bytes/sec (0 = off), burst in bytes, flags LDT_PACE_F_* -
+ * negative values are left unchanged */
+int ldt_tun_setpace (const char *name, int64_t rate, int burst, int flags);
+/* mode LDT_FEC_*, k data packets per parity (0 = receive only),
+ * delay in msec - negative values select the default */
+int ldt_tun_setfec (const char *name, int mode, int k, int delay);
+/* one path of a bonding tunnel - local of family AF_UNSPEC is any
+ * address, dev "" is any interface, rate in bytes/sec (0 = default) */
+struct ldt_path {
+	frad_t		local;
+	char			dev[16];
+	uint32_t		rate;
+};
+/* num < 0 leaves the paths unchanged, reorder in msec (< 0 unchanged) */
+int ldt_tun_setpaths (const char *name, const struct ldt_path *list, int num,
+								int reorder);
+/* cfg NULL switches the class copying off */
+int ldt_tun_setqos (const char *name, const struct ldt_qoscfg *cfg);
 int ldt_tunbind (const char *name, frad_t *laddr);
 int ldt_tunbind2dev (const char *name, const char *dev);
 int ldt_rm_tun (const char *name);
@@ -91,13 +144,48 @@ int ldt_set_mtu (const char *name, uint32_t mtu);
 int ldt_event_send (const char *name, int evtype, int reason);
 
 
+/* bulk provisioning */
+
+struct ldt_bulkdev {
+	/* request */
+	const char	*name;
+	uint32_t		devflags;	/* as for ldt_create_dev */
+	uint32_t		mtu;			/* 0 - leave as is */
+	const char	*tuntype;	/* NULL - no tunnel */
+	int			txqlen;		/* -1 - leave as is */
+	int			qpolicy;		/* -1 - leave as is */
+	const char	*bind2dev;
+	frad_t		laddr;
+	int			hasladdr;
+	frad_t		raddr;
+	int			hasraddr;
+	int			server;		/* -1 - no server, else serverstart flags */
+	/* result */
+	int			ret;			/* 0 or errno */
+	int			step;			/* enum ldt_bulk_step that failed */
+	char			outname[16];
+};
+void ldt_bulkdev_init (struct ldt_bulkdev*);
+int ldt_bulk_apply (struct ldt_bulkdev *list, int num, uint32_t flags,
+							int *numfailed);
+const char *ldt_bulk_stepname (int step);
+int ldt_bulk_parse (const char *buf, struct ldt_bulkdev **list, int *num);
+int ldt_bulk_readfile (const char *fname, struct ldt_bulkdev **list, int *num);
+
+
 
 /* event functions */
 
 int ldt_subscribe ();
+/* subscribe with kernel side filter - ifaces (max. LDT_SUBSCRIBE_MAXIF)
+ * and evmask (1<<LDT_EVTYPE_*) of 0 pass all */
+int ldt_subscribe2 (const char **ifaces, int nif, uint32_t evmask);
+int ldt_subscribe_update (const char **ifaces, int nif, uint32_t evmask);
 int ldt_event_open ();
 int ldt_event_close ();
 int ldt_event_recv (int *evtype, uint32_t *iarg, char **sarg, tmo_t tout);
+int ldt_event_recv2 (int *evtype, uint32_t *iarg, const char **sarg,
+						tmo_t tout);
 
 
 struct ldt_evinfo {
@@ -113,16 +201,43 @@ struct ldt_evinfo {
 	const char	*s_reason;
 	int			bundling;
 	const char	*subflow;
+	int			peeridx;		/* winning peer candidate, -1 if none */
+	int			clientid;	/* multi client server, -1 if none */
+	int			switchover;	/* make before break rebind (usec), -1 if none */
 };
 #define LDT_EVINFO_HFREE(evinfo)	do { if ((evinfo)->buf) free ((evinfo)->buf); } while (0)
 
 
+/* binary event ring (LDT_EVRING_DEV) - lossless as long as the reader
+ * keeps up, otherwise lost counts the records overwritten in between.
+ * fd can be used with poll(), ldt_evring_read() must be called until
+ * it returns RERR_TIMEDOUT with timeout 0 before polling again.
+ */
+struct ldt_evring {
+	int									fd;
+	void									*map;
+	size_t								mapsz;
+	const struct ldt_evring_hdr	*hdr;
+	const char							*rec;
+	uint32_t								recsz;
+	uint32_t								nrec;
+	uint64_t								next;		/* seq of next record to read */
+	uint64_t								lost;		/* records lost so far */
+};
+#define LDT_EVRING_F_OLDEST	0x01	/* start with oldest record available */
+int ldt_evring_open (struct ldt_evring*, int flags);
+int ldt_evring_close (struct ldt_evring*);
+int ldt_evring_fd (struct ldt_evring*);
+int ldt_evring_read (struct ldt_evring*, struct ldt_evrec*, tmo_t timeout);
+
+
 #define LDT_F_CONTONERR	1
 int ldt_waitev (char **evstr, int evtype, tmo_t timeout, int flags);
 int ldt_waitev2 (char **evstr, int *evtype, int listen_evtypes,
 							tmo_t timeout, int flags);
 int ldt_waitifaceev (	struct ldt_evinfo*, const char *listen_iface,
 									uint64_t listen_evtypes, tmo_t timeout, int flags);
+int ldt_evinfo_parse (struct ldt_evinfo*, char *evstr, int evtype);
 
 #define LDT_EVTYPE_ALL	((1<<(LDT_EVTYPE_MAX+1))-1)
 int ldt_getevmap (const char *str);
@@ -141,8 +256,67 @@ struct ldt_status_t {
 int ldt_get_status (struct ldt_status_t **statlist, int *numstat, const char *iface);
 
 
+/* pipelining - requests are sent without waiting for their answer,
+ * failures are reported to the callback (ret is a RERR_* code, errno
+ * is set for RERR_SYSTEM). Tag is the value set by ldt_pipeline_settag()
+ * when the request was sent.
+ */
+typedef void (*ldt_pipeline_cb_t) (void *arg, int tag, int ret);
+#define LDT_PIPELINE_WINDOW	64		/* max. outstanding answers */
+int ldt_pipeline_start (int window, ldt_pipeline_cb_t cb, void *arg);
+void ldt_pipeline_settag (int tag);
+int ldt_pipeline_flush ();
+int ldt_pipeline_stop ();
+
+
+/* asynchronous interface - each context has its own (non blocking)
+ * netlink socket, which can be polled using ldt_ctx_fd(). The submit
+ * functions return a sequence id (> 0) or a RERR_* code. When the answer
+ * arrives ldt_ctx_dispatch() calls the completion callback with err
+ * being 0 or an errno, data holds the answer of info requests.
+ * Events (after ldt_async_subscribe) are passed to the event callback.
+ * Contexts may be used from several threads, callbacks are called
+ * without any lock held.
+ */
+struct ldt_ctx;
+typedef void (*ldt_async_cb_t) (	struct ldt_ctx *ctx, void *arg, int seq,
+											int err, const char *data, uint32_t dlen);
+typedef void (*ldt_async_evcb_t) (	struct ldt_ctx *ctx, void *arg, int evtype,
+												uint32_t iarg, const char *sarg);
+struct ldt_ctx *ldt_ctx_new (int flags);
+void ldt_ctx_free (struct ldt_ctx *ctx);
+int ldt_ctx_fd (struct ldt_ctx *ctx);
+void ldt_ctx_setevcb (struct ldt_ctx *ctx, ldt_async_evcb_t evcb, void *arg);
+int ldt_ctx_pending (struct ldt_ctx *ctx);
+int ldt_ctx_submit (	struct ldt_ctx *ctx, char *msg, size_t len,
+							ldt_async_cb_t cb, void *arg);
+int ldt_ctx_dispatch (struct ldt_ctx *ctx, int maxmsg);
+
+int ldt_async_subscribe (struct ldt_ctx*, ldt_async_cb_t cb, void *arg);
+int ldt_async_create_dev (	struct ldt_ctx*, const char *name, uint32_t flags,
+									ldt_async_cb_t cb, void *arg);
+int ldt_async_rm_dev (	struct ldt_ctx*, const char *name,
+								ldt_async_cb_t cb, void *arg);
+int ldt_async_get_devinfo (	struct ldt_ctx*, const char *name,
+										ldt_async_cb_t cb, void *arg);
+int ldt_async_newtun (	struct ldt_ctx*, const char *name, const char *tuntype,
+								ldt_async_cb_t cb, void *arg);
+int ldt_async_tunbind (	struct ldt_ctx*, const char *name, frad_t *laddr,
+								ldt_async_cb_t cb, void *arg);
+int ldt_async_setpeer (	struct ldt_ctx*, const char *name, frad_t *raddr,
+								ldt_async_cb_t cb, void *arg);
+int ldt_async_serverstart (	struct ldt_ctx*, const char *name, uint32_t flags,
+										ldt_async_cb_t cb, void *arg);
+int ldt_async_set_mtu (	struct ldt_ctx*, const char *name, uint32_t mtu,
+								ldt_async_cb_t cb, void *arg);
+int ldt_async_setqueue (	struct ldt_ctx*, const char *name, int txqlen,
+									int qpolicy, ldt_async_cb_t cb, void *arg);
+
+
 /* the following functions are internally used, do not use them directly */
+#define LDT_NL_F_SYNC	0x01		/* don't pipeline */
 int ldt_nl_getret ();
+int ldt_nl_getret2 (int flags);
 int ldt_nl_getanswer (char **data, uint32_t *dlen);
 int ldt_nl_send (char *msg, size_t len);
 
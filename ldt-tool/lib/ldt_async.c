@@ -0,0 +1,732 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/genetlink.h>
+
+#include <fr/base.h>
+#include <fr/netlink/fnl.h>
+
+#include <ldt/ldt.h>
+
+
+/* asynchronous interface
+ *
+ * Every context has its own netlink socket. Requests are sent without
+ * waiting, the answers are matched by sequence number and handed to
+ * the completion callback given on submit. Events received on the same
+ * socket are handed to the event callback. The socket is non blocking,
+ * ldt_ctx_dispatch() is to be called when ldt_ctx_fd() gets readable.
+ *
+ * The frlib netlink functions keep global state, they are used for
+ * opening and closing only (protected by a global mutex). Sending and
+ * receiving is done on the socket directly.
+ */
+
+struct ldt_areq {
+	uint32_t				seq;
+	ldt_async_cb_t		cb;
+	void					*arg;
+	struct ldt_areq	*next;
+};
+
+struct ldt_ctx {
+	int					sd;
+	int					famid;
+	uint32_t				portid;
+	uint32_t				seq;
+	pthread_mutex_t	lock;
+	struct ldt_areq	*pending;
+	struct ldt_areq	**ptail;
+	ldt_async_evcb_t	evcb;
+	void					*evarg;
+	char					*rbuf;
+	size_t				rblen;
+};
+
+/* what dispatch got from the socket */
+struct ldt_amsg {
+	int					isevent;
+	uint32_t				seq;
+	int					err;
+	char					*data;
+	uint32_t				dlen;
+	int					evtype;
+	uint32_t				iarg;
+	const char			*sarg;
+};
+
+static pthread_mutex_t	fnl_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int ctx_recv (struct ldt_ctx*, struct ldt_amsg*);
+static int ctx_parse (char*, ssize_t, struct ldt_amsg*);
+static struct ldt_areq *ctx_unlink (struct ldt_ctx*, uint32_t);
+static char *ctx_mkmsg (int, int, int*);
+
+
+
+struct ldt_ctx *
+ldt_ctx_new (flags)
+	int	flags;
+{
+	struct ldt_ctx	*ctx;
+	struct sockaddr_nl	snl;
+	socklen_t				alen = sizeof (snl);
+	int						sd, ret;
+
+	ctx = malloc (sizeof (struct ldt_ctx));
+	if (!ctx) return NULL;
+	bzero (ctx, sizeof (struct ldt_ctx));
+	pthread_mutex_lock (&fnl_lock);
+	sd = fnl_gopen2 (LDT_NAME, 0, ldt_gettimeout (), 0);
+	if (sd >= 0) {
+		ret = ctx->famid = fnl_getfamilyid (sd, NULL, 0, 0);
+		if (!RERR_ISOK(ret)) {
+			fnl_close (sd);
+			sd = ret;
+		}
+	}
+	pthread_mutex_unlock (&fnl_lock);
+	if (sd < 0) {
+		SLOGFE (LOG_ERR, "error connecting to ldt kernel module: %s",
+					rerr_getstr3(sd));
+		free (ctx);
+		return NULL;
+	}
+	if (getsockname (sd, (struct sockaddr*)&snl, &alen) < 0 ||
+				fcntl (sd, F_SETFL, fcntl (sd, F_GETFL) | O_NONBLOCK) < 0) {
+		SLOGFE (LOG_ERR, "cannot setup netlink socket: %s",
+					rerr_getstr3(RERR_SYSTEM));
+		pthread_mutex_lock (&fnl_lock);
+		fnl_close (sd);
+		pthread_mutex_unlock (&fnl_lock);
+		free (ctx);
+		return NULL;
+	}
+	ctx->sd = sd;
+	ctx->portid = snl.nl_pid;
+	ctx->ptail = &ctx->pending;
+	pthread_mutex_init (&ctx->lock, NULL);
+	return ctx;
+}
+
+void
+ldt_ctx_free (ctx)
+	struct ldt_ctx	*ctx;
+{
+	struct ldt_areq	*req, *next;
+
+	if (!ctx) return;
+	pthread_mutex_lock (&fnl_lock);
+	fnl_close (ctx->sd);
+	pthread_mutex_unlock (&fnl_lock);
+	/* requests never answered are cancelled */
+	for (req = ctx->pending; req; req = next) {
+		next = req->next;
+		if (req->cb) req->cb (ctx, req->arg, req->seq, ECANCELED, NULL, 0);
+		free (req);
+	}
+	pthread_mutex_destroy (&ctx->lock);
+	if (ctx->rbuf) free (ctx->rbuf);
+	free (ctx);
+}
+
+int
+ldt_ctx_fd (ctx)
+	struct ldt_ctx	*ctx;
+{
+	if (!ctx) return RERR_PARAM;
+	return ctx->sd;
+}
+
+void
+ldt_ctx_setevcb (ctx, evcb, arg)
+	struct ldt_ctx		*ctx;
+	ldt_async_evcb_t	evcb;
+	void					*arg;
+{
+	if (!ctx) return;
+	pthread_mutex_lock (&ctx->lock);
+	ctx->evcb = evcb;
+	ctx->evarg = arg;
+	pthread_mutex_unlock (&ctx->lock);
+}
+
+int
+ldt_ctx_pending (ctx)
+	struct ldt_ctx	*ctx;
+{
+	struct ldt_areq	*req;
+	int					num = 0;
+
+	if (!ctx) return RERR_PARAM;
+	pthread_mutex_lock (&ctx->lock);
+	for (req = ctx->pending; req; req = req->next) num++;
+	pthread_mutex_unlock (&ctx->lock);
+	return num;
+}
+
+
+/* sends a message created with ctx_mkmsg (or by hand, leaving room for
+ * the netlink and genetlink headers), returns the sequence id (> 0)
+ */
+int
+ldt_ctx_submit (ctx, msg, len, cb, arg)
+	struct ldt_ctx	*ctx;
+	char				*msg;
+	size_t			len;
+	ldt_async_cb_t	cb;
+	void				*arg;
+{
+	struct nlmsghdr		*nlh = (struct nlmsghdr*)msg;
+	struct genlmsghdr		*gnlh;
+	struct sockaddr_nl	peer = { .nl_family = AF_NETLINK, };
+	struct ldt_areq		*req;
+	ssize_t					ret;
+	int						seq;
+
+	if (!ctx || !msg || len < NLMSG_HDRLEN + GENL_HDRLEN) return RERR_PARAM;
+	req = malloc (sizeof (struct ldt_areq));
+	if (!req) return RERR_NOMEM;
+	pthread_mutex_lock (&ctx->lock);
+	/* sequence ids are positive ints */
+	if (++ctx->seq > 0x7fffffff) ctx->seq = 1;
+	seq = (int)ctx->seq;
+	nlh->nlmsg_len = len;
+	nlh->nlmsg_type = ctx->famid;
+	nlh->nlmsg_flags = NLM_F_REQUEST;
+	nlh->nlmsg_seq = seq;
+	nlh->nlmsg_pid = ctx->portid;
+	gnlh = (struct genlmsghdr*)(msg + NLMSG_HDRLEN);
+	gnlh->version = LDT_NL_VERSION;
+	*req = (struct ldt_areq) { .seq = seq, .cb = cb, .arg = arg, };
+	/* enqueue first - the answer might be read by another thread
+	 * before sendto returns
+	 */
+	*ctx->ptail = req;
+	ctx->ptail = &req->next;
+	do {
+		ret = sendto (ctx->sd, msg, len, 0, (struct sockaddr*)&peer,
+							sizeof (peer));
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0) {
+		ret = RERR_SYSTEM;
+		SLOGFE (LOG_ERR, "error sending request: %s", rerr_getstr3(ret));
+		ctx_unlink (ctx, seq);
+		free (req);
+		pthread_mutex_unlock (&ctx->lock);
+		return ret;
+	}
+	pthread_mutex_unlock (&ctx->lock);
+	return seq;
+}
+
+/* reads all available messages (at most maxmsg, if > 0) and calls the
+ * callbacks, returns the number of messages processed
+ */
+int
+ldt_ctx_dispatch (ctx, maxmsg)
+	struct ldt_ctx	*ctx;
+	int				maxmsg;
+{
+	struct ldt_amsg	msg;
+	struct ldt_areq	*req;
+	ldt_async_evcb_t	evcb;
+	void					*evarg;
+	int					ret, num = 0;
+
+	if (!ctx) return RERR_PARAM;
+	while (maxmsg <= 0 || num < maxmsg) {
+		pthread_mutex_lock (&ctx->lock);
+		ret = ctx_recv (ctx, &msg);
+		if (ret == RERR_BUSY) {
+			pthread_mutex_unlock (&ctx->lock);
+			break;
+		}
+		if (!RERR_ISOK(ret)) {
+			pthread_mutex_unlock (&ctx->lock);
+			if (num > 0) break;
+			return ret;
+		}
+		num++;
+		if (ret == 0) {
+			pthread_mutex_unlock (&ctx->lock);
+			continue;
+		}
+		/* callbacks are called without lock held, they might submit
+		 * new requests
+		 */
+		if (msg.isevent) {
+			evcb = ctx->evcb;
+			evarg = ctx->evarg;
+			pthread_mutex_unlock (&ctx->lock);
+			if (evcb) evcb (ctx, evarg, msg.evtype, msg.iarg, msg.sarg);
+		} else {
+			req = ctx_unlink (ctx, msg.seq);
+			pthread_mutex_unlock (&ctx->lock);
+			if (!req) {
+				SLOGF (LOG_NOTICE, "answer for unknown request %u", msg.seq);
+			} else {
+				if (req->cb) req->cb (ctx, req->arg, req->seq, msg.err,
+												msg.data, msg.dlen);
+				free (req);
+			}
+		}
+		if (msg.data) free (msg.data);
+	}
+	return num;
+}
+
+
+/* receives one message - must be called with lock held,
+ * returns 0 for messages to be ignored, 1 otherwise
+ */
+static
+int
+ctx_recv (ctx, msg)
+	struct ldt_ctx		*ctx;
+	struct ldt_amsg	*msg;
+{
+	ssize_t	n;
+	char		*p;
+
+	bzero (msg, sizeof (struct ldt_amsg));
+	while (1) {
+		n = recv (ctx->sd, ctx->rbuf, ctx->rblen, MSG_PEEK | MSG_TRUNC);
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return RERR_BUSY;
+		if (n < 0) return RERR_SYSTEM;
+		if ((size_t)n <= ctx->rblen && ctx->rbuf) break;
+		p = realloc (ctx->rbuf, n + 1024);
+		if (!p) return RERR_NOMEM;
+		ctx->rbuf = p;
+		ctx->rblen = n + 1024;
+	}
+	do {
+		n = recv (ctx->sd, ctx->rbuf, ctx->rblen, 0);
+	} while (n < 0 && errno == EINTR);
+	if (n < 0) return RERR_SYSTEM;
+	return ctx_parse (ctx->rbuf, n, msg);
+}
+
+static
+int
+ctx_parse (buf, mlen, msg)
+	char					*buf;
+	ssize_t				mlen;
+	struct ldt_amsg	*msg;
+{
+	struct nlmsghdr	*nlh = (struct nlmsghdr*)buf;
+	char					*ptr, *data, *xptr;
+	int					cmd, id, len;
+
+	if (mlen < NLMSG_HDRLEN) return 0;
+	if (mlen > (ssize_t)nlh->nlmsg_len) mlen = nlh->nlmsg_len;
+	msg->seq = nlh->nlmsg_seq;
+	if (nlh->nlmsg_type == NLMSG_ERROR) {
+		if (mlen < NLMSG_LENGTH(sizeof(struct nlmsgerr))) return 0;
+		msg->err = -((struct nlmsgerr*)NLMSG_DATA(buf))->error;
+		return 1;
+	} else if (nlh->nlmsg_type < NLMSG_MIN_TYPE) {
+		return 0;
+	}
+	if (mlen < NLMSG_HDRLEN + GENL_HDRLEN) return 0;
+	cmd = fnl_getcmd (buf);
+	if (cmd == LDT_CMD_SEND_EVENT) {
+		msg->isevent = 1;
+	} else if (cmd != LDT_CMD_SEND_INFO) {
+		return 0;
+	}
+	/* the answer data comes in chunks - concatenate them */
+	data = xptr = NULL;
+	if (!msg->isevent) {
+		data = xptr = malloc (mlen + 1);
+		if (!data) return RERR_NOMEM;
+	}
+	for (ptr = fnl_getmsgdata (buf, 0); ptr && ptr-buf < mlen;
+				ptr = fnl_getnextattr (ptr)) {
+		id = fnl_getattrid (ptr);
+		len = fnl_getattrlen (ptr);
+		if (msg->isevent) {
+			switch (id) {
+			case LDT_CMD_SEND_EVENT_ATTR_EVTYPE:
+				msg->evtype = (int)*(uint32_t*)fnl_getattrdata (ptr);
+				break;
+			case LDT_CMD_SEND_EVENT_ATTR_IARG:
+				msg->iarg = *(uint32_t*)fnl_getattrdata (ptr);
+				break;
+			case LDT_CMD_SEND_EVENT_ATTR_SARG:
+				msg->sarg = fnl_getattrdata (ptr);
+				if (len <= 0 || msg->sarg[len-1] != 0) msg->sarg = NULL;
+				break;
+			}
+		} else {
+			switch (id) {
+			case LDT_CMD_SEND_INFO_ATTR_RET:
+				msg->err = (int)*(uint32_t*)fnl_getattrdata (ptr);
+				break;
+			case LDT_CMD_SEND_INFO_ATTR_INFO:
+				memcpy (xptr, fnl_getattrdata (ptr), len);
+				xptr += len;
+				break;
+			}
+		}
+	}
+	if (data) {
+		*xptr = 0;
+		msg->dlen = xptr - data;
+		if (msg->dlen == 0) {
+			free (data);
+			data = NULL;
+		}
+		msg->data = data;
+	}
+	return 1;
+}
+
+/* must be called with lock held */
+static
+struct ldt_areq *
+ctx_unlink (ctx, seq)
+	struct ldt_ctx	*ctx;
+	uint32_t			seq;
+{
+	struct ldt_areq	**pp, *req;
+
+	for (pp = &ctx->pending; *pp; pp = &(*pp)->next) {
+		if ((*pp)->seq != seq) continue;
+		req = *pp;
+		*pp = req->next;
+		if (ctx->ptail == &req->next) ctx->ptail = pp;
+		req->next = NULL;
+		return req;
+	}
+	return NULL;
+}
+
+static
+char *
+ctx_mkmsg (cmd, dlen, len)
+	int	cmd, dlen;
+	int	*len;
+{
+	char	*msg;
+
+	*len = FNL_MSGMINLEN + dlen + 128;
+	msg = malloc (*len);
+	if (!msg) return NULL;
+	bzero (msg, *len);
+	fnl_setcmd (msg, cmd);
+	return msg;
+}
+
+#define CTX_SEND(ctx,msg,ptr,cb,arg) do { \
+		int	_ret; \
+		if (!(ptr)) { \
+			free (msg); \
+			return RERR_INTERNAL; \
+		} \
+		_ret = ldt_ctx_submit ((ctx), (msg), (ptr) - (msg), (cb), (arg)); \
+		free (msg); \
+		return _ret; \
+	} while (0)
+
+
+
+/* asynchronous versions of the configuration commands */
+
+int
+ldt_async_subscribe (ctx, cb, arg)
+	struct ldt_ctx	*ctx;
+	ldt_async_cb_t	cb;
+	void				*arg;
+{
+	char	*msg, *ptr;
+	int	len;
+
+	msg = ctx_mkmsg (LDT_CMD_SUBSCRIBE, 0, &len);
+	if (!msg) return RERR_NOMEM;
+	ptr = fnl_getmsgdata (msg, 0);
+	CTX_SEND (ctx, msg, ptr, cb, arg);
+}
+
+int
+ldt_async_create_dev (ctx, name, flags, cb, arg)
+	struct ldt_ctx	*ctx;
+	const char		*name;
+	uint32_t			flags;
+	ldt_async_cb_t	cb;
+	void				*arg;
+{
+	char	*msg, *ptr;
+	int	len;
+
+	if (!name) name = "";
+	msg = ctx_mkmsg (LDT_CMD_CREATE_DEV, strlen (name), &len);
+	if (!msg) return RERR_NOMEM;
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (ptr, LDT_CMD_CREATE_DEV_ATTR_NAME, name, strlen(name)+1);
+	if (ptr) ptr = fnl_putattr (ptr, LDT_CMD_CREATE_DEV_ATTR_FLAGS, &flags, 4);
+	CTX_SEND (ctx, msg, ptr, cb, arg);
+}
+
+int
+ldt_async_rm_dev (ctx, name, cb, arg)
+	struct ldt_ctx	*ctx;
+	const char		*name;
+	ldt_async_cb_t	cb;
+	void				*arg;
+{
+	char	*msg, *ptr;
+	int	len;
+
+	if (!name) return RERR_PARAM;
+	msg = ctx_mkmsg (LDT_CMD_RM_DEV, strlen (name), &len);
+	if (!msg) return RERR_NOMEM;
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (ptr, LDT_CMD_RM_DEV_ATTR_NAME, name, strlen(name)+1);
+	CTX_SEND (ctx, msg, ptr, cb, arg);
+}
+
+int
+ldt_async_get_devinfo (ctx, name, cb, arg)
+	struct ldt_ctx	*ctx;
+	const char		*name;
+	ldt_async_cb_t	cb;
+	void				*arg;
+{
+	char	*msg, *ptr;
+	int	len;
+
+	if (!name) return RERR_PARAM;
+	msg = ctx_mkmsg (LDT_CMD_SHOW_DEV, strlen (name), &len);
+	if (!msg) return RERR_NOMEM;
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (ptr, LDT_CMD_SHOW_DEV_ATTR_NAME, name, strlen(name)+1);
+	CTX_SEND (ctx, msg, ptr, cb, arg);
+}
+
+int
+ldt_async_newtun (ctx, name, tuntype, cb, arg)
+	struct ldt_ctx	*ctx;
+	const char		*name, *tuntype;
+	ldt_async_cb_t	cb;
+	void				*arg;
+{
+	char	*msg, *ptr;
+	int	len;
+
+	if (!name || !tuntype) return RERR_PARAM;
+	msg = ctx_mkmsg (LDT_CMD_NEWTUN, strlen (name) + strlen (tuntype), &len);
+	if (!msg) return RERR_NOMEM;
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (ptr, LDT_CMD_NEWTUN_ATTR_NAME, name, strlen(name)+1);
+	if (ptr) ptr = fnl_putattr (	ptr, LDT_CMD_NEWTUN_ATTR_TUN_TYPE, tuntype,
+											strlen(tuntype)+1);
+	CTX_SEND (ctx, msg, ptr, cb, arg);
+}
+
+int
+ldt_async_tunbind (ctx, name, laddr, cb, arg)
+	struct ldt_ctx	*ctx;
+	const char		*name;
+	frad_t			*laddr;
+	ldt_async_cb_t	cb;
+	void				*arg;
+{
+	char		*msg, *ptr;
+	int		len;
+	uint16_t	port;
+
+	if (!name || !laddr) return RERR_PARAM;
+	msg = ctx_mkmsg (LDT_CMD_BIND, strlen (name), &len);
+	if (!msg) return RERR_NOMEM;
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (ptr, LDT_CMD_BIND_ATTR_NAME, name, strlen(name)+1);
+	if (ptr && !FRADP_ISIPV6(laddr)) {
+		ptr = fnl_putattr (	ptr, LDT_CMD_BIND_ATTR_ADDR4,
+									&laddr->v4.sin_addr.s_addr, 4);
+	} else if (ptr) {
+		ptr = fnl_putattr (	ptr, LDT_CMD_BIND_ATTR_ADDR6,
+									laddr->v6.sin6_addr.s6_addr, 16);
+	}
+	port = frad_getport (laddr);
+	if (ptr) ptr = fnl_putattr (ptr, LDT_CMD_BIND_ATTR_PORT, &port, 2);
+	CTX_SEND (ctx, msg, ptr, cb, arg);
+}
+
+int
+ldt_async_setpeer (ctx, name, raddr, cb, arg)
+	struct ldt_ctx	*ctx;
+	const char		*name;
+	frad_t			*raddr;
+	ldt_async_cb_t	cb;
+	void				*arg;
+{
+	char		*msg, *ptr;
+	int		len;
+	uint16_t	port;
+
+	if (!name) return RERR_PARAM;
+	msg = ctx_mkmsg (LDT_CMD_PEER, strlen (name), &len);
+	if (!msg) return RERR_NOMEM;
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (ptr, LDT_CMD_PEER_ATTR_NAME, name, strlen(name)+1);
+	if (ptr && raddr) {
+		if (!FRADP_ISIPV6(raddr)) {
+			ptr = fnl_putattr (	ptr, LDT_CMD_PEER_ATTR_ADDR4,
+										&raddr->v4.sin_addr.s_addr, 4);
+		} else {
+			ptr = fnl_putattr (	ptr, LDT_CMD_PEER_ATTR_ADDR6,
+										raddr->v6.sin6_addr.s6_addr, 16);
+		}
+		port = frad_getport (raddr);
+		if (ptr) ptr = fnl_putattr (ptr, LDT_CMD_PEER_ATTR_PORT, &port, 2);
+	}
+	CTX_SEND (ctx, msg, ptr, cb, arg);
+}
+
+int
+ldt_async_serverstart (ctx, name, flags, cb, arg)
+	struct ldt_ctx	*ctx;
+	const char		*name;
+	uint32_t			flags;
+	ldt_async_cb_t	cb;
+	void				*arg;
+{
+	char	*msg, *ptr;
+	int	len;
+
+	if (!name) return RERR_PARAM;
+	msg = ctx_mkmsg (LDT_CMD_SERVERSTART, strlen (name), &len);
+	if (!msg) return RERR_NOMEM;
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (ptr, LDT_CMD_SERVERSTART_ATTR_NAME, name, strlen(name)+1);
+	if (ptr && flags) {
+		ptr = fnl_putattr (ptr, LDT_CMD_SERVERSTART_ATTR_FLAGS, &flags, 4);
+	}
+	CTX_SEND (ctx, msg, ptr, cb, arg);
+}
+
+int
+ldt_async_set_mtu (ctx, name, mtu, cb, arg)
+	struct ldt_ctx	*ctx;
+	const char		*name;
+	uint32_t			mtu;
+	ldt_async_cb_t	cb;
+	void				*arg;
+{
+	char	*msg, *ptr;
+	int	len;
+
+	if (!name) return RERR_PARAM;
+	msg = ctx_mkmsg (LDT_CMD_SET_MTU, strlen (name), &len);
+	if (!msg) return RERR_NOMEM;
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (ptr, LDT_CMD_SET_MTU_ATTR_NAME, name, strlen(name)+1);
+	if (ptr) ptr = fnl_putattr (ptr, LDT_CMD_SET_MTU_ATTR_MTU, &mtu, 4);
+	CTX_SEND (ctx, msg, ptr, cb, arg);
+}
+
+int
+ldt_async_setqueue (ctx, name, txqlen, qpolicy, cb, arg)
+	struct ldt_ctx	*ctx;
+	const char		*name;
+	int				txqlen, qpolicy;
+	ldt_async_cb_t	cb;
+	void				*arg;
+{
+	char		*msg, *ptr;
+	int		len;
+	uint16_t	val;
+
+	if (!name) return RERR_PARAM;
+	msg = ctx_mkmsg (LDT_CMD_SET_QUEUE, strlen (name), &len);
+	if (!msg) return RERR_NOMEM;
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (ptr, LDT_CMD_SETQUEUE_ATTR_NAME, name, strlen(name)+1);
+	if (ptr && txqlen >= 0) {
+		val = (uint16_t)txqlen;
+		ptr = fnl_putattr (ptr, LDT_CMD_SETQUEUE_ATTR_TXQLEN, &val, 2);
+	}
+	if (ptr && qpolicy >= 0) {
+		val = (uint16_t)qpolicy;
+		ptr = fnl_putattr (ptr, LDT_CMD_SETQUEUE_ATTR_QPOLICY, &val, 2);
+	}
+	CTX_SEND (ctx, msg, ptr, cb, arg);
+}
+
+
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
@@ -0,0 +1,471 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/genetlink.h>
+
+#include <fr/base.h>
+#include <fr/netlink/fnl.h>
+
+#include <ldt/ldt.h>
+
+
+/* an nested attribute (nla_len is 16 bit) must not exceed 64k */
+#define BULK_MAXLIST		(60*1024)
+
+static int bulk_send (struct ldt_bulkdev*, int, uint32_t, int*);
+static int bulk_entrylen (struct ldt_bulkdev*);
+static char *bulk_putentry (char*, struct ldt_bulkdev*);
+static int bulk_parseline (struct ldt_bulkdev*, char*, int);
+
+
+
+void
+ldt_bulkdev_init (dev)
+	struct ldt_bulkdev	*dev;
+{
+	if (!dev) return;
+	bzero (dev, sizeof (struct ldt_bulkdev));
+	dev->server = -1;
+	dev->txqlen = -1;
+	dev->qpolicy = -1;
+}
+
+
+int
+ldt_bulk_apply (list, num, flags, numfailed)
+	struct ldt_bulkdev	*list;
+	int						num;
+	uint32_t					flags;
+	int						*numfailed;
+{
+	int	ret, done, nfail = 0;
+
+	if (numfailed) *numfailed = 0;
+	if (!list || num < 0) return RERR_PARAM;
+	for (done=0; done < num; done += ret) {
+		ret = bulk_send (list+done, num-done, flags, &nfail);
+		if (ret < 0) break;
+		if (ret == 0) {
+			ret = RERR_INTERNAL;
+			break;
+		}
+	}
+	ldt_mayclose ();
+	if (numfailed) *numfailed = nfail;
+	if (ret < 0) return ret;
+	return nfail > 0 ? RERR_FAIL : RERR_OK;
+}
+
+const char *
+ldt_bulk_stepname (step)
+	int	step;
+{
+	switch (step) {
+	case LDT_BULK_STEP_NONE:	return "none";
+	case LDT_BULK_STEP_PARSE:	return "parse";
+	case LDT_BULK_STEP_CREATE:	return "create";
+	case LDT_BULK_STEP_MTU:		return "mtu";
+	case LDT_BULK_STEP_NEWTUN:	return "newtun";
+	case LDT_BULK_STEP_QUEUE:	return "setqueue";
+	case LDT_BULK_STEP_BIND:	return "bind";
+	case LDT_BULK_STEP_PEER:	return "peer";
+	case LDT_BULK_STEP_SERVER:	return "serverstart";
+	}
+	return "unknown";
+}
+
+
+/* sends as many entries as fit into one request, returns the number
+ * of entries processed
+ */
+static
+int
+bulk_send (list, num, flags, nfail)
+	struct ldt_bulkdev	*list;
+	int						num;
+	uint32_t					flags;
+	int						*nfail;
+{
+	char						*msg, *ptr, *lstart, *data;
+	int						ret, len, elen, i, n;
+	uint32_t					dlen;
+	struct ldt_bulkres	*res;
+
+	if (num > LDT_BULK_MAX) num = LDT_BULK_MAX;
+	for (n=0, len=0; n < num; n++) {
+		elen = bulk_entrylen (list+n);
+		if (n > 0 && len + elen > BULK_MAXLIST) break;
+		len += elen;
+	}
+	num = n;
+	len += FNL_MSGMINLEN + 64;
+	msg = malloc (len);
+	if (!msg) return RERR_NOMEM;
+	bzero (msg, len);
+	ret = fnl_setcmd (msg, LDT_CMD_BULK);
+	if (!RERR_ISOK(ret)) {
+		free (msg);
+		return ret;
+	}
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (ptr, LDT_CMD_BULK_ATTR_FLAGS, &flags, 4);
+	lstart = ptr;
+	ptr = fnl_putattr (ptr, LDT_CMD_BULK_ATTR_LIST | NLA_F_NESTED, NULL, 0);
+	for (i=0; ptr && i < num; i++) {
+		ptr = bulk_putentry (ptr, list+i);
+	}
+	if (!ptr) {
+		free (msg);
+		return RERR_INTERNAL;
+	}
+	((struct nlattr*)lstart)->nla_len = ptr - lstart;
+	len = ptr - msg;
+	ret = ldt_nl_send (msg, len);
+	free (msg);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR, "error sending request to ldt kernel module: %s",
+					rerr_getstr3(ret));
+		return ret;
+	}
+	SLOGF (LOG_VVERB, "sent %d bytes (%d entries)", ret, num);
+	ret = ldt_nl_getanswer (&data, &dlen);
+	if (!RERR_ISOK(ret)) return ret;
+	if (dlen != num * sizeof (struct ldt_bulkres)) {
+		SLOGF (LOG_ERR, "invalid answer size %u (expected %d entries)",
+					(unsigned)dlen, num);
+		free (data);
+		return RERR_SERVER;
+	}
+	res = (struct ldt_bulkres*)data;
+	for (i=0; i<num; i++) {
+		list[i].ret = res[i].ret < 0 ? -res[i].ret : res[i].ret;
+		list[i].step = res[i].step;
+		strncpy (list[i].outname, res[i].name, sizeof (list[i].outname) - 1);
+		if (list[i].ret) (*nfail)++;
+	}
+	free (data);
+	return num;
+}
+
+static
+int
+bulk_entrylen (dev)
+	struct ldt_bulkdev	*dev;
+{
+	int	len = 14 * NLA_HDRLEN + 16*3 + 4*8 + 2*4;
+
+	if (dev->name) len += NLA_ALIGN(strlen (dev->name) + 1);
+	if (dev->tuntype) len += NLA_ALIGN(strlen (dev->tuntype) + 1);
+	if (dev->bind2dev) len += NLA_ALIGN(strlen (dev->bind2dev) + 1);
+	return len;
+}
+
+static
+char *
+bulk_putentry (ptr, dev)
+	char						*ptr;
+	struct ldt_bulkdev	*dev;
+{
+	char		*start = ptr;
+	uint32_t	val;
+	uint16_t	val16;
+
+	ptr = fnl_putattr (ptr, LDT_BULK_ATTR_DEV | NLA_F_NESTED, NULL, 0);
+	if (ptr && dev->name && *dev->name) {
+		ptr = fnl_putattr (	ptr, LDT_BULKDEV_ATTR_NAME, dev->name,
+									strlen (dev->name)+1);
+	}
+	if (ptr && dev->devflags) {
+		ptr = fnl_putattr (ptr, LDT_BULKDEV_ATTR_DEVFLAGS, &dev->devflags, 4);
+	}
+	if (ptr && dev->mtu > 0) {
+		ptr = fnl_putattr (ptr, LDT_BULKDEV_ATTR_MTU, &dev->mtu, 4);
+	}
+	if (ptr && dev->tuntype) {
+		ptr = fnl_putattr (	ptr, LDT_BULKDEV_ATTR_TUN_TYPE, dev->tuntype,
+									strlen (dev->tuntype)+1);
+	}
+	if (ptr && dev->txqlen >= 0) {
+		val16 = (uint16_t)dev->txqlen;
+		ptr = fnl_putattr (ptr, LDT_BULKDEV_ATTR_TXQLEN, &val16, 2);
+	}
+	if (ptr && dev->qpolicy >= 0) {
+		val16 = (uint16_t)dev->qpolicy;
+		ptr = fnl_putattr (ptr, LDT_BULKDEV_ATTR_QPOLICY, &val16, 2);
+	}
+	if (ptr && dev->bind2dev) {
+		ptr = fnl_putattr (	ptr, LDT_BULKDEV_ATTR_BIND2DEV, dev->bind2dev,
+									strlen (dev->bind2dev)+1);
+	}
+	if (ptr && dev->hasladdr) {
+		if (!FRADP_ISIPV6(&dev->laddr)) {
+			ptr = fnl_putattr (	ptr, LDT_BULKDEV_ATTR_LADDR4,
+										&dev->laddr.v4.sin_addr.s_addr, 4);
+		} else {
+			ptr = fnl_putattr (	ptr, LDT_BULKDEV_ATTR_LADDR6,
+										dev->laddr.v6.sin6_addr.s6_addr, 16);
+		}
+		val16 = frad_getport (&dev->laddr);
+		if (ptr) ptr = fnl_putattr (ptr, LDT_BULKDEV_ATTR_LPORT, &val16, 2);
+	}
+	if (ptr && dev->server >= 0) {
+		val = (uint32_t)dev->server;
+		ptr = fnl_putattr (ptr, LDT_BULKDEV_ATTR_SERVER, &val, 4);
+	} else if (ptr && dev->hasraddr) {
+		if (!FRADP_ISIPV6(&dev->raddr)) {
+			ptr = fnl_putattr (	ptr, LDT_BULKDEV_ATTR_RADDR4,
+										&dev->raddr.v4.sin_addr.s_addr, 4);
+		} else {
+			ptr = fnl_putattr (	ptr, LDT_BULKDEV_ATTR_RADDR6,
+										dev->raddr.v6.sin6_addr.s6_addr, 16);
+		}
+		val16 = frad_getport (&dev->raddr);
+		if (ptr) ptr = fnl_putattr (ptr, LDT_BULKDEV_ATTR_RPORT, &val16, 2);
+	}
+	if (!ptr) return NULL;
+	((struct nlattr*)start)->nla_len = ptr - start;
+	return ptr;
+}
+
+
+
+/* config file handling
+ *
+ * one device per line, the device name followed by options:
+ *    <name> [type=<tuntype>] [flags=<num>] [mtu=<num>]
+ *           [txqlen=<num>] [qpolicy=oldest|newest]
+ *           [dev=<iface>] [laddr=<addr:port>]
+ *           [raddr=<addr:port> | server[=multiclient]]
+ * empty lines and everything after # are ignored
+ */
+
+int
+ldt_bulk_parse (buf, olist, onum)
+	const char				*buf;
+	struct ldt_bulkdev	**olist;
+	int						*onum;
+{
+	struct ldt_bulkdev	*list;
+	char						*xbuf, *ptr, *line;
+	const char				*s;
+	int						num, lineno, ret;
+
+	if (!buf || !olist || !onum) return RERR_PARAM;
+	/* we allocate the list and a copy of the buffer in one chunk,
+	 * so a single free releases everything
+	 */
+	for (num=1, s=buf; *s; s++) if (*s == '\n') num++;
+	list = malloc (num * sizeof (struct ldt_bulkdev) + strlen (buf) + 1);
+	if (!list) return RERR_NOMEM;
+	xbuf = (char*)(list + num);
+	strcpy (xbuf, buf);
+	num = 0;
+	ptr = xbuf;
+	for (lineno=1; ptr; lineno++) {
+		line = top_getline (&ptr, TOP_F_NOSKIPBLANK);
+		if (!line || !*line) continue;
+		ret = bulk_parseline (list+num, line, lineno);
+		if (!RERR_ISOK(ret)) {
+			free (list);
+			return ret;
+		}
+		num++;
+	}
+	*olist = list;
+	*onum = num;
+	return RERR_OK;
+}
+
+int
+ldt_bulk_readfile (fname, olist, onum)
+	const char				*fname;
+	struct ldt_bulkdev	**olist;
+	int						*onum;
+{
+	char	*buf;
+	int	ret;
+
+	if (!fname) return RERR_PARAM;
+	if (!strcmp (fname, "-")) {
+		buf = fop_read_fd (0);
+	} else {
+		buf = fop_read_fn (fname);
+	}
+	if (!buf) {
+		SLOGFE (LOG_ERR, "cannot read config file >>%s<<", fname);
+		return RERR_SYSTEM;
+	}
+	ret = ldt_bulk_parse (buf, olist, onum);
+	free (buf);
+	return ret;
+}
+
+static
+int
+bulk_parseline (dev, line, lineno)
+	struct ldt_bulkdev	*dev;
+	char						*line;
+	int						lineno;
+{
+	char	*key, *val;
+	int	ret;
+
+	ldt_bulkdev_init (dev);
+	dev->name = top_getfield (&line, " \t", 0);
+	if (!dev->name) return RERR_PARAM;
+	while ((key = top_getfield (&line, " \t", 0))) {
+		val = index (key, '=');
+		if (val) *val++ = 0;
+		sswitch (key) {
+		sicase ("type")
+			dev->tuntype = val;
+			break;
+		sicase ("flags")
+			dev->devflags = val ? (uint32_t)strtoul (val, NULL, 0) : 0;
+			break;
+		sicase ("mtu")
+			dev->mtu = val ? (uint32_t)atoi (val) : 0;
+			break;
+		sicase ("txqlen")
+			dev->txqlen = val ? atoi (val) : -1;
+			if (dev->txqlen > 65535) {
+				SLOGF (LOG_ERR, "line %d: queue length out of range", lineno);
+				return RERR_PARAM;
+			}
+			break;
+		sicase ("qpolicy")
+			if (!val) val = "";
+			sswitch (val) {
+			sicase ("drop_oldest")
+			sicase ("drop-oldest")
+			sicase ("oldest")
+				dev->qpolicy = LDT_CMD_SETQUEUE_QPOLICY_DROP_OLDEST;
+				break;
+			sicase ("drop_newest")
+			sicase ("drop-newest")
+			sicase ("newest")
+				dev->qpolicy = LDT_CMD_SETQUEUE_QPOLICY_DROP_NEWEST;
+				break;
+			sdefault
+				SLOGF (LOG_ERR, "line %d: invalid queueing policy >>%s<<",
+								lineno, val);
+				return RERR_PARAM;
+			} esac;
+			break;
+		sicase ("dev")
+			dev->bind2dev = val;
+			break;
+		sicase ("laddr")
+		sicase ("bind")
+			if (!val) break;
+			ret = frad_getaddr (&dev->laddr, val, 0);
+			if (!RERR_ISOK(ret)) {
+				SLOGFE (LOG_ERR, "line %d: invalid local address >>%s<<: %s",
+								lineno, val, rerr_getstr3 (ret));
+				return ret;
+			}
+			dev->hasladdr = 1;
+			break;
+		sicase ("raddr")
+		sicase ("peer")
+			if (!val) break;
+			ret = frad_getaddr (&dev->raddr, val, 0);
+			if (!RERR_ISOK(ret)) {
+				SLOGFE (LOG_ERR, "line %d: invalid remote address >>%s<<: %s",
+								lineno, val, rerr_getstr3 (ret));
+				return ret;
+			}
+			dev->hasraddr = 1;
+			break;
+		sicase ("server")
+			dev->server = 0;
+			if (val && (!strcasecmp (val, "multiclient") || !strcasecmp (val, "mc"))) {
+				dev->server = LDT_SERVERSTART_F_MULTICLIENT;
+			}
+			break;
+		sdefault
+			SLOGF (LOG_ERR, "line %d: unknown option >>%s<<", lineno, key);
+			return RERR_PARAM;
+		} esac;
+	}
+	if (dev->server >= 0 && dev->hasraddr) {
+		SLOGF (LOG_ERR, "line %d: server and raddr are mutually exclusive",
+						lineno);
+		return RERR_PARAM;
+	}
+	return RERR_OK;
+}
+
+
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
@@ -74,8 +74,8 @@
 
 #include <ldt/ldt.h>
 
-static int do_tun_setpeer (const char *name, frad_t *raddr);
-static int do_tun_serverstart (const char *);
+static int do_tun_setpeer (const char *name, frad_t *raddr, int);
+static int do_tun_serverstart (const char *, uint32_t, int);
 
 
 int
@@ -358,7 +358,7 @@ ldt_tun_setpeer (name, raddr, tout)
 	struct ldt_evinfo	evinfo;
 
 	ldt_event_open ();
-	ret = do_tun_setpeer (name, raddr);
+	ret = do_tun_setpeer (name, raddr, tout != 0);
 	if (!RERR_ISOK(ret)) {
 		SLOGFE (LOG_ERR, "error setting peer: %s", rerr_getstr3(ret));
 		ldt_mayclose ();
@@ -411,9 +411,10 @@ ldt_tun_setpeer (name, raddr, tout)
 
 static
 int
-do_tun_setpeer (name, raddr)
+do_tun_setpeer (name, raddr, sync)
 	const char	*name;
 	frad_t		*raddr;
+	int			sync;
 {
 	char		*msg;
 	int		ret, len;
@@ -464,6 +465,189 @@ do_tun_setpeer (name, raddr)
 		return ret;
 	}
 	SLOGF (LOG_VVERB, "sent %d bytes", ret);
+	/* we are going to wait for events - don't pipeline */
+	ret = ldt_nl_getret2 (sync ? LDT_NL_F_SYNC : 0);
+	ldt_mayclose ();
+	return ret;
+}
+
+int
+ldt_tun_setpeerlist (name, list, num, backoff_min, backoff_max)
+	const char	*name;
+	frad_t		*list;
+	int			num, backoff_min, backoff_max;
+{
+	return ldt_tun_setpeerlist2 (name, list, NULL, num, backoff_min,
+											backoff_max, 0, -1);
+}
+
+/* local (may be NULL) holds a local address per candidate, AF_UNSPEC
+ * entries use the tunnel address - the kernel accepts local addresses
+ * in race mode (LDT_PEERLIST_F_RACE) only.
+ * stagger < 0 uses the kernel default.
+ */
+int
+ldt_tun_setpeerlist2 (name, list, local, num, backoff_min, backoff_max, flags, stagger)
+	const char	*name;
+	frad_t		*list, *local;
+	int			num, backoff_min, backoff_max;
+	uint32_t		flags;
+	int			stagger;
+{
+	char						*msg;
+	int						ret, len, i;
+	char						*ptr;
+	uint32_t					val;
+	struct ldt_peeraddr	pa[LDT_PEERLIST_MAX];
+	struct ldt_peeraddr	la[LDT_PEERLIST_MAX];
+
+	if (!name || num < 0 || (num > 0 && !list)) return RERR_PARAM;
+	if (num > LDT_PEERLIST_MAX) {
+		SLOGF (LOG_ERR, "too many peer candidates (%d), maximum is %d", num,
+					LDT_PEERLIST_MAX);
+		return RERR_PARAM;
+	}
+	bzero (pa, sizeof (pa));
+	for (i=0; i<num; i++) {
+		if (!FRADP_ISIPV6(&list[i])) {
+			pa[i].addr.v4 = list[i].v4.sin_addr.s_addr;
+		} else {
+			pa[i].ipv6 = 1;
+			memcpy (pa[i].addr.v6, list[i].v6.sin6_addr.s6_addr, 16);
+		}
+		pa[i].port = frad_getport (&list[i]);
+	}
+	bzero (la, sizeof (la));
+	for (i=0; local && i<num; i++) {
+		if (FRADP_FAM(&local[i]) == AF_INET) {
+			la[i].addr.v4 = local[i].v4.sin_addr.s_addr;
+		} else if (FRADP_ISIPV6(&local[i])) {
+			la[i].ipv6 = 1;
+			memcpy (la[i].addr.v6, local[i].v6.sin6_addr.s6_addr, 16);
+		} else {
+			continue;
+		}
+		la[i].port = frad_getport (&local[i]);
+	}
+	len = FNL_MSGMINLEN + strlen (name) + sizeof (pa) + sizeof (la) + 48 + 128;
+	msg = malloc (len);
+	if (!msg) return RERR_NOMEM;
+	bzero (msg, len);
+	ret = fnl_setcmd (msg, LDT_CMD_PEERLIST);
+	if (!RERR_ISOK(ret)) {
+		free (msg);
+		return ret;
+	}
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (	ptr, LDT_CMD_PEERLIST_ATTR_NAME, name,
+								strlen(name)+1);
+	if (ptr && num > 0) {
+		ptr = fnl_putattr (	ptr, LDT_CMD_PEERLIST_ATTR_LIST, pa,
+									num * sizeof (struct ldt_peeraddr));
+	}
+	if (ptr && backoff_min > 0) {
+		val = (uint32_t)backoff_min;
+		ptr = fnl_putattr (ptr, LDT_CMD_PEERLIST_ATTR_BACKOFF_MIN, &val, 4);
+	}
+	if (ptr && backoff_max > 0) {
+		val = (uint32_t)backoff_max;
+		ptr = fnl_putattr (ptr, LDT_CMD_PEERLIST_ATTR_BACKOFF_MAX, &val, 4);
+	}
+	if (ptr && local && num > 0) {
+		ptr = fnl_putattr (	ptr, LDT_CMD_PEERLIST_ATTR_LOCAL, la,
+									num * sizeof (struct ldt_peeraddr));
+	}
+	if (ptr && flags) {
+		ptr = fnl_putattr (ptr, LDT_CMD_PEERLIST_ATTR_FLAGS, &flags, 4);
+	}
+	if (ptr && stagger >= 0) {
+		val = (uint32_t)stagger;
+		ptr = fnl_putattr (ptr, LDT_CMD_PEERLIST_ATTR_STAGGER, &val, 4);
+	}
+	if (!ptr) {
+		free (msg);
+		return RERR_INTERNAL;
+	}
+	len = ptr - msg;
+	ret = ldt_nl_send (msg, len);
+	free (msg);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR, "error sending request to ldt kernel module: %s",
+					rerr_getstr3(ret));
+		return ret;
+	}
+	SLOGF (LOG_VVERB, "sent %d bytes", ret);
+	ret = ldt_nl_getret ();
+	ldt_mayclose ();
+	return ret;
+}
+
+int
+ldt_tun_clientroute (name, raddr, inner, plen, flags)
+	const char	*name;
+	frad_t		*raddr, *inner;
+	int			plen, flags;
+{
+	char		*msg;
+	int		ret, len;
+	char		*ptr;
+	uint16_t	port;
+	uint32_t	val;
+	uint8_t	val8;
+
+	if (!name || !raddr) return RERR_PARAM;
+	if (!inner && !(flags & LDT_CLIENTROUTE_F_DEL)) return RERR_PARAM;
+	len = FNL_MSGMINLEN + strlen (name) + 4*24 + 128;
+	msg = malloc (len);
+	if (!msg) return RERR_NOMEM;
+	bzero (msg, len);
+	ret = fnl_setcmd (msg, LDT_CMD_CLIENTROUTE);
+	if (!RERR_ISOK(ret)) {
+		free (msg);
+		return ret;
+	}
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (	ptr, LDT_CMD_CLIENTROUTE_ATTR_NAME, name,
+								strlen(name)+1);
+	if (ptr && !FRADP_ISIPV6(raddr)) {
+		ptr = fnl_putattr (	ptr, LDT_CMD_CLIENTROUTE_ATTR_ADDR4,
+									&raddr->v4.sin_addr.s_addr, 4);
+	} else if (ptr) {
+		ptr = fnl_putattr (	ptr, LDT_CMD_CLIENTROUTE_ATTR_ADDR6,
+									raddr->v6.sin6_addr.s6_addr, 16);
+	}
+	port = frad_getport (raddr);
+	if (ptr && port > 0) {
+		ptr = fnl_putattr (ptr, LDT_CMD_CLIENTROUTE_ATTR_PORT, &port, 2);
+	}
+	if (ptr && inner && !FRADP_ISIPV6(inner)) {
+		ptr = fnl_putattr (	ptr, LDT_CMD_CLIENTROUTE_ATTR_INNER4,
+									&inner->v4.sin_addr.s_addr, 4);
+	} else if (ptr && inner) {
+		ptr = fnl_putattr (	ptr, LDT_CMD_CLIENTROUTE_ATTR_INNER6,
+									inner->v6.sin6_addr.s6_addr, 16);
+	}
+	if (ptr && plen >= 0) {
+		val8 = (uint8_t)plen;
+		ptr = fnl_putattr (ptr, LDT_CMD_CLIENTROUTE_ATTR_PREFIXLEN, &val8, 1);
+	}
+	if (ptr && flags) {
+		val = (uint32_t)flags;
+		ptr = fnl_putattr (ptr, LDT_CMD_CLIENTROUTE_ATTR_FLAGS, &val, 4);
+	}
+	if (!ptr) {
+		free (msg);
+		return RERR_INTERNAL;
+	}
+	len = ptr - msg;
+	ret = ldt_nl_send (msg, len);
+	free (msg);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR, "error sending request to ldt kernel module: %s",
+					rerr_getstr3(ret));
+		return ret;
+	}
+	SLOGF (LOG_VVERB, "sent %d bytes", ret);
 	ret = ldt_nl_getret ();
 	ldt_mayclose ();
 	return ret;
@@ -473,6 +657,15 @@ int
 ldt_tun_setqueue (name, txqlen, qpolicy)
 	const char	*name;
 	int			txqlen, qpolicy;
+{
+	return ldt_tun_setqueue2 (name, txqlen, qpolicy, NULL);
+}
+
+int
+ldt_tun_setqueue2 (name, txqlen, qpolicy, bands)
+	const char					*name;
+	int							txqlen, qpolicy;
+	const struct ldt_qbands	*bands;
 {
 	char		*msg;
 	int		ret, len;
@@ -480,8 +673,9 @@ ldt_tun_setqueue (name, txqlen, qpolicy)
 	uint16_t	val;
 
 	if (!name) return RERR_PARAM;
-	len = FNL_MSGMINLEN + strlen (name) + + 24 + 128;
+	len = FNL_MSGMINLEN + strlen (name) + sizeof (struct ldt_qbands) + 24 + 128;
 	msg = malloc (len);
+	if (!msg) return RERR_NOMEM;
 	bzero (msg, len);
 	ret = fnl_setcmd (msg, LDT_CMD_SET_QUEUE);
 	if (!RERR_ISOK(ret)) {
@@ -511,6 +705,460 @@ ldt_tun_setqueue (name, txqlen, qpolicy)
 			return RERR_INTERNAL;
 		}
 	}
+	if (bands) {
+		ptr = fnl_putattr (ptr, LDT_CMD_SETQUEUE_ATTR_BANDS, bands,
+									sizeof (struct ldt_qbands));
+		if (!ptr) {
+			free (msg);
+			return RERR_INTERNAL;
+		}
+	}
+
+	len = ptr - msg;
+	ret = ldt_nl_send (msg, len);
+	free (msg);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR, "error sending request to ldt kernel module: %s",
+					rerr_getstr3(ret));
+		return ret;
+	}
+	SLOGF (LOG_VVERB, "sent %d bytes", ret);
+	ret = ldt_nl_getret ();
+	ldt_mayclose ();
+	return ret;
+}
+
+/* default map: the class selector (dscp >> 3) resp. the priority
+ * (0..7, higher is more important) is spread over the bands, expedited
+ * forwarding goes to band 0. The last band is the default.
+ */
+int
+ldt_qbands_init (bands, nbands, classify)
+	struct ldt_qbands	*bands;
+	int					nbands, classify;
+{
+	int	i, prio;
+
+	if (!bands) return RERR_PARAM;
+	if (nbands < LDT_QBANDS_MIN || nbands > LDT_QBANDS_MAX) return RERR_PARAM;
+	if (classify != LDT_QBANDS_CLS_DSCP && classify != LDT_QBANDS_CLS_PRIO)
+		return RERR_PARAM;
+	*bands = (struct ldt_qbands) {
+		.nbands = nbands,
+		.classify = classify,
+		.sched = LDT_QBANDS_SCHED_STRICT,
+		.dflt = nbands - 1,
+	};
+	for (i=0; i<64; i++) {
+		if (classify == LDT_QBANDS_CLS_DSCP) {
+			prio = i >> 3;
+		} else {
+			prio = i < 8 ? i : 0;
+		}
+		bands->map[i] = (7 - prio) * nbands / 8;
+	}
+	if (classify == LDT_QBANDS_CLS_DSCP) bands->map[46] = 0;		/* ef */
+	return RERR_OK;
+}
+
+
+int
+ldt_tun_setsockopt (name, opt)
+	const char						*name;
+	const struct ldt_sockopt	*opt;
+{
+	char		*msg;
+	int		ret, len;
+	char		*ptr;
+	uint8_t	v8;
+	uint32_t	v32;
+
+	if (!name || !opt) return RERR_PARAM;
+	len = FNL_MSGMINLEN + strlen (name) + 8*8 + 128;
+	msg = malloc (len);
+	if (!msg) return RERR_NOMEM;
+	bzero (msg, len);
+	ret = fnl_setcmd (msg, LDT_CMD_SET_SOCKOPT);
+	if (!RERR_ISOK(ret)) {
+		free (msg);
+		return ret;
+	}
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (	ptr, LDT_CMD_SET_SOCKOPT_ATTR_NAME, name,
+								strlen(name)+1);
+#define PUTATTR(attr,var,val)	do { \
+		var = (val); \
+		if (ptr) ptr = fnl_putattr (ptr, (attr), &var, sizeof (var)); \
+	} while (0)
+	if (opt->txccid >= 0)
+		PUTATTR (LDT_CMD_SET_SOCKOPT_ATTR_TXCCID, v8, opt->txccid);
+	if (opt->rxccid >= 0)
+		PUTATTR (LDT_CMD_SET_SOCKOPT_ATTR_RXCCID, v8, opt->rxccid);
+	if (opt->sndbuf >= 0)
+		PUTATTR (LDT_CMD_SET_SOCKOPT_ATTR_SNDBUF, v32, opt->sndbuf);
+	if (opt->rcvbuf >= 0)
+		PUTATTR (LDT_CMD_SET_SOCKOPT_ATTR_RCVBUF, v32, opt->rcvbuf);
+	if (opt->service >= 0)
+		PUTATTR (LDT_CMD_SET_SOCKOPT_ATTR_SERVICE, v32, opt->service);
+	if (opt->cscov >= 0)
+		PUTATTR (LDT_CMD_SET_SOCKOPT_ATTR_CSCOV, v8, opt->cscov);
+	if (opt->flags)
+		PUTATTR (LDT_CMD_SET_SOCKOPT_ATTR_FLAGS, v32, opt->flags);
+#undef PUTATTR
+	if (!ptr) {
+		free (msg);
+		return RERR_INTERNAL;
+	}
+
+	len = ptr - msg;
+	ret = ldt_nl_send (msg, len);
+	free (msg);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR, "error sending request to ldt kernel module: %s",
+					rerr_getstr3(ret));
+		return ret;
+	}
+	SLOGF (LOG_VVERB, "sent %d bytes", ret);
+	ret = ldt_nl_getret ();
+	ldt_mayclose ();
+	return ret;
+}
+
+int
+ldt_tun_setrxsteer (name, mode, cpus, nwords)
+	const char		*name;
+	int				mode;
+	const uint32_t	*cpus;
+	int				nwords;
+{
+	char		*msg;
+	int		ret, len;
+	char		*ptr;
+	uint32_t	val;
+
+	if (!name || mode < 0 || nwords < 0) return RERR_PARAM;
+	if (mode != LDT_RXSTEER_OFF && (!cpus || nwords == 0)) return RERR_PARAM;
+	if (nwords > LDT_RXSTEER_MAXCPUS / 32) nwords = LDT_RXSTEER_MAXCPUS / 32;
+	len = FNL_MSGMINLEN + strlen (name) + nwords * 4 + 24 + 128;
+	msg = malloc (len);
+	if (!msg) return RERR_NOMEM;
+	bzero (msg, len);
+	ret = fnl_setcmd (msg, LDT_CMD_SET_RXSTEER);
+	if (!RERR_ISOK(ret)) {
+		free (msg);
+		return ret;
+	}
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (	ptr, LDT_CMD_SET_RXSTEER_ATTR_NAME, name,
+								strlen(name)+1);
+	val = mode;
+	if (ptr) ptr = fnl_putattr (ptr, LDT_CMD_SET_RXSTEER_ATTR_MODE, &val, 4);
+	if (ptr && mode != LDT_RXSTEER_OFF) {
+		ptr = fnl_putattr (ptr, LDT_CMD_SET_RXSTEER_ATTR_CPUS, cpus, nwords * 4);
+	}
+	if (!ptr) {
+		free (msg);
+		return RERR_INTERNAL;
+	}
+
+	len = ptr - msg;
+	ret = ldt_nl_send (msg, len);
+	free (msg);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR, "error sending request to ldt kernel module: %s",
+					rerr_getstr3(ret));
+		return ret;
+	}
+	SLOGF (LOG_VVERB, "sent %d bytes", ret);
+	ret = ldt_nl_getret ();
+	ldt_mayclose ();
+	return ret;
+}
+
+int
+ldt_tun_setrebind (name, mode, drain)
+	const char	*name;
+	int			mode, drain;
+{
+	char		*msg;
+	int		ret, len;
+	char		*ptr;
+	uint32_t	val;
+
+	if (!name || mode > LDT_REBIND_MAX) return RERR_PARAM;
+	if (drain > LDT_REBIND_DRAIN_MAX) return RERR_PARAM;
+	len = FNL_MSGMINLEN + strlen (name) + 32 + 128;
+	msg = malloc (len);
+	if (!msg) return RERR_NOMEM;
+	bzero (msg, len);
+	ret = fnl_setcmd (msg, LDT_CMD_SET_REBIND);
+	if (!RERR_ISOK(ret)) {
+		free (msg);
+		return ret;
+	}
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (	ptr, LDT_CMD_SET_REBIND_ATTR_NAME, name,
+								strlen(name)+1);
+	if (ptr && mode >= 0) {
+		val = mode;
+		ptr = fnl_putattr (ptr, LDT_CMD_SET_REBIND_ATTR_MODE, &val, 4);
+	}
+	if (ptr && drain >= 0) {
+		val = drain;
+		ptr = fnl_putattr (ptr, LDT_CMD_SET_REBIND_ATTR_DRAIN, &val, 4);
+	}
+	if (!ptr) {
+		free (msg);
+		return RERR_INTERNAL;
+	}
+
+	len = ptr - msg;
+	ret = ldt_nl_send (msg, len);
+	free (msg);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR, "error sending request to ldt kernel module: %s",
+					rerr_getstr3(ret));
+		return ret;
+	}
+	SLOGF (LOG_VVERB, "sent %d bytes", ret);
+	ret = ldt_nl_getret ();
+	ldt_mayclose ();
+	return ret;
+}
+
+int
+ldt_tun_setaead (name, alg, key, keylen, keyid, flags)
+	const char		*name;
+	int				alg;
+	const uint8_t	*key;
+	int				keylen, keyid;
+	uint32_t			flags;
+{
+	char		*msg;
+	int		ret, len;
+	char		*ptr;
+	uint32_t	val;
+	uint8_t	kid;
+
+	if (!name || keyid < 0 || keyid > LDT_AEAD_KEYID_MAX) return RERR_PARAM;
+	if (flags & (LDT_AEAD_F_TX | LDT_AEAD_F_RX)) {
+		if (alg <= LDT_AEAD_NONE || alg > LDT_AEAD_MAX) return RERR_PARAM;
+		if (!key || keylen <= LDT_AEAD_SALTLEN || keylen > LDT_AEAD_MAXKEYLEN)
+			return RERR_PARAM;
+	}
+	len = FNL_MSGMINLEN + strlen (name) + LDT_AEAD_MAXKEYLEN + 48 + 128;
+	msg = malloc (len);
+	if (!msg) return RERR_NOMEM;
+	bzero (msg, len);
+	ret = fnl_setcmd (msg, LDT_CMD_SET_AEAD);
+	if (!RERR_ISOK(ret)) {
+		free (msg);
+		return ret;
+	}
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (	ptr, LDT_CMD_SET_AEAD_ATTR_NAME, name,
+								strlen(name)+1);
+	val = flags;
+	if (ptr) ptr = fnl_putattr (ptr, LDT_CMD_SET_AEAD_ATTR_FLAGS, &val, 4);
+	if (ptr && (flags & (LDT_AEAD_F_TX | LDT_AEAD_F_RX))) {
+		val = alg;
+		ptr = fnl_putattr (ptr, LDT_CMD_SET_AEAD_ATTR_ALG, &val, 4);
+		if (ptr) ptr = fnl_putattr (ptr, LDT_CMD_SET_AEAD_ATTR_KEY, key, keylen);
+		kid = keyid;
+		if (ptr) ptr = fnl_putattr (ptr, LDT_CMD_SET_AEAD_ATTR_KEYID, &kid, 1);
+	}
+	if (!ptr) {
+		bzero (msg, len);
+		free (msg);
+		return RERR_INTERNAL;
+	}
+
+	len = ptr - msg;
+	ret = ldt_nl_send (msg, len);
+	/* do not leave the key in freed memory */
+	bzero (msg, len);
+	free (msg);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR, "error sending request to ldt kernel module: %s",
+					rerr_getstr3(ret));
+		return ret;
+	}
+	SLOGF (LOG_VVERB, "sent %d bytes", ret);
+	ret = ldt_nl_getret ();
+	ldt_mayclose ();
+	return ret;
+}
+
+int
+ldt_tun_setpace (name, rate, burst, flags)
+	const char	*name;
+	int64_t		rate;
+	int			burst, flags;
+{
+	char		*msg;
+	int		ret, len;
+	char		*ptr;
+	uint32_t	val;
+	uint64_t	val64;
+
+	if (!name || rate > (int64_t)LDT_PACE_RATE_MAX) return RERR_PARAM;
+	if (burst > LDT_PACE_BURST_MAX) return RERR_PARAM;
+	len = FNL_MSGMINLEN + strlen (name) + 48 + 128;
+	msg = malloc (len);
+	if (!msg) return RERR_NOMEM;
+	bzero (msg, len);
+	ret = fnl_setcmd (msg, LDT_CMD_SET_PACE);
+	if (!RERR_ISOK(ret)) {
+		free (msg);
+		return ret;
+	}
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (	ptr, LDT_CMD_SET_PACE_ATTR_NAME, name,
+								strlen(name)+1);
+	if (ptr && rate >= 0) {
+		val64 = rate;
+		ptr = fnl_putattr (ptr, LDT_CMD_SET_PACE_ATTR_RATE, &val64, 8);
+	}
+	if (ptr && burst >= 0) {
+		val = burst;
+		ptr = fnl_putattr (ptr, LDT_CMD_SET_PACE_ATTR_BURST, &val, 4);
+	}
+	if (ptr && flags >= 0) {
+		val = flags;
+		ptr = fnl_putattr (ptr, LDT_CMD_SET_PACE_ATTR_FLAGS, &val, 4);
+	}
+	if (!ptr) {
+		free (msg);
+		return RERR_INTERNAL;
+	}
+
+	len = ptr - msg;
+	ret = ldt_nl_send (msg, len);
+	free (msg);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR, "error sending request to ldt kernel module: %s",
+					rerr_getstr3(ret));
+		return ret;
+	}
+	SLOGF (LOG_VVERB, "sent %d bytes", ret);
+	ret = ldt_nl_getret ();
+	ldt_mayclose ();
+	return ret;
+}
+
+int
+ldt_tun_setfec (name, mode, k, delay)
+	const char	*name;
+	int			mode, k, delay;
+{
+	char		*msg;
+	int		ret, len;
+	char		*ptr;
+	uint32_t	val;
+	uint8_t	val8;
+
+	if (!name || mode < 0 || mode > LDT_FEC_MAX) return RERR_PARAM;
+	if (k > LDT_FEC_K_MAX || delay > LDT_FEC_DELAY_MAX) return RERR_PARAM;
+	len = FNL_MSGMINLEN + strlen (name) + 48 + 128;
+	msg = malloc (len);
+	if (!msg) return RERR_NOMEM;
+	bzero (msg, len);
+	ret = fnl_setcmd (msg, LDT_CMD_SET_FEC);
+	if (!RERR_ISOK(ret)) {
+		free (msg);
+		return ret;
+	}
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (	ptr, LDT_CMD_SET_FEC_ATTR_NAME, name,
+								strlen(name)+1);
+	if (ptr) {
+		val = mode;
+		ptr = fnl_putattr (ptr, LDT_CMD_SET_FEC_ATTR_MODE, &val, 4);
+	}
+	if (ptr && k >= 0) {
+		val8 = k;
+		ptr = fnl_putattr (ptr, LDT_CMD_SET_FEC_ATTR_K, &val8, 1);
+	}
+	if (ptr && delay >= 0) {
+		val = delay;
+		ptr = fnl_putattr (ptr, LDT_CMD_SET_FEC_ATTR_DELAY, &val, 4);
+	}
+	if (!ptr) {
+		free (msg);
+		return RERR_INTERNAL;
+	}
+
+	len = ptr - msg;
+	ret = ldt_nl_send (msg, len);
+	free (msg);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR, "error sending request to ldt kernel module: %s",
+					rerr_getstr3(ret));
+		return ret;
+	}
+	SLOGF (LOG_VVERB, "sent %d bytes", ret);
+	ret = ldt_nl_getret ();
+	ldt_mayclose ();
+	return ret;
+}
+
+
+int
+ldt_tun_setpaths (name, list, num, reorder)
+	const char					*name;
+	const struct ldt_path	*list;
+	int							num, reorder;
+{
+	char						*msg;
+	int						ret, len, i;
+	char						*ptr;
+	uint32_t					val;
+	struct ldt_bondpath	bp[LDT_BOND_MAXPATH];
+
+	if (!name || (num > 0 && !list)) return RERR_PARAM;
+	if (num > LDT_BOND_MAXPATH) {
+		SLOGF (LOG_ERR, "too many paths (%d), maximum is %d", num,
+					LDT_BOND_MAXPATH);
+		return RERR_PARAM;
+	}
+	if (reorder > LDT_BOND_REORDER_MAX) return RERR_PARAM;
+	bzero (bp, sizeof (bp));
+	for (i=0; i<num; i++) {
+		if (FRADP_FAM(&list[i].local) == AF_INET) {
+			bp[i].local.addr.v4 = list[i].local.v4.sin_addr.s_addr;
+			bp[i].local.port = frad_getport ((frad_t*)&list[i].local);
+		} else if (FRADP_ISIPV6(&list[i].local)) {
+			bp[i].local.ipv6 = 1;
+			memcpy (bp[i].local.addr.v6, list[i].local.v6.sin6_addr.s6_addr, 16);
+			bp[i].local.port = frad_getport ((frad_t*)&list[i].local);
+		}
+		strncpy (bp[i].dev, list[i].dev, sizeof (bp[i].dev) - 1);
+		bp[i].rate = list[i].rate;
+	}
+	len = FNL_MSGMINLEN + strlen (name) + sizeof (bp) + 48 + 128;
+	msg = malloc (len);
+	if (!msg) return RERR_NOMEM;
+	bzero (msg, len);
+	ret = fnl_setcmd (msg, LDT_CMD_SET_PATHS);
+	if (!RERR_ISOK(ret)) {
+		free (msg);
+		return ret;
+	}
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (	ptr, LDT_CMD_SET_PATHS_ATTR_NAME, name,
+								strlen(name)+1);
+	if (ptr && num >= 0) {
+		ptr = fnl_putattr (	ptr, LDT_CMD_SET_PATHS_ATTR_LIST, bp,
+									num * sizeof (struct ldt_bondpath));
+	}
+	if (ptr && reorder >= 0) {
+		val = (uint32_t)reorder;
+		ptr = fnl_putattr (ptr, LDT_CMD_SET_PATHS_ATTR_REORDER, &val, 4);
+	}
+	if (!ptr) {
+		free (msg);
+		return RERR_INTERNAL;
+	}
 
 	len = ptr - msg;
 	ret = ldt_nl_send (msg, len);
@@ -525,17 +1173,71 @@ ldt_tun_setqueue (name, txqlen, qpolicy)
 	ldt_mayclose ();
 	return ret;
 }
+int
+ldt_tun_setqos (name, cfg)
+	const char					*name;
+	const struct ldt_qoscfg	*cfg;
+{
+	char		*msg;
+	int		ret, len;
+	char		*ptr;
+
+	if (!name) return RERR_PARAM;
+	if (cfg && cfg->dscp > LDT_QOS_DSCP_MAX) return RERR_PARAM;
+	len = FNL_MSGMINLEN + strlen (name) + sizeof (*cfg) + 48 + 128;
+	msg = malloc (len);
+	if (!msg) return RERR_NOMEM;
+	bzero (msg, len);
+	ret = fnl_setcmd (msg, LDT_CMD_SET_QOS);
+	if (!RERR_ISOK(ret)) {
+		free (msg);
+		return ret;
+	}
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (	ptr, LDT_CMD_SET_QOS_ATTR_NAME, name,
+								strlen(name)+1);
+	if (ptr && cfg) {
+		ptr = fnl_putattr (ptr, LDT_CMD_SET_QOS_ATTR_CFG, cfg, sizeof (*cfg));
+	}
+	if (!ptr) {
+		free (msg);
+		return RERR_INTERNAL;
+	}
+
+	len = ptr - msg;
+	ret = ldt_nl_send (msg, len);
+	free (msg);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR, "error sending request to ldt kernel module: %s",
+					rerr_getstr3(ret));
+		return ret;
+	}
+	SLOGF (LOG_VVERB, "sent %d bytes", ret);
+	ret = ldt_nl_getret ();
+	ldt_mayclose ();
+	return ret;
+}
+
 
 int
 ldt_tun_serverstart (name, tout)
 	const char	*name;
 	tmo_t			tout;
+{
+	return ldt_tun_serverstart2 (name, 0, tout);
+}
+
+int
+ldt_tun_serverstart2 (name, flags, tout)
+	const char	*name;
+	uint32_t		flags;
+	tmo_t			tout;
 {
 	int							ret;
 	struct ldt_evinfo	evinfo;
 
 	ldt_event_open ();
-	ret = do_tun_serverstart (name);
+	ret = do_tun_serverstart (name, flags, tout != 0);
 	if (!RERR_ISOK(ret)) {
 		SLOGFE (LOG_ERR, "error starting server: %s", rerr_getstr3(ret));
 		ldt_mayclose ();
@@ -588,8 +1290,10 @@ ldt_tun_serverstart (name, tout)
 
 static
 int
-do_tun_serverstart (name)
+do_tun_serverstart (name, flags, sync)
 	const char	*name;
+	uint32_t		flags;
+	int			sync;
 {
 	char		*msg;
 	int		ret, len;
@@ -607,6 +1311,9 @@ do_tun_serverstart (name)
 	ptr = fnl_getmsgdata (msg, 0);
 	ptr = fnl_putattr (	ptr, LDT_CMD_SERVERSTART_ATTR_NAME, name,
 								strlen(name)+1);
+	if (ptr && flags) {
+		ptr = fnl_putattr (ptr, LDT_CMD_SERVERSTART_ATTR_FLAGS, &flags, 4);
+	}
 	if (!ptr) {
 		free (msg);
 		return RERR_INTERNAL;
@@ -620,7 +1327,8 @@ do_tun_serverstart (name)
 		return ret;
 	}
 	SLOGF (LOG_VVERB, "sent %d bytes", ret);
-	ret = ldt_nl_getret ();
+	/* we are going to wait for events - don't pipeline */
+	ret = ldt_nl_getret2 (sync ? LDT_NL_F_SYNC : 0);
 	ldt_mayclose ();
 	return ret;
 }
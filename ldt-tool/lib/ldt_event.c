@@ -79,6 +79,7 @@
 static int ldt_ifaceev_parse (char*, struct ldt_evinfo*, int);
 static int ldt_ifaceev_parse2 (struct xml*, struct ldt_evinfo*, int);
 static int tp_getparseflags (int);
+static int ldt_subscribe_send (int, const char**, int, uint32_t);
 
 int
 ldt_event_open ()
@@ -94,26 +95,79 @@ ldt_event_close ()
 
 int
 ldt_subscribe ()
+{
+	return ldt_subscribe2 (NULL, 0, 0);
+}
+
+int
+ldt_subscribe2 (ifaces, nif, evmask)
+	const char	**ifaces;
+	int			nif;
+	uint32_t		evmask;
+{
+	return ldt_subscribe_send (LDT_CMD_SUBSCRIBE, ifaces, nif, evmask);
+}
+
+int
+ldt_subscribe_update (ifaces, nif, evmask)
+	const char	**ifaces;
+	int			nif;
+	uint32_t		evmask;
+{
+	return ldt_subscribe_send (LDT_CMD_SUBSCRIBE_UPDATE, ifaces, nif, evmask);
+}
+
+static
+int
+ldt_subscribe_send (cmd, ifaces, nif, evmask)
+	int			cmd;
+	const char	**ifaces;
+	int			nif;
+	uint32_t		evmask;
 {
 	char		*msg;
-	int		ret, len;
+	int		ret, len, i;
 	char		*ptr;
+	char		iflist[LDT_SUBSCRIBE_MAXIF][16];
 
+	if (nif > 0 && !ifaces) return RERR_PARAM;
+	if (nif > LDT_SUBSCRIBE_MAXIF) {
+		SLOGF (LOG_ERR, "too many interfaces (%d), maximum is %d", nif,
+					LDT_SUBSCRIBE_MAXIF);
+		return RERR_PARAM;
+	}
+	bzero (iflist, sizeof (iflist));
+	for (i=0; i<nif; i++) {
+		if (!ifaces[i]) return RERR_PARAM;
+		strncpy (iflist[i], ifaces[i], sizeof (iflist[i]) - 1);
+	}
 	ret = ldt_open ();
 	if (!RERR_ISOK(ret)) {
 		SLOGF (LOG_ERR, "error opening connection to ldt module: %s",
 						rerr_getstr3(ret));
 		return ret;
 	}
-	len = FNL_MSGMINLEN + 128;
+	len = FNL_MSGMINLEN + sizeof (iflist) + 48 + 128;
 	msg = malloc (len);
+	if (!msg) return RERR_NOMEM;
 	bzero (msg, len);
-	ret = fnl_setcmd (msg, LDT_CMD_SUBSCRIBE);
+	ret = fnl_setcmd (msg, cmd);
 	if (!RERR_ISOK(ret)) {
 		free (msg);
 		return ret;
 	}
 	ptr = fnl_getmsgdata (msg, 0);
+	if (nif > 0) {
+		ptr = fnl_putattr (	ptr, LDT_CMD_SUBSCRIBE_ATTR_IFLIST, iflist,
+									nif * sizeof (iflist[0]));
+	}
+	if (ptr && evmask) {
+		ptr = fnl_putattr (ptr, LDT_CMD_SUBSCRIBE_ATTR_EVMASK, &evmask, 4);
+	}
+	if (!ptr) {
+		free (msg);
+		return RERR_INTERNAL;
+	}
 	len = ptr - msg;
 	ret = ldt_nl_send (msg, len);
 	free (msg);
@@ -254,6 +308,25 @@ ldt_waitifaceev (evinfo, listen_iface, listen_evtypes,
 }
 
 
+/* parses an event string as received by ldt_event_recv, evstr is
+ * modified and referenced by evinfo (freed by LDT_EVINFO_HFREE)
+ */
+int
+ldt_evinfo_parse (evinfo, evstr, evtype)
+	struct ldt_evinfo	*evinfo;
+	char					*evstr;
+	int					evtype;
+{
+	int	ret;
+
+	if (!evinfo || !evstr) return RERR_PARAM;
+	ret = ldt_ifaceev_parse (evstr, evinfo, tp_getparseflags (evtype));
+	if (!RERR_ISOK(ret)) return ret;
+	evinfo->evtype = evtype;
+	return RERR_OK;
+}
+
+
 static
 int
 ldt_ifaceev_parse (buf, evinfo, flags)
@@ -323,6 +396,24 @@ ldt_ifaceev_parse2 (xml, evinfo, flags)
 	} else {
 		evinfo->remport = -1;
 	}
+	ret = xml_search (&s, xml, "peeridx", 0);
+	if (RERR_ISOK(ret) && s) {
+		evinfo->peeridx = atoi (s);
+	} else {
+		evinfo->peeridx = -1;
+	}
+	ret = xml_search (&s, xml, "clientid", 0);
+	if (RERR_ISOK(ret) && s) {
+		evinfo->clientid = atoi (s);
+	} else {
+		evinfo->clientid = -1;
+	}
+	ret = xml_search (&s, xml, "switchover", 0);
+	if (RERR_ISOK(ret) && s) {
+		evinfo->switchover = atoi (s);
+	} else {
+		evinfo->switchover = -1;
+	}
 	evinfo->reason = 0;
 	evinfo->s_reason = "none";
 	ret = xml_search (&s, xml, "subflow", 0);
@@ -350,6 +441,8 @@ tp_getparseflags (evtype)
 		{ LDT_EVTYPE_REBIND, TP_PARSE_NEED_IFC},
 		{ LDT_EVTYPE_SUBFLOW_UP, TP_PARSE_NEED_IFC},
 		{ LDT_EVTYPE_SUBFLOW_DOWN, TP_PARSE_NEED_IFC},
+		{ LDT_EVTYPE_PEER_UP, TP_PARSE_NEED_IFC},
+		{ LDT_EVTYPE_PEER_DOWN, TP_PARSE_NEED_IFC},
 		{ -1, -1 }};
 	const struct needflags			*p;
 
@@ -374,6 +467,8 @@ static const struct top_flagmap evnamemap[] = {
 	{ "rebind", 1<<LDT_EVTYPE_REBIND },
 	{ "subflowup", 1<<LDT_EVTYPE_SUBFLOW_UP },
 	{ "subflowdown", 1<<LDT_EVTYPE_SUBFLOW_UP },
+	{ "peerup", 1<<LDT_EVTYPE_PEER_UP },
+	{ "peerdown", 1<<LDT_EVTYPE_PEER_DOWN },
 	{ NULL, -1 }};
 
 int
@@ -405,6 +500,8 @@ static const struct top_flagmap evhelpmap[] = {
 	{ "new interface brought up", 1<<LDT_EVTYPE_IFUP },
 	{ "ldt module unloaded", 1<<LDT_EVTYPE_TPDOWN },
 	{ "address was rebinded", 1<<LDT_EVTYPE_REBIND },
+	{ "client connected to multi client server", 1<<LDT_EVTYPE_PEER_UP },
+	{ "client disconnected from multi client server", 1<<LDT_EVTYPE_PEER_DOWN },
 	{ NULL, -1 }};
 
 const char *
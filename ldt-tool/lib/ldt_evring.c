@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2015-2022 by Frank Reker, Deutsche Telekom AG
+ *
+ * LDT - Lightweight (MP-)DCCP Tunnel kernel module
+ *
+ * This is not Open Source software. 
+ * This work is made available to you under a source-available license, as 
+ * detailed below.
+ *
+ * Copyright 2022 Deutsche Telekom AG
+ *
+ * Permission is hereby granted, free of charge, subject to below Commons 
+ * Clause, to any person obtaining a copy of this software and associated 
+ * documentation files (the "Software"), to deal in the Software without 
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * “Commons Clause” License Condition v1.0
+ *
+ * The Software is provided to you by the Licensor under the License, as
+ * defined below, subject to the following condition.
+ *
+ * Without limiting other conditions in the License, the grant of rights under
+ * the License will not include, and the License does not grant to you, the
+ * right to Sell the Software.
+ *
+ * For purposes of the foregoing, “Sell” means practicing any or all of the
+ * rights granted to you under the License to provide to third parties, for a
+ * fee or other consideration (including without limitation fees for hosting 
+ * or consulting/ support services related to the Software), a product or 
+ * service whose value derives, entirely or substantially, from the
+ * functionality of the Software. Any license notice or attribution required
+ * by the License must also include this Commons Clause License Condition
+ * notice.
+ *
+ * Licensor: Deutsche Telekom AG
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fr/base.h>
+
+#include <ldt/ldt.h>
+
+
+static int evring_get (struct ldt_evring*, struct ldt_evrec*);
+
+
+int
+ldt_evring_open (ring, flags)
+	struct ldt_evring	*ring;
+	int					flags;
+{
+	struct ldt_evring_hdr	hdr;
+	uint64_t						head;
+	void							*map;
+	size_t						mapsz;
+	int							fd;
+
+	if (!ring) return RERR_PARAM;
+	*ring = (struct ldt_evring) { .fd = -1 };
+	fd = open (LDT_EVRING_DEV, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) {
+		SLOGF (LOG_ERR, "cannot open %s: %s", LDT_EVRING_DEV,
+					strerror (errno));
+		return RERR_SYSTEM;
+	}
+	/* map the header page first to learn the ring size */
+	map = mmap (NULL, sysconf (_SC_PAGESIZE), PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		SLOGF (LOG_ERR, "cannot mmap event ring: %s", strerror (errno));
+		close (fd);
+		return RERR_SYSTEM;
+	}
+	hdr = *(struct ldt_evring_hdr*)map;
+	munmap (map, sysconf (_SC_PAGESIZE));
+	if (hdr.magic != LDT_EVRING_MAGIC || hdr.version != LDT_EVRING_VERSION
+			|| hdr.recsz < sizeof (struct ldt_evrec) || hdr.nrec == 0
+			|| (hdr.nrec & (hdr.nrec - 1))) {
+		SLOGF (LOG_ERR, "event ring has unsupported format");
+		close (fd);
+		return RERR_INVALID_FORMAT;
+	}
+	mapsz = (size_t)hdr.hdrsz + (size_t)hdr.nrec * hdr.recsz;
+	map = mmap (NULL, mapsz, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		SLOGF (LOG_ERR, "cannot mmap event ring: %s", strerror (errno));
+		close (fd);
+		return RERR_SYSTEM;
+	}
+	ring->fd = fd;
+	ring->map = map;
+	ring->mapsz = mapsz;
+	ring->hdr = map;
+	ring->rec = (const char*)map + hdr.hdrsz;
+	ring->recsz = hdr.recsz;
+	ring->nrec = hdr.nrec;
+	head = __atomic_load_n (&ring->hdr->head, __ATOMIC_ACQUIRE);
+	if ((flags & LDT_EVRING_F_OLDEST) && head > 0) {
+		ring->next = (head > ring->nrec) ? head - ring->nrec + 1 : 1;
+	} else {
+		ring->next = head + 1;
+	}
+	return RERR_OK;
+}
+
+
+int
+ldt_evring_close (ring)
+	struct ldt_evring	*ring;
+{
+	if (!ring) return RERR_PARAM;
+	if (ring->map) munmap (ring->map, ring->mapsz);
+	if (ring->fd >= 0) close (ring->fd);
+	*ring = (struct ldt_evring) { .fd = -1 };
+	return RERR_OK;
+}
+
+
+int
+ldt_evring_fd (ring)
+	struct ldt_evring	*ring;
+{
+	return ring ? ring->fd : -1;
+}
+
+
+/* returns the next record - RERR_TIMEDOUT if there is none within
+ * timeout (0 = don't wait, -1 = wait forever). records overwritten
+ * before they could be read are added to ring->lost */
+int
+ldt_evring_read (ring, ev, timeout)
+	struct ldt_evring	*ring;
+	struct ldt_evrec	*ev;
+	tmo_t					timeout;
+{
+	struct pollfd	pfd;
+	tmo_t				start, now, tout;
+	uint64_t			head;
+	int				ret;
+
+	if (!ring || !ring->map || !ev) return RERR_PARAM;
+	TMO_START(start,timeout);
+	while (1) {
+		ret = evring_get (ring, ev);
+		if (ret != RERR_NODATA) return ret;
+		/* rearm poll, then look at the ring again - otherwise we could
+		 * miss records written in between */
+		if (read (ring->fd, &head, sizeof (head)) < 0 && errno != EAGAIN) {
+			SLOGF (LOG_ERR, "error reading event ring: %s", strerror (errno));
+			return RERR_SYSTEM;
+		}
+		ret = evring_get (ring, ev);
+		if (ret != RERR_NODATA) return ret;
+		tout = TMO_GETTIMEOUT(start,timeout,now);
+		if (tout == 0) return RERR_TIMEDOUT;
+		pfd = (struct pollfd) { .fd = ring->fd, .events = POLLIN };
+		ret = poll (&pfd, 1, tout < 0 ? -1 : (int)((tout + 999) / 1000));
+		if (ret < 0) {
+			if (errno == EINTR) continue;
+			SLOGF (LOG_ERR, "error polling event ring: %s", strerror (errno));
+			return RERR_SYSTEM;
+		}
+		if (ret == 0) return RERR_TIMEDOUT;
+	}
+}
+
+
+static
+int
+evring_get (ring, ev)
+	struct ldt_evring	*ring;
+	struct ldt_evrec	*ev;
+{
+	const struct ldt_evrec	*rec;
+	uint64_t						head, seq1, seq2;
+
+	while (1) {
+		head = __atomic_load_n (&ring->hdr->head, __ATOMIC_ACQUIRE);
+		if (ring->next > head) return RERR_NODATA;
+		if (head - ring->next >= ring->nrec) {
+			ring->lost += head - ring->nrec + 1 - ring->next;
+			ring->next = head - ring->nrec + 1;
+		}
+		rec = (const struct ldt_evrec*)(ring->rec +
+					((ring->next - 1) & (ring->nrec - 1)) * ring->recsz);
+		seq1 = __atomic_load_n (&rec->seq, __ATOMIC_ACQUIRE);
+		memcpy (ev, rec, sizeof (struct ldt_evrec));
+		__atomic_thread_fence (__ATOMIC_ACQUIRE);
+		seq2 = __atomic_load_n (&rec->seq, __ATOMIC_RELAXED);
+		if (seq1 == ring->next && seq2 == ring->next) break;
+		/* overwritten while we were copying */
+		ring->lost++;
+		ring->next++;
+	}
+	ev->seq = ring->next++;
+	ev->iface[sizeof(ev->iface)-1] = 0;
+	ev->sfname[sizeof(ev->sfname)-1] = 0;
+	return RERR_OK;
+}
+
+/*
+ * Overrides for XEmacs and vim so that we get a uniform tabbing style.
+ * XEmacs/vim will notice this stuff at the end of the file and automatically
+ * adjust the settings for this buffer only.  This must remain at the end
+ * of the file.
+ * ---------------------------------------------------------------------------
+ * Local variables:
+ * c-indent-level: 3
+ * c-basic-offset: 3
+ * tab-width: 3
+ * End:
+ * vim:tw=0:ts=3:wm=0:
+ */
@@ -268,6 +268,61 @@ ldt_get_alldevinfo (info, ilen)
 }
 
 
+/* flags: LDT_LATENCY_F_RESET resets the histograms after reading */
+int
+ldt_get_latency (name, lat, flags)
+	const char				*name;
+	struct ldt_latency	*lat;
+	uint32_t					flags;
+{
+	char		*msg;
+	int		ret, len;
+	char		*ptr;
+	char		*data = NULL;
+	uint32_t	dlen = 0;
+
+	if (!name || !lat) return RERR_PARAM;
+	len = FNL_MSGMINLEN + strlen (name) + 8 + 128;
+	msg = malloc (len);
+	if (!msg) return RERR_NOMEM;
+	bzero (msg, len);
+	ret = fnl_setcmd (msg,	LDT_CMD_GET_LATENCY);
+	if (!RERR_ISOK(ret)) {
+		free (msg);
+		return ret;
+	}
+	ptr = fnl_getmsgdata (msg, 0);
+	ptr = fnl_putattr (	ptr, LDT_CMD_GET_LATENCY_ATTR_NAME, name,
+								strlen(name)+1);
+	if (ptr && flags) {
+		ptr = fnl_putattr (ptr, LDT_CMD_GET_LATENCY_ATTR_FLAGS, &flags, 4);
+	}
+	if (!ptr) {
+		free (msg);
+		return RERR_INTERNAL;
+	}
+	len = ptr - msg;
+	ret = ldt_nl_send (msg, len);
+	free (msg);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR, "error sending request to ldt kernel module: %s",
+					rerr_getstr3(ret));
+		return ret;
+	}
+	SLOGF (LOG_VVERB, "sent %d bytes", ret);
+	ret = ldt_nl_getanswer (&data, &dlen);
+	ldt_mayclose ();
+	if (!RERR_ISOK(ret)) return ret;
+	if (dlen < sizeof (struct ldt_latency)) {
+		SLOGF (LOG_ERR, "short latency answer (%u bytes)", (unsigned)dlen);
+		free (data);
+		return RERR_SERVER;
+	}
+	memcpy (lat, data, sizeof (struct ldt_latency));
+	free (data);
+	return RERR_OK;
+}
+
 
 static int parsestat (struct ldt_status_t*, char*);
 static int tp_parse_status (struct ldt_status_t**, int*, const char *, struct xml*);
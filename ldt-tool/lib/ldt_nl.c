@@ -75,11 +75,35 @@
 #include <ldt/ldt.h>
 
 
-static int ldt_getinfo (int*, char**, uint32_t*);
+static int ldt_getinfo (int*, char**, uint32_t*, uint32_t*);
+static int pl_defer ();
+static int pl_recvone ();
+static int nl_recvmsg (char**, tmo_t, int);
 
 static int tpfd = -1;
 static int autoopen = 0;
 static tmo_t timeout = 5000000LL;
+static uint32_t lastseq = 0;
+
+/* receive buffer - reused for all messages, events are received in
+ * batches, answers one at a time (they might be larger than a slot)
+ */
+#define NL_RBUF_SLOTLEN	8192
+#define NL_RBUF_NSLOTS	16
+static struct fnl_rbuf	rbuf;
+
+/* pipelined requests waiting for their answer (ring buffer) */
+struct pl_req {
+	uint32_t	seq;
+	int		tag;
+};
+static struct pl_req			*pl_req = NULL;
+static int						pl_window = 0;
+static int						pl_head = 0;
+static int						pl_num = 0;
+static int						pl_tag = 0;
+static ldt_pipeline_cb_t	pl_cb = NULL;
+static void						*pl_arg = NULL;
 
 void
 ldt_settimeout (tout)
@@ -122,9 +146,11 @@ ldt_close ()
 	int   ret;
 	
 	if (tpfd < 0) return RERR_OK;
+	if (pl_num > 0) ldt_pipeline_flush ();
 	ret = fnl_close (tpfd);
 	tpfd = -1;
 	autoopen = 0;
+	fnl_rbuf_free (&rbuf);
 	return ret;
 }
 
@@ -147,17 +173,32 @@ ldt_nl_send (msg, len)
 	if (!RERR_ISOK(ret)) {
 		SLOGFE (LOG_ERR, "error sending messag >>%s<< to kernel: %s", msg,
 						rerr_getstr3 (ret));
+		return ret;
 	}
+	/* fnl_send has filled in the header */
+	lastseq = ((struct nlmsghdr*)msg)->nlmsg_seq;
 	return ret;
 }
 
 
 int
 ldt_nl_getret ()
+{
+	return ldt_nl_getret2 (0);
+}
+
+int
+ldt_nl_getret2 (flags)
+	int	flags;
 {
 	int	ret, rval;
 
-	ret = ldt_getinfo (&rval, NULL, NULL);
+	if (pl_req) {
+		if (!(flags & LDT_NL_F_SYNC)) return pl_defer ();
+		ret = ldt_pipeline_flush ();
+		if (!RERR_ISOK(ret)) return ret;
+	}
+	ret = ldt_getinfo (&rval, NULL, NULL, NULL);
 	if (!RERR_ISOK(ret)) {
 		SLOGFE (LOG_ERR, "error getting answer from kernel: %s",
 									rerr_getstr3(ret));
@@ -182,7 +223,11 @@ ldt_nl_getanswer (data, dlen)
 
 	if (!data) return RERR_PARAM;
 	*data = NULL;
-	ret = ldt_getinfo (&rval, data, dlen);
+	if (pl_req) {
+		ret = ldt_pipeline_flush ();
+		if (!RERR_ISOK(ret)) return ret;
+	}
+	ret = ldt_getinfo (&rval, data, dlen, NULL);
 	if (!RERR_ISOK(ret)) {
 		SLOGFE (LOG_ERR, "error getting answer from kernel: %s",
 									rerr_getstr3(ret));
@@ -204,117 +249,226 @@ ldt_nl_getanswer (data, dlen)
 
 static
 int
-ldt_getinfo (rval, data, dlen)
+ldt_getinfo (rval, data, dlen, seq)
 	int		*rval;
 	char		**data;
-	uint32_t	*dlen;
+	uint32_t	*dlen, *seq;
 {
-	ssize_t	len, mlen;
-	char		*buf=NULL, *ptr, *ptr2, *xptr, *s;
-	int		ret, kret;
-	int		hasret=0, hasdata=0;
+	ssize_t	len;
+	char		*buf, *ptr, *xptr;
+	int		ret, mlen;
+	int		hasret=0;
 
 	if (tpfd < 0) return RERR_NOT_AVAILABLE;
 
 	if (data) *data = NULL;
 	if (dlen) *dlen = 0;
 retry:
-	ret = mlen = fnl_recv (tpfd, &buf, timeout, FNL_F_NOHDR);
+	ret = mlen = nl_recvmsg (&buf, timeout, 0);
 	if (!RERR_ISOK(ret)) {
 		SLOGFE (LOG_ERR, "error receiving data: %s", rerr_getstr3 (ret));
 		return ret;
 	}
-	if (mlen == 0) goto retry;
-	if (!buf) return RERR_INTERNAL;
+	if (seq) *seq = ((struct nlmsghdr*)buf)->nlmsg_seq;
 	ret = fnl_getmsgtype (buf);
-	if (!RERR_ISOK(ret)) {
-		free (buf);
-		return ret;
-	}
+	if (!RERR_ISOK(ret)) return ret;
 	if (ret == NLMSG_ERROR) {
-		if (fnl_getcmd (buf) < NLMSG_LENGTH(sizeof(struct nlmsgerr))) {
+		if (mlen < (int)NLMSG_LENGTH(sizeof(struct nlmsgerr))) {
 			SLOGF (LOG_ERR, "truncated error message");
-			free (buf);
 			return RERR_SYSTEM;
 		} else {
 			errno = -((struct nlmsgerr*)NLMSG_DATA(buf))->error;
 			if (rval) *rval = errno;
 		}
-		free (buf);
 		return RERR_OK;
 	}
 	ret = fnl_getcmd (buf);
-	if (!RERR_ISOK(ret)) {
-		free (buf);
-		return ret;
-	}
+	if (!RERR_ISOK(ret)) return ret;
 	if (ret == LDT_CMD_SEND_EVENT) {
 		/* ignore for now - should be handeld !!! - TBD */
-		free (buf);
 		goto retry;
 	}
-	if (ret != LDT_CMD_SEND_INFO) {
-		free (buf);
-		return RERR_INVALID_CMD;
-	}
-	ptr = fnl_getmsgdata (buf, 0);
-	while (ptr && ptr-buf < mlen) {
-		ret = fnl_getattrid (ptr);
-		if (!RERR_ISOK(ret)) {
-			free (buf);
-			return ret;
-		}
-		switch (ret) {
+	if (ret != LDT_CMD_SEND_INFO) return RERR_INVALID_CMD;
+	/* the message stays in the receive buffer - sum up the data chunks
+	 * first, so the answer can be copied out in one go
+	 */
+	len = 0;
+	for (ptr = NULL; (ptr = fnl_attrnext (buf, 0, ptr)); ) {
+		switch (fnl_getattrid (ptr)) {
 		case LDT_CMD_SEND_INFO_ATTR_RET:
+			if (fnl_getattrlen (ptr) < 4) return RERR_INTERNAL;
 			hasret = 1;
-			ptr2 = fnl_getattrdata (ptr);
-			if (!ptr2) {
-				free (buf);
-				return RERR_INTERNAL;
-			}
-			kret = (int)*(uint32_t*)ptr2;
-			if (rval) *rval = kret;
+			if (rval) *rval = (int)*(uint32_t*)fnl_getattrdata (ptr);
 			break;
 		case LDT_CMD_SEND_INFO_ATTR_INFO:
-			hasdata = 1;
+			len += fnl_getattrlen (ptr);
 			break;
 		}
-		ptr = fnl_getnextattr (ptr);
 	}
-	if (hasdata && data) {
-		xptr = buf;
-		ptr = fnl_getmsgdata (buf, 0);
-		while (ptr && ptr-buf < mlen) {
-			ret = fnl_getattrid (ptr);
-			if (!RERR_ISOK(ret)) {
-				free (buf);
-				return ret;
-			}
-			len = fnl_getattrlen (ptr);
-			s = fnl_getattrdata (ptr);
-			ptr = fnl_getnextattr (ptr);
-			switch (ret) {
-			case LDT_CMD_SEND_INFO_ATTR_INFO:
-				memmove (xptr, s, len);
-				xptr += len;
-				break;
-			}
+	if (!hasret && rval) *rval = 0;
+	if (!data) return RERR_OK;
+	*data = xptr = malloc (len+1);
+	if (!xptr) return RERR_NOMEM;
+	for (ptr = NULL; (ptr = fnl_attrnext (buf, 0, ptr)); ) {
+		if (fnl_getattrid (ptr) != LDT_CMD_SEND_INFO_ATTR_INFO) continue;
+		memcpy (xptr, fnl_getattrdata (ptr), fnl_getattrlen (ptr));
+		xptr += fnl_getattrlen (ptr);
+	}
+	*xptr = 0;
+	if (dlen) *dlen = len;
+	return RERR_OK;
+}
+
+/* returns the next message from the receive buffer, the message is
+ * valid until the next call
+ */
+static
+int
+nl_recvmsg (msg, tout, batch)
+	char	**msg;
+	tmo_t	tout;
+	int	batch;
+{
+	int	ret, len;
+
+	if (!rbuf.buf) {
+		ret = fnl_rbuf_init (&rbuf, NULL, NL_RBUF_SLOTLEN, NL_RBUF_NSLOTS);
+		if (!RERR_ISOK(ret)) return ret;
+	}
+	while (!(*msg = fnl_rbuf_next (&rbuf, &len))) {
+		ret = fnl_recvbatch (tpfd, &rbuf, batch ? 0 : 1, tout, FNL_F_NOHDR);
+		if (!RERR_ISOK(ret)) return ret;
+	}
+	return len;
+}
+
+
+
+/* pipelining - requests without answer data are not waited for,
+ * instead their answers are collected later and reported to the
+ * callback. Requests that need the answer wait for all outstanding
+ * answers first - the kernel answers in order.
+ */
+
+int
+ldt_pipeline_start (window, cb, arg)
+	int					window;
+	ldt_pipeline_cb_t	cb;
+	void					*arg;
+{
+	int	ret;
+
+	if (pl_req) return RERR_BUSY;
+	if (window <= 0) window = LDT_PIPELINE_WINDOW;
+	ret = ldt_open ();
+	if (!RERR_ISOK(ret)) return ret;
+	pl_req = malloc (window * sizeof (struct pl_req));
+	if (!pl_req) return RERR_NOMEM;
+	pl_window = window;
+	pl_head = pl_num = pl_tag = 0;
+	pl_cb = cb;
+	pl_arg = arg;
+	return RERR_OK;
+}
+
+void
+ldt_pipeline_settag (tag)
+	int	tag;
+{
+	pl_tag = tag;
+}
+
+int
+ldt_pipeline_flush ()
+{
+	int	ret;
+
+	while (pl_num > 0) {
+		ret = pl_recvone ();
+		if (!RERR_ISOK(ret)) return ret;
+	}
+	return RERR_OK;
+}
+
+int
+ldt_pipeline_stop ()
+{
+	int	ret;
+
+	if (!pl_req) return RERR_OK;
+	ret = ldt_pipeline_flush ();
+	free (pl_req);
+	pl_req = NULL;
+	pl_window = pl_num = 0;
+	pl_cb = NULL;
+	ldt_close ();
+	return ret;
+}
+
+static
+int
+pl_defer ()
+{
+	int	ret, idx;
+
+	if (pl_num >= pl_window) {
+		ret = pl_recvone ();
+		if (!RERR_ISOK(ret)) return ret;
+	}
+	idx = (pl_head + pl_num) % pl_window;
+	pl_req[idx].seq = lastseq;
+	pl_req[idx].tag = pl_tag;
+	pl_num++;
+	return RERR_OK;
+}
+
+static
+int
+pl_recvone ()
+{
+	int		ret, rval = 0, i, idx;
+	uint32_t	seq;
+
+	if (pl_num <= 0) return RERR_OK;
+	ret = ldt_getinfo (&rval, NULL, NULL, &seq);
+	if (!RERR_ISOK(ret)) {
+		/* we don't know which answers are lost - fail all */
+		SLOGFE (LOG_ERR, "error receiving answer from kernel: %s",
+					rerr_getstr3(ret));
+		for (; pl_num > 0; pl_num--) {
+			if (pl_cb) pl_cb (pl_arg, pl_req[pl_head].tag, ret);
+			pl_head = (pl_head + 1) % pl_window;
 		}
-		*xptr = 0;
-		len = xptr - buf;
-		*data = realloc (buf, len+1);
-		if (!*data) *data = buf;
-		if (dlen) *dlen = len;
-	} else {
-		free (buf);
+		return ret;
+	}
+	/* find the request - older kernels don't echo the sequence number,
+	 * in that case the answer belongs to the oldest request
+	 */
+	for (i=0; i<pl_num; i++) {
+		if (pl_req[(pl_head + i) % pl_window].seq == seq) break;
 	}
-	if (!hasret) {
-		if (hasdata && rval) *rval = 0;
+	if (i == pl_num) i = 0;
+	for (; i > 0; i--, pl_num--) {
+		/* requests answered out of order have lost their answer */
+		SLOGF (LOG_WARN, "no answer for request %u",
+					pl_req[pl_head].seq);
+		if (pl_cb) pl_cb (pl_arg, pl_req[pl_head].tag, RERR_NOT_FOUND);
+		pl_head = (pl_head + 1) % pl_window;
+	}
+	idx = pl_head;
+	pl_head = (pl_head + 1) % pl_window;
+	pl_num--;
+	if (rval != 0) {
+		if (rval < 0) rval *= -1;
+		errno = rval;
+		ret = RERR_SYSTEM;
 	}
+	if (pl_cb) pl_cb (pl_arg, pl_req[idx].tag, ret);
 	return RERR_OK;
 }
 
 
+
 int
 ldt_event_recv (evtype, iarg, sarg, tout)
 	int		*evtype;
@@ -322,8 +476,31 @@ ldt_event_recv (evtype, iarg, sarg, tout)
 	char		**sarg;
 	tmo_t		tout;
 {
-	ssize_t	len, slen=-1;
-	char		*buf=NULL, *ptr, *ptr2;
+	const char	*s;
+	int			ret;
+
+	if (sarg) *sarg = NULL;
+	ret = ldt_event_recv2 (evtype, iarg, sarg ? &s : NULL, tout);
+	if (!RERR_ISOK(ret)) return ret;
+	if (sarg && s) {
+		*sarg = strdup (s);
+		if (!*sarg) return RERR_NOMEM;
+	}
+	return RERR_OK;
+}
+
+/* like ldt_event_recv, but sarg points into the receive buffer and is
+ * valid until the next receive only
+ */
+int
+ldt_event_recv2 (evtype, iarg, sarg, tout)
+	int			*evtype;
+	uint32_t		*iarg;
+	const char	**sarg;
+	tmo_t			tout;
+{
+	ssize_t	len, slen;
+	char		*buf, *ptr;
 	int		ret;
 	tmo_t		start, now;
 
@@ -338,111 +515,63 @@ ldt_event_recv (evtype, iarg, sarg, tout)
 	TMO_START(start,tout);
 startover:
 	/* receive data */
-	do {
-		ret = len = fnl_recv (tpfd, &buf, TMO_GETTIMEOUT(start,tout,now), FNL_F_NOHDR);
-		if (!RERR_ISOK(ret)) {
-			SLOGFE (LOG_ERR, "error receiving data: %s", rerr_getstr3 (ret));
-			return ret;
-		}
-		if (len > 0) break;
-	} while (TMO_CHECK(start,tout));
-	if (!buf) return RERR_INTERNAL;
-
-	/* do some error checking */
-	ret = fnl_getmsgtype (buf);
+	ret = len = nl_recvmsg (&buf, TMO_GETTIMEOUT(start,tout,now), 1);
 	if (!RERR_ISOK(ret)) {
-		free (buf);
+		SLOGFE (LOG_ERR, "error receiving data: %s", rerr_getstr3 (ret));
 		return ret;
 	}
+
+	/* do some error checking */
+	ret = fnl_getmsgtype (buf);
+	if (!RERR_ISOK(ret)) return ret;
 	if (ret == NLMSG_ERROR) {
-		if (fnl_getcmd (buf) < NLMSG_LENGTH(sizeof(struct nlmsgerr))) {
+		if (len < (ssize_t)NLMSG_LENGTH(sizeof(struct nlmsgerr))) {
 			SLOGF (LOG_ERR, "truncated error message");
 		} else {
 			errno = -((struct nlmsgerr*)NLMSG_DATA(buf))->error;
 		}
-		free (buf);
 		return RERR_SYSTEM;
 	} else if (ret < NLMSG_MIN_TYPE) {
 		SLOGF (LOG_NOTICE, "received unhandled controll messag of type %d", ret);
-		free (buf);
 		goto startover;
 	}
 	ret = fnl_getcmd (buf);
-	if (!RERR_ISOK(ret)) {
-		free (buf);
-		return ret;
-	}
+	if (!RERR_ISOK(ret)) return ret;
 	if (ret !=  LDT_CMD_SEND_EVENT) {
 		SLOGF (LOG_NOTICE, "receive invalid event command %d", ret);
-		free (buf);
 		goto startover;
 	}
 
 	/* extract data */
-	ptr = fnl_getmsgdata (buf, 0);
-	while (ptr && ptr-buf < len) {
-		ret = fnl_getattrid (ptr);
-		if (!RERR_ISOK(ret)) {
-			free (buf);
-			return ret;
-		}
-		switch (ret) {
+	for (ptr = NULL; (ptr = fnl_attrnext (buf, 0, ptr)); ) {
+		switch (fnl_getattrid (ptr)) {
 		case LDT_CMD_SEND_EVENT_ATTR_EVTYPE:
 			if (!evtype) break;
-			ptr2 = fnl_getattrdata (ptr);
-			if (!ptr2) {
-				free (buf);
-				return RERR_INTERNAL;
-			}
-			*evtype = (int)*(uint32_t*)ptr2;
+			if (fnl_getattrlen (ptr) < 4) return RERR_INTERNAL;
+			*evtype = (int)*(uint32_t*)fnl_getattrdata (ptr);
 			break;
 		case LDT_CMD_SEND_EVENT_ATTR_IARG:
 			if (!iarg) break;
-			ptr2 = fnl_getattrdata (ptr);
-			if (!ptr2) {
-				free (buf);
-				return RERR_INTERNAL;
-			}
-			*iarg = (int)*(uint32_t*)ptr2;
+			if (fnl_getattrlen (ptr) < 4) return RERR_INTERNAL;
+			*iarg = *(uint32_t*)fnl_getattrdata (ptr);
 			break;
 		case LDT_CMD_SEND_EVENT_ATTR_SARG:
 			if (!sarg) break;
 			slen = fnl_getattrlen (ptr);
-			ptr2 = fnl_getattrdata (ptr);
-			if (!ptr2 || slen < 0) {
-				free (buf);
+			/* NLA_NUL_STRING - terminated by the kernel */
+			if (slen <= 0 || fnl_getattrdata (ptr)[slen-1] != 0) {
 				return RERR_INTERNAL;
 			}
-			*sarg = ptr2;
+			*sarg = fnl_getattrdata (ptr);
 			break;
 		}
-		ptr = fnl_getnextattr (ptr);
-	}
-	if (sarg && slen >= 0) {
-		if (slen > 0) memmove (buf, *sarg, slen);
-		buf[slen]=0;
-		*sarg = realloc (buf, slen+1);
-		if (!*sarg) *sarg = buf;
-	} else {
-		free (buf);
 	}
 
 	/* done */
 	return RERR_OK;
-	
 }
 
 
-
-
-
-
-
-
-
-
-
-
 /*
  * Overrides for XEmacs and vim so that we get a uniform tabbing style.
  * XEmacs/vim will notice this stuff at the end of the file and automatically
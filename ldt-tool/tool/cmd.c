@@ -58,6 +58,7 @@
 #include <stdint.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#include <getopt.h>
 
 #include <fr/base.h>
 #include <fr/xml.h>
@@ -74,6 +75,7 @@ static int printtun (struct xml_tag*, int);
 static int printudptun (struct xml_tag*, int);
 static int showinfo (char *, const char *, int);
 static int printinfo (struct xml*, const char *, int);
+static int prtev_ring (int, int, tmo_t, int);
 
 #define SHOWDEV_F_TIMESTAMPS	0x01
 
@@ -547,6 +549,8 @@ usage_newtun()
 				"           dccp6     - dccp tunnel over ipv6\n"
 				"           mpdccp    - mpdccp tunnel over ipv4\n"
 				"           mpdccp6   - mpdccp tunnel over ipv6\n"
+				"           bond      - bonding tunnel over udp/ipv4\n"
+				"           bond6     - bonding tunnel over udp/ipv6\n"
 				"\n", PROG);
 }
 
@@ -735,34 +739,1056 @@ cmd_setpeer (argc, argv)
 	return ldt_tun_setpeer (name, sraddr ? &raddr : NULL, tout);
 }
 
+void
+usage_setpeerlist()
+{
+	printf ("setpeerlist: usage: %s setpeerlist | peerlist <options> <name>\n"
+				"         - set peer candidates the tunnel reconnects to on its own\n"
+				"  options are:\n"
+				"      <name>         - name of ldt device\n"
+				"      -h             - this help screen\n"
+				"      -r [<local>/]<addr>\n"
+				"                     - peer candidate (can be given up to %d times)\n"
+				"                       the candidates are tried in the given order\n"
+				"                       syntax is the same as for setpeer\n"
+				"                       a local address to bind to can be given\n"
+				"                       in race mode only\n"
+				"                       without any -r automatic reconnect is\n"
+				"                       switched off\n"
+				"      -R             - race mode: connect to all candidates in\n"
+				"                       parallel, the first connection wins\n"
+				"                       candidates are ranked by failures and\n"
+				"                       connect latency\n"
+				"      -s <time>      - delay between starting two racers\n"
+				"                       (default 250ms)\n"
+				"      -b <time>      - initial reconnect backoff (default 500ms)\n"
+				"      -B <time>      - maximum reconnect backoff (default 60s)\n"
+				"      -4             - force address to be ipv4 (for name resolution)\n"
+				"      -6             - force address to be ipv6 (for name resolution)\n"
+				"\n", PROG, LDT_PEERLIST_MAX);
+}
+
+
+int
+cmd_setpeerlist (argc, argv)
+	int	argc;
+	char	**argv;
+{
+	const char	*name = NULL;
+	int			c, i, ret;
+	const char	*sraddr[LDT_PEERLIST_MAX];
+	int			num = 0;
+	frad_t		list[LDT_PEERLIST_MAX];
+	frad_t		local[LDT_PEERLIST_MAX];
+	frad_pair_t	pair;
+	int			flags = 0, haslocal = 0;
+	int			bmin = 0, bmax = 0, stagger = -1;
+	uint32_t		plflags = 0;
+
+	while ((c=getopt (argc, argv, "hr:64b:B:Rs:")) != -1) {
+		switch (c) {
+		case 'h':
+			usage_setpeerlist();
+			return RERR_OK;
+		case 'r':
+			if (num >= LDT_PEERLIST_MAX) {
+				SLOGF (LOG_ERR2, "too many peer candidates, maximum is %d",
+							LDT_PEERLIST_MAX);
+				return RERR_PARAM;
+			}
+			sraddr[num++] = optarg;
+			break;
+		case '6':
+			flags |= FRAD_F_IPV6;
+			break;
+		case '4':
+			flags |= FRAD_F_IPV4;
+			break;
+		case 'b':
+			bmin = (int)(cf_atotm (optarg) / 1000LL);
+			break;
+		case 'B':
+			bmax = (int)(cf_atotm (optarg) / 1000LL);
+			break;
+		case 'R':
+			plflags |= LDT_PEERLIST_F_RACE;
+			break;
+		case 's':
+			stagger = (int)(cf_atotm (optarg) / 1000LL);
+			break;
+		}
+	}
+	if (optind < argc) {
+		name = argv[optind];
+		optind++;
+	}
+	if (!name) {
+		SLOGF (LOG_ERR2, "missing device name");
+		return RERR_PARAM;
+	}
+	/* parse addresses */
+	for (i=0; i<num; i++) {
+		if (index (sraddr[i], '/')) {
+			ret = frad_getaddrpair (&pair, sraddr[i], flags);
+			if (RERR_ISOK(ret)) {
+				frad_cp (&local[i], &pair.local);
+				frad_cp (&list[i], &pair.remote);
+				haslocal = 1;
+			}
+		} else {
+			bzero (&local[i], sizeof (frad_t));
+			ret = frad_getaddr (&list[i], sraddr[i], flags);
+		}
+		if (!RERR_ISOK(ret)) {
+			SLOGFE (LOG_ERR2, "error parsing peer address >>%s<<: %s",
+										sraddr[i], rerr_getstr3(ret));
+			return ret;
+		}
+	}
+	if (haslocal && !(plflags & LDT_PEERLIST_F_RACE)) {
+		SLOGF (LOG_ERR2, "local addresses need race mode (-R)");
+		return RERR_PARAM;
+	}
+
+	return ldt_tun_setpeerlist2 (name, list, haslocal ? local : NULL, num,
+											bmin, bmax, plflags, stagger);
+}
+
 void
 usage_serverstart()
 {
-	printf ("serverstart: usage: %s serverstart <options> <name>\n"
-				"         - sets server to listen mode\n"
+	printf ("serverstart: usage: %s serverstart <options> <name>\n"
+				"         - sets server to listen mode\n"
+				"  options are:\n"
+				"      <name>         - name of ldt device\n"
+				"      -h             - this help screen\n"
+				"      -T <timeout>   - timeout (important for (mp-)dccp only\n"
+				"      -m             - multi client mode: keep all accepted\n"
+				"                       connections, packets are routed by\n"
+				"                       inner destination (see clientroute)\n"
+				"\n", PROG);
+}
+
+int
+cmd_serverstart (argc, argv)
+	int	argc;
+	char	**argv;
+{
+	const char	*name = NULL;
+	int			c;
+	tmo_t			tout = 0;
+	uint32_t		flags = 0;
+
+	while ((c=getopt (argc, argv, "hT:m")) != -1) {
+		switch (c) {
+		case 'h':
+			usage_serverstart();
+			return RERR_OK;
+		case 'T':
+			tout = cf_atotm (optarg);
+			break;
+		case 'm':
+			flags |= LDT_SERVERSTART_F_MULTICLIENT;
+			break;
+		}
+	}
+	if (optind < argc) {
+		name = argv[optind];
+		optind++;
+	}
+	if (!name) {
+		SLOGF (LOG_ERR2, "missing device name");
+		return RERR_PARAM;
+	}
+
+	return ldt_tun_serverstart2 (name, flags, tout);
+}
+
+void
+usage_clientroute()
+{
+	printf ("clientroute: usage: %s clientroute <options> <name>\n"
+				"         - assigns an inner prefix to a client of a multi\n"
+				"           client server\n"
+				"  options are:\n"
+				"      <name>         - name of ldt device\n"
+				"      -h             - this help screen\n"
+				"      -r <addr>      - outer address of client, port is optional\n"
+				"                       (without port any port matches)\n"
+				"      -i <prefix>    - inner address or prefix (addr/len)\n"
+				"      -d             - delete route\n"
+				"      -4             - force address to be ipv4 (for name resolution)\n"
+				"      -6             - force address to be ipv6 (for name resolution)\n"
+				"  clients without route get the inner source address of their\n"
+				"  first packet assigned\n"
+				"\n", PROG);
+}
+
+int
+cmd_clientroute (argc, argv)
+	int	argc;
+	char	**argv;
+{
+	const char	*name = NULL;
+	const char	*sraddr = NULL;
+	char			*sinner = NULL, *s;
+	frad_t		raddr, inner;
+	int			c, ret, plen = -1;
+	int			flags = 0, rflags = 0;
+
+	while ((c=getopt (argc, argv, "hr:i:d64")) != -1) {
+		switch (c) {
+		case 'h':
+			usage_clientroute();
+			return RERR_OK;
+		case 'r':
+			sraddr = optarg;
+			break;
+		case 'i':
+			sinner = optarg;
+			break;
+		case 'd':
+			rflags |= LDT_CLIENTROUTE_F_DEL;
+			break;
+		case '6':
+			flags |= FRAD_F_IPV6;
+			break;
+		case '4':
+			flags |= FRAD_F_IPV4;
+			break;
+		}
+	}
+	if (optind < argc) {
+		name = argv[optind];
+		optind++;
+	}
+	if (!name) {
+		SLOGF (LOG_ERR2, "missing device name");
+		return RERR_PARAM;
+	}
+	if (!sraddr) {
+		SLOGF (LOG_ERR2, "missing client address");
+		return RERR_PARAM;
+	}
+	if (!sinner && !(rflags & LDT_CLIENTROUTE_F_DEL)) {
+		SLOGF (LOG_ERR2, "missing inner prefix");
+		return RERR_PARAM;
+	}
+	ret = frad_getaddr (&raddr, sraddr, flags);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR2, "error parsing client address >>%s<<: %s",
+									sraddr, rerr_getstr3(ret));
+		return ret;
+	}
+	if (sinner) {
+		s = index (sinner, '/');
+		if (s) {
+			*s = 0;
+			plen = atoi (s+1);
+		}
+		ret = frad_getaddr (&inner, sinner, FRAD_F_NODNS);
+		if (!RERR_ISOK(ret)) {
+			SLOGFE (LOG_ERR2, "error parsing inner prefix >>%s<<: %s",
+										sinner, rerr_getstr3(ret));
+			return ret;
+		}
+	}
+	return ldt_tun_clientroute (name, &raddr, sinner ? &inner : NULL, plen,
+										rflags);
+}
+
+void
+usage_setqueue()
+{
+	printf ("setqueue: usage: %s setqueue <options> <name>\n"
+				"         - sets tx queue length and queueing policy\n"
+				"  options are:\n"
+				"      <name>         - name of ldt device\n"
+				"      -h             - this help screen\n"
+				"      -T <len>       - tx queue length\n"
+				"      -Q <policy>    - queueing policy, possible values:\n"
+				"                       drop_oldest, drop_newest, bands\n"
+				"  options for policy bands (band 0 is served first):\n"
+				"      -B <num>       - number of bands (%d-%d, default 3)\n"
+				"      -C <class>     - classify by dscp (default) or prio\n"
+				"                       (skb priority)\n"
+				"      -S <sched>     - strict (default) or wrr (weighted round\n"
+				"                       robin)\n"
+				"      -M <map>       - dscp / prio to band, e.g. 46=0,32-47=1\n"
+				"                       the rest is mapped by class selector\n"
+				"      -L <limits>    - packets per band, e.g. 50,200,1000\n"
+				"                       (0 = tx queue length)\n"
+				"      -W <weights>   - wrr: packets per round and band\n"
+				"      -D <band>      - band for non ip packets (default last)\n"
+				"  the per band counters are shown in the qbands tag of showinfo\n"
+				"\n", PROG, LDT_QBANDS_MIN, LDT_QBANDS_MAX);
+}
+
+static
+int
+parse_u16list (list, val, num)
+	const char	*list;
+	uint16_t		*val;
+	int			num;
+{
+	const char	*s = list;
+	char			*end;
+	long			v;
+	int			i;
+
+	for (i=0; s && *s; i++) {
+		v = strtol (s, &end, 10);
+		if (end == s || v < 0 || v > 65535 || i >= num) return RERR_PARAM;
+		val[i] = v;
+		s = end;
+		if (*s == ',') {
+			s++;
+		} else if (*s) {
+			return RERR_PARAM;
+		}
+	}
+	return RERR_OK;
+}
+
+/* <from>[-<to>]=<band>[,...] */
+static
+int
+parse_bandmap (list, map)
+	const char	*list;
+	uint8_t		*map;
+{
+	const char	*s = list;
+	char			*end;
+	long			from, to, band, i;
+
+	while (s && *s) {
+		from = strtol (s, &end, 10);
+		if (end == s || from < 0 || from > 63) return RERR_PARAM;
+		to = from;
+		s = end;
+		if (*s == '-') {
+			s++;
+			to = strtol (s, &end, 10);
+			if (end == s || to < from || to > 63) return RERR_PARAM;
+			s = end;
+		}
+		if (*s != '=') return RERR_PARAM;
+		s++;
+		band = strtol (s, &end, 10);
+		if (end == s || band < 0 || band >= LDT_QBANDS_MAX) return RERR_PARAM;
+		s = end;
+		for (i=from; i<=to; i++) map[i] = band;
+		if (*s == ',') {
+			s++;
+		} else if (*s) {
+			return RERR_PARAM;
+		}
+	}
+	return RERR_OK;
+}
+
+int
+cmd_setqueue (argc, argv)
+	int	argc;
+	char	**argv;
+{
+	const char			*name = NULL;
+	const char			*map = NULL, *limits = NULL, *weights = NULL;
+	struct ldt_qbands	bands;
+	int					c, ret;
+	int					txqlen=-1, qpolicy=-1;
+	int					nbands=3, classify=LDT_QBANDS_CLS_DSCP, sched=-1, dflt=-1;
+	int					hasbands=0;
+
+	while ((c=getopt (argc, argv, "ht:T:Q:B:C:S:M:L:W:D:")) != -1) {
+		switch (c) {
+		case 'h':
+			usage_setqueue();
+			return RERR_OK;
+		case 'T':
+			txqlen = atoi (optarg);
+			if (txqlen < 0 || txqlen > 65535) {
+				SLOGF (LOG_ERR2, "queue length (%d) out of range [0, 65535]", txqlen);
+				return RERR_PARAM;
+			}
+			break;
+		case 'Q':
+			sswitch (optarg) {
+			sicase ("drop_oldest")
+			sicase ("dropoldest")
+			sicase ("drop-oldest")
+			sicase ("oldest")
+				qpolicy = LDT_CMD_SETQUEUE_QPOLICY_DROP_OLDEST;
+				break;
+			sicase ("drop_newest")
+			sicase ("dropnewest")
+			sicase ("drop-newest")
+			sicase ("newest")
+				qpolicy = LDT_CMD_SETQUEUE_QPOLICY_DROP_NEWEST;
+				break;
+			sicase ("bands")
+			sicase ("prio")
+				qpolicy = LDT_CMD_SETQUEUE_QPOLICY_BANDS;
+				hasbands = 1;
+				break;
+			sdefault
+				SLOGF (LOG_ERR2, "invalid queueing policy %s", optarg);
+				return -EINVAL;
+			} esac;
+			break;
+		case 'B':
+			nbands = atoi (optarg);
+			if (nbands < LDT_QBANDS_MIN || nbands > LDT_QBANDS_MAX) {
+				SLOGF (LOG_ERR2, "number of bands (%d) out of range [%d, %d]",
+							nbands, LDT_QBANDS_MIN, LDT_QBANDS_MAX);
+				return RERR_PARAM;
+			}
+			hasbands = 1;
+			break;
+		case 'C':
+			sswitch (optarg) {
+			sicase ("dscp")
+			sicase ("tos")
+				classify = LDT_QBANDS_CLS_DSCP;
+				break;
+			sicase ("prio")
+			sicase ("priority")
+				classify = LDT_QBANDS_CLS_PRIO;
+				break;
+			sdefault
+				SLOGF (LOG_ERR2, "invalid classification %s", optarg);
+				return RERR_PARAM;
+			} esac;
+			hasbands = 1;
+			break;
+		case 'S':
+			sswitch (optarg) {
+			sicase ("strict")
+				sched = LDT_QBANDS_SCHED_STRICT;
+				break;
+			sicase ("wrr")
+				sched = LDT_QBANDS_SCHED_WRR;
+				break;
+			sdefault
+				SLOGF (LOG_ERR2, "invalid band scheduling %s", optarg);
+				return RERR_PARAM;
+			} esac;
+			hasbands = 1;
+			break;
+		case 'M':
+			map = optarg;
+			hasbands = 1;
+			break;
+		case 'L':
+			limits = optarg;
+			hasbands = 1;
+			break;
+		case 'W':
+			weights = optarg;
+			hasbands = 1;
+			break;
+		case 'D':
+			dflt = atoi (optarg);
+			hasbands = 1;
+			break;
+		}
+	}
+	if (optind < argc) {
+		name = argv[optind];
+		optind++;
+	}
+	if (!name) {
+		SLOGF (LOG_ERR2, "missing device name");
+		return RERR_PARAM;
+	}
+	if (!hasbands) return ldt_tun_setqueue (name, txqlen, qpolicy);
+
+	ret = ldt_qbands_init (&bands, nbands, classify);
+	if (!RERR_ISOK(ret)) return ret;
+	if (sched >= 0) bands.sched = sched;
+	if (dflt >= 0) {
+		if (dflt >= nbands) {
+			SLOGF (LOG_ERR2, "default band %d out of range", dflt);
+			return RERR_PARAM;
+		}
+		bands.dflt = dflt;
+	}
+	if (map && !RERR_ISOK(parse_bandmap (map, bands.map))) {
+		SLOGF (LOG_ERR2, "invalid band map >>%s<<", map);
+		return RERR_PARAM;
+	}
+	for (c=0; c<64; c++) {
+		if (bands.map[c] >= nbands) {
+			SLOGF (LOG_ERR2, "band map: band %d out of range", bands.map[c]);
+			return RERR_PARAM;
+		}
+	}
+	if (limits && !RERR_ISOK(parse_u16list (limits, bands.limit, nbands))) {
+		SLOGF (LOG_ERR2, "invalid band limits >>%s<<", limits);
+		return RERR_PARAM;
+	}
+	if (weights && !RERR_ISOK(parse_u16list (weights, bands.weight, nbands))) {
+		SLOGF (LOG_ERR2, "invalid band weights >>%s<<", weights);
+		return RERR_PARAM;
+	}
+	return ldt_tun_setqueue2 (name, txqlen, qpolicy, &bands);
+}
+
+void
+usage_setsockopt()
+{
+	printf ("setsockopt: usage: %s setsockopt <options> <name>\n"
+				"         - sets socket options of a (mp-)dccp tunnel\n"
+				"           ccid, service code and checksum coverage are\n"
+				"           negotiated on connect, they take effect with the next\n"
+				"           (re)connect; buffer sizes are applied immediately\n"
+				"  options are:\n"
+				"      <name>         - name of ldt device\n"
+				"      -h             - this help screen\n"
+				"      -c <ccid>      - congestion control for both directions\n"
+				"                       (2 = tcp-like, 3 = tfrc, 0 = default)\n"
+				"      -t <ccid>      - tx congestion control\n"
+				"      -r <ccid>      - rx congestion control\n"
+				"      -s <bytes>     - send buffer size (0 = default)\n"
+				"      -R <bytes>     - receive buffer size (0 = default)\n"
+				"      -f             - force buffer sizes beyond\n"
+				"                       net.core.wmem_max / rmem_max\n"
+				"      -S <code>      - dccp service code, a number or up to 4\n"
+				"                       characters (e.g. RTPA), must match on\n"
+				"                       client and server\n"
+				"      -C <cscov>     - send checksum coverage (0..15, 0 = full)\n"
+				"\n", PROG);
+}
+
+static
+int64_t
+parse_service (s)
+	const char	*s;
+{
+	char		*end;
+	uint32_t	code = 0;
+	int		i;
+
+	if (!s || !*s) return -1;
+	code = strtoul (s, &end, 0);
+	if (!*end) return code;
+	if (strlen (s) > 4) return -1;
+	for (code=0, i=0; i<4; i++) {
+		code = (code << 8) | (uint8_t)(*s ? *s++ : 0);
+	}
+	return code;
+}
+
+int
+cmd_setsockopt (argc, argv)
+	int	argc;
+	char	**argv;
+{
+	const char				*name = NULL;
+	struct ldt_sockopt	opt = LDT_SOCKOPT_INIT;
+	int						c;
+
+	while ((c=getopt (argc, argv, "hc:t:r:s:R:fS:C:")) != -1) {
+		switch (c) {
+		case 'h':
+			usage_setsockopt();
+			return RERR_OK;
+		case 'c':
+			opt.txccid = opt.rxccid = atoi (optarg);
+			break;
+		case 't':
+			opt.txccid = atoi (optarg);
+			break;
+		case 'r':
+			opt.rxccid = atoi (optarg);
+			break;
+		case 's':
+			opt.sndbuf = atoi (optarg);
+			break;
+		case 'R':
+			opt.rcvbuf = atoi (optarg);
+			break;
+		case 'f':
+			opt.flags |= LDT_SOCKOPT_F_FORCEBUF;
+			break;
+		case 'S':
+			opt.service = parse_service (optarg);
+			if (opt.service < 0) {
+				SLOGF (LOG_ERR2, "invalid service code >>%s<<", optarg);
+				return RERR_PARAM;
+			}
+			break;
+		case 'C':
+			opt.cscov = atoi (optarg);
+			if (opt.cscov < 0 || opt.cscov > LDT_SOCKOPT_CSCOV_MAX) {
+				SLOGF (LOG_ERR2, "checksum coverage (%d) out of range [0, %d]",
+							opt.cscov, LDT_SOCKOPT_CSCOV_MAX);
+				return RERR_PARAM;
+			}
+			break;
+		}
+	}
+	if (opt.txccid > 255 || opt.rxccid > 255) {
+		SLOGF (LOG_ERR2, "ccid out of range");
+		return RERR_PARAM;
+	}
+	if (optind < argc) {
+		name = argv[optind];
+		optind++;
+	}
+	if (!name) {
+		SLOGF (LOG_ERR2, "missing device name");
+		return RERR_PARAM;
+	}
+	return ldt_tun_setsockopt (name, &opt);
+}
+
+void
+usage_setrxsteer()
+{
+	printf ("setrxsteer: usage: %s setrxsteer <options> <name>\n"
+				"         - selects the cpu(s) decapsulated packets are handed\n"
+				"           to the network stack on\n"
+				"  options are:\n"
+				"      <name>         - name of ldt device\n"
+				"      -h             - this help screen\n"
+				"      -m <mode>      - steering mode:\n"
+				"           off       - deliver on the receiving cpu (default)\n"
+				"           cpu       - deliver all packets of the tunnel on one\n"
+				"                       cpu of the set\n"
+				"           hash      - spread inner flows across the set\n"
+				"      -c <cpulist>   - cpu set, e.g. 0-3,8,10-11\n"
+				"  the per cpu delivery counters are shown in the rxsteer tag\n"
+				"  of showinfo\n"
+				"\n", PROG);
+}
+
+#define RXSTEER_WORDS	(LDT_RXSTEER_MAXCPUS / 32)
+
+static
+int
+parse_cpulist (list, cpus)
+	const char	*list;
+	uint32_t		*cpus;
+{
+	const char	*s = list;
+	char			*end;
+	long			from, to, i;
+
+	while (s && *s) {
+		from = strtol (s, &end, 10);
+		if (end == s || from < 0) return RERR_PARAM;
+		to = from;
+		s = end;
+		if (*s == '-') {
+			s++;
+			to = strtol (s, &end, 10);
+			if (end == s || to < from) return RERR_PARAM;
+			s = end;
+		}
+		if (to >= RXSTEER_WORDS * 32) return RERR_PARAM;
+		for (i=from; i<=to; i++) cpus[i/32] |= 1U << (i%32);
+		if (*s == ',') {
+			s++;
+		} else if (*s) {
+			return RERR_PARAM;
+		}
+	}
+	return RERR_OK;
+}
+
+int
+cmd_setrxsteer (argc, argv)
+	int	argc;
+	char	**argv;
+{
+	const char	*name = NULL;
+	const char	*cpulist = NULL;
+	uint32_t		cpus[RXSTEER_WORDS];
+	int			c, ret, nwords;
+	int			mode = -1;
+
+	while ((c=getopt (argc, argv, "hm:c:")) != -1) {
+		switch (c) {
+		case 'h':
+			usage_setrxsteer();
+			return RERR_OK;
+		case 'm':
+			sswitch (optarg) {
+			sicase ("off")
+			sicase ("none")
+				mode = LDT_RXSTEER_OFF;
+				break;
+			sicase ("cpu")
+			sicase ("pin")
+				mode = LDT_RXSTEER_CPU;
+				break;
+			sicase ("hash")
+				mode = LDT_RXSTEER_HASH;
+				break;
+			sdefault
+				SLOGF (LOG_ERR2, "invalid steering mode %s", optarg);
+				return RERR_PARAM;
+			} esac;
+			break;
+		case 'c':
+			cpulist = optarg;
+			break;
+		}
+	}
+	if (optind < argc) {
+		name = argv[optind];
+		optind++;
+	}
+	if (!name) {
+		SLOGF (LOG_ERR2, "missing device name");
+		return RERR_PARAM;
+	}
+	if (mode < 0) mode = cpulist ? LDT_RXSTEER_CPU : LDT_RXSTEER_OFF;
+	bzero (cpus, sizeof (cpus));
+	if (mode != LDT_RXSTEER_OFF) {
+		if (!cpulist) {
+			SLOGF (LOG_ERR2, "missing cpu list");
+			return RERR_PARAM;
+		}
+		ret = parse_cpulist (cpulist, cpus);
+		if (!RERR_ISOK(ret)) {
+			SLOGF (LOG_ERR2, "invalid cpu list >>%s<<", cpulist);
+			return ret;
+		}
+	}
+	for (nwords = RXSTEER_WORDS; nwords > 0 && !cpus[nwords-1]; nwords--);
+	return ldt_tun_setrxsteer (name, mode, cpus, nwords);
+}
+
+void
+usage_setrebind()
+{
+	printf ("setrebind: usage: %s setrebind <options> <name>\n"
+				"         - selects how a connected tunnel is moved to a new\n"
+				"           local address (bind, bind2dev, address change)\n"
+				"  options are:\n"
+				"      <name>         - name of ldt device\n"
+				"      -h             - this help screen\n"
+				"      -m <mode>      - rebind mode:\n"
+				"           break     - close the old connection first (default)\n"
+				"           mbb       - make before break: connect the new socket\n"
+				"                       first, switch over and close the old one\n"
+				"                       after the drain time\n"
+				"      -d <msec>      - drain time of the old socket (default %d,\n"
+				"                       max %d)\n"
+				"  the switchover time is reported in the conn_estab event\n"
+				"\n", PROG, LDT_REBIND_DRAIN_DEF, LDT_REBIND_DRAIN_MAX);
+}
+
+int
+cmd_setrebind (argc, argv)
+	int	argc;
+	char	**argv;
+{
+	const char	*name = NULL;
+	int			c;
+	int			mode = -1, drain = -1;
+
+	while ((c=getopt (argc, argv, "hm:d:")) != -1) {
+		switch (c) {
+		case 'h':
+			usage_setrebind();
+			return RERR_OK;
+		case 'm':
+			sswitch (optarg) {
+			sicase ("break")
+			sicase ("bbm")
+				mode = LDT_REBIND_BREAK;
+				break;
+			sicase ("mbb")
+			sicase ("make-before-break")
+				mode = LDT_REBIND_MBB;
+				break;
+			sdefault
+				SLOGF (LOG_ERR2, "invalid rebind mode %s", optarg);
+				return RERR_PARAM;
+			} esac;
+			break;
+		case 'd':
+			drain = atoi (optarg);
+			if (drain < 0 || drain > LDT_REBIND_DRAIN_MAX) {
+				SLOGF (LOG_ERR2, "invalid drain time %s", optarg);
+				return RERR_PARAM;
+			}
+			break;
+		}
+	}
+	if (optind < argc) {
+		name = argv[optind];
+		optind++;
+	}
+	if (!name) {
+		SLOGF (LOG_ERR2, "missing device name");
+		return RERR_PARAM;
+	}
+	if (mode < 0 && drain < 0) {
+		SLOGF (LOG_ERR2, "nothing to set");
+		return RERR_PARAM;
+	}
+	return ldt_tun_setrebind (name, mode, drain);
+}
+
+void
+usage_setaead()
+{
+	printf ("setaead: usage: %s setaead <options> <name>\n"
+				"         - encrypts and authenticates the tunnel payload\n"
+				"  options are:\n"
+				"      <name>         - name of ldt device\n"
+				"      -h             - this help screen\n"
+				"      -a <alg>       - algorithm:\n"
+				"           aes-gcm   - key of 16, 24 or 32 bytes (default)\n"
+				"           chacha20-poly1305 - key of 32 bytes\n"
+				"      -k <hex>       - key followed by 4 bytes salt in hex\n"
+				"      -i <keyid>     - key id (0..%d, default 0)\n"
+				"      -t             - use key for sending\n"
+				"      -r             - accept key for receiving\n"
+				"                       (without -t and -r the key is used for both)\n"
+				"      -R             - drop packets not encrypted\n"
+				"      -O             - accept packets not encrypted (default)\n"
+				"      -F             - remove all keys\n"
+				"  to rotate keys install the new key with a new key id with -r\n"
+				"  on both sides first, then with -t. The previous receive key\n"
+				"  is kept.\n"
+				"\n", PROG, LDT_AEAD_KEYID_MAX);
+}
+
+int
+cmd_setaead (argc, argv)
+	int	argc;
+	char	**argv;
+{
+	const char	*name = NULL;
+	int			c, ret;
+	int			alg = LDT_AEAD_AES_GCM, keylen = 0, keyid = 0;
+	uint32_t		flags = 0;
+	size_t		olen;
+	char			key[LDT_AEAD_MAXKEYLEN+3];
+
+	while ((c=getopt (argc, argv, "ha:k:i:trROF")) != -1) {
+		switch (c) {
+		case 'h':
+			usage_setaead();
+			return RERR_OK;
+		case 'a':
+			sswitch (optarg) {
+			sicase ("aes-gcm")
+			sicase ("gcm")
+				alg = LDT_AEAD_AES_GCM;
+				break;
+			sicase ("chacha20-poly1305")
+			sicase ("chacha20")
+			sicase ("chacha")
+				alg = LDT_AEAD_CHACHA20_POLY1305;
+				break;
+			sdefault
+				SLOGF (LOG_ERR2, "invalid algorithm %s", optarg);
+				return RERR_PARAM;
+			} esac;
+			break;
+		case 'k':
+			if (!strncasecmp (optarg, "0x", 2)) optarg+=2;
+			olen = LDT_AEAD_MAXKEYLEN + 2;
+			ret = tenc_hexdecode (key, &olen, optarg, TENC_F_OLEN);
+			if (!RERR_ISOK(ret) || olen <= LDT_AEAD_SALTLEN
+					|| olen > LDT_AEAD_MAXKEYLEN) {
+				SLOGF (LOG_ERR2, "invalid key");
+				return RERR_PARAM;
+			}
+			keylen = olen;
+			break;
+		case 'i':
+			keyid = atoi (optarg);
+			if (keyid < 0 || keyid > LDT_AEAD_KEYID_MAX) {
+				SLOGF (LOG_ERR2, "invalid key id %s", optarg);
+				return RERR_PARAM;
+			}
+			break;
+		case 't':
+			flags |= LDT_AEAD_F_TX;
+			break;
+		case 'r':
+			flags |= LDT_AEAD_F_RX;
+			break;
+		case 'R':
+			flags |= LDT_AEAD_F_REQUIRE;
+			break;
+		case 'O':
+			flags |= LDT_AEAD_F_OPTIONAL;
+			break;
+		case 'F':
+			flags |= LDT_AEAD_F_FLUSH;
+			break;
+		}
+	}
+	if (optind < argc) {
+		name = argv[optind];
+		optind++;
+	}
+	if (!name) {
+		SLOGF (LOG_ERR2, "missing device name");
+		return RERR_PARAM;
+	}
+	if (keylen > 0 && !(flags & (LDT_AEAD_F_TX | LDT_AEAD_F_RX)))
+		flags |= LDT_AEAD_F_TX | LDT_AEAD_F_RX;
+	if ((flags & (LDT_AEAD_F_TX | LDT_AEAD_F_RX)) && keylen <= 0) {
+		SLOGF (LOG_ERR2, "missing key");
+		return RERR_PARAM;
+	}
+	if (!flags) {
+		SLOGF (LOG_ERR2, "nothing to set");
+		return RERR_PARAM;
+	}
+	ret = ldt_tun_setaead (name, alg, (uint8_t*)key, keylen, keyid, flags);
+	bzero (key, sizeof (key));
+	return ret;
+}
+
+void
+usage_setpace()
+{
+	printf ("setpace: usage: %s setpace <options> <name>\n"
+				"         - paces the packets leaving the tunnel\n"
+				"  options are:\n"
+				"      <name>         - name of ldt device\n"
+				"      -h             - this help screen\n"
+				"      -r <rate>      - rate in bit/s, suffix k, M or G allowed\n"
+				"                       (0 = off)\n"
+				"      -b <bytes>     - burst size (default %d, max %d)\n"
+				"      -l             - learn the rate from the dccp ccid (ccid 3),\n"
+				"                       the rate given with -r is the upper limit\n"
+				"      -L             - do not learn the rate\n"
+				"  the time spent throttled is shown with showinfo\n"
+				"\n", PROG, LDT_PACE_BURST_DEF, LDT_PACE_BURST_MAX);
+}
+
+int
+cmd_setpace (argc, argv)
+	int	argc;
+	char	**argv;
+{
+	const char	*name = NULL;
+	int			c;
+	int			burst = -1, flags = -1;
+	int64_t		rate = -1;
+	double		val;
+	char			*end;
+
+	while ((c=getopt (argc, argv, "hr:b:lL")) != -1) {
+		switch (c) {
+		case 'h':
+			usage_setpace();
+			return RERR_OK;
+		case 'r':
+			val = strtod (optarg, &end);
+			switch (*end) {
+			case 'k': case 'K': val *= 1e3; end++; break;
+			case 'm': case 'M': val *= 1e6; end++; break;
+			case 'g': case 'G': val *= 1e9; end++; break;
+			}
+			if (*end || val < 0 || val / 8 > (double)LDT_PACE_RATE_MAX) {
+				SLOGF (LOG_ERR2, "invalid rate %s", optarg);
+				return RERR_PARAM;
+			}
+			rate = (int64_t)(val / 8);
+			break;
+		case 'b':
+			burst = atoi (optarg);
+			if (burst <= 0 || burst > LDT_PACE_BURST_MAX) {
+				SLOGF (LOG_ERR2, "invalid burst size %s", optarg);
+				return RERR_PARAM;
+			}
+			break;
+		case 'l':
+			flags = LDT_PACE_F_LEARN;
+			break;
+		case 'L':
+			flags = 0;
+			break;
+		}
+	}
+	if (optind < argc) {
+		name = argv[optind];
+		optind++;
+	}
+	if (!name) {
+		SLOGF (LOG_ERR2, "missing device name");
+		return RERR_PARAM;
+	}
+	if (rate < 0 && burst < 0 && flags < 0) {
+		SLOGF (LOG_ERR2, "nothing to set");
+		return RERR_PARAM;
+	}
+	return ldt_tun_setpace (name, rate, burst, flags);
+}
+
+void
+usage_setfec()
+{
+	printf ("setfec: usage: %s setfec <options> <name>\n"
+				"         - adds xor parity packets to the tunnel traffic,\n"
+				"           one lost packet per group can be recovered\n"
 				"  options are:\n"
 				"      <name>         - name of ldt device\n"
 				"      -h             - this help screen\n"
-				"      -T <timeout>   - timeout (important for (mp-)dccp only\n"
-				"\n", PROG);
+				"      -m <mode>      - xor or off (default xor)\n"
+				"      -k <num>       - data packets per parity packet\n"
+				"                       (default %d, max %d, 0 = receive only)\n"
+				"      -d <msec>      - max. time a group is kept open\n"
+				"                       (default %d, max %d)\n"
+				"  both sides of the tunnel must enable fec, the recovered\n"
+				"  packets are shown with showinfo\n"
+				"\n", PROG, LDT_FEC_K_DEF, LDT_FEC_K_MAX, LDT_FEC_DELAY_DEF,
+				LDT_FEC_DELAY_MAX);
 }
 
 int
-cmd_serverstart (argc, argv)
+cmd_setfec (argc, argv)
 	int	argc;
 	char	**argv;
 {
 	const char	*name = NULL;
 	int			c;
-	tmo_t			tout = 0;
+	int			mode = LDT_FEC_XOR, k = -1, delay = -1;
 
-	while ((c=getopt (argc, argv, "hT:")) != -1) {
+	while ((c=getopt (argc, argv, "hm:k:d:")) != -1) {
 		switch (c) {
 		case 'h':
-			usage_serverstart();
+			usage_setfec();
 			return RERR_OK;
-		case 'T':
-			tout = cf_atotm (optarg);
+		case 'm':
+			sswitch (optarg) {
+			sicase ("xor")
+				mode = LDT_FEC_XOR;
+				break;
+			sicase ("off")
+			sicase ("none")
+				mode = LDT_FEC_OFF;
+				break;
+			sdefault
+				SLOGF (LOG_ERR2, "invalid fec mode %s", optarg);
+				return RERR_PARAM;
+			} esac;
+			break;
+		case 'k':
+			k = atoi (optarg);
+			if (k < 0 || k > LDT_FEC_K_MAX) {
+				SLOGF (LOG_ERR2, "invalid group size %s", optarg);
+				return RERR_PARAM;
+			}
+			break;
+		case 'd':
+			delay = atoi (optarg);
+			if (delay <= 0 || delay > LDT_FEC_DELAY_MAX) {
+				SLOGF (LOG_ERR2, "invalid delay %s", optarg);
+				return RERR_PARAM;
+			}
 			break;
 		}
 	}
@@ -774,63 +1800,256 @@ cmd_serverstart (argc, argv)
 		SLOGF (LOG_ERR2, "missing device name");
 		return RERR_PARAM;
 	}
-
-	return ldt_tun_serverstart (name, tout);
+	return ldt_tun_setfec (name, mode, k, delay);
 }
 
 void
-usage_setqueue()
+usage_setpaths()
 {
-	printf ("setqueue: usage: %s setqueue <options> <name>\n"
-				"         - sets server to listen mode\n"
+	printf ("setpaths: usage: %s setpaths | paths <options> <name>\n"
+				"         - sets the uplinks of a bonding tunnel (bond, bond4, bond6)\n"
 				"  options are:\n"
 				"      <name>         - name of ldt device\n"
 				"      -h             - this help screen\n"
-				"      -T <len>       - tx queue length\n"
-				"      -Q <policy>    - queueing policy, possible values:\n"
-				"                       drop_oldest, drop_newest\n"
-				"\n", PROG);
+				"      -p [<local>][%%<dev>][@<rate>]\n"
+				"                     - path (can be given up to %d times)\n"
+				"                       <local> is the local address (and port)\n"
+				"                       to send from, <dev> the interface to bind\n"
+				"                       to, <rate> the initial rate in bit/s\n"
+				"                       (suffix k, M or G allowed) - it is\n"
+				"                       adjusted to the measured rate later on\n"
+				"      -c             - clear the path list - the tunnel's own\n"
+				"                       address is used as the only path\n"
+				"      -r <msec>      - max. time a packet waits for its\n"
+				"                       predecessors (default %d, max %d)\n"
+				"      -4             - force address to be ipv4 (for name resolution)\n"
+				"      -6             - force address to be ipv6 (for name resolution)\n"
+				"  the paths are set on the client only, the server learns\n"
+				"  them from the client's packets\n"
+				"\n", PROG, LDT_BOND_MAXPATH, LDT_BOND_REORDER_DEF,
+				LDT_BOND_REORDER_MAX);
 }
 
+static
 int
-cmd_setqueue (argc, argv)
+parse_path (path, str, flags)
+	struct ldt_path	*path;
+	const char			*str;
+	int					flags;
+{
+	char		buf[256];
+	char		*dev, *rate, *end;
+	double	val;
+	int		ret;
+
+	if (strlen (str) >= sizeof (buf)) return RERR_PARAM;
+	strcpy (buf, str);
+	bzero (path, sizeof (*path));
+	rate = rindex (buf, '@');
+	if (rate) {
+		*rate++ = 0;
+		val = strtod (rate, &end);
+		switch (*end) {
+		case 'k': case 'K': val *= 1e3; end++; break;
+		case 'm': case 'M': val *= 1e6; end++; break;
+		case 'g': case 'G': val *= 1e9; end++; break;
+		}
+		if (*end || val < 0 || val / 8 > (double)LDT_BOND_RATE_MAX) {
+			SLOGF (LOG_ERR2, "invalid rate %s", rate);
+			return RERR_PARAM;
+		}
+		path->rate = (uint32_t)(val / 8);
+	}
+	dev = index (buf, '%');
+	if (dev) {
+		*dev++ = 0;
+		if (strlen (dev) >= sizeof (path->dev)) {
+			SLOGF (LOG_ERR2, "invalid interface name %s", dev);
+			return RERR_PARAM;
+		}
+		strcpy (path->dev, dev);
+	}
+	if (!*buf) return RERR_OK;
+	ret = frad_getaddr (&path->local, buf, flags);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR2, "error parsing local address >>%s<<: %s",
+					buf, rerr_getstr3(ret));
+		return ret;
+	}
+	return RERR_OK;
+}
+
+int
+cmd_setpaths (argc, argv)
 	int	argc;
 	char	**argv;
 {
-	const char	*name = NULL;
-	int			c;
-	int			txqlen=-1, qpolicy=-1;
+	const char		*name = NULL;
+	int				c, i, ret;
+	const char		*spath[LDT_BOND_MAXPATH];
+	struct ldt_path	list[LDT_BOND_MAXPATH];
+	int				num = -1, reorder = -1, flags = 0;
 
-	while ((c=getopt (argc, argv, "ht:T:Q:")) != -1) {
+	while ((c=getopt (argc, argv, "hp:cr:64")) != -1) {
 		switch (c) {
 		case 'h':
-			usage_setqueue();
+			usage_setpaths();
 			return RERR_OK;
-		case 'T':
-			txqlen = atoi (optarg);
-			if (txqlen < 0 || txqlen > 65535) {
-				SLOGF (LOG_ERR2, "queue length (%d) out of range [0, 65535]", txqlen);
+		case 'p':
+			if (num < 0) num = 0;
+			if (num >= LDT_BOND_MAXPATH) {
+				SLOGF (LOG_ERR2, "too many paths, maximum is %d",
+							LDT_BOND_MAXPATH);
 				return RERR_PARAM;
 			}
+			spath[num++] = optarg;
 			break;
-		case 'Q':
+		case 'c':
+			if (num < 0) num = 0;
+			break;
+		case 'r':
+			reorder = atoi (optarg);
+			if (reorder < 0 || reorder > LDT_BOND_REORDER_MAX) {
+				SLOGF (LOG_ERR2, "invalid reorder timeout %s", optarg);
+				return RERR_PARAM;
+			}
+			break;
+		case '6':
+			flags |= FRAD_F_IPV6;
+			break;
+		case '4':
+			flags |= FRAD_F_IPV4;
+			break;
+		}
+	}
+	if (optind < argc) {
+		name = argv[optind];
+		optind++;
+	}
+	if (!name) {
+		SLOGF (LOG_ERR2, "missing device name");
+		return RERR_PARAM;
+	}
+	if (num < 0 && reorder < 0) {
+		SLOGF (LOG_ERR2, "nothing to set");
+		return RERR_PARAM;
+	}
+	for (i=0; i<num; i++) {
+		ret = parse_path (&list[i], spath[i], flags);
+		if (!RERR_ISOK(ret)) return ret;
+	}
+	return ldt_tun_setpaths (name, list, num, reorder);
+}
+
+void
+usage_setqos()
+{
+	printf ("setqos: usage: %s setqos | qos <options> <name>\n"
+				"         - copies the class of the inner packets to the outer ones\n"
+				"  options are:\n"
+				"      <name>         - name of ldt device\n"
+				"      -h             - this help screen\n"
+				"      -d <mode>      - outer dscp (traffic class):\n"
+				"                         off  - socket default\n"
+				"                         copy - inner dscp\n"
+				"                         map  - inner dscp mapped by -m\n"
+				"      -m <map>       - dscp map, e.g. 46=46,34-38=34,0-33=0\n"
+				"                       (unlisted values are kept)\n"
+				"      -p             - copy the priority (skb->priority)\n"
+				"      -f <mask>      - copy the fwmark, masked by mask\n"
+				"                       (0 = all bits)\n"
+				"      -o             - switch off\n"
+				"  without any option the class copying is switched off\n"
+				"\n", PROG);
+}
+
+static
+int
+parse_dscpmap (list, map)
+	const char	*list;
+	uint8_t		*map;
+{
+	const char	*s = list;
+	char			*end;
+	long			from, to, dscp, i;
+
+	while (s && *s) {
+		from = strtol (s, &end, 0);
+		if (end == s || from < 0 || from > 63) return RERR_PARAM;
+		to = from;
+		s = end;
+		if (*s == '-') {
+			s++;
+			to = strtol (s, &end, 0);
+			if (end == s || to < from || to > 63) return RERR_PARAM;
+			s = end;
+		}
+		if (*s != '=') return RERR_PARAM;
+		s++;
+		dscp = strtol (s, &end, 0);
+		if (end == s || dscp < 0 || dscp > 63) return RERR_PARAM;
+		s = end;
+		for (i=from; i<=to; i++) map[i] = dscp;
+		if (*s == ',') {
+			s++;
+		} else if (*s) {
+			return RERR_PARAM;
+		}
+	}
+	return RERR_OK;
+}
+
+int
+cmd_setqos (argc, argv)
+	int	argc;
+	char	**argv;
+{
+	const char			*name = NULL;
+	const char			*map = NULL;
+	struct ldt_qoscfg	cfg;
+	int					c, i, off = 0;
+	char					*end;
+
+	bzero (&cfg, sizeof (cfg));
+	for (i=0; i<64; i++) cfg.map[i] = i;
+	while ((c=getopt (argc, argv, "hd:m:pf:o")) != -1) {
+		switch (c) {
+		case 'h':
+			usage_setqos();
+			return RERR_OK;
+		case 'd':
 			sswitch (optarg) {
-			sicase ("drop_oldest")
-			sicase ("dropoldest")
-			sicase ("drop-oldest")
-			sicase ("oldest")
-				qpolicy = LDT_CMD_SETQUEUE_QPOLICY_DROP_OLDEST;
+			sicase ("off")
+				cfg.dscp = LDT_QOS_DSCP_OFF;
 				break;
-			sicase ("drop_newest")
-			sicase ("dropnewest")
-			sicase ("drop-newest")
-			sicase ("newest")
-				qpolicy = LDT_CMD_SETQUEUE_QPOLICY_DROP_NEWEST;
+			sicase ("copy")
+				cfg.dscp = LDT_QOS_DSCP_COPY;
+				break;
+			sicase ("map")
+				cfg.dscp = LDT_QOS_DSCP_MAP;
 				break;
 			sdefault
-				SLOGF (LOG_ERR2, "invalid queueing policy %s", optarg);
-				return -EINVAL;
+				SLOGF (LOG_ERR2, "invalid dscp mode %s", optarg);
+				return RERR_PARAM;
 			} esac;
+			break;
+		case 'm':
+			map = optarg;
+			break;
+		case 'p':
+			cfg.flags |= LDT_QOS_F_PRIO;
+			break;
+		case 'f':
+			cfg.markmask = strtoul (optarg, &end, 0);
+			if (*end) {
+				SLOGF (LOG_ERR2, "invalid mark mask %s", optarg);
+				return RERR_PARAM;
+			}
+			cfg.flags |= LDT_QOS_F_MARK;
+			break;
+		case 'o':
+			off = 1;
+			break;
 		}
 	}
 	if (optind < argc) {
@@ -841,13 +2060,205 @@ cmd_setqueue (argc, argv)
 		SLOGF (LOG_ERR2, "missing device name");
 		return RERR_PARAM;
 	}
+	if (map) {
+		if (!RERR_ISOK(parse_dscpmap (map, cfg.map))) {
+			SLOGF (LOG_ERR2, "invalid dscp map >>%s<<", map);
+			return RERR_PARAM;
+		}
+		if (cfg.dscp == LDT_QOS_DSCP_OFF) cfg.dscp = LDT_QOS_DSCP_MAP;
+	}
+	if (off || (cfg.dscp == LDT_QOS_DSCP_OFF && !cfg.flags)) {
+		return ldt_tun_setqos (name, NULL);
+	}
+	return ldt_tun_setqos (name, &cfg);
+}
+
+void
+usage_restore()
+{
+	printf ("restore: usage: %s restore <options> <file>\n"
+				"         - creates and configures all devices listed in file\n"
+				"           (- for stdin) with a single request per %d devices\n"
+				"  options are:\n"
+				"      <file>         - config file, one device per line:\n"
+				"                       <name> [type=<tuntype>] [flags=<num>]\n"
+				"                              [mtu=<num>] [txqlen=<num>]\n"
+				"                              [qpolicy=oldest|newest] [dev=<iface>]\n"
+				"                              [laddr=<addr>] [raddr=<addr> |\n"
+				"                              server[=multiclient]]\n"
+				"      -h             - this help screen\n"
+				"      -e             - reconfigure already existing devices\n"
+				"      -k             - keep devices that failed to configure\n"
+				"\n", PROG, LDT_BULK_MAX);
+}
+
+int
+cmd_restore (argc, argv)
+	int	argc;
+	char	**argv;
+{
+	const char				*fname = NULL;
+	struct ldt_bulkdev	*list;
+	int						c, ret, i, num, nfail;
+	uint32_t					flags = 0;
+
+	while ((c=getopt (argc, argv, "hek")) != -1) {
+		switch (c) {
+		case 'h':
+			usage_restore();
+			return RERR_OK;
+		case 'e':
+			flags |= LDT_BULK_F_EXIST;
+			break;
+		case 'k':
+			flags |= LDT_BULK_F_NOROLLBACK;
+			break;
+		}
+	}
+	if (optind < argc) {
+		fname = argv[optind];
+		optind++;
+	}
+	if (!fname) {
+		SLOGF (LOG_ERR2, "missing config file");
+		return RERR_PARAM;
+	}
+	ret = ldt_bulk_readfile (fname, &list, &num);
+	if (!RERR_ISOK(ret)) return ret;
+	ret = ldt_bulk_apply (list, num, flags, &nfail);
+	if (!RERR_ISOK(ret) && ret != RERR_FAIL) {
+		free (list);
+		return ret;
+	}
+	for (i=0; i<num; i++) {
+		if (!list[i].ret) continue;
+		printf ("%s: %s failed: %s\n", list[i].outname[0] ? list[i].outname :
+					(list[i].name ? list[i].name : "???"),
+					ldt_bulk_stepname (list[i].step), strerror (list[i].ret));
+	}
+	printf ("%d of %d devices configured\n", num - nfail, num);
+	free (list);
+	return ret;
+}
+
+void
+usage_showstats()
+{
+	printf ("showstats: usage: %s showstats <name> [<options>]\n"
+				"         - prints out statistics of given ldt device\n"
+				"      <name>         - name of ldt device\n"
+				"  options are:\n"
+				"      -h             - this help screen\n"
+				"      -l | --latency - print latency histograms (queue sojourn,\n"
+				"                       xmit scheduling delay, socket send time)\n"
+				"      -r             - reset histograms after reading\n"
+				"\n", PROG);
+}
+
+static const char	*lat_names[LDT_LAT_NUM] = {
+	"sojourn", "sched", "send" };
+
+static
+const char*
+fmt_ns (buf, ns)
+	char		*buf;
+	uint64_t	ns;
+{
+	if (ns < 10000ULL) {
+		sprintf (buf, "%lluns", (unsigned long long)ns);
+	} else if (ns < 10000000ULL) {
+		sprintf (buf, "%lluus", (unsigned long long)(ns/1000ULL));
+	} else if (ns < 10000000000ULL) {
+		sprintf (buf, "%llums", (unsigned long long)(ns/1000000ULL));
+	} else {
+		sprintf (buf, "%llus", (unsigned long long)(ns/1000000000ULL));
+	}
+	return buf;
+}
+
+static
+void
+print_lathist (tname, hist)
+	const char					*tname;
+	const struct ldt_lathist	*hist;
+{
+	char	b1[32], b2[32];
+	int	i;
+
+	printf ("  %s: count=%llu", tname, (unsigned long long)hist->count);
+	if (hist->count) {
+		printf (" avg=%s", fmt_ns (b1, hist->sum / hist->count));
+		printf (" max=%s", fmt_ns (b1, hist->max));
+	}
+	printf ("\n");
+	for (i=0; i<LDT_LATHIST_BUCKETS; i++) {
+		if (!hist->bucket[i]) continue;
+		if (i == 0) {
+			printf ("    %10s          : %llu\n", "0",
+						(unsigned long long)hist->bucket[i]);
+		} else {
+			printf ("    %10s - %-7s: %llu\n", fmt_ns (b1, 1ULL<<(i-1)),
+						fmt_ns (b2, 1ULL<<i),
+						(unsigned long long)hist->bucket[i]);
+		}
+	}
+}
 
-	return ldt_tun_setqueue (name, txqlen, qpolicy);
+int
+cmd_showstats (argc, argv)
+	int	argc;
+	char	**argv;
+{
+	static const struct option	lopts[] = {
+		{ "help", 0, NULL, 'h' },
+		{ "latency", 0, NULL, 'l' },
+		{ "reset", 0, NULL, 'r' },
+		{ NULL, 0, NULL, 0 } };
+	const char				*name = NULL;
+	struct ldt_latency	lat;
+	int						c, ret, i;
+	uint32_t					flags = 0;
+
+	while ((c=getopt_long (argc, argv, "hlr", lopts, NULL)) != -1) {
+		switch (c) {
+		case 'h':
+			usage_showstats();
+			return RERR_OK;
+		case 'l':
+			/* latency histograms are the only statistics for now */
+			break;
+		case 'r':
+			flags |= LDT_LATENCY_F_RESET;
+			break;
+		}
+	}
+	if (optind < argc) {
+		name = argv[optind];
+		optind++;
+	}
+	if (!name) {
+		SLOGF (LOG_ERR2, "missing device name");
+		return RERR_PARAM;
+	}
+	ret = ldt_get_latency (name, &lat, flags);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR2, "error reciving latency for device >>%s<<: %s",
+					name, rerr_getstr3(ret));
+		return ret;
+	}
+	printf ("%s: latency (collected over %llu ms)\n", name,
+				(unsigned long long)lat.age);
+	for (i=0; i<LDT_LAT_NUM; i++) {
+		print_lathist (lat_names[i], &lat.hist[i]);
+	}
+	return RERR_OK;
 }
 
 
 
 
+
+
 static
 int
 print_devlist (devlist, listlen)
@@ -1026,6 +2437,7 @@ printtun (tag, pflags)
 	sincase ("mpdccp")
 	sincase ("mpdccp4")
 	sincase ("mpdccp6")
+	sincase ("bond")
 		func = &printudptun;
 		break;
 	sdefault
@@ -1142,6 +2554,10 @@ printudptun (tag, pflags)
 	if (RERR_ISOK(ret)) {
 		printf ("              status: %s\n", s);
 	}
+	ret = xmltag_search (&s, tag, "numclients", 0);
+	if (RERR_ISOK(ret)) {
+		printf ("              clients: %s\n", s);
+	}
 
 	return RERR_OK;
 }
@@ -1225,7 +2641,14 @@ usage_prtev()
 				"      -o             - exits after the first event received\n"
 				"      -e             - exit on receive error (implied by -o)\n"
 				"      -T <timeout>   - timeout on wait\n"
-				"\n", PROG);
+				"      -r             - read binary records from the event ring\n"
+				"      -a             - with -r: start with the oldest record\n"
+				"                       still in the ring\n"
+				"      -i <iface>     - only events of given interface, can be\n"
+				"                       given up to %d times (filtered in kernel)\n"
+				"      -E <events>    - only given event types, comma separated\n"
+				"                       list of event names (filtered in kernel)\n"
+				"\n", PROG, LDT_SUBSCRIBE_MAXIF);
 }
 
 int
@@ -1241,8 +2664,11 @@ cmd_prtev (argc, argv)
 	char			*sarg;
 	const char	*evst,*evname;
 	int			brkerr = 0;
+	int			ring = 0, ringflags = 0;
+	const char	*ifaces[LDT_SUBSCRIBE_MAXIF];
+	int			nif = 0, evmask = 0;
 
-	while ((c=getopt (argc, argv, "hoT:t:e")) != -1) {
+	while ((c=getopt (argc, argv, "hoT:t:erai:E:")) != -1) {
 		switch (c) {
 		case 'h':
 			usage_prtev();
@@ -1257,9 +2683,31 @@ cmd_prtev (argc, argv)
 		case 't':
 			timeout = cf_atotm (optarg);
 			break;
+		case 'r':
+			ring = 1;
+			break;
+		case 'a':
+			ringflags |= LDT_EVRING_F_OLDEST;
+			break;
+		case 'i':
+			if (nif >= LDT_SUBSCRIBE_MAXIF) {
+				SLOGF (LOG_ERR2, "too many interfaces, maximum is %d",
+								LDT_SUBSCRIBE_MAXIF);
+				return RERR_PARAM;
+			}
+			ifaces[nif++] = optarg;
+			break;
+		case 'E':
+			evmask = ldt_getevmap (optarg);
+			if (evmask <= 0) {
+				SLOGF (LOG_ERR2, "invalid event list >>%s<<", optarg);
+				return RERR_PARAM;
+			}
+			break;
 		}
 	}
-	ret = ldt_event_open ();
+	if (ring) return prtev_ring (one, brkerr, timeout, ringflags);
+	ret = ldt_subscribe2 (ifaces, nif, (uint32_t)evmask);
 	if (!RERR_ISOK(ret)) {
 		SLOGF (LOG_ERR2, "error opening netlink to kernel: %s", rerr_getstr3(ret));
 		return ret;
@@ -1288,6 +2736,54 @@ cmd_prtev (argc, argv)
 	return RERR_OK;
 }
 
+static
+int
+prtev_ring (one, brkerr, timeout, flags)
+	int	one, brkerr, flags;
+	tmo_t	timeout;
+{
+	struct ldt_evring	ring;
+	struct ldt_evrec	ev;
+	uint64_t				lost = 0;
+	const char			*evst, *evname;
+	int					ret;
+
+	ret = ldt_evring_open (&ring, flags);
+	if (!RERR_ISOK(ret)) {
+		SLOGF (LOG_ERR2, "error opening event ring: %s", rerr_getstr3(ret));
+		return ret;
+	}
+	do {
+		ret = ldt_evring_read (&ring, &ev, timeout);
+		if (!RERR_ISOK(ret)) {
+			SLOGF (LOG_ERR2, "error receiving event: %s", rerr_getstr3(ret));
+			if (one || brkerr) break;
+			continue;
+		}
+		if (ring.lost != lost) {
+			printf ("*** %llu event(s) lost\n\n",
+						(unsigned long long)(ring.lost - lost));
+			lost = ring.lost;
+		}
+		evst = ldt_evgetdesc (ev.evtype);
+		if (!evst) evst = "unknown event";
+		evname = ldt_evgetname (ev.evtype);
+		if (!evname) evname = "unknown";
+		printf ("%s (%d, %s): seq %llu at %llu.%09llu\n", evst, (int)ev.evtype,
+					evname, (unsigned long long)ev.seq,
+					(unsigned long long)(ev.tstamp / 1000000000ULL),
+					(unsigned long long)(ev.tstamp % 1000000000ULL));
+		if (*ev.iface) printf ("  iface:   %s (%d)\n", ev.iface, (int)ev.ifindex);
+		if (ev.reason) printf ("  reason:  %d\n", (int)ev.reason);
+		if (ev.subflow || *ev.sfname)
+			printf ("  subflow: %u (%s)\n", (unsigned)ev.subflow, ev.sfname);
+		printf ("\n");
+		fflush (stdout);
+	} while (!one);
+	ldt_evring_close (&ring);
+	return ret;
+}
+
 
 
 
@@ -67,8 +67,20 @@ int cmd_prtev (int argc, char **argv);
 int cmd_newtun (int argc, char **argv);
 int cmd_tunbind (int argc, char **argv);
 int cmd_setpeer (int argc, char **argv);
+int cmd_setpeerlist (int argc, char **argv);
 int cmd_serverstart (int argc, char **argv);
+int cmd_clientroute (int argc, char **argv);
 int cmd_setqueue (int arcg, char **argv);
+int cmd_setsockopt (int argc, char **argv);
+int cmd_setrxsteer (int argc, char **argv);
+int cmd_setrebind (int argc, char **argv);
+int cmd_setaead (int argc, char **argv);
+int cmd_setpace (int argc, char **argv);
+int cmd_setfec (int argc, char **argv);
+int cmd_setpaths (int argc, char **argv);
+int cmd_setqos (int argc, char **argv);
+int cmd_restore (int argc, char **argv);
+int cmd_showstats (int argc, char **argv);
 
 
 void usage_newdev ();
@@ -84,8 +96,20 @@ void usage_prtev ();
 void usage_newtun ();
 void usage_tunbind ();
 void usage_setpeer ();
+void usage_setpeerlist ();
 void usage_serverstart ();
+void usage_clientroute ();
 void usage_setqueue ();
+void usage_setsockopt ();
+void usage_setrxsteer ();
+void usage_setrebind ();
+void usage_setaead ();
+void usage_setpace ();
+void usage_setfec ();
+void usage_setpaths ();
+void usage_setqos ();
+void usage_restore ();
+void usage_showstats ();
 
 
 
@@ -56,6 +56,10 @@
 #include <strings.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
 
 #include <fr/base.h>
 #include <fr/xml.h>
@@ -68,6 +72,7 @@ static int wait_on_down (const char*);
 static int addr_add (const char *, int);
 static int try_connect (const char*, frad_pair_t*);
 static int try_connect_all (const char*);
+static int conman_multi (const char*, int);
 
 extern const char *PROG;
 
@@ -87,6 +92,9 @@ usage_conman ()
 				"                       manager tries in turn to establish connection\n"
 				"      -4             - following addresses are IPv4 addresses\n"
 				"      -6             - following addresses are IPv6 addresses\n"
+				"      -f <file>      - manage all devices listed in file (instead of <name>)\n"
+				"                       one line per device: <name> [ipv4|ipv6] [connect=<addrpair>]...\n"
+				"                       send SIGHUP to re-read the file\n"
 				"\n", PROG);
 }
 
@@ -99,11 +107,12 @@ cmd_conman (argc, argv)
 	char	**argv;
 {
 	const char	*name = NULL;
+	const char	*fname = NULL;
 	int			c, ret;
 	int			debug=0;
 	int			addrflags=0;
 
-	while ((c=getopt (argc, argv, "hd46c:")) != -1) {
+	while ((c=getopt (argc, argv, "hd46c:f:")) != -1) {
 		switch (c) {
 		case 'h':
 			usage_conman ();
@@ -123,8 +132,13 @@ cmd_conman (argc, argv)
 				SLOGF (LOG_ERR2, "error parsing address: %s", rerr_getstr3(ret));
 				return ret;
 			}
+			break;
+		case 'f':
+			fname = optarg;
+			break;
 		}
 	}
+	if (fname) return conman_multi (fname, debug);
 	if (optind < argc) {
 		name = argv[optind];
 	}
@@ -321,6 +335,606 @@ wait_on_come_back (name, evtype)
 
 
 
+/* multi device connection manager
+ *
+ * All devices of the config file are handled by one process with a
+ * single event subscription. Each device runs its own state machine,
+ * connection timeouts and backoffs are kept in a timer wheel. On SIGHUP
+ * the config file is re-read, devices being up are left untouched.
+ */
+
+enum cm_state {
+	CM_ST_IDLE,				/* waiting for the (re)connect timer */
+	CM_ST_BIND,				/* bind request sent */
+	CM_ST_PEER,				/* setpeer request sent */
+	CM_ST_CONNECT,			/* waiting for connection establishment */
+	CM_ST_UP,				/* connected */
+	CM_ST_SUSPEND,			/* tunnel or interface down */
+};
+
+#define CM_TW_TICK		100000LL		/* 100 ms */
+#define CM_TW_SLOTS		256
+#define CM_CONNTMO		5000000LL	/* 5 sec */
+#define CM_PAIRDELAY		500000LL		/* 0.5 sec */
+#define CM_BACKOFF_MIN	1000000LL	/* 1 sec */
+#define CM_BACKOFF_MAX	15000000LL	/* 15 sec */
+#define CM_STARTSPREAD	1000000LL	/* 1 sec */
+
+struct cm_dev {
+	char				*name;
+	char				*cfg;				/* config line - to detect changes */
+	frad_pair_t		*pairs;
+	int				npairs;
+	int				curpair;
+	enum cm_state	state;
+	int				tundown, ifdown;
+	tmo_t				backoff;
+	int				npending;		/* requests waiting for their answer */
+	int				removed;
+	int				seen;
+	struct cm_dev	*next;
+	/* timer wheel */
+	struct cm_dev	*tw_next, **tw_pprev;
+	uint32_t			tw_rounds;
+};
+
+static struct cm_dev		*cm_devs = NULL;
+static struct cm_dev		*cm_wheel[CM_TW_SLOTS];
+static uint32_t			cm_tick = 0;
+static tmo_t				cm_ticktime = 0;
+static int					cm_ntimers = 0;
+static struct ldt_ctx	*cm_ctx = NULL;
+static int					cm_quit = 0;
+
+static void cm_connect (struct cm_dev*);
+static void cm_fail (struct cm_dev*);
+static void cm_timeout (struct cm_dev*);
+static void cm_devfree (struct cm_dev*);
+static int cm_readconf (const char*);
+
+
+static
+void
+cm_timer_del (dev)
+	struct cm_dev	*dev;
+{
+	if (!dev->tw_pprev) return;
+	*dev->tw_pprev = dev->tw_next;
+	if (dev->tw_next) dev->tw_next->tw_pprev = dev->tw_pprev;
+	dev->tw_next = NULL;
+	dev->tw_pprev = NULL;
+	cm_ntimers--;
+}
+
+static
+void
+cm_timer_add (dev, tout)
+	struct cm_dev	*dev;
+	tmo_t				tout;
+{
+	uint32_t	ticks, slot;
+
+	cm_timer_del (dev);
+	/* the wheel doesn't turn while empty */
+	if (cm_ntimers == 0) cm_ticktime = tmo_now ();
+	ticks = (tout + CM_TW_TICK - 1) / CM_TW_TICK;
+	if (ticks == 0) ticks = 1;
+	slot = (cm_tick + ticks) % CM_TW_SLOTS;
+	dev->tw_rounds = (ticks - 1) / CM_TW_SLOTS;
+	dev->tw_next = cm_wheel[slot];
+	if (dev->tw_next) dev->tw_next->tw_pprev = &dev->tw_next;
+	dev->tw_pprev = &cm_wheel[slot];
+	cm_wheel[slot] = dev;
+	cm_ntimers++;
+}
+
+static
+void
+cm_timer_run ()
+{
+	struct cm_dev	*dev, *next;
+	tmo_t				now;
+
+	now = tmo_now ();
+	while (cm_ntimers > 0 && now - cm_ticktime >= CM_TW_TICK) {
+		cm_ticktime += CM_TW_TICK;
+		cm_tick++;
+		for (dev = cm_wheel[cm_tick % CM_TW_SLOTS]; dev; dev = next) {
+			next = dev->tw_next;
+			if (dev->tw_rounds > 0) {
+				dev->tw_rounds--;
+				continue;
+			}
+			cm_timer_del (dev);
+			cm_timeout (dev);
+		}
+	}
+}
+
+static
+tmo_t
+cm_jitter (tout)
+	tmo_t	tout;
+{
+	/* spread reconnects of many tunnels failing at the same time */
+	return tout + (tmo_t)(random () % (tout / 4 + 1));
+}
+
+
+static
+struct cm_dev *
+cm_finddev (name)
+	const char	*name;
+{
+	struct cm_dev	*dev;
+
+	for (dev = cm_devs; dev; dev = dev->next) {
+		if (!strcmp (dev->name, name)) return dev;
+	}
+	return NULL;
+}
+
+/* answers of requests to removed devices still arrive - such devices
+ * are freed with the last answer
+ */
+static
+int
+cm_gotanswer (dev)
+	struct cm_dev	*dev;
+{
+	dev->npending--;
+	if (!dev->removed) return 1;
+	if (dev->npending <= 0) cm_devfree (dev);
+	return 0;
+}
+
+static
+const char *
+cm_strerr (err)
+	int	err;
+{
+	return strerror (err < 0 ? -err : err);
+}
+
+static
+void
+cm_peerdone (ctx, arg, seq, err, data, dlen)
+	struct ldt_ctx	*ctx;
+	void				*arg;
+	int				seq, err;
+	const char		*data;
+	uint32_t			dlen;
+{
+	struct cm_dev	*dev = arg;
+
+	if (!cm_gotanswer (dev)) return;
+	if (dev->state != CM_ST_PEER) return;
+	if (err) {
+		SLOGF (LOG_WARN2, "%s: error connecting: %s", dev->name, cm_strerr (err));
+		cm_fail (dev);
+		return;
+	}
+	dev->state = CM_ST_CONNECT;
+	cm_timer_add (dev, CM_CONNTMO);
+}
+
+static
+void
+cm_binddone (ctx, arg, seq, err, data, dlen)
+	struct ldt_ctx	*ctx;
+	void				*arg;
+	int				seq, err;
+	const char		*data;
+	uint32_t			dlen;
+{
+	struct cm_dev	*dev = arg;
+	char				buf[128];
+	int				ret;
+
+	if (!cm_gotanswer (dev)) return;
+	if (dev->state != CM_ST_BIND) return;
+	if (err) {
+		frad_sprint (buf, sizeof (buf), &dev->pairs[dev->curpair].local);
+		SLOGF (LOG_WARN2, "%s: error binding to address %s: %s", dev->name, buf,
+					cm_strerr (err));
+		cm_fail (dev);
+		return;
+	}
+	ret = ldt_async_setpeer (	cm_ctx, dev->name, &dev->pairs[dev->curpair].remote,
+										cm_peerdone, dev);
+	if (!RERR_ISOK(ret)) {
+		cm_fail (dev);
+		return;
+	}
+	dev->npending++;
+	dev->state = CM_ST_PEER;
+}
+
+static
+void
+cm_connect (dev)
+	struct cm_dev	*dev;
+{
+	int	ret;
+
+	cm_timer_del (dev);
+	if (dev->npairs == 0) {
+		ret = ldt_async_setpeer (cm_ctx, dev->name, NULL, cm_peerdone, dev);
+		dev->state = CM_ST_PEER;
+	} else {
+		if (dev->curpair >= dev->npairs) dev->curpair = 0;
+		ret = ldt_async_tunbind (	cm_ctx, dev->name,
+											&dev->pairs[dev->curpair].local,
+											cm_binddone, dev);
+		dev->state = CM_ST_BIND;
+	}
+	if (!RERR_ISOK(ret)) {
+		SLOGF (LOG_WARN2, "%s: error sending request: %s", dev->name,
+					rerr_getstr3 (ret));
+		cm_fail (dev);
+		return;
+	}
+	dev->npending++;
+}
+
+static
+void
+cm_fail (dev)
+	struct cm_dev	*dev;
+{
+	dev->state = CM_ST_IDLE;
+	if (++dev->curpair < dev->npairs) {
+		cm_timer_add (dev, CM_PAIRDELAY);
+		return;
+	}
+	/* all pairs failed - back off */
+	dev->curpair = 0;
+	cm_timer_add (dev, cm_jitter (dev->backoff));
+	SLOGF (LOG_INFO, "%s: connect failed, retry in %d sec", dev->name,
+				(int)(dev->backoff / 1000000LL));
+	dev->backoff *= 2;
+	if (dev->backoff > CM_BACKOFF_MAX) dev->backoff = CM_BACKOFF_MAX;
+}
+
+static
+void
+cm_timeout (dev)
+	struct cm_dev	*dev;
+{
+	switch (dev->state) {
+	case CM_ST_IDLE:
+		cm_connect (dev);
+		break;
+	case CM_ST_CONNECT:
+		SLOGF (LOG_WARN2, "%s: timeout waiting on connection", dev->name);
+		cm_fail (dev);
+		break;
+	default:
+		break;
+	}
+}
+
+static
+void
+cm_devevent (dev, evtype)
+	struct cm_dev	*dev;
+	int				evtype;
+{
+	switch (evtype) {
+	case LDT_EVTYPE_CONN_ESTAB:
+		/* the event might overtake the answer to setpeer */
+		if (dev->state != CM_ST_CONNECT && dev->state != CM_ST_PEER) break;
+		cm_timer_del (dev);
+		dev->state = CM_ST_UP;
+		dev->backoff = CM_BACKOFF_MIN;
+		SLOGF (LOG_INFO, "%s: connected", dev->name);
+		break;
+	case LDT_EVTYPE_CONN_ESTAB_FAIL:
+		if (dev->state != CM_ST_CONNECT && dev->state != CM_ST_PEER) break;
+		SLOGF (LOG_WARN2, "%s: connection failed", dev->name);
+		cm_fail (dev);
+		break;
+	case LDT_EVTYPE_DOWN:
+		if (dev->state != CM_ST_UP) break;
+		SLOGF (LOG_INFO, "%s: peer down - reconnecting", dev->name);
+		dev->curpair = 0;
+		cm_connect (dev);
+		break;
+	case LDT_EVTYPE_TUNDOWN:
+	case LDT_EVTYPE_IFDOWN:
+		if (evtype == LDT_EVTYPE_TUNDOWN) {
+			dev->tundown = 1;
+		} else {
+			dev->ifdown = 1;
+		}
+		cm_timer_del (dev);
+		dev->state = CM_ST_SUSPEND;
+		break;
+	case LDT_EVTYPE_TUNUP:
+	case LDT_EVTYPE_IFUP:
+		if (evtype == LDT_EVTYPE_TUNUP) {
+			dev->tundown = 0;
+		} else {
+			dev->ifdown = 0;
+		}
+		if (dev->state != CM_ST_SUSPEND || dev->tundown || dev->ifdown) break;
+		dev->curpair = 0;
+		cm_connect (dev);
+		break;
+	}
+}
+
+static
+void
+cm_event (ctx, arg, evtype, iarg, sarg)
+	struct ldt_ctx	*ctx;
+	void				*arg;
+	int				evtype;
+	uint32_t			iarg;
+	const char		*sarg;
+{
+	struct ldt_evinfo	evinfo;
+	struct cm_dev		*dev;
+	char					*s;
+	int					ret;
+
+	if (evtype == LDT_EVTYPE_TPDOWN) {
+		SLOGF (LOG_NOTICE, "ldt module unloaded - exiting");
+		cm_quit = 1;
+		return;
+	}
+	if (!sarg || !(s = strdup (sarg))) return;
+	bzero (&evinfo, sizeof (evinfo));
+	ret = ldt_evinfo_parse (&evinfo, s, evtype);
+	if (!evinfo.buf) free (s);
+	if (RERR_ISOK(ret) && evinfo.iface && (dev = cm_finddev (evinfo.iface))) {
+		cm_devevent (dev, evtype);
+	}
+	LDT_EVINFO_HFREE (&evinfo);
+}
+
+static
+void
+cm_subscribed (ctx, arg, seq, err, data, dlen)
+	struct ldt_ctx	*ctx;
+	void				*arg;
+	int				seq, err;
+	const char		*data;
+	uint32_t			dlen;
+{
+	if (!err) return;
+	SLOGF (LOG_ERR2, "error subscribing to events: %s", cm_strerr (err));
+	cm_quit = 1;
+}
+
+
+static
+void
+cm_devfree (dev)
+	struct cm_dev	*dev;
+{
+	if (!dev) return;
+	if (dev->name) free (dev->name);
+	if (dev->cfg) free (dev->cfg);
+	if (dev->pairs) free (dev->pairs);
+	free (dev);
+}
+
+static
+int
+cm_parseline (odev, line, lineno)
+	struct cm_dev	**odev;
+	char				*line;
+	int				lineno;
+{
+	struct cm_dev	*dev;
+	frad_pair_t		*p;
+	char				*name, *key, *val;
+	int				ret, flags = 0;
+
+	name = top_getfield (&line, " \t", 0);
+	if (!name || *name == '#') return RERR_OK;
+	dev = calloc (1, sizeof (struct cm_dev));
+	if (!dev) return RERR_NOMEM;
+	dev->name = strdup (name);
+	dev->cfg = strdup (line ? line : "");
+	if (!dev->name || !dev->cfg) {
+		cm_devfree (dev);
+		return RERR_NOMEM;
+	}
+	while ((key = top_getfield (&line, " \t", 0))) {
+		val = index (key, '=');
+		if (val) *val++ = 0;
+		sswitch (key) {
+		sicase ("ipv4")
+			flags = FRAD_F_IPV4;
+			break;
+		sicase ("ipv6")
+			flags = FRAD_F_IPV6;
+			break;
+		sicase ("connect")
+			p = realloc (dev->pairs, sizeof (frad_pair_t) * (dev->npairs+1));
+			if (!p) {
+				cm_devfree (dev);
+				return RERR_NOMEM;
+			}
+			dev->pairs = p;
+			ret = frad_getaddrpair (&dev->pairs[dev->npairs], val ? val : "", flags);
+			if (!RERR_ISOK(ret)) {
+				SLOGF (LOG_ERR2, "line %d: invalid address pair: %s", lineno,
+							rerr_getstr3(ret));
+				cm_devfree (dev);
+				return ret;
+			}
+			dev->npairs++;
+			break;
+		sdefault
+			SLOGF (LOG_ERR2, "line %d: unknown option >>%s<<", lineno, key);
+			cm_devfree (dev);
+			return RERR_PARAM;
+		} esac;
+	}
+	*odev = dev;
+	return RERR_OK;
+}
+
+/* reads the config file and merges it into the device list - on error
+ * the old configuration is kept
+ */
+static
+int
+cm_readconf (fname)
+	const char	*fname;
+{
+	struct cm_dev	*newlist = NULL, **plast = &newlist;
+	struct cm_dev	*dev, *ndev, **pp;
+	char				*buf, *ptr, *line;
+	int				lineno, ret = RERR_OK;
+
+	buf = fop_read_fn (fname);
+	if (!buf) {
+		SLOGFE (LOG_ERR2, "cannot read config file >>%s<<", fname);
+		return RERR_SYSTEM;
+	}
+	ptr = buf;
+	for (lineno=1; ptr; lineno++) {
+		line = top_getline (&ptr, TOP_F_NOSKIPBLANK);
+		if (!line || !*line) continue;
+		ndev = NULL;
+		ret = cm_parseline (&ndev, line, lineno);
+		if (!RERR_ISOK(ret)) break;
+		if (!ndev) continue;
+		*plast = ndev;
+		plast = &ndev->next;
+	}
+	free (buf);
+	if (!RERR_ISOK(ret)) {
+		for (; newlist; newlist = ndev) {
+			ndev = newlist->next;
+			cm_devfree (newlist);
+		}
+		return ret;
+	}
+
+	/* merge */
+	for (dev = cm_devs; dev; dev = dev->next) dev->seen = 0;
+	for (; newlist; newlist = ndev) {
+		ndev = newlist->next;
+		dev = cm_finddev (newlist->name);
+		if (!dev) {
+			newlist->next = cm_devs;
+			cm_devs = newlist;
+			newlist->state = CM_ST_IDLE;
+			newlist->backoff = CM_BACKOFF_MIN;
+			newlist->seen = 1;
+			cm_timer_add (newlist, (tmo_t)(random () % CM_STARTSPREAD));
+			SLOGF (LOG_INFO, "%s: managing device", newlist->name);
+			continue;
+		}
+		dev->seen = 1;
+		if (strcmp (dev->cfg, newlist->cfg) != 0) {
+			/* new addresses are used on next (re)connect */
+			SLOGF (LOG_INFO, "%s: configuration changed", dev->name);
+			free (dev->cfg);
+			free (dev->pairs);
+			dev->cfg = newlist->cfg;
+			dev->pairs = newlist->pairs;
+			dev->npairs = newlist->npairs;
+			newlist->cfg = NULL;
+			newlist->pairs = NULL;
+			if (dev->curpair >= dev->npairs) dev->curpair = 0;
+		}
+		cm_devfree (newlist);
+	}
+	for (pp = &cm_devs; *pp; ) {
+		dev = *pp;
+		if (dev->seen) {
+			pp = &dev->next;
+			continue;
+		}
+		SLOGF (LOG_INFO, "%s: not managed any more", dev->name);
+		*pp = dev->next;
+		cm_timer_del (dev);
+		dev->removed = 1;
+		if (dev->npending <= 0) cm_devfree (dev);
+	}
+	return RERR_OK;
+}
+
+
+static
+int
+conman_multi (fname, debug)
+	const char	*fname;
+	int			debug;
+{
+	struct epoll_event		ev, evs[4];
+	struct signalfd_siginfo	si;
+	sigset_t						mask;
+	int							efd, sfd, i, n, ret;
+
+	cm_ctx = ldt_ctx_new (0);
+	if (!cm_ctx) return RERR_CONNECTION;
+	ldt_ctx_setevcb (cm_ctx, cm_event, NULL);
+	ret = ldt_async_subscribe (cm_ctx, cm_subscribed, NULL);
+	if (!RERR_ISOK(ret)) {
+		SLOGF (LOG_ERR2, "error subscribing to events: %s", rerr_getstr3(ret));
+		ldt_ctx_free (cm_ctx);
+		return ret;
+	}
+	srandom ((unsigned)(tmo_now () ^ getpid ()));
+	ret = cm_readconf (fname);
+	if (!RERR_ISOK(ret)) {
+		ldt_ctx_free (cm_ctx);
+		return ret;
+	}
+	if (!debug) {
+		frdaemonize ();
+	}
+	sigemptyset (&mask);
+	sigaddset (&mask, SIGHUP);
+	sigprocmask (SIG_BLOCK, &mask, NULL);
+	sfd = signalfd (-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	efd = epoll_create1 (EPOLL_CLOEXEC);
+	if (sfd < 0 || efd < 0) {
+		SLOGFE (LOG_ERR2, "cannot setup event loop: %s",
+					rerr_getstr3(RERR_SYSTEM));
+		return RERR_SYSTEM;
+	}
+	ev = (struct epoll_event) { .events = EPOLLIN, .data.fd = sfd };
+	epoll_ctl (efd, EPOLL_CTL_ADD, sfd, &ev);
+	ev = (struct epoll_event) { .events = EPOLLIN, .data.fd = ldt_ctx_fd (cm_ctx) };
+	epoll_ctl (efd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+
+	while (!cm_quit) {
+		n = epoll_wait (efd, evs, 4, cm_ntimers > 0 ? CM_TW_TICK / 1000 : -1);
+		if (n < 0 && errno != EINTR) {
+			SLOGFE (LOG_ERR2, "error in epoll_wait: %s", rerr_getstr3(RERR_SYSTEM));
+			break;
+		}
+		for (i=0; i<n; i++) {
+			if (evs[i].data.fd == sfd) {
+				while (read (sfd, &si, sizeof (si)) == sizeof (si));
+				SLOGF (LOG_NOTICE, "re-reading config file %s", fname);
+				cm_readconf (fname);
+				continue;
+			}
+			ret = ldt_ctx_dispatch (cm_ctx, 0);
+			if (!RERR_ISOK(ret)) {
+				SLOGF (LOG_WARN2, "error receiving from kernel: %s",
+							rerr_getstr3(ret));
+			}
+		}
+		cm_timer_run ();
+	}
+	close (efd);
+	close (sfd);
+	ldt_ctx_free (cm_ctx);
+	return RERR_OK;
+}
+
+
+
 
 
 
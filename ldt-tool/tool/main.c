@@ -78,6 +78,9 @@ usage ()
 				"    -c <config file>  - config file to use\n"
 				"    -t <timeout>      - timeout (default 5 sec)\n"
 				"    -V                - print version of ldt tool\n"
+				"    -b <file>         - batch mode - executes the commands in file\n"
+				"                        (- for stdin, one command per line) over\n"
+				"                        one netlink session\n"
 				"                        note - the kernel version is the version for\n"
 				"                        which ldt was compiled. to obtain the \n"
 				"                        version of the running module: ldt ver\n"
@@ -90,20 +93,37 @@ usage ()
 				"    showdev - shows information for a specific device\n"
 				"    showinfo | info - shows specific info for specific device\n"
 				"    showall - shows information for all ldt devices\n"
+				"    showstats | stats - shows statistics (latency) of a device\n"
 				"    newtun | addtun - creates a new tunnel\n"
 				"    tunbind - binds tunnel to address\n"
 				"    setpeer | peer - sets peer address to connect to\n"
+				"    setpeerlist | peerlist - sets peer candidates for auto reconnect\n"
 				"    serverstart - sets server to listen mode\n"
+				"    clientroute - assigns inner prefix to client of multi client server\n"
 				"    rmtun - remove a tunnel from a ldt device\n"
 				"    setmtu - sets mtu for given ldt device\n"
 				"    printev | prtev - prints (all) ldt events\n"
 				"    setqueue - set tx queue length and/or queueing policy\n"
+				"    setsockopt - set ccid, socket buffers, service code and\n"
+				"                 checksum coverage of a (mp-)dccp tunnel\n"
+				"    setrxsteer - select cpu(s) for receive processing\n"
+				"    setrebind - select how a tunnel moves to a new address\n"
+				"    setaead - install keys for encryption of the tunnel payload\n"
+				"    setpace - set pacing rate and burst of the tunnel egress\n"
+				"    setfec - set forward error correction of the tunnel\n"
+				"    setpaths | paths - set the uplinks of a bonding tunnel\n"
+				"    setqos | qos - copy the class of inner packets to the outer ones\n"
+				"    restore - creates and configures devices from config file\n"
 				"    conman - start connection manager\n"
 				"\n");
 }
 
 
 
+static int runcmd (int, char**, const char**);
+static int runbatch (const char*);
+
+
 int
 main (argc, argv)
 	int	argc;
@@ -111,9 +131,10 @@ main (argc, argv)
 {
 	int			c, ret;
 	const char	*cmd;
+	const char	*batch = NULL;
 
 	PROG = fr_getprog ();
-	while ((c = getopt (argc, argv, "+hc:t:V")) != -1) {
+	while ((c = getopt (argc, argv, "+hc:t:Vb:")) != -1) {
 		switch (c) {
 		case 'h':
 			usage ();
@@ -124,6 +145,9 @@ main (argc, argv)
 		case 't':
 			ldt_settimeout (cf_atotm (optarg));
 			break;
+		case 'b':
+			batch = optarg;
+			break;
 		case 'V':
 			printf ("library version: %s\n", LDT_LIB_VERSION);
 			printf ("kernel  version: %s\n", LDT_KERN_VERSION);
@@ -131,6 +155,7 @@ main (argc, argv)
 			return 0;
 		}
 	}
+	if (batch) return runbatch (batch);
 	if (optind < argc && !strcmp (argv[optind], "--")) optind++;
 	if (optind < argc) {
 		cmd = argv[optind];
@@ -140,6 +165,27 @@ main (argc, argv)
 	}
 	argc -= optind - 1;
 	argv += optind - 1;
+	ret = runcmd (argc, argv, &cmd);
+	if (!RERR_ISOK(ret)) {
+		SLOGFE (LOG_ERR2, "error executing command >>%s<<: %s", cmd,
+					rerr_getstr3 (ret));
+		return ret;
+	}
+	return 0;
+}
+
+
+/* argv[0] is the command - argv[-1] must be valid */
+static
+int
+runcmd (argc, argv, ocmd)
+	int			argc;
+	char			**argv;
+	const char	**ocmd;
+{
+	int			ret;
+	const char	*cmd = *ocmd;
+
 	optind = 0;
 	opterr = 0;
 	sswitch (cmd) {
@@ -189,10 +235,17 @@ main (argc, argv)
 	sicase ("peer")
 		ret = cmd_setpeer (argc, argv);
 		break;
+	sicase ("setpeerlist")
+	sicase ("peerlist")
+		ret = cmd_setpeerlist (argc, argv);
+		break;
 	sicase ("serverstart")
 	sicase ("listen")
 		ret = cmd_serverstart (argc, argv);
 		break;
+	sicase ("clientroute")
+		ret = cmd_clientroute (argc, argv);
+		break;
 	sicase ("setmtu")
 		ret = cmd_set_mtu (argc, argv);
 		break;
@@ -203,6 +256,45 @@ main (argc, argv)
 	sicase ("setqueue")
 		ret = cmd_setqueue (argc, argv);
 		break;
+	sicase ("setsockopt")
+	sicase ("sockopt")
+		ret = cmd_setsockopt (argc, argv);
+		break;
+	sicase ("setrxsteer")
+	sicase ("rxsteer")
+		ret = cmd_setrxsteer (argc, argv);
+		break;
+	sicase ("setrebind")
+	sicase ("rebind")
+		ret = cmd_setrebind (argc, argv);
+		break;
+	sicase ("setaead")
+	sicase ("aead")
+		ret = cmd_setaead (argc, argv);
+		break;
+	sicase ("setpace")
+	sicase ("pace")
+		ret = cmd_setpace (argc, argv);
+		break;
+	sicase ("setfec")
+	sicase ("fec")
+		ret = cmd_setfec (argc, argv);
+		break;
+	sicase ("setpaths")
+	sicase ("paths")
+		ret = cmd_setpaths (argc, argv);
+		break;
+	sicase ("setqos")
+	sicase ("qos")
+		ret = cmd_setqos (argc, argv);
+		break;
+	sicase ("restore")
+		ret = cmd_restore (argc, argv);
+		break;
+	sicase ("showstats")
+	sicase ("stats")
+		ret = cmd_showstats (argc, argv);
+		break;
 	sicase ("conman")
 		ret = cmd_conman (argc, argv);
 		break;
@@ -210,15 +302,109 @@ main (argc, argv)
 		argv--;
 		argc++;
 		ret = cmd_showdev (argc, argv);
-		cmd = "showdev";
+		*ocmd = "showdev";
 		break;
 	} esac;
+	return ret;
+}
+
+
+struct batchstat {
+	int	num;
+	int	numfailed;
+	int	*failed;		/* line numbers */
+	int	fsize;
+};
+
+static
+void
+batchfail (arg, lineno, ret)
+	void	*arg;
+	int	lineno, ret;
+{
+	struct batchstat	*stat = (struct batchstat*)arg;
+	int					*p;
+
+	SLOGFE (LOG_ERR2, "line %d: command failed: %s", lineno,
+				rerr_getstr3 (ret));
+	if (stat->numfailed >= stat->fsize) {
+		p = realloc (stat->failed, (stat->fsize + 64) * sizeof (int));
+		if (!p) {
+			stat->numfailed++;
+			return;
+		}
+		stat->failed = p;
+		stat->fsize += 64;
+	}
+	stat->failed[stat->numfailed++] = lineno;
+}
+
+#define BATCH_MAXARGS	64
+
+/* runs one command per line of the given file (- for stdin) over one
+ * netlink session. Requests without answer data are pipelined.
+ */
+static
+int
+runbatch (fname)
+	const char	*fname;
+{
+	char					*buf, *ptr, *line, *arg;
+	char					*xargv[BATCH_MAXARGS+2];
+	const char			*cmd;
+	int					argc, lineno, ret, i;
+	struct batchstat	stat;
+
+	if (!strcmp (fname, "-")) {
+		buf = fop_read_fd (0);
+	} else {
+		buf = fop_read_fn (fname);
+	}
+	if (!buf) {
+		SLOGFE (LOG_ERR2, "cannot read batch file >>%s<<", fname);
+		return RERR_SYSTEM;
+	}
+	bzero (&stat, sizeof (stat));
+	ret = ldt_pipeline_start (0, batchfail, &stat);
 	if (!RERR_ISOK(ret)) {
-		SLOGFE (LOG_ERR2, "error executing command >>%s<<: %s", cmd,
+		SLOGFE (LOG_ERR2, "error opening connection to ldt module: %s",
 					rerr_getstr3 (ret));
+		free (buf);
 		return ret;
 	}
-	return 0;
+	xargv[0] = (char*)PROG;
+	ptr = buf;
+	for (lineno=1; ptr; lineno++) {
+		line = top_getline (&ptr, TOP_F_NOSKIPBLANK);
+		if (!line || !*line) continue;
+		for (argc=0; argc < BATCH_MAXARGS; argc++) {
+			arg = top_getquotedfield (&line, " \t", 0);
+			if (!arg) break;
+			xargv[argc+1] = arg;
+		}
+		if (argc == 0) continue;
+		if (line && *line) {
+			batchfail (&stat, lineno, RERR_PARAM);
+			continue;
+		}
+		xargv[argc+1] = NULL;
+		stat.num++;
+		cmd = xargv[1];
+		ldt_pipeline_settag (lineno);
+		ret = runcmd (argc, xargv+1, &cmd);
+		if (!RERR_ISOK(ret)) batchfail (&stat, lineno, ret);
+	}
+	free (buf);
+	ldt_pipeline_stop ();
+	if (stat.numfailed > 0) {
+		printf ("%d of %d commands failed, lines:", stat.numfailed, stat.num);
+		for (i=0; i<stat.numfailed && i<stat.fsize; i++) {
+			printf (" %d", stat.failed[i]);
+		}
+		printf ("\n");
+	}
+	if (stat.failed) free (stat.failed);
+	return stat.numfailed > 0 ? 1 : 0;
 }
 
 